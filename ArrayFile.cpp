@@ -0,0 +1,232 @@
+#include <cstring>
+#include "ArrayFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+  const char magic[8] = { 'c', 'd', 'm', 'a', 't', 'h', 'A', 0 };
+  const uint32_t endianness = 0x01020304;
+  const uint32_t version = 1;
+  const uint32_t alignment = 64;
+
+  static_assert(sizeof(ArrayFileHeader) == 48, "ArrayFileHeader is part of the file format");
+  static_assert(sizeof(ArrayFileEntry) == 64, "ArrayFileEntry is part of the file format");
+
+#ifdef _WIN32
+  int createFile(const char* path) { return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE); }
+  bool writeAll(int fd, const char* p, size_t size)
+  {
+    while (size) {
+      int n = _write(fd, p, unsigned(size < (1u << 30) ? size : (1u << 30)));
+      if (n <= 0) return false;
+      p += n;
+      size -= size_t(n);
+    }
+    return true;
+  }
+  bool seekStart(int fd) { return _lseeki64(fd, 0, SEEK_SET) == 0; }
+  void closeFile(int fd) { _close(fd); }
+#else
+  int createFile(const char* path) { return ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644); }
+  bool writeAll(int fd, const char* p, size_t size)
+  {
+    while (size) {
+      ssize_t n = ::write(fd, p, size);
+      if (n <= 0) return false;
+      p += n;
+      size -= size_t(n);
+    }
+    return true;
+  }
+  bool seekStart(int fd) { return ::lseek(fd, 0, SEEK_SET) == 0; }
+  void closeFile(int fd) { ::close(fd); }
+#endif
+
+  bool fail(ArrayFileWriter& writer, ArrayFileError error)
+  {
+    if (writer.error == ArrayFileError::None) writer.error = error;
+    return false;
+  }
+
+  bool append(ArrayFileWriter& writer, const void* data, size_t size)
+  {
+    if (writer.error != ArrayFileError::None) return false;
+    if (!writeAll(writer.fd, static_cast<const char*>(data), size)) return fail(writer, ArrayFileError::Open);
+    writer.offset += size;
+    return true;
+  }
+
+  bool pad(ArrayFileWriter& writer)
+  {
+    char zeros[alignment] = {};
+    return append(writer, zeros, size_t((alignment - writer.offset % alignment) % alignment));
+  }
+
+  // Check the header and the directory, and point file.entries at the directory.
+  ArrayFileError check(ArrayFile& file)
+  {
+    const ArrayFileHeader& h = *file.header;
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) return ArrayFileError::Format;
+    if (h.endianness != endianness) return ArrayFileError::Endianness;
+    if (h.version > version) return ArrayFileError::Version;
+    if (h.headerSize != sizeof(ArrayFileHeader) || h.entrySize != sizeof(ArrayFileEntry)) return ArrayFileError::Format;
+    if (h.alignment < 8 || (h.alignment & (h.alignment - 1)) != 0) return ArrayFileError::Format;
+    if (h.size != file.size) return ArrayFileError::Truncated;
+    if (h.entries < sizeof(ArrayFileHeader) || h.entries > h.size || (h.size - h.entries) / sizeof(ArrayFileEntry) < h.count) {
+      return ArrayFileError::Truncated;
+    }
+    if (h.entries % alignof(ArrayFileEntry) != 0) return ArrayFileError::Format;
+    file.entries = reinterpret_cast<const ArrayFileEntry*>(file.base + h.entries);
+
+    for (uint32_t i = 0; i < h.count; i++) {
+      const ArrayFileEntry& e = file.entries[i];
+      if (std::memchr(e.name, 0, sizeof(e.name)) == nullptr) return ArrayFileError::Format;
+      if (e.elementSize == 0 || e.elementSize != unsigned(e.components) * e.scalarSize) return ArrayFileError::Format;
+      if (e.offset % h.alignment != 0) return ArrayFileError::Format;
+      if (e.offset < sizeof(ArrayFileHeader) || e.offset > h.entries || (h.entries - e.offset) / e.elementSize < e.count) {
+        return ArrayFileError::Truncated;
+      }
+    }
+    return ArrayFileError::None;
+  }
+
+}
+
+
+ArrayFileError open(ArrayFileWriter& writer, const char* path)
+{
+  writer.fd = createFile(path);
+  writer.offset = 0;
+  writer.entries.clear();
+  writer.error = ArrayFileError::None;
+  if (writer.fd < 0) return writer.error = ArrayFileError::Open;
+
+  // Placeholder, the header is written by close once the directory is known.
+  ArrayFileHeader header = {};
+  append(writer, &header, sizeof(header));
+  return writer.error;
+}
+
+bool beginArray(ArrayFileWriter& writer, const char* name, ArrayShape shape, ArrayScalar scalar, unsigned components, unsigned scalarSize, size_t count)
+{
+  ArrayFileEntry entry = {};
+  if (sizeof(entry.name) <= std::strlen(name)) return fail(writer, ArrayFileError::Format);
+  if (!pad(writer)) return false;
+
+  std::strcpy(entry.name, name);
+  entry.shape = uint8_t(shape);
+  entry.scalar = uint8_t(scalar);
+  entry.components = uint8_t(components);
+  entry.scalarSize = uint8_t(scalarSize);
+  entry.elementSize = components * scalarSize;
+  entry.offset = writer.offset;
+  entry.count = count;
+  writer.entries.push_back(entry);
+  return true;
+}
+
+bool writeBytes(ArrayFileWriter& writer, const void* data, size_t size)
+{
+  return append(writer, data, size);
+}
+
+ArrayFileError close(ArrayFileWriter& writer)
+{
+  if (writer.fd < 0) return writer.error;
+
+  pad(writer);
+  ArrayFileHeader header = {};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.endianness = endianness;
+  header.version = version;
+  header.headerSize = sizeof(ArrayFileHeader);
+  header.entrySize = sizeof(ArrayFileEntry);
+  header.alignment = alignment;
+  header.count = uint32_t(writer.entries.size());
+  header.entries = writer.offset;
+  header.size = writer.offset + sizeof(ArrayFileEntry) * writer.entries.size();
+  append(writer, writer.entries.data(), sizeof(ArrayFileEntry) * writer.entries.size());
+
+  if (writer.error == ArrayFileError::None) {
+    if (!seekStart(writer.fd) || !writeAll(writer.fd, reinterpret_cast<const char*>(&header), sizeof(header))) {
+      writer.error = ArrayFileError::Open;
+    }
+  }
+  closeFile(writer.fd);
+  writer.fd = -1;
+  return writer.error;
+}
+
+ArrayFileError open(ArrayFile& file, const char* path)
+{
+  file = ArrayFile();
+#ifdef _WIN32
+  HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) return ArrayFileError::Open;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size) || uint64_t(size.QuadPart) < sizeof(ArrayFileHeader)) {
+    CloseHandle(handle);
+    return ArrayFileError::Format;
+  }
+  HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(handle);
+  if (mapping == nullptr) return ArrayFileError::Open;
+  void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (base == nullptr) return ArrayFileError::Open;
+  file.size = size_t(size.QuadPart);
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return ArrayFileError::Open;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ArrayFileHeader)) {
+    ::close(fd);
+    return ArrayFileError::Format;
+  }
+  void* base = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) return ArrayFileError::Open;
+  file.size = size_t(st.st_size);
+#endif
+  file.base = static_cast<const char*>(base);
+  file.header = reinterpret_cast<const ArrayFileHeader*>(file.base);
+
+  ArrayFileError error = check(file);
+  if (error != ArrayFileError::None) close(file);
+  return error;
+}
+
+void close(ArrayFile& file)
+{
+  if (file.base) {
+#ifdef _WIN32
+    UnmapViewOfFile(file.base);
+#else
+    munmap(const_cast<char*>(file.base), file.size);
+#endif
+  }
+  file = ArrayFile();
+}
+
+const ArrayFileEntry* findEntry(const ArrayFile& file, const char* name)
+{
+  if (file.header == nullptr) return nullptr;
+  for (uint32_t i = 0; i < file.header->count; i++) {
+    if (std::strcmp(file.entries[i].name, name) == 0) return &file.entries[i];
+  }
+  return nullptr;
+}
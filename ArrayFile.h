@@ -0,0 +1,198 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+#include "LinAlgOps.h"
+
+// Binary container for named arrays of the types in LinAlg.h.
+//
+// The file starts with an ArrayFileHeader, followed by the arrays, each
+// aligned to ArrayFileHeader::alignment bytes, and ends with one
+// ArrayFileEntry per array. All values are in the byte order of the writer.
+// The reader maps the file into memory and hands out pointers into the
+// mapping, so the arrays can be passed straight to the batched operations.
+
+
+/** File header, 48 bytes. */
+struct ArrayFileHeader
+{
+  char magic[8];              // "cdmathA" and a zero byte.
+  uint32_t endianness;        // 0x01020304 in the byte order of the writer.
+  uint32_t version;
+  uint32_t headerSize;        // sizeof(ArrayFileHeader).
+  uint32_t entrySize;         // sizeof(ArrayFileEntry).
+  uint32_t alignment;         // Of the array offsets, a power of two of at least 8.
+  uint32_t count;             // Number of arrays.
+  uint64_t entries;           // Offset of the first entry.
+  uint64_t size;              // Size of the file.
+};
+
+/** Directory entry of one array, 64 bytes. */
+struct ArrayFileEntry
+{
+  char name[40];              // Zero-terminated.
+  uint8_t shape;              // ArrayShape.
+  uint8_t scalar;             // ArrayScalar.
+  uint8_t components;         // Scalars per element.
+  uint8_t scalarSize;
+  uint32_t elementSize;
+  uint64_t offset;
+  uint64_t count;
+};
+
+/** Element types, stored in the file, so never renumber. */
+enum struct ArrayShape : uint8_t
+{
+  Scalar = 0,
+  Vec2 = 1,
+  Vec3 = 2,
+  Vec4 = 3,
+  Quat = 4,
+  DualQuat = 5,
+  BBox2 = 6,
+  BBox3 = 7,
+  Plane = 8,
+  Mat3 = 9,
+  Mat3x4 = 10,
+  Mat4 = 11
+};
+
+/** Scalar types, stored in the file, so never renumber. */
+enum struct ArrayScalar : uint8_t
+{
+  Float = 1,
+  Double = 2,
+  Int32 = 3,
+  UInt32 = 4,
+  Int16 = 5,
+  UInt16 = 6,
+  Half = 7
+};
+
+enum struct ArrayFileError
+{
+  None,
+  Open,           // Could not open, map, create or write the file.
+  Format,         // Not an array file, header or entry sizes differ, or misaligned offsets.
+  Endianness,     // Written on a machine with the other byte order.
+  Version,        // Written by a newer version.
+  Truncated,      // File shorter than the header says, or arrays outside the file.
+  NotFound,       // No array with that name.
+  Layout          // Array has a different element type.
+};
+
+/** Scalar type of an array element. */
+template<typename T> struct ArrayScalarOf;
+template<> struct ArrayScalarOf<float> { static const ArrayScalar value = ArrayScalar::Float; };
+template<> struct ArrayScalarOf<double> { static const ArrayScalar value = ArrayScalar::Double; };
+template<> struct ArrayScalarOf<int32_t> { static const ArrayScalar value = ArrayScalar::Int32; };
+template<> struct ArrayScalarOf<uint32_t> { static const ArrayScalar value = ArrayScalar::UInt32; };
+template<> struct ArrayScalarOf<int16_t> { static const ArrayScalar value = ArrayScalar::Int16; };
+template<> struct ArrayScalarOf<uint16_t> { static const ArrayScalar value = ArrayScalar::UInt16; };
+template<> struct ArrayScalarOf<Half> { static const ArrayScalar value = ArrayScalar::Half; };
+
+/** Shape, scalar type and number of scalars of an array element, arrays of scalars by default. */
+template<typename T> struct ArrayLayout { typedef T Scalar; static const ArrayShape shape = ArrayShape::Scalar; static const unsigned components = 1; };
+template<typename T> struct ArrayLayout<Vec2<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Vec2; static const unsigned components = 2; };
+template<typename T> struct ArrayLayout<Vec3<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Vec3; static const unsigned components = 3; };
+template<typename T> struct ArrayLayout<Vec4<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Vec4; static const unsigned components = 4; };
+template<typename T> struct ArrayLayout<Quat<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Quat; static const unsigned components = 4; };
+template<typename T> struct ArrayLayout<DualQuat<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::DualQuat; static const unsigned components = 8; };
+template<typename T> struct ArrayLayout<BBox2<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::BBox2; static const unsigned components = 4; };
+template<typename T> struct ArrayLayout<BBox3<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::BBox3; static const unsigned components = 6; };
+template<typename T> struct ArrayLayout<Plane<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Plane; static const unsigned components = 4; };
+template<typename T> struct ArrayLayout<Mat3<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Mat3; static const unsigned components = 9; };
+template<typename T> struct ArrayLayout<Mat3x4<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Mat3x4; static const unsigned components = 12; };
+template<typename T> struct ArrayLayout<Mat4<T>> { typedef T Scalar; static const ArrayShape shape = ArrayShape::Mat4; static const unsigned components = 16; };
+
+/** Writes an array file with write(2), one array at a time. */
+struct ArrayFileWriter
+{
+  int fd = -1;
+  uint64_t offset = 0;
+  std::vector<ArrayFileEntry> entries;
+  ArrayFileError error = ArrayFileError::None;
+};
+
+/** Memory-mapped array file. */
+struct ArrayFile
+{
+  const char* base = nullptr;
+  size_t size = 0;
+  const ArrayFileHeader* header = nullptr;
+  const ArrayFileEntry* entries = nullptr;
+};
+
+/** Create or truncate the file at path. */
+ArrayFileError open(ArrayFileWriter& writer, const char* path);
+
+/** Start an array of count elements and return false if the writer has failed, used by writeArray. */
+bool beginArray(ArrayFileWriter& writer, const char* name, ArrayShape shape, ArrayScalar scalar, unsigned components, unsigned scalarSize, size_t count);
+
+/** Append size bytes to the current array and return false if the writer has failed, used by writeArray. */
+bool writeBytes(ArrayFileWriter& writer, const void* data, size_t size);
+
+/** Components of one element for writeArray, scalars are written as is. */
+template<typename S> S* writeElement(S* dst, const S& a) { *dst = a; return dst + 1; }
+template<typename S, typename T> S* writeElement(S* dst, const T& a) { return write(dst, a); }
+
+/** Append an array of N elements named name, at most 39 characters.
+ *
+ * The elements are written component by component with write(). Returns
+ * false if the writer has failed, the error is kept in writer.error. */
+template<typename T>
+bool writeArray(ArrayFileWriter& writer, const char* name, const T* data, size_t N)
+{
+  typedef typename ArrayLayout<T>::Scalar S;
+  const unsigned C = ArrayLayout<T>::components;
+  const size_t block = 16384 / (C * sizeof(S));
+  if (!beginArray(writer, name, ArrayLayout<T>::shape, ArrayScalarOf<S>::value, C, sizeof(S), N)) return false;
+
+  S buffer[C * block];
+  for (size_t i = 0; i < N; i += block) {
+    size_t n = N - i < block ? N - i : block;
+    S* p = buffer;
+    for (size_t j = 0; j < n; j++) p = writeElement(p, data[i + j]);
+    if (!writeBytes(writer, buffer, sizeof(S) * C * n)) return false;
+  }
+  return true;
+}
+
+/** Write the directory and header and close the file. */
+ArrayFileError close(ArrayFileWriter& writer);
+
+/** Map the file at path and check the header and the directory. */
+ArrayFileError open(ArrayFile& file, const char* path);
+
+/** Unmap the file, invalidating all pointers into it. */
+void close(ArrayFile& file);
+
+/** Find the entry of the array named name, or return null. */
+const ArrayFileEntry* findEntry(const ArrayFile& file, const char* name);
+
+/** Point data at the array named name and set N to its length, without copying.
+ *
+ * The data is aligned to ArrayFileHeader::alignment bytes and valid until
+ * the file is closed. Fails with Layout if the array holds other elements
+ * than T. */
+template<typename T>
+ArrayFileError findArray(const T*& data, size_t& N, const ArrayFile& file, const char* name)
+{
+  typedef typename ArrayLayout<T>::Scalar S;
+  static_assert(sizeof(T) == ArrayLayout<T>::components * sizeof(S), "Element type must not be padded");
+
+  const ArrayFileEntry* entry = findEntry(file, name);
+  if (entry == nullptr) return ArrayFileError::NotFound;
+  if (entry->shape != uint8_t(ArrayLayout<T>::shape) ||
+      entry->scalar != uint8_t(ArrayScalarOf<S>::value) ||
+      entry->components != ArrayLayout<T>::components ||
+      entry->scalarSize != sizeof(S) ||
+      entry->elementSize != sizeof(T))
+  {
+    return ArrayFileError::Layout;
+  }
+  data = reinterpret_cast<const T*>(file.base + entry->offset);
+  N = size_t(entry->count);
+  return ArrayFileError::None;
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include "BVH.h"
+#include "LinAlgOps.h"
+#include "Parallel.h"
+
+namespace {
+
+  const unsigned binCount = 16;
+  const unsigned maxLeafSize = 4;
+  const unsigned sahDepth = 32;     // Median splits below this depth, bounds tree depth to 64.
+  const unsigned maxDepth = 64;
+  const uint32_t spawnSize = 1 << 14;
+
+  struct Builder
+  {
+    const BBox3f* bboxes;
+    const Vec3f* centroids;         // min + max, i.e. twice the center.
+    uint32_t* indices;
+  };
+
+  struct Bin
+  {
+    BBox3f bbox;
+    uint32_t count;
+  };
+
+  uint32_t splitMedian(const Builder& b, unsigned axis, uint32_t begin, uint32_t end)
+  {
+    uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(b.indices + begin, b.indices + mid, b.indices + end,
+                     [&](uint32_t i, uint32_t j) { return b.centroids[i][axis] < b.centroids[j][axis]; });
+    return mid;
+  }
+
+  // Returns true and the partition point if the range should be split.
+  bool split(uint32_t& mid, const Builder& b, const BBox3f& cbox, uint32_t begin, uint32_t end, unsigned depth)
+  {
+    // A leaf of up to maxLeafSize boxes is tested with fewer box tests than
+    // visiting its children would take, and needs no nodes below it.
+    uint32_t n = end - begin;
+    if (n <= maxLeafSize) return false;
+
+    Vec3f extent = cbox.max - cbox.min;
+    unsigned longest = extent.x < extent.y ? (extent.y < extent.z ? 2 : 1) : (extent.x < extent.z ? 2 : 0);
+    if (!(0.f < extent[longest])) {
+      // All centroids coincide, no split plane separates them.
+      mid = begin + n / 2;
+      return true;
+    }
+    if (sahDepth <= depth) {
+      mid = splitMedian(b, longest, begin, end);
+      return true;
+    }
+
+    Bin bins[3][binCount];
+    float scale[3];
+    for (unsigned axis = 0; axis < 3; axis++) {
+      for (Bin& bin : bins[axis]) { bin.bbox = makeEmptyBBox3f(); bin.count = 0; }
+      scale[axis] = 0.f < extent[axis] ? (binCount * 0.9999f) / extent[axis] : 0.f;
+    }
+    for (uint32_t i = begin; i < end; i++) {
+      uint32_t ix = b.indices[i];
+      for (unsigned axis = 0; axis < 3; axis++) {
+        unsigned k = unsigned(scale[axis] * (b.centroids[ix][axis] - cbox.min[axis]));
+        if (binCount <= k) k = binCount - 1;
+        bins[axis][k].bbox = engulf(bins[axis][k].bbox, b.bboxes[ix]);
+        bins[axis][k].count++;
+      }
+    }
+
+    float bestCost = FLT_MAX;
+    unsigned bestAxis = 0;
+    unsigned bestBin = 0;
+    for (unsigned axis = 0; axis < 3; axis++) {
+      if (!(0.f < extent[axis])) continue;
+
+      float rightCost[binCount];
+      BBox3f acc = makeEmptyBBox3f();
+      uint32_t count = 0;
+      for (unsigned k = binCount - 1; 0 < k; k--) {
+        acc = engulf(acc, bins[axis][k].bbox);
+        count += bins[axis][k].count;
+        rightCost[k] = count ? count * surfaceArea(acc) : 0.f;
+      }
+
+      acc = makeEmptyBBox3f();
+      count = 0;
+      for (unsigned k = 0; k + 1 < binCount; k++) {
+        acc = engulf(acc, bins[axis][k].bbox);
+        count += bins[axis][k].count;
+        if (count == 0 || count == n) continue;
+        float cost = count * surfaceArea(acc) + rightCost[k + 1];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = k + 1;
+        }
+      }
+    }
+
+    if (bestCost == FLT_MAX) {
+      mid = splitMedian(b, longest, begin, end);
+      return true;
+    }
+
+    float origin = cbox.min[bestAxis];
+    float axisScale = scale[bestAxis];
+    uint32_t* m = std::partition(b.indices + begin, b.indices + end,
+                                 [&](uint32_t ix)
+                                 {
+                                   unsigned k = unsigned(axisScale * (b.centroids[ix][bestAxis] - origin));
+                                   return k < bestBin;
+                                 });
+    mid = uint32_t(m - b.indices);
+    return true;
+  }
+
+  // Append the nodes of a subtree built in a separate node array.
+  void splice(BVHNodeArray& nodes, uint32_t rootIx, const BVHNodeArray& subtree)
+  {
+    uint32_t offset = uint32_t(nodes.size()) - 2;
+    if (nodes[rootIx].count == 0) nodes[rootIx].first += offset;
+    for (size_t k = 2; k < subtree.size(); k++) {
+      nodes.push_back(subtree[k]);
+      if (nodes.back().count == 0) nodes.back().first += offset;
+    }
+  }
+
+  void buildNode(BVHNodeArray& nodes, uint32_t nodeIx, const Builder& b, uint32_t begin, uint32_t end, unsigned depth, unsigned spawnDepth)
+  {
+    BBox3f bbox = makeEmptyBBox3f();
+    BBox3f cbox = makeEmptyBBox3f();
+    for (uint32_t i = begin; i < end; i++) {
+      uint32_t ix = b.indices[i];
+      bbox = engulf(bbox, b.bboxes[ix]);
+      cbox = engulf(cbox, b.centroids[ix]);
+    }
+    nodes[nodeIx].bbox = bbox;
+
+    uint32_t mid;
+    if (!split(mid, b, cbox, begin, end, depth)) {
+      nodes[nodeIx].first = begin;
+      nodes[nodeIx].count = end - begin;
+      return;
+    }
+
+    uint32_t first = uint32_t(nodes.size());
+    nodes[nodeIx].first = first;
+    nodes[nodeIx].count = 0;
+    if (spawnDepth && spawnSize <= end - begin) {
+      // Both halves as one loop of two, the pool runs them on two threads.
+      BVHNodeArray halves[2] = { BVHNodeArray(2), BVHNodeArray(2) };
+      parallelFor(2, 1, 2,
+                  [&](size_t k0, size_t k1)
+                  {
+                    for (size_t k = k0; k < k1; k++) {
+                      buildNode(halves[k], 0, b, k ? mid : begin, k ? end : mid, depth + 1, spawnDepth - 1);
+                    }
+                  });
+      const BVHNodeArray& left = halves[0];
+      const BVHNodeArray& right = halves[1];
+
+      nodes.push_back(left[0]);
+      nodes.push_back(right[0]);
+      splice(nodes, first, left);
+      splice(nodes, first + 1, right);
+    }
+    else {
+      nodes.resize(first + 2);
+      buildNode(nodes, first, b, begin, mid, depth + 1, 0);
+      buildNode(nodes, first + 1, b, mid, end, depth + 1, 0);
+    }
+  }
+
+}
+
+
+void build(BVH& bvh, const BBox3f* bboxes, size_t N, unsigned threads)
+{
+  bvh.nodes.clear();
+  bvh.bboxes.clear();
+  bvh.indices.resize(N);
+  if (N == 0) return;
+
+  std::vector<Vec3f> centroids(N);
+  for (size_t i = 0; i < N; i++) {
+    bvh.indices[i] = uint32_t(i);
+    centroids[i] = bboxes[i].min + bboxes[i].max;
+  }
+
+  if (threads == 0) threads = getThreadCount();
+  unsigned spawnDepth = 0;
+  while ((1u << spawnDepth) < threads) spawnDepth++;
+
+  Builder b;
+  b.bboxes = bboxes;
+  b.centroids = centroids.data();
+  b.indices = bvh.indices.data();
+
+  bvh.nodes.resize(2);
+  bvh.nodes[1].bbox = makeEmptyBBox3f();
+  bvh.nodes[1].first = 0;
+  bvh.nodes[1].count = 0;
+  buildNode(bvh.nodes, 0, b, 0, uint32_t(N), 0, spawnDepth);
+
+  bvh.bboxes.resize(N);
+  for (size_t i = 0; i < N; i++) {
+    bvh.bboxes[i] = bboxes[bvh.indices[i]];
+  }
+}
+
+void findOverlapping(std::vector<uint32_t>& result, const BVH& bvh, const BBox3f& bbox)
+{
+  if (bvh.nodes.empty()) return;
+
+  uint32_t stack[maxDepth + 2];
+  unsigned sp = 0;
+  stack[sp++] = 0;
+  while (sp) {
+    const BVHNode& node = bvh.nodes[stack[--sp]];
+    if (isNotOverlapping(node.bbox, bbox)) continue;
+    if (node.count) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (isOverlapping(bvh.bboxes[i], bbox)) result.push_back(bvh.indices[i]);
+      }
+    }
+    else {
+      stack[sp++] = node.first + 1;
+      stack[sp++] = node.first;
+    }
+  }
+}
+
+void findContaining(std::vector<uint32_t>& result, const BVH& bvh, const Vec3f& p)
+{
+  if (bvh.nodes.empty()) return;
+
+  uint32_t stack[maxDepth + 2];
+  unsigned sp = 0;
+  stack[sp++] = 0;
+  while (sp) {
+    const BVHNode& node = bvh.nodes[stack[--sp]];
+    if (!isInside(node.bbox, p)) continue;
+    if (node.count) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (isInside(bvh.bboxes[i], p)) result.push_back(bvh.indices[i]);
+      }
+    }
+    else {
+      stack[sp++] = node.first + 1;
+      stack[sp++] = node.first;
+    }
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+#include "SoA.h"
+
+/** BVH node, 32 bytes so that a pair of siblings fills a 64-byte cache line.
+ *
+ * Inner nodes have count == 0 and children at first and first + 1, leaves
+ * cover BVH::bboxes[first .. first + count). */
+struct alignas(32) BVHNode
+{
+  BBox3f bbox;
+  uint32_t first;
+  uint32_t count;
+};
+
+/** Node storage, 64-byte aligned so that each sibling pair fills exactly one cache line. */
+typedef std::vector<BVHNode, AlignedAllocator<BVHNode, 64>> BVHNodeArray;
+
+/** Bounding volume hierarchy over an array of bounding boxes.
+ *
+ * The root is node 0, node 1 is padding so that sibling pairs start at even
+ * indices. bboxes holds the input boxes reordered to match the leaves, and
+ * indices maps these back to positions in the input array. */
+struct BVH
+{
+  BVHNodeArray nodes;
+  std::vector<BBox3f> bboxes;
+  std::vector<uint32_t> indices;
+};
+
+/** Build a BVH using binned SAH, with leaves of at most 4 boxes. threads == 0 uses all threads of the pool in Parallel.h. */
+void build(BVH& bvh, const BBox3f* bboxes, size_t N, unsigned threads = 0);
+
+/** Append the input indices of all boxes overlapping bbox to result. */
+void findOverlapping(std::vector<uint32_t>& result, const BVH& bvh, const BBox3f& bbox);
+
+/** Append the input indices of all boxes containing p to result. */
+void findContaining(std::vector<uint32_t>& result, const BVH& bvh, const Vec3f& p);
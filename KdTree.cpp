@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <limits>
+#include "KdTree.h"
+#include "LinAlgBatch.h"
+#include "LinAlgOps.h"
+#include "LinAlgSIMD.h"
+#include "Parallel.h"
+
+namespace {
+
+  const size_t leafSize = 16;
+  const size_t spawnSize = 1 << 15;   // Build subtrees of this many points or more in parallel.
+  const size_t queryGrain = 256;
+
+  template<typename T>
+  struct Entry
+  {
+    Vec3<T> p;
+    uint32_t index;
+  };
+
+  BBox3f makeEmptyBBox(float) { return makeEmptyBBox3f(); }
+  BBox3d makeEmptyBBox(double) { return makeEmptyBBox3d(); }
+
+  template<typename T>
+  void buildNode(KdTree<T>& tree, Entry<T>* e, uint32_t node, size_t begin, size_t end, const BBox3<T>& bbox, unsigned threads)
+  {
+    if (end - begin <= leafSize) return;
+
+    Vec3<T> size = bbox.max - bbox.min;
+    unsigned axis = size.x < size.y ? (size.y < size.z ? 2 : 1) : (size.x < size.z ? 2 : 0);
+    size_t mid = begin + (end - begin) / 2;
+    std::nth_element(e + begin, e + mid, e + end, [axis](const Entry<T>& a, const Entry<T>& b) { return a.p[axis] < b.p[axis]; });
+    T split = e[mid].p[axis];
+    tree.nodes[node].split = split;
+    tree.nodes[node].axis = axis;
+
+    BBox3<T> lo = bbox;
+    BBox3<T> hi = bbox;
+    lo.max[axis] = split;
+    hi.min[axis] = split;
+    if (end - begin < spawnSize) {
+      buildNode(tree, e, 2 * node, begin, mid, lo, threads);
+      buildNode(tree, e, 2 * node + 1, mid, end, hi, threads);
+    }
+    else {
+      parallelFor(2, 1, threads, [&](size_t a, size_t b)
+                  {
+                    for (size_t c = a; c < b; c++) {
+                      if (c == 0) buildNode(tree, e, 2 * node, begin, mid, lo, threads);
+                      else buildNode(tree, e, 2 * node + 1, mid, end, hi, threads);
+                    }
+                  });
+    }
+  }
+
+  template<typename T>
+  void buildTree(KdTree<T>& tree, const Vec3<T>* points, size_t N, unsigned threads)
+  {
+    // Nodes split until at most leafSize points are left, the inner nodes
+    // are at depths below the number of halvings.
+    size_t nodeCount = 1;
+    for (size_t n = N; n > leafSize; n = (n + 1) / 2) nodeCount *= 2;
+    tree.nodes.resize(nodeCount);
+
+    std::vector<Entry<T>> entries(N);
+    parallelFor(N, 1 << 16, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t i = begin; i < end; i++) {
+                    entries[i].p = points[i];
+                    entries[i].index = uint32_t(i);
+                  }
+                });
+    BBox3<T> bbox = engulf(makeEmptyBBox(T()), points, N, threads);
+    buildNode(tree, entries.data(), 1, 0, N, bbox, threads);
+
+    for (unsigned k = 0; k < 3; k++) tree.coords[k].resize(N);
+    tree.indices.resize(N);
+    parallelFor(N, 1 << 16, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t i = begin; i < end; i++) {
+                    for (unsigned k = 0; k < 3; k++) tree.coords[k][i] = entries[i].p[k];
+                    tree.indices[i] = entries[i].index;
+                  }
+                });
+  }
+
+  // Squared distances from p to the points [begin, end) of a leaf, same as distanceSquared.
+  void leafDistances(float* d, const KdTreef& tree, const Vec3f& p, size_t begin, size_t end)
+  {
+    const float* x = tree.coords[0].data() + begin;
+    const float* y = tree.coords[1].data() + begin;
+    const float* z = tree.coords[2].data() + begin;
+    size_t n = end - begin;
+    size_t i = 0;
+#ifdef LINALG_SSE2
+    __m128 px = _mm_set1_ps(p.x);
+    __m128 py = _mm_set1_ps(p.y);
+    __m128 pz = _mm_set1_ps(p.z);
+    for (; i + 4 <= n; i += 4) {
+      __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), px);
+      __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), py);
+      __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), pz);
+      _mm_storeu_ps(d + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    }
+#endif
+    for (; i < n; i++) {
+      d[i] = distanceSquared(makeVec3f(x[i], y[i], z[i]), p);
+    }
+  }
+
+  void leafDistances(double* d, const KdTreed& tree, const Vec3d& p, size_t begin, size_t end)
+  {
+    const double* x = tree.coords[0].data() + begin;
+    const double* y = tree.coords[1].data() + begin;
+    const double* z = tree.coords[2].data() + begin;
+    size_t n = end - begin;
+    size_t i = 0;
+#ifdef LINALG_SSE2
+    __m128d px = _mm_set1_pd(p.x);
+    __m128d py = _mm_set1_pd(p.y);
+    __m128d pz = _mm_set1_pd(p.z);
+    for (; i + 2 <= n; i += 2) {
+      __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i), px);
+      __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i), py);
+      __m128d dz = _mm_sub_pd(_mm_loadu_pd(z + i), pz);
+      _mm_storeu_pd(d + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz)));
+    }
+#endif
+    for (; i < n; i++) {
+      d[i] = distanceSquared(makeVec3d(x[i], y[i], z[i]), p);
+    }
+  }
+
+  // The k nearest points found so far, as a max-heap on (distance, index).
+  template<typename T>
+  struct Nearest
+  {
+    uint32_t* indices;
+    T* d;
+    size_t k;
+    size_t count;
+
+    bool less(size_t a, size_t b) const { return d[a] < d[b] || (d[a] == d[b] && indices[a] < indices[b]); }
+    void swap(size_t a, size_t b) { std::swap(d[a], d[b]); std::swap(indices[a], indices[b]); }
+
+    T worst() const { return count < k ? std::numeric_limits<T>::infinity() : d[0]; }
+
+    void siftDown(size_t i, size_t n)
+    {
+      for (size_t c = 2 * i + 1; c < n; i = c, c = 2 * i + 1) {
+        if (c + 1 < n && less(c, c + 1)) c++;
+        if (!less(i, c)) break;
+        swap(i, c);
+      }
+    }
+
+    void push(T distance, uint32_t index)
+    {
+      if (count < k) {
+        size_t i = count++;
+        d[i] = distance;
+        indices[i] = index;
+        for (; i && less((i - 1) / 2, i); i = (i - 1) / 2) swap(i, (i - 1) / 2);
+      }
+      else if (distance < d[0] || (distance == d[0] && index < indices[0])) {
+        d[0] = distance;
+        indices[0] = index;
+        siftDown(0, count);
+      }
+    }
+
+    // Heap sort into ascending order.
+    void sort()
+    {
+      for (size_t n = count; n > 1; n--) {
+        swap(0, n - 1);
+        siftDown(0, n - 1);
+      }
+    }
+  };
+
+  // Points on the far side of a split are at least |p[axis] - split| away,
+  // also after rounding, so subtrees are skipped when that is too far.
+  template<typename T>
+  void nearest(Nearest<T>& h, const KdTree<T>& tree, const Vec3<T>& p, uint32_t node, size_t begin, size_t end)
+  {
+    if (end - begin <= leafSize) {
+      T d[leafSize];
+      leafDistances(d, tree, p, begin, end);
+      for (size_t i = begin; i < end; i++) {
+        if (d[i - begin] <= h.worst()) h.push(d[i - begin], tree.indices[i]);
+      }
+      return;
+    }
+
+    const KdNode<T>& n = tree.nodes[node];
+    size_t mid = begin + (end - begin) / 2;
+    T d = p[n.axis] - n.split;
+    if (d < T(0)) {
+      nearest(h, tree, p, 2 * node, begin, mid);
+      if (d * d <= h.worst()) nearest(h, tree, p, 2 * node + 1, mid, end);
+    }
+    else {
+      nearest(h, tree, p, 2 * node + 1, mid, end);
+      if (d * d <= h.worst()) nearest(h, tree, p, 2 * node, begin, mid);
+    }
+  }
+
+  template<typename T>
+  void withinRadius(std::vector<uint32_t>& result, const KdTree<T>& tree, const Vec3<T>& p, T r2, uint32_t node, size_t begin, size_t end)
+  {
+    if (end - begin <= leafSize) {
+      T d[leafSize];
+      leafDistances(d, tree, p, begin, end);
+      for (size_t i = begin; i < end; i++) {
+        if (d[i - begin] <= r2) result.push_back(tree.indices[i]);
+      }
+      return;
+    }
+
+    const KdNode<T>& n = tree.nodes[node];
+    size_t mid = begin + (end - begin) / 2;
+    T d = p[n.axis] - n.split;
+    if (d < T(0) || d * d <= r2) withinRadius(result, tree, p, r2, 2 * node, begin, mid);
+    if (T(0) <= d || d * d <= r2) withinRadius(result, tree, p, r2, 2 * node + 1, mid, end);
+  }
+
+  template<typename T>
+  size_t findNearestT(uint32_t* indices, T* distancesSquared, const KdTree<T>& tree, const Vec3<T>& p, size_t k)
+  {
+    Nearest<T> h = { indices, distancesSquared, k, 0 };
+    if (k && !tree.indices.empty()) nearest(h, tree, p, 1, 0, tree.indices.size());
+    h.sort();
+    return h.count;
+  }
+
+  template<typename T>
+  void findNearestBatch(uint32_t* indices, T* distancesSquared, const KdTree<T>& tree, const Vec3<T>* p, size_t Q, size_t k, unsigned threads)
+  {
+    parallelFor(Q, queryGrain, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t q = begin; q < end; q++) {
+                    uint32_t* ix = indices + q * k;
+                    T* d = distancesSquared + q * k;
+                    for (size_t j = findNearestT(ix, d, tree, p[q], k); j < k; j++) {
+                      ix[j] = ~0u;
+                      d[j] = std::numeric_limits<T>::infinity();
+                    }
+                  }
+                });
+  }
+
+  template<typename T>
+  void findWithinRadiusT(std::vector<uint32_t>& result, const KdTree<T>& tree, const Vec3<T>& p, T radius)
+  {
+    if (!tree.indices.empty()) withinRadius(result, tree, p, radius * radius, 1, 0, tree.indices.size());
+  }
+
+  // Each chunk of queries collects its results on its own, then they are
+  // concatenated in order.
+  template<typename T>
+  void findWithinRadiusBatch(std::vector<uint32_t>& result, std::vector<size_t>& start, const KdTree<T>& tree, const Vec3<T>* p, size_t Q, T radius, unsigned threads)
+  {
+    size_t chunks = (Q + queryGrain - 1) / queryGrain;
+    std::vector<std::vector<uint32_t>> found(chunks);
+    start.assign(Q + 1, 0);
+    parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t c = begin; c < end; c++) {
+                    for (size_t q = c * queryGrain; q < Q && q < (c + 1) * queryGrain; q++) {
+                      size_t before = found[c].size();
+                      findWithinRadiusT(found[c], tree, p[q], radius);
+                      start[q + 1] = found[c].size() - before;
+                    }
+                  }
+                });
+
+    for (size_t q = 0; q < Q; q++) start[q + 1] += start[q];
+    result.resize(start[Q]);
+    parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t c = begin; c < end; c++) {
+                    std::copy(found[c].begin(), found[c].end(), result.begin() + start[c * queryGrain]);
+                  }
+                });
+  }
+
+}
+
+
+void build(KdTreef& tree, const Vec3f* points, size_t N, unsigned threads) { buildTree(tree, points, N, threads); }
+void build(KdTreed& tree, const Vec3d* points, size_t N, unsigned threads) { buildTree(tree, points, N, threads); }
+
+size_t findNearest(uint32_t* indices, float* distancesSquared, const KdTreef& tree, const Vec3f& p, size_t k)
+{
+  return findNearestT(indices, distancesSquared, tree, p, k);
+}
+
+size_t findNearest(uint32_t* indices, double* distancesSquared, const KdTreed& tree, const Vec3d& p, size_t k)
+{
+  return findNearestT(indices, distancesSquared, tree, p, k);
+}
+
+void findNearest(uint32_t* indices, float* distancesSquared, const KdTreef& tree, const Vec3f* p, size_t Q, size_t k, unsigned threads)
+{
+  findNearestBatch(indices, distancesSquared, tree, p, Q, k, threads);
+}
+
+void findNearest(uint32_t* indices, double* distancesSquared, const KdTreed& tree, const Vec3d* p, size_t Q, size_t k, unsigned threads)
+{
+  findNearestBatch(indices, distancesSquared, tree, p, Q, k, threads);
+}
+
+void findWithinRadius(std::vector<uint32_t>& result, const KdTreef& tree, const Vec3f& p, float radius)
+{
+  findWithinRadiusT(result, tree, p, radius);
+}
+
+void findWithinRadius(std::vector<uint32_t>& result, const KdTreed& tree, const Vec3d& p, double radius)
+{
+  findWithinRadiusT(result, tree, p, radius);
+}
+
+void findWithinRadius(std::vector<uint32_t>& result, std::vector<size_t>& start, const KdTreef& tree, const Vec3f* p, size_t Q, float radius, unsigned threads)
+{
+  findWithinRadiusBatch(result, start, tree, p, Q, radius, threads);
+}
+
+void findWithinRadius(std::vector<uint32_t>& result, std::vector<size_t>& start, const KdTreed& tree, const Vec3d* p, size_t Q, double radius, unsigned threads)
+{
+  findWithinRadiusBatch(result, start, tree, p, Q, radius, threads);
+}
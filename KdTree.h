@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+
+/** Split plane of an inner k-d tree node. */
+template<typename T>
+struct KdNode
+{
+  T split;
+  uint32_t axis;
+};
+
+/** k-d tree over points, for nearest neighbor and radius queries.
+ *
+ * The tree is implicit: the root is node 1 and the children of node i are
+ * 2i and 2i + 1. A node covering points [begin, end) splits them at
+ * begin + (end - begin) / 2, down to leaves of at most 16 points, so only
+ * the split planes are stored. The points are reordered into leaves, one
+ * array per coordinate, and indices maps them back to the input. This is
+ * about 4 * sizeof(T) + 4 bytes per point, plus one node per 8 points or less. */
+template<typename T>
+struct KdTree
+{
+  std::vector<KdNode<T>> nodes;       // nodes[0] is unused.
+  std::vector<T> coords[3];
+  std::vector<uint32_t> indices;
+};
+typedef KdTree<float> KdTreef;
+typedef KdTree<double> KdTreed;
+
+/** Build a tree over N points, splitting at the median along the longest side. threads as in LinAlgBatch.h. */
+void build(KdTreef& tree, const Vec3f* points, size_t N, unsigned threads = 0);
+void build(KdTreed& tree, const Vec3d* points, size_t N, unsigned threads = 0);
+
+/** Find the k points nearest to p, closest first and ties by input index.
+ *
+ * Writes their input indices and squared distances to indices[0 .. k) and
+ * distancesSquared[0 .. k) and returns their count, which is less than k if
+ * the tree has fewer points. */
+size_t findNearest(uint32_t* indices, float* distancesSquared, const KdTreef& tree, const Vec3f& p, size_t k);
+size_t findNearest(uint32_t* indices, double* distancesSquared, const KdTreed& tree, const Vec3d& p, size_t k);
+
+/** findNearest for Q points, query q writes indices[q * k .. (q + 1) * k) and the same range of distancesSquared.
+ *
+ * Unused slots, when the tree has fewer than k points, get index ~0u and an
+ * infinite distance. */
+void findNearest(uint32_t* indices, float* distancesSquared, const KdTreef& tree, const Vec3f* p, size_t Q, size_t k, unsigned threads = 0);
+void findNearest(uint32_t* indices, double* distancesSquared, const KdTreed& tree, const Vec3d* p, size_t Q, size_t k, unsigned threads = 0);
+
+/** Append the input indices of all points at most radius from p to result. */
+void findWithinRadius(std::vector<uint32_t>& result, const KdTreef& tree, const Vec3f& p, float radius);
+void findWithinRadius(std::vector<uint32_t>& result, const KdTreed& tree, const Vec3d& p, double radius);
+
+/** findWithinRadius for Q points, the points found for query q are result[start[q] .. start[q + 1]). */
+void findWithinRadius(std::vector<uint32_t>& result, std::vector<size_t>& start, const KdTreef& tree, const Vec3f* p, size_t Q, float radius, unsigned threads = 0);
+void findWithinRadius(std::vector<uint32_t>& result, std::vector<size_t>& start, const KdTreed& tree, const Vec3d* p, size_t Q, double radius, unsigned threads = 0);
@@ -1,7 +1,31 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <cfloat>
 
+// The types are usable in constant expressions, and so are the functions on
+// them here and in LinAlgOps.h that need neither sqrt nor SIMD, so that tables
+// of vectors, matrices and boxes can be computed at compile time.
+//
+// A constant expression may only read the union member that was last
+// written. The make functions write the named members, x, y, z, w, min, max,
+// c0r0 and so on, and constexpr code reads only those, operator[] and
+// column(). data and cols are for runtime code. operator[] relies on the
+// builtin behind std::is_constant_evaluated, which GCC 9, Clang 9 and
+// MSVC 19.25 also offer in C++17.
+#if defined(__clang__)
+#  if __has_builtin(__builtin_is_constant_evaluated)
+#    define LINALG_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#    define LINALG_HAS_CONSTANT_EVALUATED
+#  endif
+#elif (defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#  define LINALG_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#  define LINALG_HAS_CONSTANT_EVALUATED
+#endif
+#ifndef LINALG_CONSTANT_EVALUATED
+#  define LINALG_CONSTANT_EVALUATED() false
+#endif
+
 /** 2D vector */
 template<typename T>
 struct Vec2
@@ -13,15 +37,15 @@ struct Vec2
     };
     T data[2];
   };
-  T& operator[](size_t i) { return data[i]; }
-  const T& operator[](size_t i) const { return data[i]; }
+  constexpr T& operator[](size_t i) { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : y) : data[i]; }
+  constexpr const T& operator[](size_t i) const { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : y) : data[i]; }
 };
 typedef Vec2<float>    Vec2f;
 typedef Vec2<double>   Vec2d;
 typedef Vec2<int>      Vec2i;
 typedef Vec2<unsigned> Vec2u;
-template<typename T> Vec2<T> makeVec2(T x, T y) {   Vec2<T> u; u.x = x;    u.y = y;    return u; }
-template<typename T> Vec2<T> makeVec2(const T* p) { Vec2<T> u; u.x = p[0]; u.y = p[1]; return u; }
+template<typename T> constexpr Vec2<T> makeVec2(T x, T y) {   Vec2<T> u{}; u.x = x;    u.y = y;    return u; }
+template<typename T> constexpr Vec2<T> makeVec2(const T* p) { Vec2<T> u{}; u.x = p[0]; u.y = p[1]; return u; }
 
 /** 3D vector */
 template<typename T>
@@ -35,15 +59,15 @@ struct Vec3
     };
     T data[3];
   };
-  T& operator[](size_t i) { return data[i]; }
-  const T& operator[](size_t i) const { return data[i]; }
+  constexpr T& operator[](size_t i) { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : i == 1 ? y : z) : data[i]; }
+  constexpr const T& operator[](size_t i) const { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : i == 1 ? y : z) : data[i]; }
 };
 typedef Vec3<float>    Vec3f;
 typedef Vec3<double>   Vec3d;
 typedef Vec3<int>      Vec3i;
 typedef Vec3<unsigned> Vec3u;
-template<typename T> Vec3<T> makeVec3(T x, T y, T z) { Vec3<T> u; u.x = x;    u.y = y;    u.z = z;    return u; }
-template<typename T> Vec3<T> makeVec3(const T* p) {    Vec3<T> u; u.x = p[0]; u.y = p[1]; u.z = p[2]; return u; }
+template<typename T> constexpr Vec3<T> makeVec3(T x, T y, T z) { Vec3<T> u{}; u.x = x;    u.y = y;    u.z = z;    return u; }
+template<typename T> constexpr Vec3<T> makeVec3(const T* p) {    Vec3<T> u{}; u.x = p[0]; u.y = p[1]; u.z = p[2]; return u; }
 
 /** 4D vector */
 template<typename T>
@@ -58,15 +82,65 @@ struct Vec4
     };
     T data[4];
   };
-  T& operator[](size_t i) { return data[i]; }
-  const T& operator[](size_t i) const { return data[i]; }
+  constexpr T& operator[](size_t i) { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : i == 1 ? y : i == 2 ? z : w) : data[i]; }
+  constexpr const T& operator[](size_t i) const { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : i == 1 ? y : i == 2 ? z : w) : data[i]; }
 };
 typedef Vec4<float>    Vec4f;
 typedef Vec4<double>   Vec4d;
 typedef Vec4<int>      Vec4i;
 typedef Vec4<unsigned> Vec4u;
-template<typename T> Vec4<T> makeVec4(T x, T y, T z, T w) { Vec4<T> u; u.x = x;    u.y = y;    u.z = z;    u.w = w;    return u; }
-template<typename T> Vec4<T> makeVec4(const T* p) {         Vec4<T> u; u.x = p[0]; u.y = p[1]; u.z = p[2]; u.w = p[3]; return u; }
+template<typename T> constexpr Vec4<T> makeVec4(T x, T y, T z, T w) { Vec4<T> u{}; u.x = x;    u.y = y;    u.z = z;    u.w = w;    return u; }
+template<typename T> constexpr Vec4<T> makeVec4(const T* p) {         Vec4<T> u{}; u.x = p[0]; u.y = p[1]; u.z = p[2]; u.w = p[3]; return u; }
+
+/** IEEE 754 half precision float, for storage only */
+struct Half
+{
+  uint16_t bits;
+};
+
+/** Compact storage formats, see LinAlgOps.h for conversions */
+typedef Vec2<Half>     Vec2h;
+typedef Vec3<Half>     Vec3h;
+typedef Vec4<Half>     Vec4h;
+typedef Vec3<uint16_t> Vec3us;   // Position quantized relative to a BBox3f.
+typedef Vec2<int16_t>  Vec2s;    // Octahedral encoded unit vector.
+
+/** Quaternion, w is the real part */
+template<typename T>
+struct Quat
+{
+  union {
+    struct {
+      T x;
+      T y;
+      T z;
+      T w;
+    };
+    T data[4];
+  };
+  constexpr T& operator[](size_t i) { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : i == 1 ? y : i == 2 ? z : w) : data[i]; }
+  constexpr const T& operator[](size_t i) const { return LINALG_CONSTANT_EVALUATED() ? (i == 0 ? x : i == 1 ? y : i == 2 ? z : w) : data[i]; }
+};
+typedef Quat<float>  Quatf;
+typedef Quat<double> Quatd;
+template<typename T> constexpr Quat<T> makeQuat(T x, T y, T z, T w) { Quat<T> q{}; q.x = x;    q.y = y;    q.z = z;    q.w = w;    return q; }
+template<typename T> constexpr Quat<T> makeQuat(const T* p) {         Quat<T> q{}; q.x = p[0]; q.y = p[1]; q.z = p[2]; q.w = p[3]; return q; }
+
+/** Dual quaternion, real is the rotation and dual is half the translation times the rotation */
+template<typename T>
+struct DualQuat
+{
+  union {
+    struct {
+      Quat<T> real;
+      Quat<T> dual;
+    };
+    T data[8];
+  };
+};
+typedef DualQuat<float>  DualQuatf;
+typedef DualQuat<double> DualQuatd;
+template<typename T> constexpr DualQuat<T> makeDualQuat(const Quat<T>& real, const Quat<T>& dual) { DualQuat<T> d{}; d.real = real; d.dual = dual; return d; }
 
 /** 2D bounding box */
 template<typename T>
@@ -82,7 +156,7 @@ struct BBox2
 };
 typedef BBox2<float> BBox2f;
 typedef BBox2<double> BBox2d;
-template<typename T> BBox2<T> makeBBox(const Vec2<T>& min, const Vec2<T>& max) { BBox2<T> box; box.min = min; box.max = max; return box; }
+template<typename T> constexpr BBox2<T> makeBBox(const Vec2<T>& min, const Vec2<T>& max) { BBox2<T> box{}; box.min = min; box.max = max; return box; }
 
 /** 3D bounding box */
 template<typename T>
@@ -99,111 +173,178 @@ struct BBox3
 };
 typedef BBox3<float> BBox3f;
 typedef BBox3<double> BBox3d;
-template<typename T> BBox3<T> makeBBox(const Vec3<T>& min, const Vec3<T>& max) { BBox3<T> box; box.min = min; box.max = max; return box; }
+template<typename T> constexpr BBox3<T> makeBBox(const Vec3<T>& min, const Vec3<T>& max) { BBox3<T> box{}; box.min = min; box.max = max; return box; }
+
+/** Precision tags for length, distance and normalize, so that generic code can take the precision as a parameter.
+ *
+ * ExactPrecision is the same as leaving out the tag, with correctly rounded sqrt and divide.
+ * FastPrecision uses rsqrt(x, FastPrecision), for float only, and gives 0 or a zero vector for zero vectors. */
+struct ExactPrecision {};
+struct FastPrecision {};
+
+/** Plane of points p where dot(n, p) + d = 0 */
+template<typename T>
+struct Plane
+{
+  union {
+    struct {
+      Vec3<T> n;
+      T d;
+    };
+    T data[4];
+  };
+};
+typedef Plane<float> Planef;
+typedef Plane<double> Planed;
+template<typename T> constexpr Plane<T> makePlane(const Vec3<T>& n, T d) { Plane<T> p{}; p.n = n; p.d = d; return p; }
+
+/** View frustum as six planes with normals pointing inwards, ordered left, right, bottom, top, near, far */
+template<typename T>
+struct Frustum
+{
+  Plane<T> planes[6];
+};
+typedef Frustum<float> Frustumf;
+typedef Frustum<double> Frustumd;
+
+/** Result of classifying a volume against another */
+enum struct Containment
+{
+  Outside,
+  Intersecting,
+  Inside
+};
+
+/** 3D ray, invDir is the componentwise reciprocal of dir */
+template<typename T>
+struct Ray3
+{
+  Vec3<T> origin;
+  Vec3<T> dir;
+  Vec3<T> invDir;
+};
+typedef Ray3<float> Ray3f;
+typedef Ray3<double> Ray3d;
+template<typename T> constexpr Ray3<T> makeRay(const Vec3<T>& origin, const Vec3<T>& dir)
+{
+  Ray3<T> ray{};
+  ray.origin = origin;
+  ray.dir = dir;
+  ray.invDir = makeVec3(T(1) / dir.x, T(1) / dir.y, T(1) / dir.z);
+  return ray;
+}
 
 template<typename T>
 struct Mat3
 {
   union {
     struct {
-      float c0r0;
-      float c0r1;
-      float c0r2;
-      float c1r0;
-      float c1r1;
-      float c1r2;
-      float c2r0;
-      float c2r1;
-      float c2r2;
+      T c0r0;
+      T c0r1;
+      T c0r2;
+      T c1r0;
+      T c1r1;
+      T c1r2;
+      T c2r0;
+      T c2r1;
+      T c2r2;
     };
     Vec3<T> cols[3];
-    float data[3 * 3];
+    T data[3 * 3];
   };
 };
 typedef Mat3<float> Mat3f;
 typedef Mat3<double> Mat3d;
 
 template<typename T>
-Mat3<T> makeMat3(const Vec3<T>& c0, const Vec3<T>& c1, const Vec3<T>& c2)
+constexpr Mat3<T> makeMat3(const Vec3<T>& c0, const Vec3<T>& c1, const Vec3<T>& c2)
 {
-  Mat3<T> m;
-  m.cols[0] = c0;
-  m.cols[1] = c1;
-  m.cols[2] = c2;
+  Mat3<T> m{};
+  m.c0r0 = c0.x; m.c0r1 = c0.y; m.c0r2 = c0.z;
+  m.c1r0 = c1.x; m.c1r1 = c1.y; m.c1r2 = c1.z;
+  m.c2r0 = c2.x; m.c2r1 = c2.y; m.c2r2 = c2.z;
   return m;
 }
 
 template<typename T>
-Mat3<T> makeMat3(const T* p)
+constexpr Mat3<T> makeMat3(const T* p)
 {
-  Mat3<T> m;
-  for(size_t i=0; i<3*3; i++) { m.data[i] = p[i]; }
-  return m;
+  return makeMat3(makeVec3(p), makeVec3(p + 3), makeVec3(p + 6));
 }
 
 template<typename T>
-Mat3<T> makeMatRowMajor3(T c0r0, T c1r0, T c2r0,
+constexpr Mat3<T> makeMatRowMajor3(T c0r0, T c1r0, T c2r0,
                          T c0r1, T c1r1, T c2r1,
                          T c0r2, T c1r2, T c2r2)
 {
-  Mat3<T> m;
+  Mat3<T> m{};
   m.c0r0 = c0r0; m.c0r1 = c0r1; m.c0r2 = c0r2;
   m.c1r0 = c1r0; m.c1r1 = c1r1; m.c1r2 = c1r2;
   m.c2r0 = c2r0; m.c2r1 = c2r1; m.c2r2 = c2r2;
   return m;
 }
 
+/** Column i of M, also in constant expressions where cols cannot be read. */
+template<typename T>
+constexpr Vec3<T> column(const Mat3<T>& M, size_t i)
+{
+  if (LINALG_CONSTANT_EVALUATED()) {
+    return i == 0 ? makeVec3(M.c0r0, M.c0r1, M.c0r2) :
+           i == 1 ? makeVec3(M.c1r0, M.c1r1, M.c1r2) :
+                    makeVec3(M.c2r0, M.c2r1, M.c2r2);
+  }
+  return M.cols[i];
+}
+
 
 template<typename T>
 struct Mat3x4
 {
   union {
     struct {
-      float c0r0;
-      float c0r1;
-      float c0r2;
-      float c1r0;
-      float c1r1;
-      float c1r2;
-      float c2r0;
-      float c2r1;
-      float c2r2;
-      float c3r0;
-      float c3r1;
-      float c3r2;
+      T c0r0;
+      T c0r1;
+      T c0r2;
+      T c1r0;
+      T c1r1;
+      T c1r2;
+      T c2r0;
+      T c2r1;
+      T c2r2;
+      T c3r0;
+      T c3r1;
+      T c3r2;
     };
-    Vec3f cols[4];
-    float data[4 * 3];
+    Vec3<T> cols[4];
+    T data[4 * 3];
   };
 };
 typedef Mat3x4<float> Mat3x4f;
 typedef Mat3x4<double> Mat3x4d;
 
 template<typename T>
-Mat3x4<T> makeMat3x4(const Vec3<T>& c0, const Vec3<T>& c1, const Vec3<T>& c2, const Vec3<T>& c3)
+constexpr Mat3x4<T> makeMat3x4(const Vec3<T>& c0, const Vec3<T>& c1, const Vec3<T>& c2, const Vec3<T>& c3)
 {
-  Mat3<T> m;
-  m.cols[0] = c0;
-  m.cols[1] = c1;
-  m.cols[2] = c2;
-  m.cols[3] = c3;
+  Mat3x4<T> m{};
+  m.c0r0 = c0.x; m.c0r1 = c0.y; m.c0r2 = c0.z;
+  m.c1r0 = c1.x; m.c1r1 = c1.y; m.c1r2 = c1.z;
+  m.c2r0 = c2.x; m.c2r1 = c2.y; m.c2r2 = c2.z;
+  m.c3r0 = c3.x; m.c3r1 = c3.y; m.c3r2 = c3.z;
   return m;
 }
 
 template<typename T>
-Mat3x4<T> makeMat3x4(const T* p)
+constexpr Mat3x4<T> makeMat3x4(const T* p)
 {
-  Mat3<T> m;
-  for(size_t i=0; i<4*3; i++) { m.data[i] = p[i]; }
-  return m;
+  return makeMat3x4(makeVec3(p), makeVec3(p + 3), makeVec3(p + 6), makeVec3(p + 9));
 }
 
 template<typename T>
-Mat3x4<T> makeMatRowMajor3x4(T c0r0, T c1r0, T c2r0, T c3r0,
+constexpr Mat3x4<T> makeMatRowMajor3x4(T c0r0, T c1r0, T c2r0, T c3r0,
                              T c0r1, T c1r1, T c2r1, T c3r1,
                              T c0r2, T c1r2, T c2r2, T c3r2)
 {
-  Mat3<T> m;
+  Mat3x4<T> m{};
   m.c0r0 = c0r0; m.c0r1 = c0r1; m.c0r2 = c0r2;
   m.c1r0 = c1r0; m.c1r1 = c1r1; m.c1r2 = c1r2;
   m.c2r0 = c2r0; m.c2r1 = c2r1; m.c2r2 = c2r2;
@@ -211,93 +352,241 @@ Mat3x4<T> makeMatRowMajor3x4(T c0r0, T c1r0, T c2r0, T c3r0,
   return m;
 }
 
+template<typename T>
+constexpr Vec3<T> column(const Mat3x4<T>& M, size_t i)
+{
+  if (LINALG_CONSTANT_EVALUATED()) {
+    return i == 0 ? makeVec3(M.c0r0, M.c0r1, M.c0r2) :
+           i == 1 ? makeVec3(M.c1r0, M.c1r1, M.c1r2) :
+           i == 2 ? makeVec3(M.c2r0, M.c2r1, M.c2r2) :
+                    makeVec3(M.c3r0, M.c3r1, M.c3r2);
+  }
+  return M.cols[i];
+}
+
+/** 4x4 matrix, column-major like Mat3 and Mat3x4.
+ *
+ * Columns are 4 elements apart while Mat3x4 columns are 3 elements apart, so
+ * the two cannot be reinterpreted as each other, use makeMat4 and makeMat3x4. */
+template<typename T>
+struct Mat4
+{
+  union {
+    struct {
+      T c0r0;
+      T c0r1;
+      T c0r2;
+      T c0r3;
+      T c1r0;
+      T c1r1;
+      T c1r2;
+      T c1r3;
+      T c2r0;
+      T c2r1;
+      T c2r2;
+      T c2r3;
+      T c3r0;
+      T c3r1;
+      T c3r2;
+      T c3r3;
+    };
+    Vec4<T> cols[4];
+    T data[4 * 4];
+  };
+};
+typedef Mat4<float> Mat4f;
+typedef Mat4<double> Mat4d;
+
+template<typename T>
+constexpr Mat4<T> makeMat4(const Vec4<T>& c0, const Vec4<T>& c1, const Vec4<T>& c2, const Vec4<T>& c3)
+{
+  Mat4<T> m{};
+  m.c0r0 = c0.x; m.c0r1 = c0.y; m.c0r2 = c0.z; m.c0r3 = c0.w;
+  m.c1r0 = c1.x; m.c1r1 = c1.y; m.c1r2 = c1.z; m.c1r3 = c1.w;
+  m.c2r0 = c2.x; m.c2r1 = c2.y; m.c2r2 = c2.z; m.c2r3 = c2.w;
+  m.c3r0 = c3.x; m.c3r1 = c3.y; m.c3r2 = c3.z; m.c3r3 = c3.w;
+  return m;
+}
+
+template<typename T>
+constexpr Mat4<T> makeMat4(const T* p)
+{
+  return makeMat4(makeVec4(p), makeVec4(p + 4), makeVec4(p + 8), makeVec4(p + 12));
+}
+
+template<typename T>
+constexpr Mat4<T> makeMat4(const Mat3x4<T>& a)
+{
+  return makeMat4(makeVec4(a.c0r0, a.c0r1, a.c0r2, T(0)),
+                  makeVec4(a.c1r0, a.c1r1, a.c1r2, T(0)),
+                  makeVec4(a.c2r0, a.c2r1, a.c2r2, T(0)),
+                  makeVec4(a.c3r0, a.c3r1, a.c3r2, T(1)));
+}
+
+template<typename T>
+constexpr Mat3x4<T> makeMat3x4(const Mat4<T>& a)
+{
+  return makeMat3x4(makeVec3(a.c0r0, a.c0r1, a.c0r2),
+                    makeVec3(a.c1r0, a.c1r1, a.c1r2),
+                    makeVec3(a.c2r0, a.c2r1, a.c2r2),
+                    makeVec3(a.c3r0, a.c3r1, a.c3r2));
+}
+
+template<typename T>
+constexpr Mat4<T> makeMatRowMajor4(T c0r0, T c1r0, T c2r0, T c3r0,
+                         T c0r1, T c1r1, T c2r1, T c3r1,
+                         T c0r2, T c1r2, T c2r2, T c3r2,
+                         T c0r3, T c1r3, T c2r3, T c3r3)
+{
+  Mat4<T> m{};
+  m.c0r0 = c0r0; m.c0r1 = c0r1; m.c0r2 = c0r2; m.c0r3 = c0r3;
+  m.c1r0 = c1r0; m.c1r1 = c1r1; m.c1r2 = c1r2; m.c1r3 = c1r3;
+  m.c2r0 = c2r0; m.c2r1 = c2r1; m.c2r2 = c2r2; m.c2r3 = c2r3;
+  m.c3r0 = c3r0; m.c3r1 = c3r1; m.c3r2 = c3r2; m.c3r3 = c3r3;
+  return m;
+}
+
+template<typename T>
+constexpr Vec4<T> column(const Mat4<T>& M, size_t i)
+{
+  if (LINALG_CONSTANT_EVALUATED()) {
+    return i == 0 ? makeVec4(M.c0r0, M.c0r1, M.c0r2, M.c0r3) :
+           i == 1 ? makeVec4(M.c1r0, M.c1r1, M.c1r2, M.c1r3) :
+           i == 2 ? makeVec4(M.c2r0, M.c2r1, M.c2r2, M.c2r3) :
+                    makeVec4(M.c3r0, M.c3r1, M.c3r2, M.c3r3);
+  }
+  return M.cols[i];
+}
+
+
+
+constexpr Vec2f makeVec2f(float x)                { return makeVec2(x, x); }
+constexpr Vec2f makeVec2f(float x, float y)       { return makeVec2(x, y); }
+constexpr Vec2f makeVec2f(const float* p)         { return makeVec2(p); }
+constexpr Vec2f makeVec2f(const Vec2f& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2f makeVec2f(const Vec3f& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2f makeVec2f(const Vec4f& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2d makeVec2d(double x)               { return makeVec2(x, x); }
+constexpr Vec2d makeVec2d(double x, double y)     { return makeVec2(x, y); }
+constexpr Vec2d makeVec2d(const double* p)        { return makeVec2(p); }
+constexpr Vec2d makeVec2d(const Vec2d& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2d makeVec2d(const Vec3d& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2d makeVec2d(const Vec4d& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2i makeVec2i(int x)                  { return makeVec2(x, x); }
+constexpr Vec2i makeVec2i(int x, int y)           { return makeVec2(x, y); }
+constexpr Vec2i makeVec2i(const int* p)           { return makeVec2(p); }
+constexpr Vec2i makeVec2i(const Vec2i& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2i makeVec2i(const Vec3i& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2i makeVec2i(const Vec4i& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2u makeVec2u(unsigned x)             { return makeVec2(x, x); }
+constexpr Vec2u makeVec2u(unsigned x, unsigned y) { return makeVec2(x, y); }
+constexpr Vec2u makeVec2u(const unsigned* p)      { return makeVec2(p); }
+constexpr Vec2u makeVec2u(const Vec2u& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2u makeVec2u(const Vec3u& v)         { return makeVec2(v.x, v.y); }
+constexpr Vec2u makeVec2u(const Vec4u& v)         { return makeVec2(v.x, v.y); }
+
+constexpr Vec3f makeVec3f(float x)                            { return makeVec3(x, x, x); }
+constexpr Vec3f makeVec3f(float x, float y, float z)          { return makeVec3(x, y, z); }
+constexpr Vec3f makeVec3f(const float* p)                     { return makeVec3(p); }
+constexpr Vec3f makeVec3f(const Vec3f& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3f makeVec3f(const Vec4f& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3d makeVec3d(double x)                           { return makeVec3(x, x, x); }
+constexpr Vec3d makeVec3d(double x, double y, double z)       { return makeVec3(x, y, z); }
+constexpr Vec3d makeVec3d(const double* p)                    { return makeVec3(p); }
+constexpr Vec3d makeVec3d(const Vec3d& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3d makeVec3d(const Vec4d& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3i makeVec3i(int x)                              { return makeVec3(x, x, x); }
+constexpr Vec3i makeVec3i(int x, int y, int z)                { return makeVec3(x, y, z); }
+constexpr Vec3i makeVec3i(const int* p)                       { return makeVec3(p); }
+constexpr Vec3i makeVec3i(const Vec3i& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3i makeVec3i(const Vec4i& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3u makeVec3u(unsigned x)                         { return makeVec3(x, x, x); }
+constexpr Vec3u makeVec3u(unsigned x, unsigned y, unsigned z) { return makeVec3(x, y, z); }
+constexpr Vec3u makeVec3u(const unsigned* p)                  { return makeVec3(p); }
+constexpr Vec3u makeVec3u(const Vec3u& v)                     { return makeVec3(v.x, v.y, v.z); }
+constexpr Vec3u makeVec3u(const Vec4u& v)                     { return makeVec3(v.x, v.y, v.z); }
 
+constexpr Vec4f makeVec4f(float x)                                        { return makeVec4(x, x, x, x); }
+constexpr Vec4f makeVec4f(float x, float y, float z, float w)             { return makeVec4(x, y, z, w); }
+constexpr Vec4f makeVec4f(const float* p)                                 { return makeVec4(p); }
+constexpr Vec4f makeVec4f(const Vec4f& v)                                 { return makeVec4(v.x, v.y, v.z, v.w); }
+constexpr Vec4d makeVec4d(double x)                                       { return makeVec4(x, x, x, x); }
+constexpr Vec4d makeVec4d(double x, double y, double z, double w)         { return makeVec4(x, y, z, w); }
+constexpr Vec4d makeVec4d(const double* p)                                { return makeVec4(p); }
+constexpr Vec4d makeVec4d(const Vec4d& v)                                 { return makeVec4(v.x, v.y, v.z, v.w); }
+constexpr Vec4i makeVec4i(int x)                                          { return makeVec4(x, x, x, x); }
+constexpr Vec4i makeVec4i(int x, int y, int z, int w)                     { return makeVec4(x, y, z, w); }
+constexpr Vec4i makeVec4i(const int* p)                                   { return makeVec4(p); }
+constexpr Vec4i makeVec4i(const Vec4i& v)                                 { return makeVec4(v.x, v.y, v.z, v.w); }
+constexpr Vec4u makeVec4u(unsigned x)                                     { return makeVec4(x, x, x, x); }
+constexpr Vec4u makeVec4u(unsigned x, unsigned y, unsigned z, unsigned w) { return makeVec4(x, y, z, w); }
+constexpr Vec4u makeVec4u(const unsigned* p)                              { return makeVec4(p); }
+constexpr Vec4u makeVec4u(const Vec4u& v)                                 { return makeVec4(v.x, v.y, v.z, v.w); }
 
-inline Vec2f makeVec2f(float x)                { return makeVec2(x, x); }
-inline Vec2f makeVec2f(float x, float y)       { return makeVec2(x, y); }
-inline Vec2f makeVec2f(const float* p)         { return makeVec2(p); }
-inline Vec2f makeVec2f(const Vec2f& v)         { return makeVec2(v.data); }
-inline Vec2f makeVec2f(const Vec3f& v)         { return makeVec2(v.data); }
-inline Vec2f makeVec2f(const Vec4f& v)         { return makeVec2(v.data); }
-inline Vec2d makeVec2d(double x)               { return makeVec2(x, x); }
-inline Vec2d makeVec2d(double x, double y)     { return makeVec2(x, y); }
-inline Vec2d makeVec2d(const double* p)        { return makeVec2(p); }
-inline Vec2d makeVec2d(const Vec2d& v)         { return makeVec2(v.data); }
-inline Vec2d makeVec2d(const Vec3d& v)         { return makeVec2(v.data); }
-inline Vec2d makeVec2d(const Vec4d& v)         { return makeVec2(v.data); }
-inline Vec2i makeVec2i(int x)                  { return makeVec2(x, x); }
-inline Vec2i makeVec2i(int x, int y)           { return makeVec2(x, y); }
-inline Vec2i makeVec2i(const int* p)           { return makeVec2(p); }
-inline Vec2i makeVec2i(const Vec2i& v)         { return makeVec2(v.data); }
-inline Vec2i makeVec2i(const Vec3i& v)         { return makeVec2(v.data); }
-inline Vec2i makeVec2i(const Vec4i& v)         { return makeVec2(v.data); }
-inline Vec2u makeVec2u(unsigned x)             { return makeVec2(x, x); }
-inline Vec2u makeVec2u(unsigned x, unsigned y) { return makeVec2(x, y); }
-inline Vec2u makeVec2u(const unsigned* p)      { return makeVec2(p); }
-inline Vec2u makeVec2u(const Vec2u& v)         { return makeVec2(v.data); }
-inline Vec2u makeVec2u(const Vec3u& v)         { return makeVec2(v.data); }
-inline Vec2u makeVec2u(const Vec4u& v)         { return makeVec2(v.data); }
-
-inline Vec3f makeVec3f(float x)                            { return makeVec3(x, x, x); }
-inline Vec3f makeVec3f(float x, float y, float z)          { return makeVec3(x, y, z); }
-inline Vec3f makeVec3f(const float* p)                     { return makeVec3(p); }
-inline Vec3f makeVec3f(const Vec3f& v)                     { return makeVec3(v.data); }
-inline Vec3f makeVec3f(const Vec4f& v)                     { return makeVec3(v.data); }
-inline Vec3d makeVec3d(double x)                           { return makeVec3(x, x, x); }
-inline Vec3d makeVec3d(double x, double y, double z)       { return makeVec3(x, y, z); }
-inline Vec3d makeVec3d(const double* p)                    { return makeVec3(p); }
-inline Vec3d makeVec3d(const Vec3d& v)                     { return makeVec3(v.data); }
-inline Vec3d makeVec3d(const Vec4d& v)                     { return makeVec3(v.data); }
-inline Vec3i makeVec3i(int x)                              { return makeVec3(x, x, x); }
-inline Vec3i makeVec3i(int x, int y, int z)                { return makeVec3(x, y, z); }
-inline Vec3i makeVec3i(const int* p)                       { return makeVec3(p); }
-inline Vec3i makeVec3i(const Vec3i& v)                     { return makeVec3(v.data); }
-inline Vec3i makeVec3i(const Vec4i& v)                     { return makeVec3(v.data); }
-inline Vec3u makeVec3u(unsigned x)                         { return makeVec3(x, x, x); }
-inline Vec3u makeVec3u(unsigned x, unsigned y, unsigned z) { return makeVec3(x, y, z); }
-inline Vec3u makeVec3u(const unsigned* p)                  { return makeVec3(p); }
-inline Vec3u makeVec3u(const Vec3u& v)                     { return makeVec3(v.data); }
-inline Vec3u makeVec3u(const Vec4u& v)                     { return makeVec3(v.data); }
-
-inline Vec4f makeVec4f(float x)                                        { return makeVec4(x, x, x, x); }
-inline Vec4f makeVec4f(float x, float y, float z, float w)             { return makeVec4(x, y, z, w); }
-inline Vec4f makeVec4f(const float* p)                                 { return makeVec4(p); }
-inline Vec4f makeVec4f(const Vec4f& v)                                 { return makeVec4(v.data); }
-inline Vec4d makeVec4d(double x)                                       { return makeVec4(x, x, x, x); }
-inline Vec4d makeVec4d(double x, double y, double z, double w)         { return makeVec4(x, y, z, w); }
-inline Vec4d makeVec4d(const double* p)                                { return makeVec4(p); }
-inline Vec4d makeVec4d(const Vec4d& v)                                 { return makeVec4(v.data); }
-inline Vec4i makeVec4i(int x)                                          { return makeVec4(x, x, x, x); }
-inline Vec4i makeVec4i(int x, int y, int z, int w)                     { return makeVec4(x, y, z, w); }
-inline Vec4i makeVec4i(const int* p)                                   { return makeVec4(p); }
-inline Vec4i makeVec4i(const Vec4i& v)                                 { return makeVec4(v.data); }
-inline Vec4u makeVec4u(unsigned x)                                     { return makeVec4(x, x, x, x); }
-inline Vec4u makeVec4u(unsigned x, unsigned y, unsigned z, unsigned w) { return makeVec4(x, y, z, w); }
-inline Vec4u makeVec4u(const unsigned* p)                              { return makeVec4(p); }
-inline Vec4u makeVec4u(const Vec4u& v)                                 { return makeVec4(v.data); }
-
-inline BBox2f makeEmptyBBox2f() { BBox2f box; box.min = makeVec2f(FLT_MAX); box.max = makeVec2f(-FLT_MAX); return box; }
-inline BBox2d makeEmptyBBox2d() { BBox2d box; box.min = makeVec2d(DBL_MAX); box.max = makeVec2d(-DBL_MAX); return box; }
-inline BBox3f makeEmptyBBox3f() { BBox3f box; box.min = makeVec3f(FLT_MAX); box.max = makeVec3f(-FLT_MAX); return box; }
-inline BBox3d makeEmptyBBox3d() { BBox3d box; box.min = makeVec3d(DBL_MAX); box.max = makeVec3d(-DBL_MAX); return box; }
-
-inline Mat3f makeMat3f(const Vec3f& c0, const Vec3f& c1, const Vec3f& c2) { return makeMat3(c0, c1, c2); }
-inline Mat3d makeMat3d(const Vec3d& c0, const Vec3d& c1, const Vec3d& c2) { return makeMat3(c0, c1, c2); }
-inline Mat3f makeMat3f(const float* p) { return makeMat3(p); }
-inline Mat3d makeMat3d(const double* p) { return makeMat3(p); }
-inline Mat3f makeMatRowMajor3f(float c0r0, float c1r0, float c2r0,
-                               float c0r1, float c1r1, float c2r1,
-                               float c0r2, float c1r2, float c2r2)
+constexpr BBox2f makeEmptyBBox2f() { BBox2f box{}; box.min = makeVec2f(FLT_MAX); box.max = makeVec2f(-FLT_MAX); return box; }
+constexpr BBox2d makeEmptyBBox2d() { BBox2d box{}; box.min = makeVec2d(DBL_MAX); box.max = makeVec2d(-DBL_MAX); return box; }
+constexpr BBox3f makeEmptyBBox3f() { BBox3f box{}; box.min = makeVec3f(FLT_MAX); box.max = makeVec3f(-FLT_MAX); return box; }
+constexpr BBox3d makeEmptyBBox3d() { BBox3d box{}; box.min = makeVec3d(DBL_MAX); box.max = makeVec3d(-DBL_MAX); return box; }
+
+constexpr Mat3f makeMat3f(const Vec3f& c0, const Vec3f& c1, const Vec3f& c2) { return makeMat3(c0, c1, c2); }
+constexpr Mat3d makeMat3d(const Vec3d& c0, const Vec3d& c1, const Vec3d& c2) { return makeMat3(c0, c1, c2); }
+constexpr Mat3f makeMat3f(const float* p) { return makeMat3(p); }
+constexpr Mat3d makeMat3d(const double* p) { return makeMat3(p); }
+constexpr Mat3f makeMatRowMajor3f(float c0r0, float c1r0, float c2r0,
+                                  float c0r1, float c1r1, float c2r1,
+                                  float c0r2, float c1r2, float c2r2)
 {
   return makeMatRowMajor3(c0r0, c1r0, c2r0,
                           c0r1, c1r1, c2r1,
                           c0r2, c1r2, c2r2);
 }
-inline Mat3d makeMatRowMajor3d(double c0r0, double c1r0, double c2r0,
-                               double c0r1, double c1r1, double c2r1,
-                               double c0r2, double c1r2, double c2r2)
+constexpr Mat3d makeMatRowMajor3d(double c0r0, double c1r0, double c2r0,
+                                  double c0r1, double c1r1, double c2r1,
+                                  double c0r2, double c1r2, double c2r2)
 {
   return makeMatRowMajor3(c0r0, c1r0, c2r0,
                           c0r1, c1r1, c2r1,
                           c0r2, c1r2, c2r2);
 }
+
+constexpr Mat3x4f makeMat3x4f(const Vec3f& c0, const Vec3f& c1, const Vec3f& c2, const Vec3f& c3) { return makeMat3x4(c0, c1, c2, c3); }
+constexpr Mat3x4d makeMat3x4d(const Vec3d& c0, const Vec3d& c1, const Vec3d& c2, const Vec3d& c3) { return makeMat3x4(c0, c1, c2, c3); }
+constexpr Mat3x4f makeMat3x4f(const float* p) { return makeMat3x4(p); }
+constexpr Mat3x4d makeMat3x4d(const double* p) { return makeMat3x4(p); }
+constexpr Mat3x4f makeMat3x4f(const Mat4f& m) { return makeMat3x4(m); }
+constexpr Mat3x4d makeMat3x4d(const Mat4d& m) { return makeMat3x4(m); }
+constexpr Mat3x4f makeMatRowMajor3x4f(float c0r0, float c1r0, float c2r0, float c3r0,
+                                      float c0r1, float c1r1, float c2r1, float c3r1,
+                                      float c0r2, float c1r2, float c2r2, float c3r2)
+{
+  return makeMatRowMajor3x4(c0r0, c1r0, c2r0, c3r0,
+                            c0r1, c1r1, c2r1, c3r1,
+                            c0r2, c1r2, c2r2, c3r2);
+}
+
+constexpr Mat4f makeMat4f(const Vec4f& c0, const Vec4f& c1, const Vec4f& c2, const Vec4f& c3) { return makeMat4(c0, c1, c2, c3); }
+constexpr Mat4d makeMat4d(const Vec4d& c0, const Vec4d& c1, const Vec4d& c2, const Vec4d& c3) { return makeMat4(c0, c1, c2, c3); }
+constexpr Mat4f makeMat4f(const float* p) { return makeMat4(p); }
+constexpr Mat4d makeMat4d(const double* p) { return makeMat4(p); }
+constexpr Mat4f makeMat4f(const Mat3x4f& m) { return makeMat4(m); }
+constexpr Mat4d makeMat4d(const Mat3x4d& m) { return makeMat4(m); }
+constexpr Mat4f makeMatRowMajor4f(float c0r0, float c1r0, float c2r0, float c3r0,
+                                  float c0r1, float c1r1, float c2r1, float c3r1,
+                                  float c0r2, float c1r2, float c2r2, float c3r2,
+                                  float c0r3, float c1r3, float c2r3, float c3r3)
+{
+  return makeMatRowMajor4(c0r0, c1r0, c2r0, c3r0,
+                          c0r1, c1r1, c2r1, c3r1,
+                          c0r2, c1r2, c2r2, c3r2,
+                          c0r3, c1r3, c2r3, c3r3);
+}
+
+constexpr Quatf makeQuatf(float x, float y, float z, float w)      { return makeQuat(x, y, z, w); }
+constexpr Quatf makeQuatf(const float* p)                          { return makeQuat(p); }
+constexpr Quatf makeIdentityQuatf()                                { return makeQuat(0.f, 0.f, 0.f, 1.f); }
+constexpr Quatd makeQuatd(double x, double y, double z, double w)  { return makeQuat(x, y, z, w); }
+constexpr Quatd makeQuatd(const double* p)                         { return makeQuat(p); }
+constexpr Quatd makeIdentityQuatd()                                { return makeQuat(0.0, 0.0, 0.0, 1.0); }
+
+constexpr Ray3f makeRay3f(const Vec3f& origin, const Vec3f& dir) { return makeRay(origin, dir); }
+constexpr Ray3d makeRay3d(const Vec3d& origin, const Vec3d& dir) { return makeRay(origin, dir); }
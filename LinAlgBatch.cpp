@@ -0,0 +1,538 @@
+#include <cstdlib>
+#include <cstring>
+#include "LinAlgBatch.h"
+#include "LinAlgOps.h"
+#include "LinAlgSIMD.h"
+#include "LinAlgSVD.h"
+#include "Parallel.h"
+
+#if defined(LINALG_DISPATCH) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(LINALG_DISPATCH)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+  // The kernels of one instruction set, see LinAlgBatchKernels.h.
+  struct Kernels
+  {
+    void (*transformPoints)(Vec3f*, const Mat3x4f&, const Vec3f*, size_t);
+    void (*transformPointsStrided)(float*, size_t, const Mat3x4f&, const float*, size_t, size_t);
+    void (*transformBoxes)(BBox3f*, const Mat3x4f&, const BBox3f*, size_t);
+    void (*transformBoxesEach)(BBox3f*, const Mat3x4f*, const BBox3f*, size_t);
+    void (*transformPointsSoA)(float*, size_t, const Mat3x4f&, const float*, size_t, size_t);
+    void (*splitPoints)(float*, size_t, const float*, size_t, size_t);
+    void (*joinPoints)(float*, size_t, const float*, size_t, size_t);
+    void (*splitBoxes)(float*, size_t, const BBox3f*, size_t);
+    void (*joinBoxes)(BBox3f*, const float*, size_t, size_t);
+    BBox2f (*boundsVec2f)(const Vec2f*, size_t);
+    BBox3f (*boundsVec3f)(const Vec3f*, size_t);
+    BBox3d (*boundsVec3d)(const Vec3d*, size_t);
+    BBox3f (*boundsBBox3f)(const BBox3f*, size_t);
+    BBox3f (*boundsStrided)(const char*, size_t, size_t);
+    BBox3f (*boundsSoA)(const float*, size_t, size_t);
+    void (*lengthExact)(float*, const Vec3f*, size_t, ExactPrecision);
+    void (*lengthFast)(float*, const Vec3f*, size_t, FastPrecision);
+    void (*distanceExact)(float*, const Vec3f*, const Vec3f*, size_t, ExactPrecision);
+    void (*distanceFast)(float*, const Vec3f*, const Vec3f*, size_t, FastPrecision);
+    void (*normalizeExact)(Vec3f*, const Vec3f*, size_t, ExactPrecision);
+    void (*normalizeFast)(Vec3f*, const Vec3f*, size_t, FastPrecision);
+    void (*skinLinear)(Vec3f*, const Vec3f*, const Vec4u*, const Vec4f*, const Mat3x4f*, size_t);
+    void (*skinDualQuat)(Vec3f*, const Vec3f*, const Vec4u*, const Vec4f*, const DualQuatf*, size_t);
+    void (*toHalf)(Vec3h*, const Vec3f*, size_t);
+    void (*fromHalf)(Vec3f*, const Vec3h*, size_t);
+    void (*quantize)(Vec3us*, const BBox3f&, const Vec3f*, size_t);
+    void (*dequantize)(Vec3f*, const BBox3f&, const Vec3us*, size_t);
+    void (*mortonKeys3)(uint32_t*, const BBox3f&, const Vec3f*, size_t);
+    void (*mortonKeys2)(uint32_t*, const BBox2f&, const Vec2f*, size_t);
+    void (*mortonKeys3x64)(uint64_t*, const BBox3f&, const Vec3f*, size_t);
+    void (*mortonKeys2x64)(uint64_t*, const BBox2f&, const Vec2f*, size_t);
+    void (*hilbertKeys3)(uint32_t*, const BBox3f&, const Vec3f*, size_t);
+    void (*hilbertKeys2)(uint32_t*, const BBox2f&, const Vec2f*, size_t);
+    void (*hilbertKeys3x64)(uint64_t*, const BBox3f&, const Vec3f*, size_t);
+    void (*hilbertKeys2x64)(uint64_t*, const BBox2f&, const Vec2f*, size_t);
+    void (*encodeNormals)(Vec2s*, const Vec3f*, size_t);
+    void (*decodeNormals)(Vec3f*, const Vec2s*, size_t);
+    void (*intersectRay)(uint32_t*, float*, const Ray3f&, const BBox3f*, size_t, float, float);
+    void (*intersectRays)(uint32_t*, float*, const Ray3f*, size_t, const BBox3f&, float, float);
+    void (*classifyBoxes)(Containment*, const Frustumf&, const BBox3f*, size_t);
+    void (*cullBoxes)(size_t*, uint32_t* const*, const Frustumf*, size_t, const BBox3f*, size_t);
+    void (*inverseMat3f)(Mat3f*, uint32_t*, const Mat3f*, size_t);
+    void (*inverseTransposeMat3f)(Mat3f*, uint32_t*, const Mat3f*, size_t);
+    void (*inverseMat3d)(Mat3d*, uint32_t*, const Mat3d*, size_t);
+    void (*inverseTransposeMat3d)(Mat3d*, uint32_t*, const Mat3d*, size_t);
+    void (*svdMat3f)(Mat3f*, Vec3f*, Mat3f*, const Mat3f*, size_t);
+    void (*polarMat3f)(Mat3f*, Mat3f*, const Mat3f*, size_t);
+    void (*scaleMat3f)(float*, const Mat3f*, size_t);
+    void (*scaleMat3x4f)(float*, const Mat3x4f*, size_t);
+  };
+
+  namespace scalar {
+#define LINALG_KERNEL_WIDTH 0
+#include "LinAlgBatchKernels.h"
+#undef LINALG_KERNEL_WIDTH
+  }
+
+#ifdef LINALG_SSE2
+  namespace sse2 {
+#define LINALG_KERNEL_WIDTH 4
+#include "LinAlgBatchKernels.h"
+#undef LINALG_KERNEL_WIDTH
+  }
+#endif
+
+#ifdef LINALG_DISPATCH
+  // No FMA, so that all levels give the same results as the scalar code.
+  LINALG_TARGET_BEGIN("avx2,f16c")
+  namespace avx2 {
+#define LINALG_KERNEL_WIDTH 8
+#include "LinAlgBatchKernels.h"
+#undef LINALG_KERNEL_WIDTH
+  }
+  LINALG_TARGET_END
+
+  // GCC 12 warns about the undefined pass-through register inside its own
+  // AVX-512 intrinsics when they are used from a target region.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+  LINALG_TARGET_BEGIN("avx512f,avx2,f16c")
+  namespace avx512 {
+#define LINALG_KERNEL_WIDTH 16
+#include "LinAlgBatchKernels.h"
+#undef LINALG_KERNEL_WIDTH
+  }
+  LINALG_TARGET_END
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+  void cpuid(unsigned* r, unsigned leaf, unsigned subleaf)
+  {
+#ifdef _MSC_VER
+    int t[4];
+    __cpuidex(t, int(leaf), int(subleaf));
+    for (unsigned k = 0; k < 4; k++) r[k] = unsigned(t[k]);
+#else
+    __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+#endif
+  }
+
+  // Register state enabled by the OS.
+  uint64_t xgetbv0()
+  {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t(hi) << 32) | lo;
+#endif
+  }
+#endif
+
+  SIMDLevel detectSIMDLevel()
+  {
+#if defined(LINALG_DISPATCH)
+    unsigned r[4];
+    cpuid(r, 0, 0);
+    unsigned maxLeaf = r[0];
+    cpuid(r, 1, 0);
+    bool osxsave = (r[2] >> 27) & 1;
+    bool avx = (r[2] >> 28) & 1;
+    bool f16c = (r[2] >> 29) & 1;
+    if (maxLeaf < 7 || !osxsave || !avx || !f16c) return SIMDLevel::SSE2;
+
+    uint64_t xcr0 = xgetbv0();
+    if ((xcr0 & 0x6) != 0x6) return SIMDLevel::SSE2;             // SSE and AVX state
+
+    cpuid(r, 7, 0);
+    bool avx2 = (r[1] >> 5) & 1;
+    bool avx512f = (r[1] >> 16) & 1;
+    if (!avx2) return SIMDLevel::SSE2;
+    if (!avx512f || (xcr0 & 0xe0) != 0xe0) return SIMDLevel::AVX2;  // Opmask and ZMM state
+    return SIMDLevel::AVX512;
+#elif defined(LINALG_SSE2)
+    return SIMDLevel::SSE2;
+#else
+    return SIMDLevel::Scalar;
+#endif
+  }
+
+  SIMDLevel selectSIMDLevel()
+  {
+    SIMDLevel level = detectSIMDLevel();
+    if (const char* cap = std::getenv("CDMATH_SIMD")) {
+      const char* names[] = { "scalar", "sse2", "avx2", "avx512" };
+      for (unsigned i = 0; i < 4; i++) {
+        if (std::strcmp(cap, names[i]) == 0 && SIMDLevel(i) < level) level = SIMDLevel(i);
+      }
+    }
+    return level;
+  }
+
+  Kernels selectKernels(SIMDLevel level)
+  {
+    switch (level) {
+#ifdef LINALG_DISPATCH
+    case SIMDLevel::AVX512: return avx512::makeKernels();
+    case SIMDLevel::AVX2: return avx2::makeKernels();
+#endif
+#ifdef LINALG_SSE2
+    case SIMDLevel::SSE2: return sse2::makeKernels();
+#endif
+    default: return scalar::makeKernels();
+    }
+  }
+
+  SIMDLevel& currentLevel()
+  {
+    static SIMDLevel level = selectSIMDLevel();
+    return level;
+  }
+
+  // The kernels of the current level, replaced by setSIMDLevel.
+  Kernels& kernels()
+  {
+    static Kernels k = selectKernels(currentLevel());
+    return k;
+  }
+
+  // Elements per task for points and for the heavier boxes, vertices and
+  // matrices. Multiples of 32, so that tasks write separate words of bit masks.
+  const size_t pointGrain = 1 << 16;
+  const size_t boxGrain = 1 << 14;
+
+  // Split the matrices across tasks, each with its own words of singular.
+  template<typename M>
+  void parallelInverse(void (*kernel)(M*, uint32_t*, const M*, size_t), M* dst, uint32_t* singular, const M* src, size_t N, unsigned threads)
+  {
+    parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, singular ? singular + a / 32 : nullptr, src + a, b - a); });
+  }
+
+  template<typename Key, typename BBox, typename Vec>
+  void parallelKeys(void (*kernel)(Key*, const BBox&, const Vec*, size_t), Key* dst, const BBox& frame, const Vec* src, size_t N, unsigned threads)
+  {
+    parallelFor(N, pointGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, frame, src + a, b - a); });
+  }
+
+  // Reduce chunks of pointGrain elements with f and merge the results with engulf.
+  template<typename BBox, typename F>
+  BBox parallelBounds(const BBox& bbox, size_t N, unsigned threads, F f)
+  {
+    return parallelReduce(N, pointGrain, threads, bbox, f, [](const BBox& a, const BBox& b) { return engulf(a, b); });
+  }
+
+}
+
+
+SIMDLevel getSIMDLevel()
+{
+  return currentLevel();
+}
+
+void setSIMDLevel(SIMDLevel level)
+{
+  SIMDLevel best = detectSIMDLevel();
+  currentLevel() = level < best ? level : best;
+  kernels() = selectKernels(currentLevel());
+}
+
+void transform(Vec3f* dst, const Mat3x4f& M, const Vec3f* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformPoints, N);
+  auto kernel = kernels().transformPoints;
+  parallelFor(N, pointGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, M, src + a, b - a); });
+}
+
+void transform(float* dst, size_t dstStride, const Mat3x4f& M, const float* src, size_t srcStride, size_t N)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformPoints, N);
+  if (dstStride == sizeof(Vec3f) && srcStride == sizeof(Vec3f)) {
+    kernels().transformPoints(reinterpret_cast<Vec3f*>(dst), M, reinterpret_cast<const Vec3f*>(src), N);
+  }
+  else {
+    kernels().transformPointsStrided(dst, dstStride, M, src, srcStride, N);
+  }
+}
+
+void transform(BBox3f* dst, const Mat3x4f& M, const BBox3f* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformBBoxes, N);
+  auto kernel = kernels().transformBoxes;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, M, src + a, b - a); });
+}
+
+void transform(BBox3f* dst, const Mat3x4f* M, const BBox3f* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformBBoxes, N);
+  auto kernel = kernels().transformBoxesEach;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, M + a, src + a, b - a); });
+}
+
+BBox2f engulf(const BBox2f& bbox, const Vec2f* p, size_t N, unsigned threads)
+{
+  auto bounds = kernels().boundsVec2f;
+  return parallelBounds(bbox, N, threads, [=](size_t a, size_t b) { return bounds(p + a, b - a); });
+}
+
+BBox3f engulf(const BBox3f& bbox, const Vec3f* p, size_t N, unsigned threads)
+{
+  auto bounds = kernels().boundsVec3f;
+  return parallelBounds(bbox, N, threads, [=](size_t a, size_t b) { return bounds(p + a, b - a); });
+}
+
+BBox3d engulf(const BBox3d& bbox, const Vec3d* p, size_t N, unsigned threads)
+{
+  auto bounds = kernels().boundsVec3d;
+  return parallelBounds(bbox, N, threads, [=](size_t a, size_t b) { return bounds(p + a, b - a); });
+}
+
+BBox3f engulf(const BBox3f& bbox, const BBox3f* bboxes, size_t N, unsigned threads)
+{
+  auto bounds = kernels().boundsBBox3f;
+  return parallelBounds(bbox, N, threads, [=](size_t a, size_t b) { return bounds(bboxes + a, b - a); });
+}
+
+BBox3f engulf(const BBox3f& bbox, const float* p, size_t stride, size_t N, unsigned threads)
+{
+  auto bounds = kernels().boundsStrided;
+  const char* q = reinterpret_cast<const char*>(p);
+  return parallelBounds(bbox, N, threads, [=](size_t a, size_t b) { return bounds(q + a * stride, stride, b - a); });
+}
+
+BBox3f engulf(const BBox3f& bbox, const Vec3View<const float>& p, unsigned threads)
+{
+  return engulf(bbox, p.data, p.stride, p.size, threads);
+}
+
+BBox3f engulf(const BBox3f& bbox, const Vec3SoAf& p, unsigned threads)
+{
+  auto bounds = kernels().boundsSoA;
+  const float* q = p.x();
+  size_t pitch = p.pitch;
+  return parallelBounds(bbox, p.size, threads, [=](size_t a, size_t b) { return bounds(q + a, pitch, b - a); });
+}
+
+void transform(const Vec3View<float>& dst, const Mat3x4f& M, const Vec3View<const float>& src, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformPoints, src.size);
+  parallelFor(src.size, pointGrain, threads, [&](size_t a, size_t b) { transform(dst.at(a), dst.stride, M, src.at(a), src.stride, b - a); });
+}
+
+void transform(Vec3SoAf& dst, const Mat3x4f& M, const Vec3SoAf& src, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformPoints, src.size);
+  if (&dst != &src) resize(dst, src.size);
+  auto kernel = kernels().transformPointsSoA;
+  parallelFor(src.size, pointGrain, threads, [&](size_t a, size_t b) { kernel(dst.x() + a, dst.pitch, M, src.x() + a, src.pitch, b - a); });
+}
+
+void convert(Vec3SoAf& dst, const Vec3View<const float>& src, unsigned threads)
+{
+  resize(dst, src.size);
+  auto kernel = kernels().splitPoints;
+  parallelFor(src.size, pointGrain, threads, [&](size_t a, size_t b) { kernel(dst.x() + a, dst.pitch, src.at(a), src.stride, b - a); });
+}
+
+void convert(const Vec3View<float>& dst, const Vec3SoAf& src, unsigned threads)
+{
+  auto kernel = kernels().joinPoints;
+  parallelFor(src.size, pointGrain, threads, [&](size_t a, size_t b) { kernel(dst.at(a), dst.stride, src.x() + a, src.pitch, b - a); });
+}
+
+void convert(BBox3SoAf& dst, const BBox3f* src, size_t N, unsigned threads)
+{
+  resize(dst, N);
+  auto kernel = kernels().splitBoxes;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst.array(0) + a, dst.pitch, src + a, b - a); });
+}
+
+void convert(BBox3f* dst, const BBox3SoAf& src, unsigned threads)
+{
+  auto kernel = kernels().joinBoxes;
+  parallelFor(src.size, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, src.array(0) + a, src.pitch, b - a); });
+}
+
+void skinLinear(Vec3f* dst, const Vec3f* src, const Vec4u* bones, const Vec4f* weights, const Mat3x4f* transforms, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(Skin, N);
+  auto kernel = kernels().skinLinear;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, src + a, bones + a, weights + a, transforms, b - a); });
+}
+
+void skinDualQuat(Vec3f* dst, const Vec3f* src, const Vec4u* bones, const Vec4f* weights, const DualQuatf* transforms, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(Skin, N);
+  auto kernel = kernels().skinDualQuat;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, src + a, bones + a, weights + a, transforms, b - a); });
+}
+
+void convert(Vec3h* dst, const Vec3f* src, size_t N)
+{
+  kernels().toHalf(dst, src, N);
+}
+
+void convert(Vec3f* dst, const Vec3h* src, size_t N)
+{
+  kernels().fromHalf(dst, src, N);
+}
+
+void quantize(Vec3us* dst, const BBox3f& frame, const Vec3f* src, size_t N)
+{
+  kernels().quantize(dst, frame, src, N);
+}
+
+void dequantize(Vec3f* dst, const BBox3f& frame, const Vec3us* src, size_t N)
+{
+  kernels().dequantize(dst, frame, src, N);
+}
+
+void encodeOctahedral(Vec2s* dst, const Vec3f* src, size_t N)
+{
+  kernels().encodeNormals(dst, src, N);
+}
+
+void decodeOctahedral(Vec3f* dst, const Vec2s* src, size_t N)
+{
+  LINALG_INSTRUMENT_MUTE();
+  kernels().decodeNormals(dst, src, N);
+}
+
+void transform(Vec3f* dst, const Mat3x4f& M, const Vec3h* src, size_t N)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformPoints, N);
+  const size_t chunk = 256;
+  Vec3f tmp[chunk];
+  for (size_t i = 0; i < N; i += chunk) {
+    size_t n = N - i < chunk ? N - i : chunk;
+    convert(tmp, src + i, n);
+    transform(dst + i, M, tmp, n);
+  }
+}
+
+void transform(Vec3f* dst, const Mat3x4f& M, const BBox3f& frame, const Vec3us* src, size_t N)
+{
+  LINALG_INSTRUMENT_SCOPE(TransformPoints, N);
+  Mat3x4f A;
+  for (unsigned k = 0; k < 3; k++) {
+    A.cols[k] = ((frame.max[k] - frame.min[k]) / 65535.f) * M.cols[k];
+  }
+  A.cols[3] = mul(M, frame.min);
+
+  const size_t chunk = 256;
+  Vec3f tmp[chunk];
+  for (size_t i = 0; i < N; i += chunk) {
+    size_t n = N - i < chunk ? N - i : chunk;
+    for (size_t j = 0; j < n; j++) {
+      tmp[j] = makeVec3f(float(src[i + j].x), float(src[i + j].y), float(src[i + j].z));
+    }
+    transform(dst + i, A, tmp, n);
+  }
+}
+
+void intersect(uint32_t* hits, float* t, const Ray3f& ray, const BBox3f* bboxes, size_t N, float tmin, float tmax)
+{
+  kernels().intersectRay(hits, t, ray, bboxes, N, tmin, tmax);
+}
+
+void intersect(uint32_t* hits, float* t, const Ray3f* rays, size_t N, const BBox3f& bbox, float tmin, float tmax)
+{
+  kernels().intersectRays(hits, t, rays, N, bbox, tmin, tmax);
+}
+
+void classify(Containment* result, const Frustumf& frustum, const BBox3f* bboxes, size_t N)
+{
+  kernels().classifyBoxes(result, frustum, bboxes, N);
+}
+
+size_t cull(uint32_t* visible, const Frustumf& frustum, const BBox3f* bboxes, size_t N)
+{
+  size_t count;
+  uint32_t* const lists[1] = { visible };
+  kernels().cullBoxes(&count, lists, &frustum, 1, bboxes, N);
+  return count;
+}
+
+void cull(size_t* counts, uint32_t* const* visible, const Frustumf* frustums, size_t V, const BBox3f* bboxes, size_t N)
+{
+  kernels().cullBoxes(counts, visible, frustums, V, bboxes, N);
+}
+
+void inverse(Mat3f* dst, uint32_t* singular, const Mat3f* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseBatch, N);
+  parallelInverse(kernels().inverseMat3f, dst, singular, src, N, threads);
+}
+
+void inverse(Mat3d* dst, uint32_t* singular, const Mat3d* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseBatch, N);
+  parallelInverse(kernels().inverseMat3d, dst, singular, src, N, threads);
+}
+
+void inverseTranspose(Mat3f* dst, uint32_t* singular, const Mat3f* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseTransposeBatch, N);
+  parallelInverse(kernels().inverseTransposeMat3f, dst, singular, src, N, threads);
+}
+
+void inverseTranspose(Mat3d* dst, uint32_t* singular, const Mat3d* src, size_t N, unsigned threads)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseTransposeBatch, N);
+  parallelInverse(kernels().inverseTransposeMat3d, dst, singular, src, N, threads);
+}
+
+void svd(Mat3f* U, Vec3f* sigma, Mat3f* V, const Mat3f* M, size_t N, unsigned threads)
+{
+  auto kernel = kernels().svdMat3f;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(U + a, sigma + a, V + a, M + a, b - a); });
+}
+
+void polarDecomposition(Mat3f* R, Mat3f* S, const Mat3f* M, size_t N, unsigned threads)
+{
+  auto kernel = kernels().polarMat3f;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(R + a, S + a, M + a, b - a); });
+}
+
+void getScale(float* dst, const Mat3f* M, size_t N, unsigned threads)
+{
+  auto kernel = kernels().scaleMat3f;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, M + a, b - a); });
+}
+
+void getScale(float* dst, const Mat3x4f* M, size_t N, unsigned threads)
+{
+  auto kernel = kernels().scaleMat3x4f;
+  parallelFor(N, boxGrain, threads, [&](size_t a, size_t b) { kernel(dst + a, M + a, b - a); });
+}
+
+void mortonKey(uint32_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads) { parallelKeys(kernels().mortonKeys3, dst, frame, src, N, threads); }
+void mortonKey(uint32_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads) { parallelKeys(kernels().mortonKeys2, dst, frame, src, N, threads); }
+void mortonKey(uint64_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads) { parallelKeys(kernels().mortonKeys3x64, dst, frame, src, N, threads); }
+void mortonKey(uint64_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads) { parallelKeys(kernels().mortonKeys2x64, dst, frame, src, N, threads); }
+void hilbertKey(uint32_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads) { parallelKeys(kernels().hilbertKeys3, dst, frame, src, N, threads); }
+void hilbertKey(uint32_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads) { parallelKeys(kernels().hilbertKeys2, dst, frame, src, N, threads); }
+void hilbertKey(uint64_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads) { parallelKeys(kernels().hilbertKeys3x64, dst, frame, src, N, threads); }
+void hilbertKey(uint64_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads) { parallelKeys(kernels().hilbertKeys2x64, dst, frame, src, N, threads); }
+
+void length(float* dst, const Vec3f* src, size_t N) { kernels().lengthExact(dst, src, N, ExactPrecision()); }
+void length(float* dst, const Vec3f* src, size_t N, FastPrecision precision) { kernels().lengthFast(dst, src, N, precision); }
+
+void distance(float* dst, const Vec3f* a, const Vec3f* b, size_t N) { kernels().distanceExact(dst, a, b, N, ExactPrecision()); }
+void distance(float* dst, const Vec3f* a, const Vec3f* b, size_t N, FastPrecision precision) { kernels().distanceFast(dst, a, b, N, precision); }
+
+void normalize(Vec3f* dst, const Vec3f* src, size_t N)
+{
+  LINALG_INSTRUMENT_SCOPE(NormalizeBatch, N);
+  kernels().normalizeExact(dst, src, N, ExactPrecision());
+}
+
+void normalize(Vec3f* dst, const Vec3f* src, size_t N, FastPrecision precision)
+{
+  LINALG_INSTRUMENT_SCOPE(NormalizeBatch, N);
+  kernels().normalizeFast(dst, src, N, precision);
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <cstddef>
+#include "LinAlg.h"
+#include "SoA.h"
+
+// Batched versions of the operations in LinAlgOps.h, operating on arrays.
+//
+// Unless noted otherwise, results are bit-identical to calling the scalar
+// function on each element, as long as the compiler does not contract the
+// scalar path into fused multiply-adds (e.g. -ffp-contract=fast with -mfma).
+// In that case, the difference is bounded by one rounding per multiply-add.
+//
+// The kernels are built for several instruction sets and the best one the
+// CPU supports is picked on first use, see getSIMDLevel. All levels give the
+// same results, except that FastPrecision follows the reciprocal square
+// root estimate of the CPU, and that half conversions at the AVX2 level and
+// above use F16C, which keeps NaN payloads.
+//
+// Functions with a threads argument split large arrays across the thread
+// pool in Parallel.h. threads == 0 uses all threads of the pool and 1 runs on
+// the calling thread. The results do not depend on the number of threads.
+
+
+/** Instruction sets the batched operations are built for. */
+enum struct SIMDLevel
+{
+  Scalar,
+  SSE2,
+  AVX2,
+  AVX512
+};
+
+/** Instruction set used by the batched operations.
+ *
+ * Detected once, as the best level supported by both the CPU and the OS.
+ * Setting the environment variable CDMATH_SIMD to scalar, sse2, avx2 or
+ * avx512 caps the level, e.g. to test the scalar fallback. */
+SIMDLevel getSIMDLevel();
+
+/** Use the kernels of level, or of the best level the CPU supports if that is lower, e.g. to compare the levels in tests.
+ *
+ * Ignores CDMATH_SIMD. Must not be called while a batched operation is running. */
+void setSIMDLevel(SIMDLevel level);
+
+
+/** Transform N points, dst[i] = mul(M, src[i]). dst may be equal to src. */
+void transform(Vec3f* dst, const Mat3x4f& M, const Vec3f* src, size_t N, unsigned threads = 0);
+
+/** Transform N points in interleaved buffers, strides are in bytes. dst may be equal to src. */
+void transform(float* dst, size_t dstStride, const Mat3x4f& M, const float* src, size_t srcStride, size_t N);
+
+/** Transform N bounding boxes by one matrix, dst[i] = transform(M, src[i]). dst may be equal to src. */
+void transform(BBox3f* dst, const Mat3x4f& M, const BBox3f* src, size_t N, unsigned threads = 0);
+
+/** Transform N bounding boxes by one matrix each, dst[i] = transform(M[i], src[i]). dst may be equal to src. */
+void transform(BBox3f* dst, const Mat3x4f* M, const BBox3f* src, size_t N, unsigned threads = 0);
+
+/** Grow bbox to include N points, NaN coordinates are ignored.
+ *
+ * Calling this repeatedly on chunks of points gives the same result as one
+ * call on all points. The points are only split across threads when there
+ * are enough of them. */
+BBox2f engulf(const BBox2f& bbox, const Vec2f* p, size_t N, unsigned threads = 0);
+BBox3f engulf(const BBox3f& bbox, const Vec3f* p, size_t N, unsigned threads = 0);
+BBox3d engulf(const BBox3d& bbox, const Vec3d* p, size_t N, unsigned threads = 0);
+
+/** Grow bbox to include N boxes, same as merging them one by one with engulf. */
+BBox3f engulf(const BBox3f& bbox, const BBox3f* bboxes, size_t N, unsigned threads = 0);
+
+/** Grow bbox to include N points in an interleaved buffer, stride is in bytes. */
+BBox3f engulf(const BBox3f& bbox, const float* p, size_t stride, size_t N, unsigned threads = 0);
+
+/** Grow bbox to include the points of a view or a structure of arrays, see SoA.h. */
+BBox3f engulf(const BBox3f& bbox, const Vec3View<const float>& p, unsigned threads = 0);
+BBox3f engulf(const BBox3f& bbox, const Vec3SoAf& p, unsigned threads = 0);
+
+/** Transform the points of src into dst, which must hold as many. dst may be equal to src. */
+void transform(const Vec3View<float>& dst, const Mat3x4f& M, const Vec3View<const float>& src, unsigned threads = 0);
+
+/** Transform the points of src, dst is resized to match. dst may be equal to src. */
+void transform(Vec3SoAf& dst, const Mat3x4f& M, const Vec3SoAf& src, unsigned threads = 0);
+
+/** Copy points into a structure of arrays, from a Vec3f array or an interleaved buffer. dst is resized to match. */
+void convert(Vec3SoAf& dst, const Vec3View<const float>& src, unsigned threads = 0);
+
+/** Copy points out of a structure of arrays, dst must hold as many. */
+void convert(const Vec3View<float>& dst, const Vec3SoAf& src, unsigned threads = 0);
+
+/** Copy N boxes into a structure of arrays, dst is resized to match. */
+void convert(BBox3SoAf& dst, const BBox3f* src, size_t N, unsigned threads = 0);
+
+/** Copy boxes out of a structure of arrays, dst must hold src.size boxes. */
+void convert(BBox3f* dst, const BBox3SoAf& src, unsigned threads = 0);
+
+/** Linear blend skinning of N vertices with four bone influences each.
+ *
+ * dst[i] = mul(sum_k weights[i][k] * transforms[bones[i][k]], src[i]). */
+void skinLinear(Vec3f* dst, const Vec3f* src, const Vec4u* bones, const Vec4f* weights, const Mat3x4f* transforms, size_t N, unsigned threads = 0);
+
+/** Dual quaternion skinning of N vertices with four bone influences each, transforms are unit dual quaternions.
+ *
+ * Influences in the other hemisphere than the first one are negated, and
+ * the blend is normalized. Runs four vertices at a time at any SIMD level,
+ * at about 2.5 times the cost per vertex of skinLinear, which needs no
+ * hemisphere test, square root or division. */
+void skinDualQuat(Vec3f* dst, const Vec3f* src, const Vec4u* bones, const Vec4f* weights, const DualQuatf* transforms, size_t N, unsigned threads = 0);
+
+/** Convert N vectors to half precision, dst[i] = makeVec3h(src[i]). */
+void convert(Vec3h* dst, const Vec3f* src, size_t N);
+
+/** Convert N vectors from half precision, dst[i] = makeVec3f(src[i]). */
+void convert(Vec3f* dst, const Vec3h* src, size_t N);
+
+/** Quantize N points, dst[i] = quantize(frame, src[i]). */
+void quantize(Vec3us* dst, const BBox3f& frame, const Vec3f* src, size_t N);
+
+/** Dequantize N points, dst[i] = dequantize(frame, src[i]). */
+void dequantize(Vec3f* dst, const BBox3f& frame, const Vec3us* src, size_t N);
+
+/** Encode N unit vectors, dst[i] = encodeOctahedral(src[i]), so vectors without a direction encode as +z. */
+void encodeOctahedral(Vec2s* dst, const Vec3f* src, size_t N);
+
+/** Decode N unit vectors, dst[i] = decodeOctahedral(src[i]). */
+void decodeOctahedral(Vec3f* dst, const Vec2s* src, size_t N);
+
+/** Transform N half precision points, dst[i] = mul(M, makeVec3f(src[i])). */
+void transform(Vec3f* dst, const Mat3x4f& M, const Vec3h* src, size_t N);
+
+/** Transform N quantized points, dst[i] = mul(M, dequantize(frame, src[i])).
+ *
+ * The dequantization is folded into M, so results may differ by a few ulps
+ * from dequantizing first. */
+void transform(Vec3f* dst, const Mat3x4f& M, const BBox3f& frame, const Vec3us* src, size_t N);
+
+/** Intersect one ray with N boxes, see intersect(T&, const Ray3<T>&, const BBox3<T>&, T, T).
+ *
+ * Bit i % 32 of hits[i / 32] is set if box i is hit, and t[i] is then the
+ * entry distance. hits must hold (N + 31) / 32 words. */
+void intersect(uint32_t* hits, float* t, const Ray3f& ray, const BBox3f* bboxes, size_t N, float tmin, float tmax);
+
+/** Intersect N rays with one box, hits and t as above. */
+void intersect(uint32_t* hits, float* t, const Ray3f* rays, size_t N, const BBox3f& bbox, float tmin, float tmax);
+
+/** Classify N boxes against frustum, result[i] = classify(frustum, bboxes[i]). */
+void classify(Containment* result, const Frustumf& frustum, const BBox3f* bboxes, size_t N);
+
+/** Write the indices of the boxes not outside frustum to visible and return their count.
+ *
+ * visible must have room for N indices. */
+size_t cull(uint32_t* visible, const Frustumf& frustum, const BBox3f* bboxes, size_t N);
+
+/** Cull N boxes against V frustums in one pass over the boxes.
+ *
+ * visible[v] receives the indices of the boxes not outside frustums[v], and
+ * counts[v] their number. Each visible[v] must have room for N indices. */
+void cull(size_t* counts, uint32_t* const* visible, const Frustumf* frustums, size_t V, const BBox3f* bboxes, size_t N);
+
+/** Invert N matrices, dst[i] = inverse(src[i]). dst may be equal to src.
+ *
+ * Bit i % 32 of singular[i / 32] is set if isSingular(determinant(src[i])),
+ * dst[i] is then not a valid inverse. singular may be null, otherwise it
+ * must hold (N + 31) / 32 words. */
+void inverse(Mat3f* dst, uint32_t* singular, const Mat3f* src, size_t N, unsigned threads = 0);
+void inverse(Mat3d* dst, uint32_t* singular, const Mat3d* src, size_t N, unsigned threads = 0);
+
+/** Normal matrices of N matrices, dst[i] = inverseTranspose(src[i]), singular as above. */
+void inverseTranspose(Mat3f* dst, uint32_t* singular, const Mat3f* src, size_t N, unsigned threads = 0);
+void inverseTranspose(Mat3d* dst, uint32_t* singular, const Mat3d* src, size_t N, unsigned threads = 0);
+
+/** Decompose N matrices, svd(U[i], sigma[i], V[i], M[i]), 4 to 16 at a time without branches. */
+void svd(Mat3f* U, Vec3f* sigma, Mat3f* V, const Mat3f* M, size_t N, unsigned threads = 0);
+
+/** Decompose N matrices, polarDecomposition(R[i], S[i], M[i]). */
+void polarDecomposition(Mat3f* R, Mat3f* S, const Mat3f* M, size_t N, unsigned threads = 0);
+
+/** Largest singular values of N matrices, dst[i] = getScale(M[i]), 4 at a time in double. */
+void getScale(float* dst, const Mat3f* M, size_t N, unsigned threads = 0);
+void getScale(float* dst, const Mat3x4f* M, size_t N, unsigned threads = 0);
+
+/** Morton keys of N points, dst[i] = mortonKey(frame, src[i]) or mortonKey64 for 64-bit keys. */
+void mortonKey(uint32_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads = 0);
+void mortonKey(uint32_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads = 0);
+void mortonKey(uint64_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads = 0);
+void mortonKey(uint64_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads = 0);
+
+/** Hilbert keys of N points, dst[i] = hilbertKey(frame, src[i]) or hilbertKey64 for 64-bit keys. */
+void hilbertKey(uint32_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads = 0);
+void hilbertKey(uint32_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads = 0);
+void hilbertKey(uint64_t* dst, const BBox3f& frame, const Vec3f* src, size_t N, unsigned threads = 0);
+void hilbertKey(uint64_t* dst, const BBox2f& frame, const Vec2f* src, size_t N, unsigned threads = 0);
+
+/** Lengths of N vectors, dst[i] = length(src[i]), optionally with FastPrecision. */
+void length(float* dst, const Vec3f* src, size_t N);
+void length(float* dst, const Vec3f* src, size_t N, FastPrecision precision);
+
+/** Distances between N pairs of points, dst[i] = distance(a[i], b[i]), optionally with FastPrecision. */
+void distance(float* dst, const Vec3f* a, const Vec3f* b, size_t N);
+void distance(float* dst, const Vec3f* a, const Vec3f* b, size_t N, FastPrecision precision);
+
+/** Normalize N vectors, dst[i] = normalize(src[i]), optionally with FastPrecision. dst may be equal to src. */
+void normalize(Vec3f* dst, const Vec3f* src, size_t N);
+void normalize(Vec3f* dst, const Vec3f* src, size_t N, FastPrecision precision);
@@ -0,0 +1,1967 @@
+// Internal to LinAlgBatch.cpp, which includes this file once per instruction
+// set, each time in its own namespace and target region, with
+// LINALG_KERNEL_WIDTH set to the number of floats in a register: 0 for the
+// scalar kernels, 4 for SSE2, 8 for AVX2 and 16 for AVX-512.
+//
+// Kernels written against Pack use the full width. The others use SSE
+// registers at any width above 0, and get the VEX encoding for free in the
+// wider target regions. All kernels end with a scalar loop over what is
+// left, which is all the scalar kernels run.
+//
+// No include guard, as it is included several times.
+
+#if LINALG_KERNEL_WIDTH
+
+// ---- SSE registers, at every width ----
+
+inline __m128 vadd(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+inline __m128 vsub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+inline __m128 vmul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+inline __m128 vdiv(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+inline __m128 vmin(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+inline __m128 vmax(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+inline __m128 vsqrt(__m128 a) { return _mm_sqrt_ps(a); }
+inline __m128 vrsqrt(__m128 a) { return _mm_rsqrt_ps(a); }
+inline __m128 vabs(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+inline __m128 vunpacklo(__m128 a, __m128 b) { return _mm_unpacklo_ps(a, b); }
+inline __m128 vunpackhi(__m128 a, __m128 b) { return _mm_unpackhi_ps(a, b); }
+template<int I> __m128 vshuffle(__m128 a, __m128 b) { return _mm_shuffle_ps(a, b, I); }
+
+// Comparisons give masks, which are registers below AVX-512.
+inline __m128 vcmplt(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+inline __m128 vcmple(__m128 a, __m128 b) { return _mm_cmple_ps(a, b); }
+inline __m128 vor(__m128 a, __m128 b) { return _mm_or_ps(a, b); }
+inline __m128 vandnot(__m128 a, __m128 b) { return _mm_andnot_ps(a, b); }
+inline __m128 vselect(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline unsigned vbits(__m128 mask) { return unsigned(_mm_movemask_ps(mask)); }
+
+inline __m128i vselect(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+// Two doubles per register, used at every width.
+inline __m128d vadd(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+inline __m128d vsub(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+inline __m128d vmul(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+inline __m128d vdiv(__m128d a, __m128d b) { return _mm_div_pd(a, b); }
+inline __m128d vsqrt(__m128d a) { return _mm_sqrt_pd(a); }
+inline __m128d vabs(__m128d a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+inline __m128d vcmplt(__m128d a, __m128d b) { return _mm_cmplt_pd(a, b); }
+inline __m128d vcmple(__m128d a, __m128d b) { return _mm_cmple_pd(a, b); }
+inline __m128d vselect(__m128d mask, __m128d a, __m128d b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+inline unsigned vbits(__m128d mask) { return unsigned(_mm_movemask_pd(mask)); }
+
+template<typename P> P vset1(float x);
+template<typename P> P vload(const float* p);
+// Load the 4-float lanes of a register from p, p + stride, p + 2 * stride, ...
+template<typename P> P vloadLanes(const float* p, size_t stride);
+
+template<> inline __m128 vset1<__m128>(float x) { return _mm_set1_ps(x); }
+template<> inline __m128 vload<__m128>(const float* p) { return _mm_loadu_ps(p); }
+template<> inline __m128 vloadLanes<__m128>(const float* p, size_t) { return _mm_loadu_ps(p); }
+inline void vstore(float* p, __m128 a) { _mm_storeu_ps(p, a); }
+inline void vstoreLanes(float* p, size_t, __m128 a) { _mm_storeu_ps(p, a); }
+
+#if LINALG_KERNEL_WIDTH == 4
+typedef __m128 Pack;
+typedef __m128 Mask;
+inline Mask vnone() { return _mm_setzero_ps(); }
+#endif
+
+// ---- AVX registers ----
+
+#if 8 <= LINALG_KERNEL_WIDTH
+
+inline __m256 vadd(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+inline __m256 vsub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+inline __m256 vmul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+inline __m256 vdiv(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+inline __m256 vmin(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+inline __m256 vmax(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+inline __m256 vsqrt(__m256 a) { return _mm256_sqrt_ps(a); }
+inline __m256 vrsqrt(__m256 a) { return _mm256_rsqrt_ps(a); }
+inline __m256 vabs(__m256 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+inline __m256 vunpacklo(__m256 a, __m256 b) { return _mm256_unpacklo_ps(a, b); }
+inline __m256 vunpackhi(__m256 a, __m256 b) { return _mm256_unpackhi_ps(a, b); }
+template<int I> __m256 vshuffle(__m256 a, __m256 b) { return _mm256_shuffle_ps(a, b, I); }
+
+inline __m256 vcmplt(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline __m256 vcmple(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline __m256 vor(__m256 a, __m256 b) { return _mm256_or_ps(a, b); }
+inline __m256 vandnot(__m256 a, __m256 b) { return _mm256_andnot_ps(a, b); }
+inline __m256 vselect(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+inline unsigned vbits(__m256 mask) { return unsigned(_mm256_movemask_ps(mask)); }
+
+template<> inline __m256 vset1<__m256>(float x) { return _mm256_set1_ps(x); }
+template<> inline __m256 vload<__m256>(const float* p) { return _mm256_loadu_ps(p); }
+template<> inline __m256 vloadLanes<__m256>(const float* p, size_t stride)
+{
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + stride), 1);
+}
+inline void vstore(float* p, __m256 a) { _mm256_storeu_ps(p, a); }
+inline void vstoreLanes(float* p, size_t stride, __m256 a)
+{
+  _mm_storeu_ps(p, _mm256_castps256_ps128(a));
+  _mm_storeu_ps(p + stride, _mm256_extractf128_ps(a, 1));
+}
+
+#if LINALG_KERNEL_WIDTH == 8
+typedef __m256 Pack;
+typedef __m256 Mask;
+inline Mask vnone() { return _mm256_setzero_ps(); }
+#endif
+
+#endif
+
+// ---- AVX-512 registers ----
+
+#if 16 <= LINALG_KERNEL_WIDTH
+
+inline __m512 vadd(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+inline __m512 vsub(__m512 a, __m512 b) { return _mm512_sub_ps(a, b); }
+inline __m512 vmul(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+inline __m512 vdiv(__m512 a, __m512 b) { return _mm512_div_ps(a, b); }
+inline __m512 vmin(__m512 a, __m512 b) { return _mm512_min_ps(a, b); }
+inline __m512 vmax(__m512 a, __m512 b) { return _mm512_max_ps(a, b); }
+inline __m512 vsqrt(__m512 a) { return _mm512_sqrt_ps(a); }
+inline __m512 vabs(__m512 a) { return _mm512_abs_ps(a); }
+inline __m512 vunpacklo(__m512 a, __m512 b) { return _mm512_unpacklo_ps(a, b); }
+inline __m512 vunpackhi(__m512 a, __m512 b) { return _mm512_unpackhi_ps(a, b); }
+template<int I> __m512 vshuffle(__m512 a, __m512 b) { return _mm512_shuffle_ps(a, b, I); }
+
+// The AVX-512 estimate is more precise, use the AVX one on each half to
+// get the same results as the narrower kernels.
+inline __m512 vrsqrt(__m512 a)
+{
+  __m256 lo = _mm256_rsqrt_ps(_mm512_castps512_ps256(a));
+  __m256 hi = _mm256_rsqrt_ps(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1)));
+  return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+inline __mmask16 vcmplt(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+inline __mmask16 vcmple(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+inline __mmask16 vor(__mmask16 a, __mmask16 b) { return __mmask16(a | b); }
+inline __mmask16 vandnot(__mmask16 a, __mmask16 b) { return __mmask16(~a & b); }
+inline __m512 vselect(__mmask16 mask, __m512 a, __m512 b) { return _mm512_mask_blend_ps(mask, b, a); }
+inline unsigned vbits(__mmask16 mask) { return unsigned(mask); }
+
+template<> inline __m512 vset1<__m512>(float x) { return _mm512_set1_ps(x); }
+template<> inline __m512 vload<__m512>(const float* p) { return _mm512_loadu_ps(p); }
+template<> inline __m512 vloadLanes<__m512>(const float* p, size_t stride)
+{
+  __m512 a = _mm512_castps128_ps512(_mm_loadu_ps(p));
+  a = _mm512_insertf32x4(a, _mm_loadu_ps(p + stride), 1);
+  a = _mm512_insertf32x4(a, _mm_loadu_ps(p + 2 * stride), 2);
+  return _mm512_insertf32x4(a, _mm_loadu_ps(p + 3 * stride), 3);
+}
+inline void vstore(float* p, __m512 a) { _mm512_storeu_ps(p, a); }
+inline void vstoreLanes(float* p, size_t stride, __m512 a)
+{
+  _mm_storeu_ps(p, _mm512_castps512_ps128(a));
+  _mm_storeu_ps(p + stride, _mm512_extractf32x4_ps(a, 1));
+  _mm_storeu_ps(p + 2 * stride, _mm512_extractf32x4_ps(a, 2));
+  _mm_storeu_ps(p + 3 * stride, _mm512_extractf32x4_ps(a, 3));
+}
+
+typedef __m512 Pack;
+typedef __mmask16 Mask;
+inline Mask vnone() { return 0; }
+
+#endif
+
+// ---- Helpers, shuffles stay within 4-float lanes ----
+
+template<typename P>
+void transpose4(P& r0, P& r1, P& r2, P& r3)
+{
+  P t0 = vunpacklo(r0, r1);
+  P t1 = vunpackhi(r0, r1);
+  P t2 = vunpacklo(r2, r3);
+  P t3 = vunpackhi(r2, r3);
+  r0 = vshuffle<_MM_SHUFFLE(1, 0, 1, 0)>(t0, t2);
+  r1 = vshuffle<_MM_SHUFFLE(3, 2, 3, 2)>(t0, t2);
+  r2 = vshuffle<_MM_SHUFFLE(1, 0, 1, 0)>(t1, t3);
+  r3 = vshuffle<_MM_SHUFFLE(3, 2, 3, 2)>(t1, t3);
+}
+
+// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3  ->  x = x0 x1 x2 x3, ...
+template<typename P>
+void transposeAoS3(P& x, P& y, P& z, P a, P b, P c)
+{
+  P t0 = vshuffle<_MM_SHUFFLE(2, 1, 3, 2)>(b, c);  // x2 y2 x3 y3
+  P t1 = vshuffle<_MM_SHUFFLE(1, 0, 2, 1)>(a, b);  // y0 z0 y1 z1
+  x = vshuffle<_MM_SHUFFLE(2, 0, 3, 0)>(a, t0);
+  y = vshuffle<_MM_SHUFFLE(3, 1, 2, 0)>(t1, t0);
+  z = vshuffle<_MM_SHUFFLE(3, 0, 3, 1)>(t1, c);
+}
+
+// Inverse of transposeAoS3.
+template<typename P>
+void transposeSoA3(P& a, P& b, P& c, P x, P y, P z)
+{
+  P lo = vunpacklo(x, y);  // x0 y0 x1 y1
+  P hi = vunpackhi(x, y);  // x2 y2 x3 y3
+  a = vshuffle<_MM_SHUFFLE(2, 0, 1, 0)>(lo, vshuffle<_MM_SHUFFLE(2, 2, 0, 0)>(z, lo));
+  b = vshuffle<_MM_SHUFFLE(1, 0, 2, 0)>(vshuffle<_MM_SHUFFLE(1, 1, 3, 3)>(lo, z), hi);
+  c = vshuffle<_MM_SHUFFLE(2, 0, 2, 0)>(vshuffle<_MM_SHUFFLE(2, 2, 2, 2)>(z, hi),
+                                        vshuffle<_MM_SHUFFLE(3, 3, 3, 3)>(hi, z));
+}
+
+// Load points p[0 .. width) into SoA form.
+template<typename P>
+void loadAoS3(P& x, P& y, P& z, const float* p)
+{
+  transposeAoS3(x, y, z, vloadLanes<P>(p, 12), vloadLanes<P>(p + 4, 12), vloadLanes<P>(p + 8, 12));
+}
+
+template<typename P>
+void storeAoS3(float* p, P x, P y, P z)
+{
+  P a, b, c;
+  transposeSoA3(a, b, c, x, y, z);
+  vstoreLanes(p, 12, a);
+  vstoreLanes(p + 4, 12, b);
+  vstoreLanes(p + 8, 12, c);
+}
+
+// Same order of operations as mul(const Mat3x4f&, const Vec3f&).
+template<typename P>
+void mul3x4(P& rx, P& ry, P& rz, const P* m, P x, P y, P z)
+{
+  rx = vadd(vadd(vadd(vmul(m[0], x), vmul(m[3], y)), vmul(m[6], z)), m[9]);
+  ry = vadd(vadd(vadd(vmul(m[1], x), vmul(m[4], y)), vmul(m[7], z)), m[10]);
+  rz = vadd(vadd(vadd(vmul(m[2], x), vmul(m[5], y)), vmul(m[8], z)), m[11]);
+}
+
+template<typename P>
+void splat(P* m, const Mat3x4f& M)
+{
+  for (unsigned i = 0; i < 12; i++) m[i] = vset1<P>(M.data[i]);
+}
+
+// Load matrices M[0 .. width) into SoA form, m[i] holds data[i] of each matrix.
+template<typename P>
+void loadSoA(P* m, const Mat3x4f* M)
+{
+  for (unsigned i = 0; i < 12; i += 4) {
+    for (unsigned j = 0; j < 4; j++) {
+      m[i + j] = vloadLanes<P>(M[j].data + i, 4 * 12);
+    }
+    transpose4(m[i + 0], m[i + 1], m[i + 2], m[i + 3]);
+  }
+}
+
+// Load boxes B[0 .. width) into SoA form, b[i] holds data[i] of each box.
+template<typename P>
+void loadSoA(P* b, const BBox3f* B)
+{
+  P t[4];
+  for (unsigned j = 0; j < 4; j++) {
+    t[j] = vloadLanes<P>(B[j].data + 2, 4 * 6);
+    b[j] = vloadLanes<P>(B[j].data, 4 * 6);
+  }
+  transpose4(t[0], t[1], t[2], t[3]);
+  transpose4(b[0], b[1], b[2], b[3]);
+  b[4] = t[2];
+  b[5] = t[3];
+}
+
+template<typename P>
+void storeSoA(BBox3f* B, const P* b)
+{
+  P t0 = b[2], t1 = b[3], t2 = b[4], t3 = b[5];
+  transpose4(t0, t1, t2, t3);
+  P s0 = b[0], s1 = b[1], s2 = b[2], s3 = b[3];
+  transpose4(s0, s1, s2, s3);
+  vstoreLanes(B[0].data, 4 * 6, s0);  vstoreLanes(B[0].data + 2, 4 * 6, t0);
+  vstoreLanes(B[1].data, 4 * 6, s1);  vstoreLanes(B[1].data + 2, 4 * 6, t1);
+  vstoreLanes(B[2].data, 4 * 6, s2);  vstoreLanes(B[2].data + 2, 4 * 6, t2);
+  vstoreLanes(B[3].data, 4 * 6, s3);  vstoreLanes(B[3].data + 2, 4 * 6, t3);
+}
+
+// Same order of operations as transform(const Mat3x4f&, const BBox3f&).
+template<typename P>
+void transformSoA(P* r, const P* m, const P* b)
+{
+  P half = vset1<P>(0.5f);
+  P cx = vmul(half, vadd(b[3], b[0]));
+  P cy = vmul(half, vadd(b[4], b[1]));
+  P cz = vmul(half, vadd(b[5], b[2]));
+  P ex = vmul(half, vsub(b[3], b[0]));
+  P ey = vmul(half, vsub(b[4], b[1]));
+  P ez = vmul(half, vsub(b[5], b[2]));
+
+  P C[3];
+  mul3x4(C[0], C[1], C[2], m, cx, cy, cz);
+
+  P ax = vabs(cx);
+  P ay = vabs(cy);
+  P az = vabs(cz);
+  P padding = vset1<P>(bboxTransformPadding);
+
+  auto empty = vcmplt(b[3], b[0]);
+  for (unsigned k = 0; k < 3; k++) {
+    P E = vadd(vadd(vmul(vabs(m[k]), ex),
+                    vmul(vabs(m[3 + k]), ey)),
+               vmul(vabs(m[6 + k]), ez));
+    P S = vadd(vadd(vadd(vmul(vabs(m[k]), ax),
+                         vmul(vabs(m[3 + k]), ay)),
+                    vmul(vabs(m[6 + k]), az)),
+               vabs(m[9 + k]));
+    E = vadd(E, vmul(padding, vadd(S, E)));
+    r[k] = vselect(empty, vset1<P>(FLT_MAX), vsub(C[k], E));
+    r[3 + k] = vselect(empty, vset1<P>(-FLT_MAX), vadd(C[k], E));
+  }
+}
+
+template<typename P>
+P dotSoA(P ax, P ay, P az, P bx, P by, P bz)
+{
+  return vadd(vadd(vmul(ax, bx), vmul(ay, by)), vmul(az, bz));
+}
+
+// Load matrices M[0 .. width) into SoA form, m[i] holds data[i] of each
+// matrix. The last 4-float group starts at data[5] to stay inside M.
+template<typename P>
+void loadSoA(P* m, const Mat3f* M)
+{
+  P t[4];
+  for (unsigned j = 0; j < 4; j++) {
+    m[j] = vloadLanes<P>(M[j].data, 4 * 9);
+    m[4 + j] = vloadLanes<P>(M[j].data + 4, 4 * 9);
+    t[j] = vloadLanes<P>(M[j].data + 5, 4 * 9);
+  }
+  transpose4(m[0], m[1], m[2], m[3]);
+  transpose4(m[4], m[5], m[6], m[7]);
+  transpose4(t[0], t[1], t[2], t[3]);
+  m[8] = t[3];
+}
+
+template<typename P>
+void storeSoA(Mat3f* M, const P* m)
+{
+  P s[4] = { m[0], m[1], m[2], m[3] };
+  P t[4] = { m[4], m[5], m[6], m[7] };
+  P u[4] = { m[5], m[6], m[7], m[8] };
+  transpose4(s[0], s[1], s[2], s[3]);
+  transpose4(t[0], t[1], t[2], t[3]);
+  transpose4(u[0], u[1], u[2], u[3]);
+  for (unsigned j = 0; j < 4; j++) {
+    vstoreLanes(M[j].data + 5, 4 * 9, u[j]);
+    vstoreLanes(M[j].data, 4 * 9, s[j]);
+    vstoreLanes(M[j].data + 4, 4 * 9, t[j]);
+  }
+}
+
+// Two matrices into SoA form.
+inline void loadSoA(__m128d* m, const Mat3d* M)
+{
+  for (unsigned i = 0; i < 8; i += 2) {
+    __m128d a = _mm_loadu_pd(M[0].data + i);
+    __m128d b = _mm_loadu_pd(M[1].data + i);
+    m[i] = _mm_unpacklo_pd(a, b);
+    m[i + 1] = _mm_unpackhi_pd(a, b);
+  }
+  m[8] = _mm_loadh_pd(_mm_load_sd(M[0].data + 8), M[1].data + 8);
+}
+
+inline void storeSoA(Mat3d* M, const __m128d* m)
+{
+  for (unsigned i = 0; i < 8; i += 2) {
+    _mm_storeu_pd(M[0].data + i, _mm_unpacklo_pd(m[i], m[i + 1]));
+    _mm_storeu_pd(M[1].data + i, _mm_unpackhi_pd(m[i], m[i + 1]));
+  }
+  _mm_storel_pd(M[0].data + 8, m[8]);
+  _mm_storeh_pd(M[1].data + 8, m[8]);
+}
+
+// Rows of the inverse and the determinant, same order of operations as
+// inverse(const Mat3f&). r[3 * i + k] is component k of row i, which is
+// data[3 * i + k] of the inverse-transpose.
+template<typename P>
+P inverseRowsSoA(P* r, const P* m, P one)
+{
+  for (unsigned i = 0; i < 3; i++) {
+    const P* a = m + 3 * ((i + 1) % 3);
+    const P* b = m + 3 * ((i + 2) % 3);
+    r[3 * i + 0] = vsub(vmul(a[1], b[2]), vmul(a[2], b[1]));
+    r[3 * i + 1] = vsub(vmul(a[2], b[0]), vmul(a[0], b[2]));
+    r[3 * i + 2] = vsub(vmul(a[0], b[1]), vmul(a[1], b[0]));
+  }
+  P det = dotSoA(r[6], r[7], r[8], m[6], m[7], m[8]);
+  P invDet = vdiv(one, det);
+  for (unsigned k = 0; k < 9; k++) r[k] = vmul(invDet, r[k]);
+  return det;
+}
+
+// Bit l is set if lane l is isSingular, lanes is the number of lanes.
+template<typename P>
+unsigned singularBits(P det, P min, P max, unsigned lanes)
+{
+  P a = vabs(det);
+  return ~(vbits(vcmple(min, a)) & vbits(vcmple(a, max))) & ((1u << lanes) - 1);
+}
+
+// Inverses of Mat3f or Mat3d in blocks of width matrices, returns the number done.
+template<bool Transposed, typename T, typename P>
+size_t inversesSoA(Mat3<T>* dst, uint32_t* singular, const Mat3<T>* src, size_t N, unsigned width, P one, P min, P max)
+{
+  size_t i = 0;
+  for (; i + width <= N; i += width) {
+    P m[9], r[9];
+    loadSoA(m, src + i);
+    P det = inverseRowsSoA(r, m, one);
+    if (Transposed) {
+      storeSoA(dst + i, r);
+    }
+    else {
+      for (unsigned k = 0; k < 9; k++) m[k] = r[3 * (k % 3) + k / 3];
+      storeSoA(dst + i, m);
+    }
+    if (singular) singular[i / 32] |= uint32_t(singularBits(det, min, max, width)) << (i % 32);
+  }
+  return i;
+}
+
+// ---- Singular value decomposition, same operations as in LinAlgOps.cpp ----
+
+template<typename P>
+P elementScaleSoA(const P* m)
+{
+  P zero = vset1<P>(0.f);
+  P s = zero;
+  for (unsigned k = 0; k < 9; k++) {
+    P a = vabs(m[k]);
+    s = vselect(vcmplt(s, a), a, s);
+  }
+  return vselect(vcmplt(zero, s), s, vset1<P>(1.f));
+}
+
+template<typename P>
+void jacobiRotateSoA(P (&a)[3][3], P (&v)[3][3], unsigned p, unsigned q)
+{
+  P zero = vset1<P>(0.f);
+  unsigned r = 3 - p - q;
+  P o = a[p][q];
+  P d = vsub(a[q][q], a[p][p]);
+  P h = vsqrt(vadd(vmul(d, d), vmul(vmul(vset1<P>(4.f), o), o)));
+  P den = vadd(vabs(d), h);
+  P t = vdiv(vmul(vset1<P>(2.f), o), den);
+  t = vselect(vcmplt(d, zero), vmul(vset1<P>(-1.f), t), t);
+  t = vselect(vcmplt(zero, den), t, zero);
+  P c = vdiv(vset1<P>(1.f), vsqrt(vadd(vset1<P>(1.f), vmul(t, t))));
+  P s = vmul(t, c);
+
+  P to = vmul(t, o);
+  a[p][p] = vsub(a[p][p], to);
+  a[q][q] = vadd(a[q][q], to);
+  a[p][q] = a[q][p] = zero;
+  P ap = a[r][p];
+  P aq = a[r][q];
+  a[r][p] = a[p][r] = vsub(vmul(c, ap), vmul(s, aq));
+  a[r][q] = a[q][r] = vadd(vmul(s, ap), vmul(c, aq));
+  for (unsigned k = 0; k < 3; k++) {
+    P vp = v[p][k];
+    P vq = v[q][k];
+    v[p][k] = vsub(vmul(c, vp), vmul(s, vq));
+    v[q][k] = vadd(vmul(s, vp), vmul(c, vq));
+  }
+}
+
+template<typename P>
+void eigenATASoA(P* lambda, P (&v)[3][3], const P* m)
+{
+  P a[3][3];
+  for (unsigned i = 0; i < 3; i++) {
+    for (unsigned j = i; j < 3; j++) {
+      a[i][j] = a[j][i] = dotSoA(m[3 * i], m[3 * i + 1], m[3 * i + 2], m[3 * j], m[3 * j + 1], m[3 * j + 2]);
+    }
+  }
+  for (unsigned i = 0; i < 3; i++) {
+    for (unsigned k = 0; k < 3; k++) v[i][k] = vset1<P>(i == k ? 1.f : 0.f);
+  }
+  for (unsigned sweep = 0; sweep < svdSweeps; sweep++) {
+    jacobiRotateSoA(a, v, 0, 1);
+    jacobiRotateSoA(a, v, 0, 2);
+    jacobiRotateSoA(a, v, 1, 2);
+  }
+  for (unsigned k = 0; k < 3; k++) lambda[k] = a[k][k];
+}
+
+template<typename P>
+void sortPairSoA(P* lambda, P (&v)[3][3], unsigned p, unsigned q)
+{
+  auto swap = vcmplt(lambda[p], lambda[q]);
+  P lp = lambda[p];
+  lambda[p] = vselect(swap, lambda[q], lp);
+  lambda[q] = vselect(swap, lp, lambda[q]);
+  for (unsigned k = 0; k < 3; k++) {
+    P vp = v[p][k];
+    v[p][k] = vselect(swap, v[q][k], vp);
+    v[q][k] = vselect(swap, vmul(vset1<P>(-1.f), vp), v[q][k]);
+  }
+}
+
+template<typename P>
+P svdColumnsSoA(P (&u)[3][3], P* sigma, P (&v)[3][3], const P* M)
+{
+  P scale = elementScaleSoA(M);
+  P invScale = vdiv(vset1<P>(1.f), scale);
+  P m[9];
+  for (unsigned k = 0; k < 9; k++) m[k] = vmul(invScale, M[k]);
+
+  P lambda[3];
+  eigenATASoA(lambda, v, m);
+  sortPairSoA(lambda, v, 0, 1);
+  sortPairSoA(lambda, v, 0, 2);
+  sortPairSoA(lambda, v, 1, 2);
+
+  P b[3][3];
+  for (unsigned i = 0; i < 3; i++) {
+    for (unsigned k = 0; k < 3; k++) b[i][k] = dotSoA(m[k], m[3 + k], m[6 + k], v[i][0], v[i][1], v[i][2]);
+  }
+
+  P one = vset1<P>(1.f);
+  P l0 = dotSoA(b[0][0], b[0][1], b[0][2], b[0][0], b[0][1], b[0][2]);
+  P r0 = vdiv(one, vsqrt(l0));
+  auto ok0 = vcmple(vset1<P>(FLT_MIN), l0);
+  for (unsigned k = 0; k < 3; k++) u[0][k] = vselect(ok0, vmul(r0, b[0][k]), vset1<P>(k == 0 ? 1.f : 0.f));
+
+  P d = dotSoA(u[0][0], u[0][1], u[0][2], b[1][0], b[1][1], b[1][2]);
+  P w[3];
+  for (unsigned k = 0; k < 3; k++) w[k] = vsub(b[1][k], vmul(d, u[0][k]));
+  P l1 = dotSoA(w[0], w[1], w[2], w[0], w[1], w[2]);
+  P r1 = vdiv(one, vsqrt(l1));
+  auto ok1 = vcmplt(vmul(vset1<P>(svdRankTolerance), l0), l1);
+  auto useX = vcmplt(vabs(u[0][0]), vset1<P>(0.5f));
+  P zero = vset1<P>(0.f);
+  P minusOne = vset1<P>(-1.f);
+  P e[3] = { vselect(useX, zero, vmul(minusOne, u[0][2])),
+             vselect(useX, u[0][2], zero),
+             vselect(useX, vmul(minusOne, u[0][1]), u[0][0]) };
+  P re = vdiv(one, vsqrt(dotSoA(e[0], e[1], e[2], e[0], e[1], e[2])));
+  for (unsigned k = 0; k < 3; k++) u[1][k] = vselect(ok1, vmul(r1, w[k]), vmul(re, e[k]));
+
+  u[2][0] = vsub(vmul(u[0][1], u[1][2]), vmul(u[0][2], u[1][1]));
+  u[2][1] = vsub(vmul(u[0][2], u[1][0]), vmul(u[0][0], u[1][2]));
+  u[2][2] = vsub(vmul(u[0][0], u[1][1]), vmul(u[0][1], u[1][0]));
+
+  for (unsigned i = 0; i < 3; i++) sigma[i] = dotSoA(u[i][0], u[i][1], u[i][2], b[i][0], b[i][1], b[i][2]);
+  return scale;
+}
+
+// Same as getScale(const Mat3f&) for the elements m of two matrices.
+inline __m128d largestSingularValueSoA(const __m128d* m)
+{
+  __m128d a00 = vadd(vadd(vmul(m[0], m[0]), vmul(m[1], m[1])), vmul(m[2], m[2]));
+  __m128d a11 = vadd(vadd(vmul(m[3], m[3]), vmul(m[4], m[4])), vmul(m[5], m[5]));
+  __m128d a22 = vadd(vadd(vmul(m[6], m[6]), vmul(m[7], m[7])), vmul(m[8], m[8]));
+  __m128d a01 = vadd(vadd(vmul(m[0], m[3]), vmul(m[1], m[4])), vmul(m[2], m[5]));
+  __m128d a02 = vadd(vadd(vmul(m[0], m[6]), vmul(m[1], m[7])), vmul(m[2], m[8]));
+  __m128d a12 = vadd(vadd(vmul(m[3], m[6]), vmul(m[4], m[7])), vmul(m[5], m[8]));
+
+  __m128d zero = _mm_set1_pd(0.0);
+  __m128d one = _mm_set1_pd(1.0);
+  __m128d minusOne = _mm_set1_pd(-1.0);
+  __m128d half = _mm_set1_pd(0.5);
+  __m128d two = _mm_set1_pd(2.0);
+  __m128d q = vmul(vadd(vadd(a00, a11), a22), _mm_set1_pd(1.0 / 3.0));
+  __m128d d0 = vsub(a00, q);
+  __m128d d1 = vsub(a11, q);
+  __m128d d2 = vsub(a22, q);
+  __m128d o = vadd(vadd(vmul(a01, a01), vmul(a02, a02)), vmul(a12, a12));
+  __m128d p2 = vmul(vadd(vadd(vadd(vmul(d0, d0), vmul(d1, d1)), vmul(d2, d2)), vmul(two, o)), _mm_set1_pd(1.0 / 6.0));
+  __m128d p = vsqrt(p2);
+  __m128d p3 = vmul(vmul(two, p2), p);
+  __m128d det = vadd(vsub(vmul(d0, vsub(vmul(d1, d2), vmul(a12, a12))),
+                          vmul(a01, vsub(vmul(a01, d2), vmul(a12, a02)))),
+                     vmul(a02, vsub(vmul(a01, a12), vmul(d1, a02))));
+  __m128d r = vselect(vcmplt(zero, p3), vdiv(det, p3), zero);
+  r = vselect(vcmplt(r, minusOne), minusOne, r);
+  r = vselect(vcmplt(one, r), one, r);
+  __m128d x = vsub(vmul(two, vsqrt(vadd(half, vmul(half, r)))), one);
+
+  __m128d c[10];
+  for (unsigned k = 0; k < 10; k++) c[k] = _mm_set1_pd(scaleAngleCoefficients[k]);
+  __m128d x2 = vmul(x, x);
+  __m128d x4 = vmul(x2, x2);
+  __m128d g = vadd(vadd(vadd(c[0], vmul(c[1], x)), vmul(x2, vadd(c[2], vmul(c[3], x)))),
+                   vmul(x4, vadd(vadd(c[4], vmul(c[5], x)), vmul(x2, vadd(c[6], vmul(c[7], x))))));
+  g = vadd(g, vmul(vmul(x4, x4), vadd(c[8], vmul(c[9], x))));
+  return vsqrt(vadd(q, vmul(vmul(two, p), g)));
+}
+
+// Same as getScale(const Mat3f&) for the first 9 elements of M, four matrices.
+inline __m128 scaleSoA(const __m128* M)
+{
+  __m128d lo[9], hi[9];
+  for (unsigned k = 0; k < 9; k++) {
+    lo[k] = _mm_cvtps_pd(M[k]);
+    hi[k] = _mm_cvtps_pd(_mm_movehl_ps(M[k], M[k]));
+  }
+  return _mm_movelh_ps(_mm_cvtpd_ps(largestSingularValueSoA(lo)), _mm_cvtpd_ps(largestSingularValueSoA(hi)));
+}
+
+// Same as rsqrt(x, FastPrecision).
+template<typename P>
+P rsqrtSoA(P x)
+{
+  P r = vrsqrt(x);
+  r = vmul(r, vsub(vset1<P>(1.5f), vmul(vmul(vmul(vset1<P>(0.5f), x), r), r)));
+  return vselect(vcmplt(x, vset1<P>(FLT_MIN)), vset1<P>(0.f), r);
+}
+
+// Length and reciprocal length from squared length, as in LinAlgOps.h.
+template<typename P> P lengthSoA(P s, ExactPrecision) { return vsqrt(s); }
+template<typename P> P lengthSoA(P s, FastPrecision) { return vmul(s, rsqrtSoA(s)); }
+template<typename P> P invLengthSoA(P s, ExactPrecision) { return vdiv(vset1<P>(1.f), vsqrt(s)); }
+template<typename P> P invLengthSoA(P s, FastPrecision) { return rsqrtSoA(s); }
+
+// Frustum planes splatted across lanes, with the indices into the SoA
+// boxes of loadSoA that give the p- and n-vertex of each plane.
+struct FrustumPlanes
+{
+  Pack n[6][3];
+  Pack d[6];
+  unsigned pIx[6][3];
+  unsigned nIx[6][3];
+};
+
+inline void splat(FrustumPlanes& f, const Frustumf& frustum)
+{
+  for (unsigned j = 0; j < 6; j++) {
+    const Planef& plane = frustum.planes[j];
+    for (unsigned k = 0; k < 3; k++) {
+      bool positive = 0.f < plane.n[k];
+      f.n[j][k] = vset1<Pack>(plane.n[k]);
+      f.pIx[j][k] = positive ? 3 + k : k;
+      f.nIx[j][k] = positive ? k : 3 + k;
+    }
+    f.d[j] = vset1<Pack>(plane.d);
+  }
+}
+
+// Same as classify, bit i of outside or intersecting is set if box i is.
+inline void classifySoA(unsigned& outside, unsigned& intersecting, const FrustumPlanes& f, const Pack* b)
+{
+  const Pack zero = vset1<Pack>(0.f);
+  Mask out = vnone();
+  Mask cut = vnone();
+  for (unsigned j = 0; j < 6; j++) {
+    const Pack* n = f.n[j];
+    const unsigned* p = f.pIx[j];
+    const unsigned* q = f.nIx[j];
+    Pack dp = vadd(vadd(vadd(vmul(n[0], b[p[0]]), vmul(n[1], b[p[1]])), vmul(n[2], b[p[2]])), f.d[j]);
+    Pack dn = vadd(vadd(vadd(vmul(n[0], b[q[0]]), vmul(n[1], b[q[1]])), vmul(n[2], b[q[2]])), f.d[j]);
+    out = vor(out, vcmplt(dp, zero));
+    cut = vor(cut, vcmplt(dn, zero));
+  }
+  outside = vbits(out);
+  intersecting = vbits(vandnot(out, cut));
+}
+
+// Pack two vectors of 32-bit values in [0, 65535] into eight 16-bit values.
+inline __m128i packUnsigned16(__m128i a, __m128i b)
+{
+  __m128i bias = _mm_set1_epi32(0x8000);
+  return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias)), _mm_set1_epi16(-0x8000));
+}
+
+// Same as makeHalf, result in the low 16 bits of each lane.
+inline __m128i floatToHalf4(__m128 x)
+{
+  const __m128i f32infty = _mm_set1_epi32(255 << 23);
+  const __m128i f16max = _mm_set1_epi32((127 + 16) << 23);
+  const __m128i denormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+
+  __m128i u = _mm_castps_si128(x);
+  __m128i sign = _mm_and_si128(u, _mm_set1_epi32(int(0x80000000u)));
+  u = _mm_xor_si128(u, sign);
+
+  __m128i infNan = _mm_cmpgt_epi32(u, _mm_sub_epi32(f16max, _mm_set1_epi32(1)));
+  __m128i infNanBits = vselect(_mm_cmpgt_epi32(u, f32infty), _mm_set1_epi32(0x7e00), _mm_set1_epi32(0x7c00));
+
+  __m128i denorm = _mm_cmplt_epi32(u, _mm_set1_epi32(113 << 23));
+  __m128i denormBits = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(u), _mm_castsi128_ps(denormMagic))), denormMagic);
+
+  __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(u, 13), _mm_set1_epi32(1));
+  __m128i normalBits = _mm_add_epi32(u, _mm_set1_epi32(int(uint32_t(15 - 127) << 23) + 0xfff));
+  normalBits = _mm_srli_epi32(_mm_add_epi32(normalBits, mantissaOdd), 13);
+
+  __m128i o = vselect(infNan, infNanBits, vselect(denorm, denormBits, normalBits));
+  return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+}
+
+// Same as makeFloat, input in the low 16 bits of each lane.
+inline __m128 halfToFloat4(__m128i h)
+{
+  const __m128i shiftedExp = _mm_set1_epi32(0x7c00 << 13);
+  const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+
+  __m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+  __m128i exp = _mm_and_si128(o, shiftedExp);
+  o = _mm_add_epi32(o, _mm_set1_epi32((127 - 15) << 23));
+  o = _mm_add_epi32(o, _mm_and_si128(_mm_cmpeq_epi32(exp, shiftedExp), _mm_set1_epi32((128 - 16) << 23)));
+  __m128i denorm = _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))), magic));
+  o = vselect(_mm_cmpeq_epi32(exp, _mm_setzero_si128()), denorm, o);
+  return _mm_castsi128_ps(_mm_or_si128(o, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+}
+
+const size_t W = LINALG_KERNEL_WIDTH;
+
+#endif
+
+// ---- Kernels ----
+
+// Clear the (N + 31) / 32 words of a bit mask, if any.
+inline void clearBits(uint32_t* bits, size_t N)
+{
+  if (bits == nullptr) return;
+  for (size_t w = 0; w < (N + 31) / 32; w++) {
+    bits[w] = 0;
+  }
+}
+
+// Min and max ignoring NaN in x, like _mm_min_ps(x, a) and _mm_max_ps(x, a).
+template<typename T> T minNum(T a, T x) { return x < a ? x : a; }
+template<typename T> T maxNum(T a, T x) { return a < x ? x : a; }
+
+void transformPoints(Vec3f* dst, const Mat3x4f& M, const Vec3f* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  Pack m[12];
+  splat(m, M);
+  for (; i + W <= N; i += W) {
+    Pack x, y, z;
+    loadAoS3(x, y, z, src[i].data);
+    mul3x4(x, y, z, m, x, y, z);
+    storeAoS3(dst[i].data, x, y, z);
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = mul(M, src[i]);
+  }
+}
+
+void transformPointsStrided(float* dst, size_t dstStride, const Mat3x4f& M, const float* src, size_t srcStride, size_t N)
+{
+  const char* s = reinterpret_cast<const char*>(src);
+  char* d = reinterpret_cast<char*>(dst);
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  __m128 m[12];
+  splat(m, M);
+  for (; i + 4 <= N; i += 4) {
+    const float* s0 = reinterpret_cast<const float*>(s);
+    const float* s1 = reinterpret_cast<const float*>(s + srcStride);
+    const float* s2 = reinterpret_cast<const float*>(s + 2 * srcStride);
+    const float* s3 = reinterpret_cast<const float*>(s + 3 * srcStride);
+    __m128 x = _mm_setr_ps(s0[0], s1[0], s2[0], s3[0]);
+    __m128 y = _mm_setr_ps(s0[1], s1[1], s2[1], s3[1]);
+    __m128 z = _mm_setr_ps(s0[2], s1[2], s2[2], s3[2]);
+    mul3x4(x, y, z, m, x, y, z);
+
+    alignas(16) float r[3][4];
+    _mm_store_ps(r[0], x);
+    _mm_store_ps(r[1], y);
+    _mm_store_ps(r[2], z);
+    for (unsigned k = 0; k < 4; k++) {
+      float* dk = reinterpret_cast<float*>(d + k * dstStride);
+      dk[0] = r[0][k];
+      dk[1] = r[1][k];
+      dk[2] = r[2][k];
+    }
+    s += 4 * srcStride;
+    d += 4 * dstStride;
+  }
+#endif
+  for (; i < N; i++) {
+    Vec3f r = mul(M, makeVec3f(reinterpret_cast<const float*>(s)));
+    write(reinterpret_cast<float*>(d), r);
+    s += srcStride;
+    d += dstStride;
+  }
+}
+
+// Points stride bytes apart into the arrays dst, dst + pitch and dst + 2 * pitch.
+void splitPoints(float* dst, size_t pitch, const float* src, size_t stride, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  if (stride == sizeof(Vec3f)) {
+    for (; i + W <= N; i += W) {
+      Pack x, y, z;
+      loadAoS3(x, y, z, src + 3 * i);
+      vstore(dst + i, x);
+      vstore(dst + pitch + i, y);
+      vstore(dst + 2 * pitch + i, z);
+    }
+  }
+  else if (16 <= stride) {
+    // Four floats per point, so the last point is left to the scalar loop
+    // to not read past the buffer.
+    for (; i + 4 < N; i += 4) {
+      __m128 x = _mm_loadu_ps(addBytes(src, i * stride));
+      __m128 y = _mm_loadu_ps(addBytes(src, (i + 1) * stride));
+      __m128 z = _mm_loadu_ps(addBytes(src, (i + 2) * stride));
+      __m128 w = _mm_loadu_ps(addBytes(src, (i + 3) * stride));
+      transpose4(x, y, z, w);
+      _mm_storeu_ps(dst + i, x);
+      _mm_storeu_ps(dst + pitch + i, y);
+      _mm_storeu_ps(dst + 2 * pitch + i, z);
+    }
+  }
+#endif
+  for (; i < N; i++) {
+    const float* p = addBytes(src, i * stride);
+    dst[i] = p[0];
+    dst[pitch + i] = p[1];
+    dst[2 * pitch + i] = p[2];
+  }
+}
+
+// Inverse of splitPoints.
+void joinPoints(float* dst, size_t stride, const float* src, size_t pitch, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  if (stride == sizeof(Vec3f)) {
+    for (; i + W <= N; i += W) {
+      storeAoS3(dst + 3 * i, vload<Pack>(src + i), vload<Pack>(src + pitch + i), vload<Pack>(src + 2 * pitch + i));
+    }
+  }
+#endif
+  for (; i < N; i++) {
+    float* p = addBytes(dst, i * stride);
+    p[0] = src[i];
+    p[1] = src[pitch + i];
+    p[2] = src[2 * pitch + i];
+  }
+}
+
+// Boxes into six arrays pitch elements apart.
+void splitBoxes(float* dst, size_t pitch, const BBox3f* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack b[6];
+    loadSoA(b, src + i);
+    for (unsigned k = 0; k < 6; k++) vstore(dst + k * pitch + i, b[k]);
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 6; k++) dst[k * pitch + i] = src[i].data[k];
+  }
+}
+
+void joinBoxes(BBox3f* dst, const float* src, size_t pitch, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack b[6];
+    for (unsigned k = 0; k < 6; k++) b[k] = vload<Pack>(src + k * pitch + i);
+    storeSoA(dst + i, b);
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 6; k++) dst[i].data[k] = src[k * pitch + i];
+  }
+}
+
+// Points in three arrays pitch elements apart, no transposes needed.
+void transformPointsSoA(float* dst, size_t dstPitch, const Mat3x4f& M, const float* src, size_t srcPitch, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  Pack m[12];
+  splat(m, M);
+  for (; i + W <= N; i += W) {
+    Pack x, y, z;
+    mul3x4(x, y, z, m, vload<Pack>(src + i), vload<Pack>(src + srcPitch + i), vload<Pack>(src + 2 * srcPitch + i));
+    vstore(dst + i, x);
+    vstore(dst + dstPitch + i, y);
+    vstore(dst + 2 * dstPitch + i, z);
+  }
+#endif
+  for (; i < N; i++) {
+    Vec3f r = mul(M, makeVec3f(src[i], src[srcPitch + i], src[2 * srcPitch + i]));
+    for (unsigned k = 0; k < 3; k++) dst[k * dstPitch + i] = r[k];
+  }
+}
+
+void transformBoxes(BBox3f* dst, const Mat3x4f& M, const BBox3f* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  Pack m[12];
+  splat(m, M);
+  for (; i + W <= N; i += W) {
+    Pack b[6];
+    loadSoA(b, src + i);
+    transformSoA(b, m, b);
+    storeSoA(dst + i, b);
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = transform(M, src[i]);
+  }
+}
+
+void transformBoxesEach(BBox3f* dst, const Mat3x4f* M, const BBox3f* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack m[12], b[6];
+    loadSoA(m, M + i);
+    loadSoA(b, src + i);
+    transformSoA(b, m, b);
+    storeSoA(dst + i, b);
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = transform(M[i], src[i]);
+  }
+}
+
+BBox2f boundsVec2f(const Vec2f* p, size_t N)
+{
+  BBox2f r = makeEmptyBBox2f();
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // Lane j holds component j % 2.
+  Pack lo = vset1<Pack>(FLT_MAX);
+  Pack hi = vset1<Pack>(-FLT_MAX);
+  for (; i + W / 2 <= N; i += W / 2) {
+    Pack a = vload<Pack>(p[i].data);
+    lo = vmin(a, lo);
+    hi = vmax(a, hi);
+  }
+  alignas(64) float l[W], h[W];
+  vstore(l, lo);
+  vstore(h, hi);
+  for (unsigned j = 0; j < W; j++) {
+    r.min[j % 2] = minNum(r.min[j % 2], l[j]);
+    r.max[j % 2] = maxNum(r.max[j % 2], h[j]);
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 2; k++) {
+      r.min[k] = minNum(r.min[k], p[i][k]);
+      r.max[k] = maxNum(r.max[k], p[i][k]);
+    }
+  }
+  return r;
+}
+
+BBox3f boundsVec3f(const Vec3f* p, size_t N)
+{
+  BBox3f r = makeEmptyBBox3f();
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // W points are three registers, x0 y0 z0 x1 | y1 z1 x2 y2 | ..., keep
+  // per-lane min and max and sort out the components at the end.
+  Pack lo[3], hi[3];
+  for (unsigned k = 0; k < 3; k++) {
+    lo[k] = vset1<Pack>(FLT_MAX);
+    hi[k] = vset1<Pack>(-FLT_MAX);
+  }
+  for (; i + W <= N; i += W) {
+    const float* q = p[i].data;
+    for (unsigned k = 0; k < 3; k++) {
+      Pack a = vload<Pack>(q + W * k);
+      lo[k] = vmin(a, lo[k]);
+      hi[k] = vmax(a, hi[k]);
+    }
+  }
+  alignas(64) float l[3 * W], h[3 * W];
+  for (unsigned k = 0; k < 3; k++) {
+    vstore(l + W * k, lo[k]);
+    vstore(h + W * k, hi[k]);
+  }
+  for (unsigned j = 0; j < 3 * W; j++) {
+    r.min[j % 3] = minNum(r.min[j % 3], l[j]);
+    r.max[j % 3] = maxNum(r.max[j % 3], h[j]);
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 3; k++) {
+      r.min[k] = minNum(r.min[k], p[i][k]);
+      r.max[k] = maxNum(r.max[k], p[i][k]);
+    }
+  }
+  return r;
+}
+
+BBox3f boundsSoA(const float* p, size_t pitch, size_t N)
+{
+  BBox3f r = makeEmptyBBox3f();
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  Pack lo[3], hi[3];
+  for (unsigned k = 0; k < 3; k++) {
+    lo[k] = vset1<Pack>(FLT_MAX);
+    hi[k] = vset1<Pack>(-FLT_MAX);
+  }
+  for (; i + W <= N; i += W) {
+    for (unsigned k = 0; k < 3; k++) {
+      Pack a = vload<Pack>(p + k * pitch + i);
+      lo[k] = vmin(a, lo[k]);
+      hi[k] = vmax(a, hi[k]);
+    }
+  }
+  alignas(64) float l[W], h[W];
+  for (unsigned k = 0; k < 3; k++) {
+    vstore(l, lo[k]);
+    vstore(h, hi[k]);
+    for (unsigned j = 0; j < W; j++) {
+      r.min[k] = minNum(r.min[k], l[j]);
+      r.max[k] = maxNum(r.max[k], h[j]);
+    }
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 3; k++) {
+      r.min[k] = minNum(r.min[k], p[k * pitch + i]);
+      r.max[k] = maxNum(r.max[k], p[k * pitch + i]);
+    }
+  }
+  return r;
+}
+
+BBox3f boundsBBox3f(const BBox3f* b, size_t N)
+{
+  BBox3f r = makeEmptyBBox3f();
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // W boxes are six registers, lane j holds min component j % 6 if j % 6 < 3
+  // and max component j % 6 - 3 otherwise, keep both min and max per lane.
+  Pack lo[6], hi[6];
+  for (unsigned k = 0; k < 6; k++) {
+    lo[k] = vset1<Pack>(FLT_MAX);
+    hi[k] = vset1<Pack>(-FLT_MAX);
+  }
+  for (; i + W <= N; i += W) {
+    const float* q = b[i].min.data;
+    for (unsigned k = 0; k < 6; k++) {
+      Pack a = vload<Pack>(q + W * k);
+      lo[k] = vmin(a, lo[k]);
+      hi[k] = vmax(a, hi[k]);
+    }
+  }
+  alignas(64) float l[6 * W], h[6 * W];
+  for (unsigned k = 0; k < 6; k++) {
+    vstore(l + W * k, lo[k]);
+    vstore(h + W * k, hi[k]);
+  }
+  for (unsigned j = 0; j < 6 * W; j++) {
+    if (j % 6 < 3) r.min[j % 6] = minNum(r.min[j % 6], l[j]);
+    else r.max[j % 6 - 3] = maxNum(r.max[j % 6 - 3], h[j]);
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 3; k++) {
+      r.min[k] = minNum(r.min[k], b[i].min[k]);
+      r.max[k] = maxNum(r.max[k], b[i].max[k]);
+    }
+  }
+  return r;
+}
+
+BBox3d boundsVec3d(const Vec3d* p, size_t N)
+{
+  BBox3d r = makeEmptyBBox3d();
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // Two points are three registers, x0 y0 | z0 x1 | y1 z1.
+  __m128d lo[3], hi[3];
+  for (unsigned k = 0; k < 3; k++) {
+    lo[k] = _mm_set1_pd(DBL_MAX);
+    hi[k] = _mm_set1_pd(-DBL_MAX);
+  }
+  for (; i + 2 <= N; i += 2) {
+    const double* q = p[i].data;
+    for (unsigned k = 0; k < 3; k++) {
+      __m128d a = _mm_loadu_pd(q + 2 * k);
+      lo[k] = _mm_min_pd(a, lo[k]);
+      hi[k] = _mm_max_pd(a, hi[k]);
+    }
+  }
+  alignas(16) double l[6], h[6];
+  for (unsigned k = 0; k < 3; k++) {
+    _mm_store_pd(l + 2 * k, lo[k]);
+    _mm_store_pd(h + 2 * k, hi[k]);
+  }
+  for (unsigned j = 0; j < 6; j++) {
+    r.min[j % 3] = minNum(r.min[j % 3], l[j]);
+    r.max[j % 3] = maxNum(r.max[j % 3], h[j]);
+  }
+#endif
+  for (; i < N; i++) {
+    for (unsigned k = 0; k < 3; k++) {
+      r.min[k] = minNum(r.min[k], p[i][k]);
+      r.max[k] = maxNum(r.max[k], p[i][k]);
+    }
+  }
+  return r;
+}
+
+BBox3f boundsStrided(const char* p, size_t stride, size_t N)
+{
+  BBox3f r = makeEmptyBBox3f();
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  __m128 lo[3], hi[3];
+  for (unsigned k = 0; k < 3; k++) {
+    lo[k] = _mm_set1_ps(FLT_MAX);
+    hi[k] = _mm_set1_ps(-FLT_MAX);
+  }
+  for (; i + 4 <= N; i += 4) {
+    const float* q0 = reinterpret_cast<const float*>(p);
+    const float* q1 = reinterpret_cast<const float*>(p + stride);
+    const float* q2 = reinterpret_cast<const float*>(p + 2 * stride);
+    const float* q3 = reinterpret_cast<const float*>(p + 3 * stride);
+    for (unsigned k = 0; k < 3; k++) {
+      __m128 a = _mm_setr_ps(q0[k], q1[k], q2[k], q3[k]);
+      lo[k] = _mm_min_ps(a, lo[k]);
+      hi[k] = _mm_max_ps(a, hi[k]);
+    }
+    p += 4 * stride;
+  }
+  alignas(16) float l[4], h[4];
+  for (unsigned k = 0; k < 3; k++) {
+    _mm_store_ps(l, lo[k]);
+    _mm_store_ps(h, hi[k]);
+    r.min[k] = minNum(minNum(l[0], l[1]), minNum(l[2], l[3]));
+    r.max[k] = maxNum(maxNum(h[0], h[1]), maxNum(h[2], h[3]));
+  }
+#endif
+  for (; i < N; i++) {
+    const float* q = reinterpret_cast<const float*>(p);
+    for (unsigned k = 0; k < 3; k++) {
+      r.min[k] = minNum(r.min[k], q[k]);
+      r.max[k] = maxNum(r.max[k], q[k]);
+    }
+    p += stride;
+  }
+  return r;
+}
+
+template<typename Precision>
+void lengths(float* dst, const Vec3f* src, size_t N, Precision precision)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack x, y, z;
+    loadAoS3(x, y, z, src[i].data);
+    vstore(dst + i, lengthSoA(dotSoA(x, y, z, x, y, z), precision));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = length(src[i], precision);
+  }
+}
+
+template<typename Precision>
+void distances(float* dst, const Vec3f* a, const Vec3f* b, size_t N, Precision precision)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack ax, ay, az, bx, by, bz;
+    loadAoS3(ax, ay, az, a[i].data);
+    loadAoS3(bx, by, bz, b[i].data);
+    Pack x = vsub(ax, bx);
+    Pack y = vsub(ay, by);
+    Pack z = vsub(az, bz);
+    vstore(dst + i, lengthSoA(dotSoA(x, y, z, x, y, z), precision));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = distance(a[i], b[i], precision);
+  }
+}
+
+template<typename Precision>
+void normalizes(Vec3f* dst, const Vec3f* src, size_t N, Precision precision)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack x, y, z;
+    loadAoS3(x, y, z, src[i].data);
+    Pack r = invLengthSoA(dotSoA(x, y, z, x, y, z), precision);
+    storeAoS3(dst[i].data, vmul(r, x), vmul(r, y), vmul(r, z));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = normalize(src[i], precision);
+  }
+}
+
+void skinLinear(Vec3f* dst, const Vec3f* src, const Vec4u* bones, const Vec4f* weights, const Mat3x4f* transforms, size_t N)
+{
+  for (size_t i = 0; i < N; i++) {
+    const Vec4u& b = bones[i];
+    const Vec4f& w = weights[i];
+    Mat3x4f M;
+#if LINALG_KERNEL_WIDTH
+    __m128 m0 = _mm_setzero_ps();
+    __m128 m1 = _mm_setzero_ps();
+    __m128 m2 = _mm_setzero_ps();
+    for (unsigned k = 0; k < 4; k++) {
+      __m128 wk = _mm_set1_ps(w[k]);
+      const float* t = transforms[b[k]].data;
+      m0 = _mm_add_ps(m0, _mm_mul_ps(wk, _mm_loadu_ps(t)));
+      m1 = _mm_add_ps(m1, _mm_mul_ps(wk, _mm_loadu_ps(t + 4)));
+      m2 = _mm_add_ps(m2, _mm_mul_ps(wk, _mm_loadu_ps(t + 8)));
+    }
+    _mm_storeu_ps(M.data, m0);
+    _mm_storeu_ps(M.data + 4, m1);
+    _mm_storeu_ps(M.data + 8, m2);
+#else
+    for (unsigned j = 0; j < 12; j++) {
+      M.data[j] = 0.f;
+      for (unsigned k = 0; k < 4; k++) {
+        M.data[j] += w[k] * transforms[b[k]].data[j];
+      }
+    }
+#endif
+    dst[i] = mul(M, src[i]);
+  }
+}
+
+#if LINALG_KERNEL_WIDTH
+
+// Influence k of vertices bones[0 .. 4) in SoA form, q[c] holds data[c] of each dual quaternion.
+inline void gatherSoA(__m128* q, const DualQuatf* transforms, const Vec4u* bones, unsigned k)
+{
+  for (unsigned c = 0; c < 8; c += 4) {
+    for (unsigned j = 0; j < 4; j++) {
+      q[c + j] = _mm_loadu_ps(transforms[bones[j][k]].data + c);
+    }
+    transpose4(q[c], q[c + 1], q[c + 2], q[c + 3]);
+  }
+}
+
+// Same order of operations as cross(const Vec3f&, const Vec3f&).
+inline void crossSoA(__m128* r, const __m128* a, const __m128* b)
+{
+  r[0] = vsub(vmul(a[1], b[2]), vmul(a[2], b[1]));
+  r[1] = vsub(vmul(a[2], b[0]), vmul(a[0], b[2]));
+  r[2] = vsub(vmul(a[0], b[1]), vmul(a[1], b[0]));
+}
+
+inline __m128 dotSoA4(const __m128* a, const __m128* b)
+{
+  return vadd(vadd(vadd(vmul(a[0], b[0]), vmul(a[1], b[1])), vmul(a[2], b[2])), vmul(a[3], b[3]));
+}
+
+#endif
+
+void skinDualQuat(Vec3f* dst, const Vec3f* src, const Vec4u* bones, const Vec4f* weights, const DualQuatf* transforms, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // Four vertices at a time in SSE registers, one per lane, in the same
+  // order of operations as the loop below and mul(const DualQuatf&, const Vec3f&).
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 two = _mm_set1_ps(2.f);
+  for (; i + 4 <= N; i += 4) {
+    __m128 w[4];
+    for (unsigned j = 0; j < 4; j++) w[j] = _mm_loadu_ps(weights[i + j].data);
+    transpose4(w[0], w[1], w[2], w[3]);
+
+    __m128 t[8], pivot[4], d[8];
+    gatherSoA(t, transforms, bones + i, 0);
+    for (unsigned c = 0; c < 4; c++) pivot[c] = t[c];
+    for (unsigned c = 0; c < 8; c++) d[c] = zero;
+    for (unsigned k = 0; k < 4; k++) {
+      if (k) gatherSoA(t, transforms, bones + i, k);
+      __m128 flip = vcmplt(dotSoA4(pivot, t), zero);
+      __m128 s = vselect(flip, _mm_xor_ps(w[k], sign), w[k]);
+      for (unsigned c = 0; c < 8; c++) d[c] = vadd(d[c], vmul(s, t[c]));
+    }
+    __m128 n = vdiv(_mm_set1_ps(1.f), vsqrt(dotSoA4(d, d)));
+    for (unsigned c = 0; c < 8; c++) d[c] = vmul(d[c], n);
+
+    // t = 2 (real.w dual.xyz - dual.w real.xyz + cross(real.xyz, dual.xyz)).
+    const __m128* r = d;
+    const __m128* u = d + 4;
+    __m128 ru[3], T[3];
+    crossSoA(ru, r, u);
+    for (unsigned c = 0; c < 3; c++) T[c] = vmul(two, vadd(vsub(vmul(d[3], u[c]), vmul(d[7], r[c])), ru[c]));
+
+    // Rotate p by real and add t.
+    __m128 p[3], a[3], b[3], q[3];
+    loadAoS3(p[0], p[1], p[2], src[i].data);
+    crossSoA(a, r, p);
+    for (unsigned c = 0; c < 3; c++) a[c] = vmul(two, a[c]);
+    crossSoA(b, r, a);
+    for (unsigned c = 0; c < 3; c++) q[c] = vadd(vadd(vadd(p[c], vmul(d[3], a[c])), b[c]), T[c]);
+    storeAoS3(dst[i].data, q[0], q[1], q[2]);
+  }
+#endif
+  for (; i < N; i++) {
+    const Vec4u& b = bones[i];
+    const Vec4f& w = weights[i];
+
+    // Flip influences that are in the other hemisphere than the first one
+    // to blend along the shortest path.
+    const Quatf& pivot = transforms[b.x].real;
+    float s[4];
+    for (unsigned k = 0; k < 4; k++) {
+      s[k] = dot(pivot, transforms[b[k]].real) < 0.f ? -w[k] : w[k];
+    }
+
+    DualQuatf d;
+#if LINALG_KERNEL_WIDTH
+    __m128 r = _mm_setzero_ps();
+    __m128 u = _mm_setzero_ps();
+    for (unsigned k = 0; k < 4; k++) {
+      __m128 sk = _mm_set1_ps(s[k]);
+      const float* t = transforms[b[k]].data;
+      r = _mm_add_ps(r, _mm_mul_ps(sk, _mm_loadu_ps(t)));
+      u = _mm_add_ps(u, _mm_mul_ps(sk, _mm_loadu_ps(t + 4)));
+    }
+    _mm_storeu_ps(d.data, r);
+    _mm_storeu_ps(d.data + 4, u);
+#else
+    for (unsigned j = 0; j < 8; j++) {
+      d.data[j] = 0.f;
+      for (unsigned k = 0; k < 4; k++) {
+        d.data[j] += s[k] * transforms[b[k]].data[j];
+      }
+    }
+#endif
+    float n = 1.f / std::sqrt(dot(d.real, d.real));
+    for (unsigned j = 0; j < 8; j++) {
+      d.data[j] *= n;
+    }
+    dst[i] = mul(d, src[i]);
+  }
+}
+
+void toHalf(Vec3h* dst, const Vec3f* src, size_t N)
+{
+  const float* s = src[0].data;
+  uint16_t* d = &dst[0].data[0].bits;
+  size_t n = 3 * N;
+  size_t i = 0;
+#if 8 <= LINALG_KERNEL_WIDTH
+  for (; i + 8 <= n; i += 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), _mm256_cvtps_ph(_mm256_loadu_ps(s + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+#elif LINALG_KERNEL_WIDTH
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = floatToHalf4(_mm_loadu_ps(s + i));
+    __m128i b = floatToHalf4(_mm_loadu_ps(s + i + 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), packUnsigned16(a, b));
+  }
+#endif
+  for (; i < n; i++) {
+    d[i] = makeHalf(s[i]).bits;
+  }
+}
+
+void fromHalf(Vec3f* dst, const Vec3h* src, size_t N)
+{
+  const uint16_t* s = &src[0].data[0].bits;
+  float* d = dst[0].data;
+  size_t n = 3 * N;
+  size_t i = 0;
+#if 8 <= LINALG_KERNEL_WIDTH
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(d + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))));
+  }
+#elif LINALG_KERNEL_WIDTH
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    _mm_storeu_ps(d + i, halfToFloat4(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+    _mm_storeu_ps(d + i + 4, halfToFloat4(_mm_unpackhi_epi16(h, _mm_setzero_si128())));
+  }
+#endif
+  for (; i < n; i++) {
+    Half h;
+    h.bits = s[i];
+    d[i] = makeFloat(h);
+  }
+}
+
+void quantizePoints(Vec3us* dst, const BBox3f& frame, const Vec3f* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // Four points are three registers with components x y z x | y z x y | z x y z.
+  float origin[3], scale[3];
+  for (unsigned k = 0; k < 3; k++) {
+    float extent = frame.max[k] - frame.min[k];
+    origin[k] = frame.min[k];
+    scale[k] = 0.f < extent ? 65535.f / extent : 0.f;
+  }
+  __m128 o[3], m[3];
+  for (unsigned j = 0; j < 3; j++) {
+    o[j] = _mm_setr_ps(origin[(4 * j) % 3], origin[(4 * j + 1) % 3], origin[(4 * j + 2) % 3], origin[(4 * j + 3) % 3]);
+    m[j] = _mm_setr_ps(scale[(4 * j) % 3], scale[(4 * j + 1) % 3], scale[(4 * j + 2) % 3], scale[(4 * j + 3) % 3]);
+  }
+  for (; i + 4 <= N; i += 4) {
+    const float* s = src[i].data;
+    __m128i q[3];
+    for (unsigned j = 0; j < 3; j++) {
+      __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s + 4 * j), o[j]), m[j]);
+      t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(65535.f));
+      q[j] = _mm_cvtps_epi32(t);
+    }
+    uint16_t* d = dst[i].data;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d), packUnsigned16(q[0], q[1]));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(d + 8), packUnsigned16(q[2], q[2]));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = quantize(frame, src[i]);
+  }
+}
+
+#if LINALG_KERNEL_WIDTH
+
+// Four points loaded into D registers of coordinates.
+inline void loadPoints(__m128* p, const Vec3f* src) { loadAoS3(p[0], p[1], p[2], src->data); }
+
+inline void loadPoints(__m128* p, const Vec2f* src)
+{
+  __m128 a = _mm_loadu_ps(src[0].data);
+  __m128 b = _mm_loadu_ps(src[2].data);
+  p[0] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  p[1] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// Same bit spreading as in LinAlgOps.cpp, on 32- and 64-bit lanes.
+inline __m128i spreadBits(__m128i x, const uint32_t* masks, const int* shifts, unsigned n)
+{
+  for (unsigned j = 0; j < n; j++) {
+    x = _mm_and_si128(_mm_or_si128(x, _mm_sll_epi32(x, _mm_cvtsi32_si128(shifts[j]))), _mm_set1_epi32(int(masks[j])));
+  }
+  return x;
+}
+
+inline __m128i spreadBits64(__m128i x, const uint64_t* masks, const int* shifts, unsigned n)
+{
+  for (unsigned j = 0; j < n; j++) {
+    x = _mm_and_si128(_mm_or_si128(x, _mm_sll_epi64(x, _mm_cvtsi32_si128(shifts[j]))), _mm_set1_epi64x(int64_t(masks[j])));
+  }
+  return x;
+}
+
+inline __m128i spread(__m128i x, unsigned D, uint32_t)
+{
+  static const uint32_t masks2[] = { 0xffff, 0x00ff00ff, 0x0f0f0f0f, 0x33333333, 0x55555555 };
+  static const uint32_t masks3[] = { 0x3ff, 0x030000ff, 0x0300f00f, 0x030c30c3, 0x09249249 };
+  static const int shifts2[] = { 0, 8, 4, 2, 1 };
+  static const int shifts3[] = { 0, 16, 8, 4, 2 };
+  return D == 2 ? spreadBits(x, masks2, shifts2, 5) : spreadBits(x, masks3, shifts3, 5);
+}
+
+inline __m128i spread(__m128i x, unsigned D, uint64_t)
+{
+  static const uint64_t masks2[] = { 0xffffffff, 0x0000ffff0000ffff, 0x00ff00ff00ff00ff, 0x0f0f0f0f0f0f0f0f, 0x3333333333333333, 0x5555555555555555 };
+  static const uint64_t masks3[] = { 0x1fffff, 0x001f00000000ffff, 0x001f0000ff0000ff, 0x100f00f00f00f00f, 0x10c30c30c30c30c3, 0x1249249249249249 };
+  static const int shifts2[] = { 0, 16, 8, 4, 2, 1 };
+  static const int shifts3[] = { 0, 32, 16, 8, 4, 2 };
+  return D == 2 ? spreadBits64(x, masks2, shifts2, 6) : spreadBits64(x, masks3, shifts3, 6);
+}
+
+// Same as hilbertTranspose in LinAlgOps.cpp, with selects for the branches.
+template<unsigned D>
+void hilbertTransposeSSE(__m128i* x, unsigned bits)
+{
+  __m128i zero = _mm_setzero_si128();
+  for (uint32_t q = 1u << (bits - 1); q > 1; q >>= 1) {
+    __m128i p = _mm_set1_epi32(int(q - 1));
+    __m128i Q = _mm_set1_epi32(int(q));
+    for (unsigned i = 0; i < D; i++) {
+      __m128i clear = _mm_cmpeq_epi32(_mm_and_si128(x[i], Q), zero);
+      __m128i t = _mm_and_si128(_mm_xor_si128(x[0], x[i]), p);
+      // Set: x[0] ^= p. Clear: swap the low bits of x[0] and x[i].
+      x[0] = _mm_xor_si128(x[0], vselect(clear, t, p));
+      x[i] = _mm_xor_si128(x[i], _mm_and_si128(clear, t));
+    }
+  }
+  for (unsigned i = 1; i < D; i++) x[i] = _mm_xor_si128(x[i], x[i - 1]);
+  __m128i t = zero;
+  for (uint32_t q = 1u << (bits - 1); q > 1; q >>= 1) {
+    __m128i set = _mm_cmpeq_epi32(_mm_and_si128(x[D - 1], _mm_set1_epi32(int(q))), zero);
+    t = _mm_xor_si128(t, _mm_andnot_si128(set, _mm_set1_epi32(int(q - 1))));
+  }
+  for (unsigned i = 0; i < D; i++) x[i] = _mm_xor_si128(x[i], t);
+}
+
+inline void storeKeys(uint32_t* dst, const __m128i* c, unsigned D, bool hilbert)
+{
+  __m128i key = _mm_setzero_si128();
+  for (unsigned k = 0; k < D; k++) {
+    key = _mm_or_si128(key, _mm_sll_epi32(spread(c[k], D, uint32_t()), _mm_cvtsi32_si128(int(hilbert ? D - 1 - k : k))));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), key);
+}
+
+inline void storeKeys(uint64_t* dst, const __m128i* c, unsigned D, bool hilbert)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = zero, hi = zero;
+  for (unsigned k = 0; k < D; k++) {
+    __m128i shift = _mm_cvtsi32_si128(int(hilbert ? D - 1 - k : k));
+    lo = _mm_or_si128(lo, _mm_sll_epi64(spread(_mm_unpacklo_epi32(c[k], zero), D, uint64_t()), shift));
+    hi = _mm_or_si128(hi, _mm_sll_epi64(spread(_mm_unpackhi_epi32(c[k], zero), D, uint64_t()), shift));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), lo);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2), hi);
+}
+
+#endif
+
+inline void spatialKey(uint32_t& key, bool hilbert, const BBox3f& frame, const Vec3f& p) { key = hilbert ? hilbertKey(frame, p) : mortonKey(frame, p); }
+inline void spatialKey(uint32_t& key, bool hilbert, const BBox2f& frame, const Vec2f& p) { key = hilbert ? hilbertKey(frame, p) : mortonKey(frame, p); }
+inline void spatialKey(uint64_t& key, bool hilbert, const BBox3f& frame, const Vec3f& p) { key = hilbert ? hilbertKey64(frame, p) : mortonKey64(frame, p); }
+inline void spatialKey(uint64_t& key, bool hilbert, const BBox2f& frame, const Vec2f& p) { key = hilbert ? hilbertKey64(frame, p) : mortonKey64(frame, p); }
+
+// Morton or Hilbert keys of N points, four at a time.
+template<bool Hilbert, typename Key, typename BBox, typename Vec>
+void spatialKeys(Key* dst, const BBox& frame, const Vec* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // Cells as in cellsOf in LinAlgOps.cpp.
+  const unsigned D = sizeof(Vec) / sizeof(float);
+  const unsigned bits = (sizeof(Key) == 4 ? 30 : 63) / D;
+  float cells = float(1u << bits);
+  __m128 limit = _mm_set1_ps(bits <= 24 ? float((1u << bits) - 1) : float(1u << bits) - float(1u << (bits - 24)));
+  __m128 origin[3], scale[3];
+  for (unsigned k = 0; k < D; k++) {
+    float extent = frame.max[k] - frame.min[k];
+    origin[k] = _mm_set1_ps(frame.min[k]);
+    scale[k] = _mm_set1_ps(0.f < extent ? cells / extent : 0.f);
+  }
+  for (; i + 4 <= N; i += 4) {
+    __m128 p[3];
+    __m128i c[3];
+    loadPoints(p, src + i);
+    for (unsigned k = 0; k < D; k++) {
+      __m128 t = _mm_mul_ps(_mm_sub_ps(p[k], origin[k]), scale[k]);
+      c[k] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), limit));
+    }
+    if (Hilbert) hilbertTransposeSSE<D>(c, bits);
+    storeKeys(dst + i, c, D, Hilbert);
+  }
+#endif
+  for (; i < N; i++) {
+    spatialKey(dst[i], Hilbert, frame, src[i]);
+  }
+}
+
+void dequantizePoints(Vec3f* dst, const BBox3f& frame, const Vec3us* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  float origin[3], step[3];
+  for (unsigned k = 0; k < 3; k++) {
+    origin[k] = frame.min[k];
+    step[k] = (frame.max[k] - frame.min[k]) / 65535.f;
+  }
+  __m128 o[3], m[3];
+  for (unsigned j = 0; j < 3; j++) {
+    o[j] = _mm_setr_ps(origin[(4 * j) % 3], origin[(4 * j + 1) % 3], origin[(4 * j + 2) % 3], origin[(4 * j + 3) % 3]);
+    m[j] = _mm_setr_ps(step[(4 * j) % 3], step[(4 * j + 1) % 3], step[(4 * j + 2) % 3], step[(4 * j + 3) % 3]);
+  }
+  for (; i + 4 <= N; i += 4) {
+    const uint16_t* s = src[i].data;
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + 8));
+    __m128i q[3] = {
+      _mm_unpacklo_epi16(a, _mm_setzero_si128()),
+      _mm_unpackhi_epi16(a, _mm_setzero_si128()),
+      _mm_unpacklo_epi16(b, _mm_setzero_si128())
+    };
+    float* d = dst[i].data;
+    for (unsigned j = 0; j < 3; j++) {
+      _mm_storeu_ps(d + 4 * j, _mm_add_ps(o[j], _mm_mul_ps(_mm_cvtepi32_ps(q[j]), m[j])));
+    }
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = dequantize(frame, src[i]);
+  }
+}
+
+void encodeNormals(Vec2s* dst, const Vec3f* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+  for (; i + 4 <= N; i += 4) {
+    __m128 x, y, z;
+    loadAoS3(x, y, z, src[i].data);
+    __m128 l = _mm_add_ps(_mm_add_ps(vabs(x), vabs(y)), vabs(z));
+    __m128 valid = _mm_and_ps(_mm_cmple_ps(_mm_set1_ps(FLT_MIN), l), _mm_cmple_ps(l, _mm_set1_ps(FLT_MAX)));
+    __m128 r = _mm_div_ps(one, l);
+    x = _mm_mul_ps(x, r);
+    y = _mm_mul_ps(y, r);
+    __m128 ax = vabs(x);
+    __m128 ay = vabs(y);
+    __m128 fx = vselect(_mm_cmplt_ps(x, zero), _mm_sub_ps(ay, one), _mm_sub_ps(one, ay));
+    __m128 fy = vselect(_mm_cmplt_ps(y, zero), _mm_sub_ps(ax, one), _mm_sub_ps(one, ax));
+    __m128 lower = _mm_cmplt_ps(z, zero);
+    // Invalid lanes encode as +z, as in encodeOctahedral.
+    __m128i ex = _mm_cvtps_epi32(_mm_and_ps(valid, _mm_mul_ps(_mm_set1_ps(32767.f), vselect(lower, fx, x))));
+    __m128i ey = _mm_cvtps_epi32(_mm_and_ps(valid, _mm_mul_ps(_mm_set1_ps(32767.f), vselect(lower, fy, y))));
+    __m128i e = _mm_packs_epi32(_mm_unpacklo_epi32(ex, ey), _mm_unpackhi_epi32(ex, ey));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst[i].data), e);
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = encodeOctahedral(src[i]);
+  }
+}
+
+void decodeNormals(Vec3f* dst, const Vec2s* src, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+  for (; i + 4 <= N; i += 4) {
+    __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src[i].data));
+    __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(e, e), 16));
+    __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(e, e), 16));
+    __m128 x = _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), _mm_set1_ps(1.f / 32767.f));
+    __m128 y = _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), _mm_set1_ps(1.f / 32767.f));
+    x = _mm_max_ps(x, _mm_set1_ps(-1.f));
+    y = _mm_max_ps(y, _mm_set1_ps(-1.f));
+    __m128 ax = vabs(x);
+    __m128 ay = vabs(y);
+    __m128 z = _mm_sub_ps(_mm_sub_ps(one, ax), ay);
+    __m128 lower = _mm_cmplt_ps(z, zero);
+    x = vselect(lower, vselect(_mm_cmplt_ps(x, zero), _mm_sub_ps(ay, one), _mm_sub_ps(one, ay)), x);
+    y = vselect(lower, vselect(_mm_cmplt_ps(y, zero), _mm_sub_ps(ax, one), _mm_sub_ps(one, ax)), y);
+
+    __m128 r = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+    storeAoS3(dst[i].data, _mm_mul_ps(r, x), _mm_mul_ps(r, y), _mm_mul_ps(r, z));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = decodeOctahedral(src[i]);
+  }
+}
+
+void intersectRay(uint32_t* hits, float* t, const Ray3f& ray, const BBox3f* bboxes, size_t N, float tmin, float tmax)
+{
+  for (size_t w = 0; w < (N + 31) / 32; w++) {
+    hits[w] = 0;
+  }
+
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // The ray direction decides which side of each slab is entered first.
+  unsigned nearIx[3], farIx[3];
+  Pack o[3], inv[3];
+  for (unsigned k = 0; k < 3; k++) {
+    bool negative = ray.invDir[k] < 0.f;
+    nearIx[k] = negative ? 3 + k : k;
+    farIx[k] = negative ? k : 3 + k;
+    o[k] = vset1<Pack>(ray.origin[k]);
+    inv[k] = vset1<Pack>(ray.invDir[k]);
+  }
+  for (; i + W <= N; i += W) {
+    Pack b[6];
+    loadSoA(b, bboxes + i);
+    Pack t0 = vset1<Pack>(tmin);
+    Pack t1 = vset1<Pack>(tmax);
+    for (unsigned k = 0; k < 3; k++) {
+      t0 = vmax(vmul(vsub(b[nearIx[k]], o[k]), inv[k]), t0);
+      t1 = vmin(vmul(vsub(b[farIx[k]], o[k]), inv[k]), t1);
+    }
+    vstore(t + i, t0);
+    hits[i / 32] |= uint32_t(vbits(vcmple(t0, t1))) << (i % 32);
+  }
+#endif
+  for (; i < N; i++) {
+    if (intersect(t[i], ray, bboxes[i], tmin, tmax)) {
+      hits[i / 32] |= 1u << (i % 32);
+    }
+  }
+}
+
+void intersectRays(uint32_t* hits, float* t, const Ray3f* rays, size_t N, const BBox3f& bbox, float tmin, float tmax)
+{
+  for (size_t w = 0; w < (N + 31) / 32; w++) {
+    hits[w] = 0;
+  }
+
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  __m128 bmin[3], bmax[3];
+  for (unsigned k = 0; k < 3; k++) {
+    bmin[k] = _mm_set1_ps(bbox.min[k]);
+    bmax[k] = _mm_set1_ps(bbox.max[k]);
+  }
+  for (; i + 4 <= N; i += 4) {
+    const Ray3f* r = rays + i;
+    __m128 t0 = _mm_set1_ps(tmin);
+    __m128 t1 = _mm_set1_ps(tmax);
+    for (unsigned k = 0; k < 3; k++) {
+      __m128 o = _mm_setr_ps(r[0].origin[k], r[1].origin[k], r[2].origin[k], r[3].origin[k]);
+      __m128 inv = _mm_setr_ps(r[0].invDir[k], r[1].invDir[k], r[2].invDir[k], r[3].invDir[k]);
+      __m128 negative = _mm_cmplt_ps(inv, _mm_setzero_ps());
+      __m128 near = vselect(negative, bmax[k], bmin[k]);
+      __m128 far = vselect(negative, bmin[k], bmax[k]);
+      t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(near, o), inv), t0);
+      t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(far, o), inv), t1);
+    }
+    _mm_storeu_ps(t + i, t0);
+    hits[i / 32] |= uint32_t(_mm_movemask_ps(_mm_cmple_ps(t0, t1))) << (i % 32);
+  }
+#endif
+  for (; i < N; i++) {
+    if (intersect(t[i], rays[i], bbox, tmin, tmax)) {
+      hits[i / 32] |= 1u << (i % 32);
+    }
+  }
+}
+
+void classifyBoxes(Containment* result, const Frustumf& frustum, const BBox3f* bboxes, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  FrustumPlanes f;
+  splat(f, frustum);
+  for (; i + W <= N; i += W) {
+    Pack b[6];
+    loadSoA(b, bboxes + i);
+    unsigned outside, intersecting;
+    classifySoA(outside, intersecting, f, b);
+    // Outside = 0, Intersecting = 1, Inside = 2.
+    for (unsigned l = 0; l < W; l++) {
+      result[i + l] = Containment(2 - 2 * ((outside >> l) & 1) - ((intersecting >> l) & 1));
+    }
+  }
+#endif
+  for (; i < N; i++) {
+    result[i] = classify(frustum, bboxes[i]);
+  }
+}
+
+// Inverses of Mat3f or Mat3d from i on, or their transposes, one at a time.
+template<bool Transposed, typename T>
+void inversesScalar(Mat3<T>* dst, uint32_t* singular, const Mat3<T>* src, size_t i, size_t N)
+{
+  for (; i < N; i++) {
+    T det = determinant(src[i]);
+    dst[i] = Transposed ? inverseTranspose(src[i]) : inverse(src[i]);
+    if (singular && isSingular(det)) singular[i / 32] |= 1u << (i % 32);
+  }
+}
+
+template<bool Transposed>
+void inverseMat3f(Mat3f* dst, uint32_t* singular, const Mat3f* src, size_t N)
+{
+  clearBits(singular, N);
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  i = inversesSoA<Transposed>(dst, singular, src, N, W, vset1<Pack>(1.f), vset1<Pack>(FLT_MIN), vset1<Pack>(FLT_MAX));
+#endif
+  inversesScalar<Transposed>(dst, singular, src, i, N);
+}
+
+template<bool Transposed>
+void inverseMat3d(Mat3d* dst, uint32_t* singular, const Mat3d* src, size_t N)
+{
+  clearBits(singular, N);
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  i = inversesSoA<Transposed>(dst, singular, src, N, 2, _mm_set1_pd(1.0), _mm_set1_pd(DBL_MIN), _mm_set1_pd(DBL_MAX));
+#endif
+  inversesScalar<Transposed>(dst, singular, src, i, N);
+}
+
+void svdMat3f(Mat3f* U, Vec3f* sigma, Mat3f* V, const Mat3f* M, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + W <= N; i += W) {
+    Pack m[9], u[3][3], s[3], v[3][3];
+    loadSoA(m, M + i);
+    Pack scale = svdColumnsSoA(u, s, v, m);
+    storeSoA(U + i, &u[0][0]);
+    storeSoA(V + i, &v[0][0]);
+    storeAoS3(sigma[i].data, vmul(scale, s[0]), vmul(scale, s[1]), vmul(scale, s[2]));
+  }
+#endif
+  for (; i < N; i++) {
+    svd(U[i], sigma[i], V[i], M[i]);
+  }
+}
+
+void polarMat3f(Mat3f* R, Mat3f* S, const Mat3f* M, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  Pack zero = vset1<Pack>(0.f);
+  Pack minusOne = vset1<Pack>(-1.f);
+  for (; i + W <= N; i += W) {
+    Pack m[9], u[3][3], s[3], v[3][3];
+    loadSoA(m, M + i);
+    Pack scale = svdColumnsSoA(u, s, v, m);
+
+    auto flip = vcmplt(s[2], zero);
+    s[2] = vselect(flip, vmul(minusOne, s[2]), s[2]);
+    for (unsigned k = 0; k < 3; k++) u[2][k] = vselect(flip, vmul(minusOne, u[2][k]), u[2][k]);
+
+    Pack r[9], q[9];
+    for (unsigned j = 0; j < 3; j++) {
+      for (unsigned k = 0; k < 3; k++) {
+        r[3 * j + k] = dotSoA(u[0][k], u[1][k], u[2][k], v[0][j], v[1][j], v[2][j]);
+      }
+      for (unsigned k = j; k < 3; k++) {
+        q[3 * j + k] = q[3 * k + j] = vmul(scale, dotSoA(vmul(v[0][k], s[0]), vmul(v[1][k], s[1]), vmul(v[2][k], s[2]),
+                                                         v[0][j], v[1][j], v[2][j]));
+      }
+    }
+    storeSoA(R + i, r);
+    storeSoA(S + i, q);
+  }
+#endif
+  for (; i < N; i++) {
+    polarDecomposition(R[i], S[i], M[i]);
+  }
+}
+
+void scaleMat3f(float* dst, const Mat3f* M, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + 4 <= N; i += 4) {
+    __m128 m[9];
+    loadSoA(m, M + i);
+    vstore(dst + i, scaleSoA(m));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = getScale(M[i]);
+  }
+}
+
+void scaleMat3x4f(float* dst, const Mat3x4f* M, size_t N)
+{
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  for (; i + 4 <= N; i += 4) {
+    __m128 m[12];
+    loadSoA(m, M + i);
+    vstore(dst + i, scaleSoA(m));
+  }
+#endif
+  for (; i < N; i++) {
+    dst[i] = getScale(M[i]);
+  }
+}
+
+void cullBoxes(size_t* counts, uint32_t* const* visible, const Frustumf* frustums, size_t V, const BBox3f* bboxes, size_t N)
+{
+  for (size_t v = 0; v < V; v++) {
+    counts[v] = 0;
+  }
+  if (V == 0) return;
+
+  size_t i = 0;
+#if LINALG_KERNEL_WIDTH
+  // Each box block is loaded once and tested against all views, in groups
+  // of views small enough to keep their planes on the stack.
+  const size_t group = 8;
+  FrustumPlanes f[group];
+  for (size_t v0 = 0; v0 < V; v0 += group) {
+    size_t nv = V - v0 < group ? V - v0 : group;
+    for (size_t v = 0; v < nv; v++) {
+      splat(f[v], frustums[v0 + v]);
+    }
+    for (i = 0; i + W <= N; i += W) {
+      Pack b[6];
+      loadSoA(b, bboxes + i);
+      for (size_t v = 0; v < nv; v++) {
+        unsigned outside, intersecting;
+        classifySoA(outside, intersecting, f[v], b);
+        uint32_t* list = visible[v0 + v];
+        size_t& count = counts[v0 + v];
+        for (unsigned l = 0; l < W; l++) {
+          list[count] = uint32_t(i + l);
+          count += ((outside >> l) & 1) ^ 1;
+        }
+      }
+    }
+  }
+#endif
+  for (; i < N; i++) {
+    for (size_t v = 0; v < V; v++) {
+      if (classify(frustums[v], bboxes[i]) != Containment::Outside) {
+        visible[v][counts[v]++] = uint32_t(i);
+      }
+    }
+  }
+}
+
+Kernels makeKernels()
+{
+  Kernels k;
+  k.transformPoints = transformPoints;
+  k.transformPointsStrided = transformPointsStrided;
+  k.transformBoxes = transformBoxes;
+  k.transformBoxesEach = transformBoxesEach;
+  k.transformPointsSoA = transformPointsSoA;
+  k.splitPoints = splitPoints;
+  k.joinPoints = joinPoints;
+  k.splitBoxes = splitBoxes;
+  k.joinBoxes = joinBoxes;
+  k.boundsVec2f = boundsVec2f;
+  k.boundsVec3f = boundsVec3f;
+  k.boundsVec3d = boundsVec3d;
+  k.boundsBBox3f = boundsBBox3f;
+  k.boundsStrided = boundsStrided;
+  k.boundsSoA = boundsSoA;
+  k.lengthExact = lengths<ExactPrecision>;
+  k.lengthFast = lengths<FastPrecision>;
+  k.distanceExact = distances<ExactPrecision>;
+  k.distanceFast = distances<FastPrecision>;
+  k.normalizeExact = normalizes<ExactPrecision>;
+  k.normalizeFast = normalizes<FastPrecision>;
+  k.skinLinear = skinLinear;
+  k.skinDualQuat = skinDualQuat;
+  k.toHalf = toHalf;
+  k.fromHalf = fromHalf;
+  k.quantize = quantizePoints;
+  k.dequantize = dequantizePoints;
+  k.mortonKeys3 = spatialKeys<false, uint32_t, BBox3f, Vec3f>;
+  k.mortonKeys2 = spatialKeys<false, uint32_t, BBox2f, Vec2f>;
+  k.mortonKeys3x64 = spatialKeys<false, uint64_t, BBox3f, Vec3f>;
+  k.mortonKeys2x64 = spatialKeys<false, uint64_t, BBox2f, Vec2f>;
+  k.hilbertKeys3 = spatialKeys<true, uint32_t, BBox3f, Vec3f>;
+  k.hilbertKeys2 = spatialKeys<true, uint32_t, BBox2f, Vec2f>;
+  k.hilbertKeys3x64 = spatialKeys<true, uint64_t, BBox3f, Vec3f>;
+  k.hilbertKeys2x64 = spatialKeys<true, uint64_t, BBox2f, Vec2f>;
+  k.encodeNormals = encodeNormals;
+  k.decodeNormals = decodeNormals;
+  k.intersectRay = intersectRay;
+  k.intersectRays = intersectRays;
+  k.classifyBoxes = classifyBoxes;
+  k.cullBoxes = cullBoxes;
+  k.inverseMat3f = inverseMat3f<false>;
+  k.inverseTransposeMat3f = inverseMat3f<true>;
+  k.inverseMat3d = inverseMat3d<false>;
+  k.inverseTransposeMat3d = inverseMat3d<true>;
+  k.svdMat3f = svdMat3f;
+  k.polarMat3f = polarMat3f;
+  k.scaleMat3f = scaleMat3f;
+  k.scaleMat3x4f = scaleMat3x4f;
+  return k;
+}
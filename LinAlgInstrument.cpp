@@ -0,0 +1,258 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "LinAlgInstrument.h"
+
+namespace {
+
+  const size_t opCount = size_t(InstrumentedOp::Count);
+
+  const char* opNames[opCount] = {
+    "mul(Mat3f, Vec3f)",
+    "mul(Mat3x4f, Vec3f)",
+    "mul(Mat4f, Vec4f)",
+    "mul(Mat3f, Mat3f)",
+    "mul(Mat3x4f, Mat3x4f)",
+    "mul(Mat4f, Mat4f)",
+    "inverse(Mat3)",
+    "inverse(Mat3x4f)",
+    "inverse(Mat4f)",
+    "inverseTranspose(Mat3)",
+    "normalize",
+    "transform(Mat3x4f, BBox3f)",
+    "transform(Vec3f*)",
+    "transform(BBox3f*)",
+    "skin(Vec3f*)",
+    "inverse(Mat3*)",
+    "inverseTranspose(Mat3*)",
+    "normalize(Vec3f*)",
+  };
+  static_assert(sizeof(opNames) / sizeof(opNames[0]) == opCount, "a name per InstrumentedOp");
+
+  // Counters of one thread. Only the thread writes them, with relaxed loads
+  // and stores rather than atomic increments, other threads only read them.
+  struct Counters
+  {
+    std::atomic<uint64_t> calls[opCount];
+    std::atomic<uint64_t> elements[opCount];
+    std::atomic<uint64_t> sampledCalls[opCount];
+    std::atomic<uint64_t> sampledCycles[opCount];
+    unsigned nesting = 0;
+
+    Counters();
+    ~Counters();
+  };
+
+  // Never destroyed, as threads may exit during static destruction.
+  struct Registry
+  {
+    std::mutex mutex;
+    std::vector<Counters*> threads;
+    OpStats retired[opCount] = {};    // Counts of the threads that exited.
+    OpStats baseline[opCount] = {};   // Counts at the last reset.
+    OpStats frame[opCount] = {};      // Counts at the last endInstrumentFrame.
+    void (*callback)(void* context, const OpStats* stats) = nullptr;
+    void* context = nullptr;
+    std::atomic<unsigned> sampleInterval{ 0 };
+  };
+
+  Registry& registry()
+  {
+    static Registry* r = new Registry;
+    return *r;
+  }
+
+  // Counts of all threads since they started, r.mutex must be held.
+  void total(OpStats* stats, Registry& r)
+  {
+    for (size_t i = 0; i < opCount; i++) {
+      stats[i] = r.retired[i];
+      for (const Counters* c : r.threads) {
+        stats[i].calls += c->calls[i].load(std::memory_order_relaxed);
+        stats[i].elements += c->elements[i].load(std::memory_order_relaxed);
+        stats[i].sampledCalls += c->sampledCalls[i].load(std::memory_order_relaxed);
+        stats[i].sampledCycles += c->sampledCycles[i].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void subtract(OpStats* stats, const OpStats* base)
+  {
+    for (size_t i = 0; i < opCount; i++) {
+      stats[i].calls -= base[i].calls;
+      stats[i].elements -= base[i].elements;
+      stats[i].sampledCalls -= base[i].sampledCalls;
+      stats[i].sampledCycles -= base[i].sampledCycles;
+    }
+  }
+
+#ifdef LINALG_INSTRUMENT
+
+  void add(std::atomic<uint64_t>& counter, uint64_t n)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  Counters::Counters()
+  {
+    for (size_t i = 0; i < opCount; i++) {
+      calls[i].store(0, std::memory_order_relaxed);
+      elements[i].store(0, std::memory_order_relaxed);
+      sampledCalls[i].store(0, std::memory_order_relaxed);
+      sampledCycles[i].store(0, std::memory_order_relaxed);
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.push_back(this);
+  }
+
+  Counters::~Counters()
+  {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 0; i < opCount; i++) {
+      r.retired[i].calls += calls[i].load(std::memory_order_relaxed);
+      r.retired[i].elements += elements[i].load(std::memory_order_relaxed);
+      r.retired[i].sampledCalls += sampledCalls[i].load(std::memory_order_relaxed);
+      r.retired[i].sampledCycles += sampledCycles[i].load(std::memory_order_relaxed);
+    }
+    for (size_t k = 0; k < r.threads.size(); k++) {
+      if (r.threads[k] == this) {
+        r.threads[k] = r.threads.back();
+        r.threads.pop_back();
+        break;
+      }
+    }
+  }
+
+  Counters& counters()
+  {
+    thread_local Counters c;
+    return c;
+  }
+
+#endif
+
+}
+
+
+const char* getOpName(InstrumentedOp op)
+{
+  return size_t(op) < opCount ? opNames[size_t(op)] : "unknown";
+}
+
+void getInstrumentStats(OpStats* stats)
+{
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  total(stats, r);
+  subtract(stats, r.baseline);
+}
+
+void resetInstrumentStats()
+{
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  total(r.baseline, r);
+  for (size_t i = 0; i < opCount; i++) r.frame[i] = r.baseline[i];
+}
+
+void setInstrumentCycleSampling(unsigned interval)
+{
+  unsigned p = 1;
+  while (p < interval && p < 0x80000000u) p *= 2;
+  registry().sampleInterval.store(interval ? p : 0, std::memory_order_relaxed);
+}
+
+void setInstrumentCallback(void (*callback)(void* context, const OpStats* stats), void* context)
+{
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.callback = callback;
+  r.context = context;
+}
+
+void endInstrumentFrame()
+{
+  OpStats stats[opCount];
+  void (*callback)(void* context, const OpStats* stats);
+  void* context;
+  {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    total(stats, r);
+    OpStats previous[opCount];
+    for (size_t i = 0; i < opCount; i++) {
+      previous[i] = r.frame[i];
+      r.frame[i] = stats[i];
+    }
+    subtract(stats, previous);
+    callback = r.callback;
+    context = r.context;
+  }
+  // Outside the lock, so that the callback may call the functions here.
+  if (callback) callback(context, stats);
+}
+
+void printInstrumentReport(FILE* file, const OpStats* stats)
+{
+  fprintf(file, "%-28s %14s %14s %12s %14s\n", "operation", "calls", "elements", "elem/call", "cycles/call");
+  for (size_t i = 0; i < opCount; i++) {
+    const OpStats& s = stats[i];
+    if (s.calls == 0) continue;
+    fprintf(file, "%-28s %14llu %14llu %12.1f", opNames[i], (unsigned long long)s.calls, (unsigned long long)s.elements,
+            double(s.elements) / double(s.calls));
+    if (s.sampledCalls) fprintf(file, " %14.1f\n", double(s.sampledCycles) / double(s.sampledCalls));
+    else fprintf(file, " %14s\n", "-");
+  }
+}
+
+void printInstrumentReport(FILE* file)
+{
+  OpStats stats[opCount];
+  getInstrumentStats(stats);
+  printInstrumentReport(file, stats);
+}
+
+#ifdef LINALG_INSTRUMENT
+
+void countInstrumentedOp(InstrumentedOp op, size_t n)
+{
+  Counters& c = counters();
+  if (c.nesting) return;
+  add(c.calls[size_t(op)], 1);
+  add(c.elements[size_t(op)], n);
+}
+
+bool beginInstrumentedOp(InstrumentedOp op, size_t n)
+{
+  Counters& c = counters();
+  if (c.nesting++) return false;
+  uint64_t calls = c.calls[size_t(op)].load(std::memory_order_relaxed);
+  add(c.calls[size_t(op)], 1);
+  add(c.elements[size_t(op)], n);
+  unsigned interval = registry().sampleInterval.load(std::memory_order_relaxed);
+  return interval && (calls & (interval - 1)) == 0;
+}
+
+void endInstrumentedOp(InstrumentedOp op, bool sampled, uint64_t cycles)
+{
+  Counters& c = counters();
+  c.nesting--;
+  if (sampled) {
+    add(c.sampledCalls[size_t(op)], 1);
+    add(c.sampledCycles[size_t(op)], cycles);
+  }
+}
+
+unsigned getInstrumentNesting()
+{
+  return counters().nesting;
+}
+
+void setInstrumentNesting(unsigned nesting)
+{
+  counters().nesting = nesting;
+}
+
+#endif
@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "LinAlg.h"
+
+// Optional counters of the calls to the hot operations of LinAlgOps.h and
+// LinAlgBatch.h, to find scalar loops that are worth converting to the
+// batched operations, without attaching a profiler.
+//
+// Define LINALG_INSTRUMENT for the whole build, the library and all code
+// including its headers, to enable them. Otherwise the macros below expand
+// to nothing, and the functions here report zeros.
+//
+// Each thread counts calls and elements per operation in its own counters.
+// Only the outermost instrumented call on a thread counts, including the
+// threads that parallelFor runs it on, so that a batched call, or inverse
+// calling mul, counts once. Calls made during constant evaluation are not
+// counted. Cycles are sampled with rdtsc on x86, elsewhere they are the
+// nanoseconds of a steady clock. Only the out-of-line operations are
+// sampled, as the inline ones take fewer cycles than reading the counter.
+
+
+/** The instrumented operations, scalar and batched. */
+enum struct InstrumentedOp
+{
+  MulMat3Vec3,        // mul(Mat3f, Vec3f)
+  MulMat3x4Vec3,      // mul(Mat3x4f, Vec3f)
+  MulMat4Vec4,        // mul(Mat4f, Vec4f)
+  MulMat3,            // mul(Mat3f, Mat3f)
+  MulMat3x4,          // mul(Mat3x4f, Mat3x4f)
+  MulMat4,            // mul(Mat4f, Mat4f)
+  InverseMat3,        // inverse(Mat3f), inverse(Mat3d)
+  InverseMat3x4,      // inverse(Mat3x4f)
+  InverseMat4,        // inverse, inverseAffine and inverseRigid of Mat4f
+  InverseTranspose,   // inverseTranspose(Mat3f), inverseTranspose(Mat3d)
+  Normalize,          // normalize of vectors and quaternions
+  TransformBBox,      // transform(Mat3x4f, BBox3f)
+  TransformPoints,    // batched transform of points
+  TransformBBoxes,    // batched transform of boxes
+  Skin,               // skinLinear, skinDualQuat
+  InverseBatch,       // batched inverse of Mat3f and Mat3d
+  InverseTransposeBatch,
+  NormalizeBatch,
+  Count
+};
+
+/** Name of op in reports, e.g. "mul(Mat3f, Mat3f)". */
+const char* getOpName(InstrumentedOp op);
+
+/** Counts of one operation. Elements is the sum of the batch sizes, 1 per scalar call. */
+struct OpStats
+{
+  uint64_t calls;
+  uint64_t elements;
+  uint64_t sampledCalls;
+  uint64_t sampledCycles;
+};
+
+/** Counts per operation since the last resetInstrumentStats, summed over all threads, stats holds InstrumentedOp::Count entries. */
+void getInstrumentStats(OpStats* stats);
+
+/** Start counting from zero, for getInstrumentStats and the next frame. */
+void resetInstrumentStats();
+
+/** Sample the cycles of every interval-th call of each operation on each thread.
+ *
+ * interval is rounded up to a power of two, 0 stops sampling, which is the
+ * default. */
+void setInstrumentCycleSampling(unsigned interval);
+
+/** Callback of endInstrumentFrame, stats holds the counts of the frame. Null to remove. */
+void setInstrumentCallback(void (*callback)(void* context, const OpStats* stats), void* context);
+
+/** Pass the counts since the previous frame to the callback. */
+void endInstrumentFrame();
+
+/** Print a table of the operations that were called, with elements and sampled cycles per call. */
+void printInstrumentReport(FILE* file, const OpStats* stats);
+
+/** printInstrumentReport of getInstrumentStats. */
+void printInstrumentReport(FILE* file);
+
+
+#ifdef LINALG_INSTRUMENT
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define LINALG_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LINALG_RDTSC
+#else
+#include <chrono>
+#endif
+
+inline uint64_t readInstrumentCycles()
+{
+#ifdef LINALG_RDTSC
+  return __rdtsc();
+#else
+  return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Internal to the library, used by the macros below and Parallel.cpp.
+
+/** Count a call of op on n elements if it is the outermost, without nesting. */
+void countInstrumentedOp(InstrumentedOp op, size_t n);
+
+/** Count a call of op on n elements if it is the outermost and enter it, true if its cycles are to be sampled. */
+bool beginInstrumentedOp(InstrumentedOp op, size_t n);
+
+/** Leave the call entered by beginInstrumentedOp, adding cycles if it was sampled. */
+void endInstrumentedOp(InstrumentedOp op, bool sampled, uint64_t cycles);
+
+/** Number of instrumented calls the current thread is in, and set it, for parallelFor. */
+unsigned getInstrumentNesting();
+void setInstrumentNesting(unsigned nesting);
+
+struct InstrumentScope
+{
+  InstrumentedOp op;
+  bool sampled;
+  uint64_t start;
+
+  InstrumentScope(InstrumentedOp op, size_t n) : op(op), sampled(beginInstrumentedOp(op, n)), start(sampled ? readInstrumentCycles() : 0) {}
+  ~InstrumentScope() { endInstrumentedOp(op, sampled, sampled ? readInstrumentCycles() - start : 0); }
+  InstrumentScope(const InstrumentScope&) = delete;
+  InstrumentScope& operator=(const InstrumentScope&) = delete;
+};
+
+/** Hides the instrumented calls in its scope, for library code that uses them internally. */
+struct InstrumentMute
+{
+  InstrumentMute() { setInstrumentNesting(getInstrumentNesting() + 1); }
+  ~InstrumentMute() { setInstrumentNesting(getInstrumentNesting() - 1); }
+  InstrumentMute(const InstrumentMute&) = delete;
+  InstrumentMute& operator=(const InstrumentMute&) = delete;
+};
+
+// Inside constexpr functions, which cannot hold a scope object. Compilers
+// that cannot tell constant evaluation do not count these.
+#ifdef LINALG_HAS_CONSTANT_EVALUATED
+#define LINALG_COUNT(op) do { if (!LINALG_CONSTANT_EVALUATED()) countInstrumentedOp(InstrumentedOp::op, 1); } while (0)
+#else
+#define LINALG_COUNT(op) do {} while (0)
+#endif
+#define LINALG_INSTRUMENT_CONCAT2(a, b) a##b
+#define LINALG_INSTRUMENT_CONCAT(a, b) LINALG_INSTRUMENT_CONCAT2(a, b)
+#define LINALG_INSTRUMENT_SCOPE(op, n) InstrumentScope LINALG_INSTRUMENT_CONCAT(instrumentScope, __LINE__)(InstrumentedOp::op, n)
+#define LINALG_INSTRUMENT_MUTE() InstrumentMute LINALG_INSTRUMENT_CONCAT(instrumentMute, __LINE__)
+
+#else
+
+#define LINALG_COUNT(op) do {} while (0)
+#define LINALG_INSTRUMENT_SCOPE(op, n) do {} while (0)
+#define LINALG_INSTRUMENT_MUTE() do {} while (0)
+
+#endif
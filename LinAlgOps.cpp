@@ -1,68 +1,753 @@
+#include <cstring>
 #include "LinAlgOps.h"
+#include "LinAlgSIMD.h"
+#include "LinAlgSVD.h"
 
 
+namespace {
+
+  // Rows of the inverse of M, the cross products of its columns divided by the determinant.
+  template<typename T>
+  void inverseRows(Vec3<T>* r, const Mat3<T>& M)
+  {
+    const Vec3<T>& c0 = M.cols[0];
+    const Vec3<T>& c1 = M.cols[1];
+    const Vec3<T>& c2 = M.cols[2];
+
+    r[0] = cross(c1, c2);
+    r[1] = cross(c2, c0);
+    r[2] = cross(c0, c1);
+
+    T invDet = T(1) / dot(r[2], c2);
+    for (unsigned i = 0; i < 3; i++) r[i] = invDet * r[i];
+  }
+
+  // The SVD code below has no branches, and the kernels in
+  // LinAlgBatchKernels.h repeat its operations in the same order.
+
+  // Largest absolute element of M, or 1 if there is none, so that M / scale
+  // is within [-1, 1] and M^T M neither overflows nor underflows.
+  float elementScale(const float* m)
+  {
+    float s = 0.f;
+    for (unsigned k = 0; k < 9; k++) {
+      float a = std::abs(m[k]);
+      s = s < a ? a : s;
+    }
+    return 0.f < s ? s : 1.f;
+  }
+
+  // Jacobi rotation of the symmetric a in the plane (p, q) that makes
+  // a[p][q] zero, also applied to the columns v[p] and v[q].
+  void jacobiRotate(float (&a)[3][3], float (&v)[3][3], unsigned p, unsigned q)
+  {
+    unsigned r = 3 - p - q;
+    float o = a[p][q];
+    float d = a[q][q] - a[p][p];
+    float h = std::sqrt(d * d + (4.f * o) * o);
+    float den = std::abs(d) + h;
+    float t = (2.f * o) / den;
+    t = d < 0.f ? -t : t;
+    t = 0.f < den ? t : 0.f;
+    float c = 1.f / std::sqrt(1.f + t * t);
+    float s = t * c;
+
+    float to = t * o;
+    a[p][p] = a[p][p] - to;
+    a[q][q] = a[q][q] + to;
+    a[p][q] = a[q][p] = 0.f;
+    float ap = a[r][p];
+    float aq = a[r][q];
+    a[r][p] = a[p][r] = c * ap - s * aq;
+    a[r][q] = a[q][r] = s * ap + c * aq;
+    for (unsigned k = 0; k < 3; k++) {
+      float vp = v[p][k];
+      float vq = v[q][k];
+      v[p][k] = c * vp - s * vq;
+      v[q][k] = s * vp + c * vq;
+    }
+  }
+
+  // Eigenvalues of m^T m for m in column order, and its eigenvectors as
+  // the columns v[i], which form a rotation.
+  void eigenATA(float* lambda, float (&v)[3][3], const float* m)
+  {
+    float a[3][3];
+    for (unsigned i = 0; i < 3; i++) {
+      for (unsigned j = i; j < 3; j++) {
+        a[i][j] = a[j][i] = m[3 * i] * m[3 * j] + m[3 * i + 1] * m[3 * j + 1] + m[3 * i + 2] * m[3 * j + 2];
+      }
+    }
+    for (unsigned i = 0; i < 3; i++) {
+      for (unsigned k = 0; k < 3; k++) v[i][k] = i == k ? 1.f : 0.f;
+    }
+    for (unsigned sweep = 0; sweep < svdSweeps; sweep++) {
+      jacobiRotate(a, v, 0, 1);
+      jacobiRotate(a, v, 0, 2);
+      jacobiRotate(a, v, 1, 2);
+    }
+    for (unsigned k = 0; k < 3; k++) lambda[k] = a[k][k];
+  }
+
+  // Order lambda[p] >= lambda[q], swapping the columns of v and negating one to keep a rotation.
+  void sortPair(float* lambda, float (&v)[3][3], unsigned p, unsigned q)
+  {
+    bool swap = lambda[p] < lambda[q];
+    float lp = lambda[p];
+    lambda[p] = swap ? lambda[q] : lp;
+    lambda[q] = swap ? lp : lambda[q];
+    for (unsigned k = 0; k < 3; k++) {
+      float vp = v[p][k];
+      v[p][k] = swap ? v[q][k] : vp;
+      v[q][k] = swap ? -vp : v[q][k];
+    }
+  }
+
+  // M = scale * U diag(sigma) V^T with the columns u[i] and v[i] of the
+  // rotations U and V, returns scale. The right singular vectors come from
+  // the eigenvectors of M^T M, and U from orthonormalizing M V.
+  float svdColumns(float (&u)[3][3], float* sigma, float (&v)[3][3], const Mat3f& M)
+  {
+    float scale = elementScale(M.data);
+    float invScale = 1.f / scale;
+    float m[9];
+    for (unsigned k = 0; k < 9; k++) m[k] = invScale * M.data[k];
+
+    float lambda[3];
+    eigenATA(lambda, v, m);
+    sortPair(lambda, v, 0, 1);
+    sortPair(lambda, v, 0, 2);
+    sortPair(lambda, v, 1, 2);
+
+    float b[3][3];
+    for (unsigned i = 0; i < 3; i++) {
+      for (unsigned k = 0; k < 3; k++) b[i][k] = m[k] * v[i][0] + m[3 + k] * v[i][1] + m[6 + k] * v[i][2];
+    }
+
+    // The x axis when M is zero.
+    float l0 = b[0][0] * b[0][0] + b[0][1] * b[0][1] + b[0][2] * b[0][2];
+    float r0 = 1.f / std::sqrt(l0);
+    bool ok0 = FLT_MIN <= l0;
+    for (unsigned k = 0; k < 3; k++) u[0][k] = ok0 ? r0 * b[0][k] : (k == 0 ? 1.f : 0.f);
+
+    // Any unit vector orthogonal to u[0] when M has rank 1, cross(u[0], x) or
+    // cross(u[0], y). The test is relative to l0, as for rank 1 b[1] is
+    // rounding noise along u[0], and what is left of it here is not
+    // orthogonal to u[0].
+    float d = u[0][0] * b[1][0] + u[0][1] * b[1][1] + u[0][2] * b[1][2];
+    float w[3];
+    for (unsigned k = 0; k < 3; k++) w[k] = b[1][k] - d * u[0][k];
+    float l1 = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+    float r1 = 1.f / std::sqrt(l1);
+    bool ok1 = svdRankTolerance * l0 < l1;
+    bool useX = std::abs(u[0][0]) < 0.5f;
+    float e[3] = { useX ? 0.f : -u[0][2], useX ? u[0][2] : 0.f, useX ? -u[0][1] : u[0][0] };
+    float re = 1.f / std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+    for (unsigned k = 0; k < 3; k++) u[1][k] = ok1 ? r1 * w[k] : re * e[k];
+
+    u[2][0] = u[0][1] * u[1][2] - u[0][2] * u[1][1];
+    u[2][1] = u[0][2] * u[1][0] - u[0][0] * u[1][2];
+    u[2][2] = u[0][0] * u[1][1] - u[0][1] * u[1][0];
+
+    for (unsigned i = 0; i < 3; i++) sigma[i] = u[i][0] * b[i][0] + u[i][1] * b[i][1] + u[i][2] * b[i][2];
+    return scale;
+  }
+
+}
+
 Mat3f inverse(const Mat3f& M)
 {
+  LINALG_INSTRUMENT_SCOPE(InverseMat3, 1);
+  Vec3f r[3];
+  inverseRows(r, M);
+  return makeMatRowMajor3f(r[0].x, r[0].y, r[0].z,
+                           r[1].x, r[1].y, r[1].z,
+                           r[2].x, r[2].y, r[2].z);
+}
+
+Mat3d inverse(const Mat3d& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseMat3, 1);
+  Vec3d r[3];
+  inverseRows(r, M);
+  return makeMatRowMajor3d(r[0].x, r[0].y, r[0].z,
+                           r[1].x, r[1].y, r[1].z,
+                           r[2].x, r[2].y, r[2].z);
+}
+
+Mat3f inverseTranspose(const Mat3f& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseTranspose, 1);
+  Vec3f r[3];
+  inverseRows(r, M);
+  return makeMat3f(r[0], r[1], r[2]);
+}
+
+Mat3d inverseTranspose(const Mat3d& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseTranspose, 1);
+  Vec3d r[3];
+  inverseRows(r, M);
+  return makeMat3d(r[0], r[1], r[2]);
+}
+
+Mat3x4f inverse(const Mat3x4f& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseMat3x4, 1);
   const Vec3f& c0 = M.cols[0];
   const Vec3f& c1 = M.cols[1];
   const Vec3f& c2 = M.cols[2];
+  const Vec3f& t = M.cols[3];
 
-  Vec3f r0 = cross(c1, c2);
-  Vec3f r1 = cross(c2, c0);
-  Vec3f r2 = cross(c0, c1);
+  float invDet = 1.f / dot(cross(c0, c1), c2);
+  Vec3f r0 = invDet * cross(c1, c2);
+  Vec3f r1 = invDet * cross(c2, c0);
+  Vec3f r2 = invDet * cross(c0, c1);
 
-  float invDet = 1.f / dot(r2, c2);
+  return makeMatRowMajor3x4f(r0.x, r0.y, r0.z, -dot(r0, t),
+                             r1.x, r1.y, r1.z, -dot(r1, t),
+                             r2.x, r2.y, r2.z, -dot(r2, t));
+}
+
+Mat4f inverse(const Mat4f& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseMat4, 1);
+  float a00 = M.c0r0;  float a01 = M.c1r0;  float a02 = M.c2r0;  float a03 = M.c3r0;
+  float a10 = M.c0r1;  float a11 = M.c1r1;  float a12 = M.c2r1;  float a13 = M.c3r1;
+  float a20 = M.c0r2;  float a21 = M.c1r2;  float a22 = M.c2r2;  float a23 = M.c3r2;
+  float a30 = M.c0r3;  float a31 = M.c1r3;  float a32 = M.c2r3;  float a33 = M.c3r3;
+
+  // 2x2 determinants of the upper two and lower two rows.
+  float s0 = a00 * a11 - a10 * a01;
+  float s1 = a00 * a12 - a10 * a02;
+  float s2 = a00 * a13 - a10 * a03;
+  float s3 = a01 * a12 - a11 * a02;
+  float s4 = a01 * a13 - a11 * a03;
+  float s5 = a02 * a13 - a12 * a03;
+
+  float c0 = a20 * a31 - a30 * a21;
+  float c1 = a20 * a32 - a30 * a22;
+  float c2 = a20 * a33 - a30 * a23;
+  float c3 = a21 * a32 - a31 * a22;
+  float c4 = a21 * a33 - a31 * a23;
+  float c5 = a22 * a33 - a32 * a23;
+
+  float invDet = 1.f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+  return makeMatRowMajor4f(invDet * ( a11 * c5 - a12 * c4 + a13 * c3),
+                           invDet * (-a01 * c5 + a02 * c4 - a03 * c3),
+                           invDet * ( a31 * s5 - a32 * s4 + a33 * s3),
+                           invDet * (-a21 * s5 + a22 * s4 - a23 * s3),
+
+                           invDet * (-a10 * c5 + a12 * c2 - a13 * c1),
+                           invDet * ( a00 * c5 - a02 * c2 + a03 * c1),
+                           invDet * (-a30 * s5 + a32 * s2 - a33 * s1),
+                           invDet * ( a20 * s5 - a22 * s2 + a23 * s1),
+
+                           invDet * ( a10 * c4 - a11 * c2 + a13 * c0),
+                           invDet * (-a00 * c4 + a01 * c2 - a03 * c0),
+                           invDet * ( a30 * s4 - a31 * s2 + a33 * s0),
+                           invDet * (-a20 * s4 + a21 * s2 - a23 * s0),
+
+                           invDet * (-a10 * c3 + a11 * c1 - a12 * c0),
+                           invDet * ( a00 * c3 - a01 * c1 + a02 * c0),
+                           invDet * (-a30 * s3 + a31 * s1 - a32 * s0),
+                           invDet * ( a20 * s3 - a21 * s1 + a22 * s0));
+}
+
+Mat4f inverseAffine(const Mat4f& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseMat4, 1);
+  Vec3f c0 = makeVec3f(M.cols[0]);
+  Vec3f c1 = makeVec3f(M.cols[1]);
+  Vec3f c2 = makeVec3f(M.cols[2]);
+  Vec3f t = makeVec3f(M.cols[3]);
+
+  float invDet = 1.f / dot(cross(c0, c1), c2);
+  Vec3f r0 = invDet * cross(c1, c2);
+  Vec3f r1 = invDet * cross(c2, c0);
+  Vec3f r2 = invDet * cross(c0, c1);
+
+  return makeMatRowMajor4f(r0.x, r0.y, r0.z, -dot(r0, t),
+                           r1.x, r1.y, r1.z, -dot(r1, t),
+                           r2.x, r2.y, r2.z, -dot(r2, t),
+                           0.f,  0.f,  0.f,  1.f);
+}
 
-  return makeMatRowMajor3f(invDet * r0.x, invDet * r0.y, invDet*r0.z,
-                           invDet * r1.x, invDet * r1.y, invDet*r1.z,
-                           invDet * r2.x, invDet * r2.y, invDet*r2.z);
+Mat4f inverseRigid(const Mat4f& M)
+{
+  LINALG_INSTRUMENT_SCOPE(InverseMat4, 1);
+  const Vec4f& c0 = M.cols[0];
+  const Vec4f& c1 = M.cols[1];
+  const Vec4f& c2 = M.cols[2];
+  const Vec4f& t = M.cols[3];
+  return makeMatRowMajor4f(c0.x, c0.y, c0.z, -(c0.x * t.x + c0.y * t.y + c0.z * t.z),
+                           c1.x, c1.y, c1.z, -(c1.x * t.x + c1.y * t.y + c1.z * t.z),
+                           c2.x, c2.y, c2.z, -(c2.x * t.x + c2.y * t.y + c2.z * t.z),
+                           0.f,  0.f,  0.f,  1.f);
 }
 
-Mat3f mul(const Mat3f& A, const Mat3f& B)
+Mat4f mul(const Mat4f& A, const Mat4f& B)
 {
-  float A00 = A.cols[0].x;  float A10 = A.cols[0].y;  float A20 = A.cols[0].z;
-  float A01 = A.cols[1].x;  float A11 = A.cols[1].y;  float A21 = A.cols[1].z;
-  float A02 = A.cols[2].x;  float A12 = A.cols[2].y;  float A22 = A.cols[2].z;
+  LINALG_INSTRUMENT_SCOPE(MulMat4, 1);
+  Mat4f R;
+#ifdef LINALG_SSE2
+  __m128 a0 = _mm_loadu_ps(A.cols[0].data);
+  __m128 a1 = _mm_loadu_ps(A.cols[1].data);
+  __m128 a2 = _mm_loadu_ps(A.cols[2].data);
+  __m128 a3 = _mm_loadu_ps(A.cols[3].data);
+  for (unsigned j = 0; j < 4; j++) {
+    const float* b = B.cols[j].data;
+    __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[0])),
+                                                _mm_mul_ps(a1, _mm_set1_ps(b[1]))),
+                                     _mm_mul_ps(a2, _mm_set1_ps(b[2]))),
+                          _mm_mul_ps(a3, _mm_set1_ps(b[3])));
+    _mm_storeu_ps(R.cols[j].data, r);
+  }
+#else
+  for (unsigned j = 0; j < 4; j++) {
+    R.cols[j] = mul(A, B.cols[j]);
+  }
+#endif
+  return R;
+}
 
-  float B00 = B.cols[0].x;  float B10 = B.cols[0].y;  float B20 = B.cols[0].z;
-  float B01 = B.cols[1].x;  float B11 = B.cols[1].y;  float B21 = B.cols[1].z;
-  float B02 = B.cols[2].x;  float B12 = B.cols[2].y;  float B22 = B.cols[2].z;
+Vec4f mul(const Mat4f& A, const Vec4f& x)
+{
+  LINALG_INSTRUMENT_SCOPE(MulMat4Vec4, 1);
+  Vec4f r;
+#ifdef LINALG_SSE2
+  __m128 t = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(A.cols[0].data), _mm_set1_ps(x.x)),
+                                              _mm_mul_ps(_mm_loadu_ps(A.cols[1].data), _mm_set1_ps(x.y))),
+                                   _mm_mul_ps(_mm_loadu_ps(A.cols[2].data), _mm_set1_ps(x.z))),
+                        _mm_mul_ps(_mm_loadu_ps(A.cols[3].data), _mm_set1_ps(x.w)));
+  _mm_storeu_ps(r.data, t);
+#else
+  for (unsigned k = 0; k < 4; k++) {
+    r.data[k] = A.data[k] * x.data[0] + A.data[4 + k] * x.data[1] + A.data[8 + k] * x.data[2] + A.data[12 + k] * x.data[3];
+  }
+#endif
+  return r;
+}
 
-  return makeMatRowMajor3f(A00 * B00 + A01 * B10 + A02 * B20,
-                           A00 * B01 + A01 * B11 + A02 * B21,
-                           A00 * B02 + A01 * B12 + A02 * B22,
+Quatf slerp(const Quatf& a, const Quatf& b, float t)
+{
+  float c = dot(a, b);
+  float sign = c < 0.f ? -1.f : 1.f;
+  c = sign * c;
+  if (0.9995f < c) {
+    return nlerp(a, b, t);
+  }
 
-                           A10 * B00 + A11 * B10 + A12 * B20,
-                           A10 * B01 + A11 * B11 + A12 * B21,
-                           A10 * B02 + A11 * B12 + A12 * B22,
+  float theta = std::acos(c);
+  float invSin = 1.f / std::sin(theta);
+  float r = std::sin((1.f - t) * theta) * invSin;
+  float s = sign * std::sin(t * theta) * invSin;
+  return makeQuatf(r * a.x + s * b.x,
+                   r * a.y + s * b.y,
+                   r * a.z + s * b.z,
+                   r * a.w + s * b.w);
+}
 
-                           A20 * B00 + A21 * B10 + A22 * B20,
-                           A20 * B01 + A21 * B11 + A22 * B21,
-                           A20 * B02 + A21 * B12 + A22 * B22);
+Mat3f makeMat3f(const Quatf& q)
+{
+  float xx = q.x * q.x;  float yy = q.y * q.y;  float zz = q.z * q.z;
+  float xy = q.x * q.y;  float xz = q.x * q.z;  float yz = q.y * q.z;
+  float wx = q.w * q.x;  float wy = q.w * q.y;  float wz = q.w * q.z;
+  return makeMatRowMajor3f(1.f - 2.f * (yy + zz), 2.f * (xy - wz),       2.f * (xz + wy),
+                           2.f * (xy + wz),       1.f - 2.f * (xx + zz), 2.f * (yz - wx),
+                           2.f * (xz - wy),       2.f * (yz + wx),       1.f - 2.f * (xx + yy));
+}
+
+Quatf makeQuatf(const Mat3f& M)
+{
+  float m00 = M.c0r0;  float m01 = M.c1r0;  float m02 = M.c2r0;
+  float m10 = M.c0r1;  float m11 = M.c1r1;  float m12 = M.c2r1;
+  float m20 = M.c0r2;  float m21 = M.c1r2;  float m22 = M.c2r2;
+
+  float trace = m00 + m11 + m22;
+  if (0.f < trace) {
+    float s = 0.5f / std::sqrt(trace + 1.f);
+    return makeQuatf((m21 - m12) * s, (m02 - m20) * s, (m10 - m01) * s, 0.25f / s);
+  }
+  else if (m11 < m00 && m22 < m00) {
+    float s = 2.f * std::sqrt(1.f + m00 - m11 - m22);
+    return makeQuatf(0.25f * s, (m01 + m10) / s, (m02 + m20) / s, (m21 - m12) / s);
+  }
+  else if (m22 < m11) {
+    float s = 2.f * std::sqrt(1.f + m11 - m00 - m22);
+    return makeQuatf((m01 + m10) / s, 0.25f * s, (m12 + m21) / s, (m02 - m20) / s);
+  }
+  else {
+    float s = 2.f * std::sqrt(1.f + m22 - m00 - m11);
+    return makeQuatf((m02 + m20) / s, (m12 + m21) / s, 0.25f * s, (m10 - m01) / s);
+  }
+}
+
+DualQuatf makeDualQuatf(const Quatf& rotation, const Vec3f& translation)
+{
+  Quatf t = makeQuatf(0.5f * translation.x, 0.5f * translation.y, 0.5f * translation.z, 0.f);
+  return makeDualQuat(rotation, mul(t, rotation));
+}
+
+DualQuatf makeDualQuatf(const Mat3x4f& M)
+{
+  return makeDualQuatf(makeQuatf(makeMat3f(M.data)), M.cols[3]);
+}
+
+Mat3x4f makeMat3x4f(const DualQuatf& d)
+{
+  Mat3f R = makeMat3f(d.real);
+  Quatf t = mul(d.dual, conjugate(d.real));
+  return makeMat3x4f(R.cols[0], R.cols[1], R.cols[2], makeVec3f(2.f * t.x, 2.f * t.y, 2.f * t.z));
+}
+
+Half makeHalf(float x)
+{
+  // Round to nearest even, overflow gives infinity and NaN stays NaN.
+  const uint32_t f32infty = 255u << 23;
+  const uint32_t f16max = (127u + 16u) << 23;
+  const uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+  uint32_t u;
+  std::memcpy(&u, &x, sizeof(u));
+  uint32_t sign = u & 0x80000000u;
+  u ^= sign;
+
+  uint32_t o;
+  if (f16max <= u) {
+    o = f32infty < u ? 0x7e00u : 0x7c00u;
+  }
+  else if (u < (113u << 23)) {
+    float f, magic;
+    std::memcpy(&f, &u, sizeof(f));
+    std::memcpy(&magic, &denormMagic, sizeof(magic));
+    f += magic;
+    std::memcpy(&u, &f, sizeof(u));
+    o = u - denormMagic;
+  }
+  else {
+    uint32_t mantissaOdd = (u >> 13) & 1u;
+    u += (uint32_t(15 - 127) << 23) + 0xfffu;
+    u += mantissaOdd;
+    o = u >> 13;
+  }
+
+  Half h;
+  h.bits = uint16_t(o | (sign >> 16));
+  return h;
+}
+
+float makeFloat(Half h)
+{
+  const uint32_t shiftedExp = 0x7c00u << 13;
+  const uint32_t magicBits = 113u << 23;
+
+  uint32_t o = uint32_t(h.bits & 0x7fffu) << 13;
+  uint32_t exp = shiftedExp & o;
+  o += (127u - 15u) << 23;
+  if (exp == shiftedExp) {
+    o += (128u - 16u) << 23;    // Infinity or NaN.
+  }
+  else if (exp == 0) {
+    float f, magic;             // Zero or denormal, renormalize.
+    o += 1u << 23;
+    std::memcpy(&f, &o, sizeof(f));
+    std::memcpy(&magic, &magicBits, sizeof(magic));
+    f -= magic;
+    std::memcpy(&o, &f, sizeof(o));
+  }
+  o |= uint32_t(h.bits & 0x8000u) << 16;
+
+  float x;
+  std::memcpy(&x, &o, sizeof(x));
+  return x;
+}
+
+Vec3us quantize(const BBox3f& frame, const Vec3f& p)
+{
+  Vec3us q;
+  for (unsigned k = 0; k < 3; k++) {
+    float extent = frame.max[k] - frame.min[k];
+    float scale = 0.f < extent ? 65535.f / extent : 0.f;
+    float t = (p[k] - frame.min[k]) * scale;
+    t = t < 0.f ? 0.f : (65535.f < t ? 65535.f : t);
+    q[k] = uint16_t(std::lrint(t));
+  }
+  return q;
+}
+
+Vec3f dequantize(const BBox3f& frame, const Vec3us& q)
+{
+  Vec3f p;
+  for (unsigned k = 0; k < 3; k++) {
+    float step = (frame.max[k] - frame.min[k]) / 65535.f;
+    p[k] = frame.min[k] + float(q[k]) * step;
+  }
+  return p;
+}
+
+namespace {
+
+  // Largest cell coordinate with b bits, as the largest float below 2^b.
+  float maxCell(unsigned bits) { return bits <= 24 ? float((1u << bits) - 1) : float(1u << bits) - float(1u << (bits - 24)); }
+
+  // Cell coordinates of p along D axes, NaN goes to 0.
+  template<unsigned D, typename BBox, typename Vec>
+  void cellsOf(uint32_t* c, const BBox& frame, const Vec& p, unsigned bits)
+  {
+    float cells = float(1u << bits);
+    float limit = maxCell(bits);
+    for (unsigned k = 0; k < D; k++) {
+      float extent = frame.max[k] - frame.min[k];
+      float scale = 0.f < extent ? cells / extent : 0.f;
+      float t = (p[k] - frame.min[k]) * scale;
+      t = 0.f < t ? t : 0.f;
+      t = t < limit ? t : limit;
+      c[k] = uint32_t(int32_t(t));
+    }
+  }
+
+  // Spread the bits of x to every second or third bit.
+  uint32_t spread2(uint32_t x)
+  {
+    x &= 0xffff;
+    x = (x | x << 8) & 0x00ff00ff;
+    x = (x | x << 4) & 0x0f0f0f0f;
+    x = (x | x << 2) & 0x33333333;
+    return (x | x << 1) & 0x55555555;
+  }
+
+  uint64_t spread2(uint64_t x)
+  {
+    x &= 0xffffffff;
+    x = (x | x << 16) & 0x0000ffff0000ffff;
+    x = (x | x << 8) & 0x00ff00ff00ff00ff;
+    x = (x | x << 4) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | x << 2) & 0x3333333333333333;
+    return (x | x << 1) & 0x5555555555555555;
+  }
+
+  uint32_t spread3(uint32_t x)
+  {
+    x &= 0x3ff;
+    x = (x | x << 16) & 0x030000ff;
+    x = (x | x << 8) & 0x0300f00f;
+    x = (x | x << 4) & 0x030c30c3;
+    return (x | x << 2) & 0x09249249;
+  }
+
+  uint64_t spread3(uint64_t x)
+  {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x001f00000000ffff;
+    x = (x | x << 16) & 0x001f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    return (x | x << 2) & 0x1249249249249249;
+  }
+
+  // Skilling's transform of cell coordinates into the Hilbert index, which
+  // is then the interleaving of x[0], ..., x[D - 1] with x[0] highest.
+  template<unsigned D>
+  void hilbertTranspose(uint32_t* x, unsigned bits)
+  {
+    for (uint32_t q = 1u << (bits - 1); q > 1; q >>= 1) {
+      uint32_t p = q - 1;
+      for (unsigned i = 0; i < D; i++) {
+        // Bit q set: invert the low bits of x[0]. Clear: swap them with x[i].
+        // The bits are random, so this is done without branches.
+        uint32_t set = 0u - ((x[i] & q) != 0);
+        uint32_t t = (x[0] ^ x[i]) & p;
+        x[0] ^= (p & set) | (t & ~set);
+        x[i] ^= t & ~set;
+      }
+    }
+    for (unsigned i = 1; i < D; i++) x[i] ^= x[i - 1];
+    uint32_t t = 0;
+    for (uint32_t q = 1u << (bits - 1); q > 1; q >>= 1) {
+      t ^= (q - 1) & (0u - ((x[D - 1] & q) != 0));
+    }
+    for (unsigned i = 0; i < D; i++) x[i] ^= t;
+  }
+
+  // 30- or 63-bit keys in 3D and 30- or 62-bit keys in 2D.
+  template<typename Key, bool Hilbert, unsigned D, typename BBox, typename Vec>
+  Key spatialKey(const BBox& frame, const Vec& p)
+  {
+    const unsigned bits = (sizeof(Key) == 4 ? 30 : 63) / D;
+    uint32_t c[D];
+    cellsOf<D>(c, frame, p, bits);
+    if (Hilbert) hilbertTranspose<D>(c, bits);
+    Key key = 0;
+    for (unsigned k = 0; k < D; k++) {
+      Key s = D == 2 ? spread2(Key(c[k])) : spread3(Key(c[k]));
+      key |= s << (Hilbert ? D - 1 - k : k);
+    }
+    return key;
+  }
+
+}
+
+uint32_t mortonKey(const BBox3f& frame, const Vec3f& p) { return spatialKey<uint32_t, false, 3>(frame, p); }
+uint32_t mortonKey(const BBox2f& frame, const Vec2f& p) { return spatialKey<uint32_t, false, 2>(frame, p); }
+uint64_t mortonKey64(const BBox3f& frame, const Vec3f& p) { return spatialKey<uint64_t, false, 3>(frame, p); }
+uint64_t mortonKey64(const BBox2f& frame, const Vec2f& p) { return spatialKey<uint64_t, false, 2>(frame, p); }
+uint32_t hilbertKey(const BBox3f& frame, const Vec3f& p) { return spatialKey<uint32_t, true, 3>(frame, p); }
+uint32_t hilbertKey(const BBox2f& frame, const Vec2f& p) { return spatialKey<uint32_t, true, 2>(frame, p); }
+uint64_t hilbertKey64(const BBox3f& frame, const Vec3f& p) { return spatialKey<uint64_t, true, 3>(frame, p); }
+uint64_t hilbertKey64(const BBox2f& frame, const Vec2f& p) { return spatialKey<uint64_t, true, 2>(frame, p); }
+
+Vec2s encodeOctahedral(const Vec3f& n)
+{
+  // No direction to encode, return the code of +z.
+  float l = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  if (!(FLT_MIN <= l && l <= FLT_MAX)) return makeVec2<int16_t>(0, 0);
+
+  float s = 1.f / l;
+  float x = n.x * s;
+  float y = n.y * s;
+  if (n.z < 0.f) {
+    float ax = std::abs(x);
+    float ay = std::abs(y);
+    x = x < 0.f ? ay - 1.f : 1.f - ay;
+    y = y < 0.f ? ax - 1.f : 1.f - ax;
+  }
+  Vec2s e;
+  e.x = int16_t(std::lrint(32767.f * x));
+  e.y = int16_t(std::lrint(32767.f * y));
+  return e;
+}
+
+Vec3f decodeOctahedral(const Vec2s& e)
+{
+  float x = float(e.x) * (1.f / 32767.f);
+  float y = float(e.y) * (1.f / 32767.f);
+  x = x < -1.f ? -1.f : x;
+  y = y < -1.f ? -1.f : y;
+  float ax = std::abs(x);
+  float ay = std::abs(y);
+  float z = 1.f - ax - ay;
+  if (z < 0.f) {
+    x = x < 0.f ? ay - 1.f : 1.f - ay;
+    y = y < 0.f ? ax - 1.f : 1.f - ax;
+  }
+  return normalize(makeVec3f(x, y, z));
+}
+
+Frustumf makeFrustumf(const Mat4f& M, bool depthZeroToOne)
+{
+  Vec4f r0 = makeVec4f(M.c0r0, M.c1r0, M.c2r0, M.c3r0);
+  Vec4f r1 = makeVec4f(M.c0r1, M.c1r1, M.c2r1, M.c3r1);
+  Vec4f r2 = makeVec4f(M.c0r2, M.c1r2, M.c2r2, M.c3r2);
+  Vec4f r3 = makeVec4f(M.c0r3, M.c1r3, M.c2r3, M.c3r3);
+
+  Vec4f p[6] = {
+    r3 + r0,
+    r3 - r0,
+    r3 + r1,
+    r3 - r1,
+    depthZeroToOne ? r2 : r3 + r2,
+    r3 - r2
+  };
+
+  Frustumf frustum;
+  for (unsigned i = 0; i < 6; i++) {
+    frustum.planes[i] = normalize(makePlane(makeVec3f(p[i]), p[i].w));
+  }
+  return frustum;
+}
+
+void svd(Mat3f& U, Vec3f& sigma, Mat3f& V, const Mat3f& M)
+{
+  float u[3][3], s[3], v[3][3];
+  float scale = svdColumns(u, s, v, M);
+  for (unsigned i = 0; i < 3; i++) {
+    for (unsigned k = 0; k < 3; k++) {
+      U.cols[i][k] = u[i][k];
+      V.cols[i][k] = v[i][k];
+    }
+    sigma[i] = scale * s[i];
+  }
+}
+
+void polarDecomposition(Mat3f& R, Mat3f& S, const Mat3f& M)
+{
+  float u[3][3], s[3], v[3][3];
+  float scale = svdColumns(u, s, v, M);
+
+  // Move the sign of a mirroring M from the last singular value into U.
+  bool flip = s[2] < 0.f;
+  s[2] = flip ? -s[2] : s[2];
+  for (unsigned k = 0; k < 3; k++) u[2][k] = flip ? -u[2][k] : u[2][k];
+
+  for (unsigned j = 0; j < 3; j++) {
+    for (unsigned k = 0; k < 3; k++) {
+      R.cols[j][k] = u[0][k] * v[0][j] + u[1][k] * v[1][j] + u[2][k] * v[2][j];
+    }
+    for (unsigned k = j; k < 3; k++) {
+      S.cols[j][k] = S.cols[k][j] = scale * ((v[0][k] * s[0]) * v[0][j] + (v[1][k] * s[1]) * v[1][j] + (v[2][k] * s[2]) * v[2][j]);
+    }
+  }
 }
 
 float getScale(const Mat3f& M)
 {
-  float sx = length(M.cols[0]);
-  float sy = length(M.cols[1]);
-  float sz = length(M.cols[2]);
-  auto t = sx > sy ? sx : sy;
-  return sz > t ? sz : t;
+  // A = M^T M = q I + p B, where B has trace 0 and eigenvalues within
+  // [-2, 2], the largest being 2 cos(acos(r) / 3) for r = det(B) / 2. With
+  // t = sqrt((1 + r) / 2) that is 2 cos(2/3 acos(t)), which is smooth in
+  // t. In double, as float would lose half its digits to the
+  // square root when the two largest eigenvalues are close, and as the
+  // squares of floats neither overflow nor underflow, so M needs no scaling.
+  double m[9];
+  for (unsigned k = 0; k < 9; k++) m[k] = double(M.data[k]);
+  double a00 = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+  double a11 = m[3] * m[3] + m[4] * m[4] + m[5] * m[5];
+  double a22 = m[6] * m[6] + m[7] * m[7] + m[8] * m[8];
+  double a01 = m[0] * m[3] + m[1] * m[4] + m[2] * m[5];
+  double a02 = m[0] * m[6] + m[1] * m[7] + m[2] * m[8];
+  double a12 = m[3] * m[6] + m[4] * m[7] + m[5] * m[8];
+
+  double q = (a00 + a11 + a22) * (1.0 / 3.0);
+  double d0 = a00 - q;
+  double d1 = a11 - q;
+  double d2 = a22 - q;
+  double p2 = (d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * (a01 * a01 + a02 * a02 + a12 * a12)) * (1.0 / 6.0);
+  double p = std::sqrt(p2);
+  double p3 = 2.0 * p2 * p;
+  double det = d0 * (d1 * d2 - a12 * a12) - a01 * (a01 * d2 - a12 * a02) + a02 * (a01 * a12 - d1 * a02);
+  double r = 0.0 < p3 ? det / p3 : 0.0;
+  r = r < -1.0 ? -1.0 : r;
+  r = 1.0 < r ? 1.0 : r;
+  double x = 2.0 * std::sqrt(0.5 + 0.5 * r) - 1.0;
+
+  // Estrin's scheme, for a shorter dependency chain than Horner's.
+  const double* c = scaleAngleCoefficients;
+  double x2 = x * x;
+  double x4 = x2 * x2;
+  double g = (c[0] + c[1] * x + x2 * (c[2] + c[3] * x)) + x4 * (c[4] + c[5] * x + x2 * (c[6] + c[7] * x)) + (x4 * x4) * (c[8] + c[9] * x);
+  return float(std::sqrt(q + 2.0 * p * g));
 }
 
 
 BBox3f transform(const Mat3x4f& M, const BBox3f& bbox)
 {
-  Vec3f p[8] = {
-    mul(M, makeVec3f(bbox.min.x, bbox.min.y, bbox.min.z)),
-    mul(M, makeVec3f(bbox.min.x, bbox.min.y, bbox.max.z)),
-    mul(M, makeVec3f(bbox.min.x, bbox.max.y, bbox.min.z)),
-    mul(M, makeVec3f(bbox.min.x, bbox.max.y, bbox.max.z)),
-    mul(M, makeVec3f(bbox.max.x, bbox.min.y, bbox.min.z)),
-    mul(M, makeVec3f(bbox.max.x, bbox.min.y, bbox.max.z)),
-    mul(M, makeVec3f(bbox.max.x, bbox.max.y, bbox.min.z)),
-    mul(M, makeVec3f(bbox.max.x, bbox.max.y, bbox.max.z))
-  };
-  return makeBBox(min(min(min(p[0], p[1]), min(p[2], p[3])), min(min(p[4], p[5]), min(p[6], p[7]))),
-                  max(max(max(p[0], p[1]), max(p[2], p[3])), max(max(p[4], p[5]), max(p[6], p[7]))));
+  LINALG_INSTRUMENT_SCOPE(TransformBBox, 1);
+  if (isEmpty(bbox)) return makeEmptyBBox3f();
+
+  // Transform center and extent, the extent of the result is the extent
+  // weighted by the absolute values of the matrix (Arvo). The extent is
+  // then widened by the rounding error of transforming a corner, which is
+  // bounded relative to the sum of the absolute values of its terms, S.
+  Vec3f c = 0.5f * (bbox.max + bbox.min);
+  Vec3f e = 0.5f * (bbox.max - bbox.min);
+  Vec3f C = mul(M, c);
+  Vec3f E;
+  for (unsigned k = 0; k < 3; k++) {
+    float Ek = std::abs(M.data[k]) * e.data[0] + std::abs(M.data[3 + k]) * e.data[1] + std::abs(M.data[6 + k]) * e.data[2];
+    float Sk = std::abs(M.data[k]) * std::abs(c.data[0]) + std::abs(M.data[3 + k]) * std::abs(c.data[1]) +
+               std::abs(M.data[6 + k]) * std::abs(c.data[2]) + std::abs(M.data[9 + k]);
+    E.data[k] = Ek + bboxTransformPadding * (Sk + Ek);
+  }
+  return makeBBox(C - E, C + E);
 }
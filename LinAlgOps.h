@@ -2,30 +2,36 @@
 #include <cmath>
 #include <cfloat>
 #include "LinAlg.h"
+#include "LinAlgInstrument.h"
+
+// Same test as LINALG_SSE2 in LinAlgSIMD.h, for the inline rsqrt.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#endif
 
 template<typename T>
-Vec2<T> operator*(const T a, const Vec2<T>& b)
+constexpr Vec2<T> operator*(const T a, const Vec2<T>& b)
 {
   return makeVec2<T>(a * b.x,
                      a * b.y);
 }
 
 template<typename T>
-Vec2<T> operator-(const Vec2<T>& a, const Vec2<T>& b)
+constexpr Vec2<T> operator-(const Vec2<T>& a, const Vec2<T>& b)
 {
   return makeVec2<T>(a.x - b.x,
                      a.y - b.y);
 }
 
 template<typename T>
-Vec2<T> operator+(const Vec2<T>& a, const Vec2<T>& b)
+constexpr Vec2<T> operator+(const Vec2<T>& a, const Vec2<T>& b)
 {
   return makeVec2<T>(a.x + b.x,
                      a.y + b.y);
 }
 
 template<typename T>
-Vec3<T> operator*(const T a, const Vec3<T>& b)
+constexpr Vec3<T> operator*(const T a, const Vec3<T>& b)
 {
   return makeVec3<T>(a * b.x,
                      a * b.y,
@@ -33,7 +39,7 @@ Vec3<T> operator*(const T a, const Vec3<T>& b)
 }
 
 template<typename T>
-Vec3<T> operator-(const Vec3<T>& a, const Vec3<T>& b)
+constexpr Vec3<T> operator-(const Vec3<T>& a, const Vec3<T>& b)
 {
   return makeVec3<T>(a.x - b.x,
                      a.y - b.y,
@@ -41,7 +47,7 @@ Vec3<T> operator-(const Vec3<T>& a, const Vec3<T>& b)
 }
 
 template<typename T>
-Vec3<T> operator+(const Vec3<T>& a, const Vec3<T>& b)
+constexpr Vec3<T> operator+(const Vec3<T>& a, const Vec3<T>& b)
 {
   return makeVec3<T>(a.x + b.x,
                      a.y + b.y,
@@ -49,7 +55,7 @@ Vec3<T> operator+(const Vec3<T>& a, const Vec3<T>& b)
 }
 
 template<typename T>
-Vec4<T> operator*(const T a, const Vec4<T>& b)
+constexpr Vec4<T> operator*(const T a, const Vec4<T>& b)
 {
   return makeVec4<T>(a * b.x,
                      a * b.y,
@@ -58,7 +64,7 @@ Vec4<T> operator*(const T a, const Vec4<T>& b)
 }
 
 template<typename T>
-Vec4<T> operator-(const Vec4<T>& a, const Vec4<T>& b)
+constexpr Vec4<T> operator-(const Vec4<T>& a, const Vec4<T>& b)
 {
   return makeVec4<T>(a.x - b.x,
                      a.y - b.y,
@@ -67,7 +73,7 @@ Vec4<T> operator-(const Vec4<T>& a, const Vec4<T>& b)
 }
 
 template<typename T>
-Vec4<T> operator+(const Vec4<T>& a, const Vec4<T>& b)
+constexpr Vec4<T> operator+(const Vec4<T>& a, const Vec4<T>& b)
 {
   return makeVec4<T>(a.x + b.x,
                      a.y + b.y,
@@ -75,24 +81,24 @@ Vec4<T> operator+(const Vec4<T>& a, const Vec4<T>& b)
                      a.w + b.w);
 }
 
-template<typename T> Vec3<T> cross(const Vec3<T>& a, const Vec3<T>& b)
+template<typename T> constexpr Vec3<T> cross(const Vec3<T>& a, const Vec3<T>& b)
 {
   return makeVec3<T>(a.y * b.z - a.z * b.y,
                      a.z * b.x - a.x * b.z,
                      a.x * b.y - a.y * b.x);
 }
 
-template<typename T> T dot(const Vec2<T>& a, const Vec2<T>& b) { return a.x * b.x + a.y * b.y; }
-template<typename T> T dot(const Vec3<T>& a, const Vec3<T>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
-template<typename T> T dot(const Vec4<T>& a, const Vec4<T>& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+template<typename T> constexpr T dot(const Vec2<T>& a, const Vec2<T>& b) { return a.x * b.x + a.y * b.y; }
+template<typename T> constexpr T dot(const Vec3<T>& a, const Vec3<T>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+template<typename T> constexpr T dot(const Vec4<T>& a, const Vec4<T>& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
 
-template<typename T> T lengthSquared(const Vec2<T>& a) { return dot(a, a); }
-template<typename T> T lengthSquared(const Vec3<T>& a) { return dot(a, a); }
-template<typename T> T lengthSquared(const Vec4<T>& a) { return dot(a, a); }
+template<typename T> constexpr T lengthSquared(const Vec2<T>& a) { return dot(a, a); }
+template<typename T> constexpr T lengthSquared(const Vec3<T>& a) { return dot(a, a); }
+template<typename T> constexpr T lengthSquared(const Vec4<T>& a) { return dot(a, a); }
 
-template<typename T> T distanceSquared(const Vec2<T>& a, const Vec2<T>&b) { return lengthSquared(a - b); }
-template<typename T> T distanceSquared(const Vec3<T>& a, const Vec3<T>&b) { return lengthSquared(a - b); }
-template<typename T> T distanceSquared(const Vec4<T>& a, const Vec4<T>&b) { return lengthSquared(a - b); }
+template<typename T> constexpr T distanceSquared(const Vec2<T>& a, const Vec2<T>&b) { return lengthSquared(a - b); }
+template<typename T> constexpr T distanceSquared(const Vec3<T>& a, const Vec3<T>&b) { return lengthSquared(a - b); }
+template<typename T> constexpr T distanceSquared(const Vec4<T>& a, const Vec4<T>&b) { return lengthSquared(a - b); }
 
 template<typename T> T length(const Vec2<T>& a) { return std::sqrt(dot(a, a)); }
 template<typename T> T length(const Vec3<T>& a) { return std::sqrt(dot(a, a)); }
@@ -102,9 +108,52 @@ template<typename T> T distance(const Vec2<T>& a, const Vec2<T>&b) { return leng
 template<typename T> T distance(const Vec3<T>& a, const Vec3<T>&b) { return length(a - b); }
 template<typename T> T distance(const Vec4<T>& a, const Vec4<T>&b) { return length(a - b); }
 
-template<typename T> Vec2<T> normalize(const Vec2<T>& a) { return (T(1) / length(a)) * a; }
-template<typename T> Vec3<T> normalize(const Vec3<T>& a) { return (T(1) / length(a)) * a; }
-template<typename T> Vec4<T> normalize(const Vec4<T>& a) { return (T(1) / length(a)) * a; }
+template<typename T> Vec2<T> normalize(const Vec2<T>& a) { LINALG_COUNT(Normalize); return (T(1) / length(a)) * a; }
+template<typename T> Vec3<T> normalize(const Vec3<T>& a) { LINALG_COUNT(Normalize); return (T(1) / length(a)) * a; }
+template<typename T> Vec4<T> normalize(const Vec4<T>& a) { LINALG_COUNT(Normalize); return (T(1) / length(a)) * a; }
+
+template<typename T> T length(const Vec2<T>& a, ExactPrecision) { return length(a); }
+template<typename T> T length(const Vec3<T>& a, ExactPrecision) { return length(a); }
+template<typename T> T length(const Vec4<T>& a, ExactPrecision) { return length(a); }
+
+template<typename T> T distance(const Vec2<T>& a, const Vec2<T>& b, ExactPrecision) { return distance(a, b); }
+template<typename T> T distance(const Vec3<T>& a, const Vec3<T>& b, ExactPrecision) { return distance(a, b); }
+template<typename T> T distance(const Vec4<T>& a, const Vec4<T>& b, ExactPrecision) { return distance(a, b); }
+
+template<typename T> Vec2<T> normalize(const Vec2<T>& a, ExactPrecision) { return normalize(a); }
+template<typename T> Vec3<T> normalize(const Vec3<T>& a, ExactPrecision) { return normalize(a); }
+template<typename T> Vec4<T> normalize(const Vec4<T>& a, ExactPrecision) { return normalize(a); }
+
+/** 1 / sqrt(x), 0 if x < FLT_MIN, for x up to FLT_MAX.
+ *
+ * The hardware estimate refined by one Newton-Raphson step. The relative
+ * error is below 5e-7 for any estimate within the architectural bound of
+ * 1.5 * 2^-12, and measures 3e-7 on current x86 CPUs. The estimate differs
+ * between CPU vendors, so results differ across machines. length, distance
+ * and normalize add the rounding of the dot product, and treat squared
+ * lengths below FLT_MIN as zero. */
+inline float rsqrt(float x, FastPrecision)
+{
+  if (x < FLT_MIN) return 0.f;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#else
+  float r = 1.f / std::sqrt(x);
+#endif
+  return r * (1.5f - ((0.5f * x) * r) * r);
+}
+
+inline float length(const Vec2f& a, FastPrecision p) { float s = dot(a, a); return s * rsqrt(s, p); }
+inline float length(const Vec3f& a, FastPrecision p) { float s = dot(a, a); return s * rsqrt(s, p); }
+inline float length(const Vec4f& a, FastPrecision p) { float s = dot(a, a); return s * rsqrt(s, p); }
+
+inline float distance(const Vec2f& a, const Vec2f& b, FastPrecision p) { return length(a - b, p); }
+inline float distance(const Vec3f& a, const Vec3f& b, FastPrecision p) { return length(a - b, p); }
+inline float distance(const Vec4f& a, const Vec4f& b, FastPrecision p) { return length(a - b, p); }
+
+inline Vec2f normalize(const Vec2f& a, FastPrecision p) { LINALG_COUNT(Normalize); return rsqrt(dot(a, a), p) * a; }
+inline Vec3f normalize(const Vec3f& a, FastPrecision p) { LINALG_COUNT(Normalize); return rsqrt(dot(a, a), p) * a; }
+inline Vec4f normalize(const Vec4f& a, FastPrecision p) { LINALG_COUNT(Normalize); return rsqrt(dot(a, a), p) * a; }
 
 template<typename T>
 T* write(T* dst, const Vec2<T>& a)
@@ -133,15 +182,25 @@ T* write(T* dst, const Vec4<T>& a)
   return dst;
 }
 
+/** Write the components of the compound types in memory order, e.g. matrices column by column. */
+template<typename T> T* write(T* dst, const Quat<T>& a) { for (unsigned i = 0; i < 4; i++) *dst++ = a.data[i]; return dst; }
+template<typename T> T* write(T* dst, const DualQuat<T>& a) { return write(write(dst, a.real), a.dual); }
+template<typename T> T* write(T* dst, const BBox2<T>& a) { return write(write(dst, a.min), a.max); }
+template<typename T> T* write(T* dst, const BBox3<T>& a) { return write(write(dst, a.min), a.max); }
+template<typename T> T* write(T* dst, const Plane<T>& a) { dst = write(dst, a.n); *dst++ = a.d; return dst; }
+template<typename T> T* write(T* dst, const Mat3<T>& a) { for (unsigned i = 0; i < 3; i++) dst = write(dst, a.cols[i]); return dst; }
+template<typename T> T* write(T* dst, const Mat3x4<T>& a) { for (unsigned i = 0; i < 4; i++) dst = write(dst, a.cols[i]); return dst; }
+template<typename T> T* write(T* dst, const Mat4<T>& a) { for (unsigned i = 0; i < 4; i++) dst = write(dst, a.cols[i]); return dst; }
+
 template<typename T>
-Vec2<T> max(const Vec2<T>& a, const Vec2<T>& b)
+constexpr Vec2<T> max(const Vec2<T>& a, const Vec2<T>& b)
 {
   return makeVec2<T>(a.x > b.x ? a.x : b.x,
                      a.y > b.y ? a.y : b.y);
 }
 
 template<typename T>
-Vec3<T> max(const Vec3<T>& a, const Vec3<T>& b)
+constexpr Vec3<T> max(const Vec3<T>& a, const Vec3<T>& b)
 {
   return makeVec3<T>(a.x > b.x ? a.x : b.x,
                      a.y > b.y ? a.y : b.y,
@@ -149,7 +208,7 @@ Vec3<T> max(const Vec3<T>& a, const Vec3<T>& b)
 }
 
 template<typename T>
-Vec4<T> max(const Vec4<T>& a, const Vec4<T>& b)
+constexpr Vec4<T> max(const Vec4<T>& a, const Vec4<T>& b)
 {
   return makeVec4<T>(a.x > b.x ? a.x : b.x,
                      a.y > b.y ? a.y : b.y,
@@ -157,82 +216,263 @@ Vec4<T> max(const Vec4<T>& a, const Vec4<T>& b)
                      a.w > b.w ? a.w : b.w);
 }
 
-inline Vec2f min(const Vec2f& a, const Vec2f& b)
+template<typename T>
+constexpr Vec2<T> min(const Vec2<T>& a, const Vec2<T>& b)
 {
-  return makeVec2f(a.x < b.x ? a.x : b.x,
-                   a.y < b.y ? a.y : b.y);
+  return makeVec2<T>(a.x < b.x ? a.x : b.x,
+                     a.y < b.y ? a.y : b.y);
 }
 
-inline Vec3f min(const Vec3f& a, const Vec3f& b)
+template<typename T>
+constexpr Vec3<T> min(const Vec3<T>& a, const Vec3<T>& b)
 {
-  return makeVec3f(a.x < b.x ? a.x : b.x,
-                   a.y < b.y ? a.y : b.y,
-                   a.z < b.z ? a.z : b.z);
+  return makeVec3<T>(a.x < b.x ? a.x : b.x,
+                     a.y < b.y ? a.y : b.y,
+                     a.z < b.z ? a.z : b.z);
 }
 
-inline Vec4f min(const Vec4f& a, const Vec4f& b)
+template<typename T>
+constexpr Vec4<T> min(const Vec4<T>& a, const Vec4<T>& b)
 {
-  return makeVec4f(a.x < b.x ? a.x : b.x,
-                   a.y < b.y ? a.y : b.y,
-                   a.z < b.z ? a.z : b.z,
-                   a.w < b.w ? a.w : b.w);
+  return makeVec4<T>(a.x < b.x ? a.x : b.x,
+                     a.y < b.y ? a.y : b.y,
+                     a.z < b.z ? a.z : b.z,
+                     a.w < b.w ? a.w : b.w);
 }
 
 Mat3f inverse(const Mat3f& M);
-
-Mat3f mul(const Mat3f& A, const Mat3f& B);
-
+Mat3d inverse(const Mat3d& M);
+
+/** Transpose of the inverse of M, e.g. to transform normals. Computed directly, without transposing. */
+Mat3f inverseTranspose(const Mat3f& M);
+Mat3d inverseTranspose(const Mat3d& M);
+
+template<typename T> constexpr T determinant(const Mat3<T>& M) { return dot(cross(column(M, 0), column(M, 1)), column(M, 2)); }
+
+/** Whether inverse(M) cannot be trusted, as the determinant is zero, denormal, infinite or NaN. */
+inline bool isSingular(float det) { float a = std::abs(det); return !(FLT_MIN <= a && a <= FLT_MAX); }
+inline bool isSingular(double det) { double a = std::abs(det); return !(DBL_MIN <= a && a <= DBL_MAX); }
+
+/** Singular value decomposition M = U diag(sigma) V^T, with rotations U and V.
+ *
+ * The singular values are ordered by decreasing magnitude. sigma.z is
+ * negative when M mirrors, so that U stays a rotation. V comes from Jacobi
+ * sweeps on M^T M and U from orthonormalizing M V, completed by cross
+ * products when M has rank 1 or 0, so U and V are orthonormal to about
+ * 1e-6. U diag(sigma) V^T reproduces M to about 1e-5 of sigma.x, but as
+ * M^T M squares them, singular values below about 3e-4 of sigma.x are
+ * only accurate to that much of sigma.x. */
+void svd(Mat3f& U, Vec3f& sigma, Mat3f& V, const Mat3f& M);
+
+/** Polar decomposition M = R S, with R orthogonal and S symmetric positive semidefinite.
+ *
+ * R is a rotation unless M mirrors. S holds the scale and shear of M in the
+ * frame of its principal axes. Computed from svd. */
+void polarDecomposition(Mat3f& R, Mat3f& S, const Mat3f& M);
+
+/** Largest factor M scales any vector by, its largest singular value.
+ *
+ * Computed in closed form from the characteristic polynomial of M^T M, in
+ * double so that it stays within 6e-8 relative, also when the two largest
+ * singular values are close. */
 float getScale(const Mat3f& M);
 
 inline float getScale(const Mat3x4f& M) { return getScale(makeMat3f(M.data)); }
 
-inline Vec3f mul(const Mat3f& A, const Vec3f& x)
+/** Inverse of the affine transform M. */
+Mat3x4f inverse(const Mat3x4f& M);
+
+Mat4f inverse(const Mat4f& M);
+
+/** Inverse of M where the last row is (0, 0, 0, 1). */
+Mat4f inverseAffine(const Mat4f& M);
+
+/** Inverse of M where the upper 3x3 is a rotation and the last row is (0, 0, 0, 1). */
+Mat4f inverseRigid(const Mat4f& M);
+
+Mat4f mul(const Mat4f& A, const Mat4f& B);
+
+Vec4f mul(const Mat4f& A, const Vec4f& x);
+
+constexpr Vec3f mul(const Mat3f& A, const Vec3f& x)
 {
-  Vec3f r;
-  for (unsigned k = 0; k < 3; k++) {
-    r.data[k] = A.data[k] * x.data[0] + A.data[3 + k] * x.data[1] + A.data[6 + k] * x.data[2];
-  }
-  return r;
+  LINALG_COUNT(MulMat3Vec3);
+  return makeVec3f(A.c0r0 * x.x + A.c1r0 * x.y + A.c2r0 * x.z,
+                   A.c0r1 * x.x + A.c1r1 * x.y + A.c2r1 * x.z,
+                   A.c0r2 * x.x + A.c1r2 * x.y + A.c2r2 * x.z);
 }
 
 
-inline Vec3f mul(const Mat3x4f& A, const Vec3f& x)
+constexpr Vec3f mul(const Mat3x4f& A, const Vec3f& x)
 {
-  Vec3f r;
-  for (unsigned k = 0; k < 3; k++) {
-    r.data[k] = A.data[k] * x.data[0] + A.data[3 + k] * x.data[1] + A.data[6 + k] * x.data[2] + A.data[9 + k];
-  }
-  return r;
+  LINALG_COUNT(MulMat3x4Vec3);
+  return makeVec3f(A.c0r0 * x.x + A.c1r0 * x.y + A.c2r0 * x.z + A.c3r0,
+                   A.c0r1 * x.x + A.c1r1 * x.y + A.c2r1 * x.z + A.c3r1,
+                   A.c0r2 * x.x + A.c1r2 * x.y + A.c2r2 * x.z + A.c3r2);
+}
+
+// The matrix products spell out mul(Mat3f, Vec3f) per column, so that they count as one call.
+constexpr Mat3f mul(const Mat3f& A, const Mat3f& B)
+{
+  LINALG_COUNT(MulMat3);
+  auto linear = [&A](const Vec3f& x) {
+    return makeVec3f(A.c0r0 * x.x + A.c1r0 * x.y + A.c2r0 * x.z,
+                     A.c0r1 * x.x + A.c1r1 * x.y + A.c2r1 * x.z,
+                     A.c0r2 * x.x + A.c1r2 * x.y + A.c2r2 * x.z);
+  };
+  return makeMat3f(linear(column(B, 0)), linear(column(B, 1)), linear(column(B, 2)));
 }
 
-template<typename T> BBox2<T> grow(const BBox2<T>& bbox, T margin)
+/** Composition of the affine transforms A and B, mul(mul(A, B), x) = mul(A, mul(B, x)) up to rounding. */
+constexpr Mat3x4f mul(const Mat3x4f& A, const Mat3x4f& B)
 {
-  return makeBBox(bbox.min - makeVec3f(margin),
-                  bbox.max + makeVec3f(margin));
+  LINALG_COUNT(MulMat3x4);
+  auto linear = [&A](const Vec3f& x) {
+    return makeVec3f(A.c0r0 * x.x + A.c1r0 * x.y + A.c2r0 * x.z,
+                     A.c0r1 * x.x + A.c1r1 * x.y + A.c2r1 * x.z,
+                     A.c0r2 * x.x + A.c1r2 * x.y + A.c2r2 * x.z);
+  };
+  return makeMat3x4f(linear(column(B, 0)), linear(column(B, 1)), linear(column(B, 2)), linear(column(B, 3)) + column(A, 3));
 }
-template<typename T> BBox3<T> grow(const BBox3<T>& bbox, T margin)
+
+/** Transform p by the projection P, including the division by w. */
+inline Vec3f project(const Mat4f& P, const Vec3f& p)
+{
+  Vec4f r = mul(P, makeVec4f(p.x, p.y, p.z, 1.f));
+  return (1.f / r.w) * makeVec3f(r);
+}
+
+template<typename T>
+constexpr Quat<T> mul(const Quat<T>& a, const Quat<T>& b)
 {
-  return makeBBox(bbox.min - makeVec3f(margin),
-                  bbox.max + makeVec3f(margin));
+  return makeQuat<T>(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                     a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                     a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                     a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
 }
 
-template<typename T> BBox2<T> engulf(const BBox2<T>& bbox, const Vec2<T>& p)
+template<typename T> constexpr Quat<T> conjugate(const Quat<T>& q) { return makeQuat<T>(-q.x, -q.y, -q.z, q.w); }
+
+template<typename T> constexpr T dot(const Quat<T>& a, const Quat<T>& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+template<typename T> Quat<T> normalize(const Quat<T>& q)
+{
+  LINALG_COUNT(Normalize);
+  T s = T(1) / std::sqrt(dot(q, q));
+  return makeQuat<T>(s * q.x, s * q.y, s * q.z, s * q.w);
+}
+
+/** Rotate v by the unit quaternion q. */
+template<typename T> constexpr Vec3<T> mul(const Quat<T>& q, const Vec3<T>& v)
+{
+  Vec3<T> u = makeVec3<T>(q.x, q.y, q.z);
+  Vec3<T> t = T(2) * cross(u, v);
+  return v + q.w * t + cross(u, t);
+}
+
+/** Normalized linear interpolation along the shortest arc. */
+template<typename T> Quat<T> nlerp(const Quat<T>& a, const Quat<T>& b, T t)
+{
+  T s = dot(a, b) < T(0) ? -t : t;
+  T r = T(1) - t;
+  return normalize(makeQuat<T>(r * a.x + s * b.x,
+                               r * a.y + s * b.y,
+                               r * a.z + s * b.z,
+                               r * a.w + s * b.w));
+}
+
+/** Spherical linear interpolation along the shortest arc. */
+Quatf slerp(const Quatf& a, const Quatf& b, float t);
+
+Mat3f makeMat3f(const Quatf& q);
+
+/** Quaternion of the rotation M. */
+Quatf makeQuatf(const Mat3f& M);
+
+DualQuatf makeDualQuatf(const Quatf& rotation, const Vec3f& translation);
+
+/** Dual quaternion of the rotation and translation M. */
+DualQuatf makeDualQuatf(const Mat3x4f& M);
+
+Mat3x4f makeMat3x4f(const DualQuatf& d);
+
+/** Transform p by the unit dual quaternion d. */
+constexpr Vec3f mul(const DualQuatf& d, const Vec3f& p)
+{
+  Vec3f r = makeVec3f(d.real.x, d.real.y, d.real.z);
+  Vec3f u = makeVec3f(d.dual.x, d.dual.y, d.dual.z);
+  Vec3f t = 2.f * (d.real.w * u - d.dual.w * r + cross(r, u));
+  return mul(d.real, p) + t;
+}
+
+/** Convert to half precision, rounds to nearest even. */
+Half makeHalf(float x);
+
+float makeFloat(Half h);
+
+inline Vec3h makeVec3h(const Vec3f& v) { Vec3h r; r.x = makeHalf(v.x); r.y = makeHalf(v.y); r.z = makeHalf(v.z); return r; }
+inline Vec3f makeVec3f(const Vec3h& v) { return makeVec3f(makeFloat(v.x), makeFloat(v.y), makeFloat(v.z)); }
+
+/** Quantize p to 16 bits per axis relative to frame, p is clamped to frame. */
+Vec3us quantize(const BBox3f& frame, const Vec3f& p);
+
+Vec3f dequantize(const BBox3f& frame, const Vec3us& q);
+
+/** Morton (Z-order) key of p relative to frame, p is clamped to frame.
+ *
+ * Each axis is split into 2^b cells, and the key interleaves the cell
+ * coordinates, x in the lowest bit. 32-bit keys use 10 bits per axis in 3D
+ * and 15 in 2D, 64-bit keys 21 and 31 bits. */
+uint32_t mortonKey(const BBox3f& frame, const Vec3f& p);
+uint32_t mortonKey(const BBox2f& frame, const Vec2f& p);
+uint64_t mortonKey64(const BBox3f& frame, const Vec3f& p);
+uint64_t mortonKey64(const BBox2f& frame, const Vec2f& p);
+
+/** Hilbert key of p relative to frame, cells as for mortonKey.
+ *
+ * Cells with consecutive keys share a face, which keeps more neighbors
+ * close in the order than Morton keys do, at some more cost. */
+uint32_t hilbertKey(const BBox3f& frame, const Vec3f& p);
+uint32_t hilbertKey(const BBox2f& frame, const Vec2f& p);
+uint64_t hilbertKey64(const BBox3f& frame, const Vec3f& p);
+uint64_t hilbertKey64(const BBox2f& frame, const Vec2f& p);
+
+/** Encode the unit vector n into 2x16 bits using an octahedral mapping.
+ *
+ * Vectors without a direction, where |n.x| + |n.y| + |n.z| is zero,
+ * denormal, infinite or NaN, encode as (0, 0), which decodes to +z. */
+Vec2s encodeOctahedral(const Vec3f& n);
+
+Vec3f decodeOctahedral(const Vec2s& e);
+
+template<typename T> constexpr BBox2<T> grow(const BBox2<T>& bbox, T margin)
+{
+  return makeBBox(bbox.min - makeVec2(margin, margin),
+                  bbox.max + makeVec2(margin, margin));
+}
+template<typename T> constexpr BBox3<T> grow(const BBox3<T>& bbox, T margin)
+{
+  return makeBBox(bbox.min - makeVec3(margin, margin, margin),
+                  bbox.max + makeVec3(margin, margin, margin));
+}
+
+template<typename T> constexpr BBox2<T> engulf(const BBox2<T>& bbox, const Vec2<T>& p)
 {
   return makeBBox(min(bbox.min, p),
                   max(bbox.max, p));
 }
-template<typename T> BBox3<T> engulf(const BBox3<T>& bbox, const Vec3<T>& p)
+template<typename T> constexpr BBox3<T> engulf(const BBox3<T>& bbox, const Vec3<T>& p)
 {
   return makeBBox(min(bbox.min, p),
                   max(bbox.max, p));
 }
 
-template<typename T> BBox2<T> engulf(const BBox2<T>& bbox, const BBox2<T>& other)
+template<typename T> constexpr BBox2<T> engulf(const BBox2<T>& bbox, const BBox2<T>& other)
 {
   return makeBBox(min(bbox.min, other.min),
                   max(bbox.max, other.max));
 }
-template<typename T> BBox3<T> engulf(const BBox3<T>& bbox, const BBox3<T>& other)
+template<typename T> constexpr BBox3<T> engulf(const BBox3<T>& bbox, const BBox3<T>& other)
 {
   return makeBBox(min(bbox.min, other.min),
                   max(bbox.max, other.max));
@@ -241,25 +481,43 @@ template<typename T> BBox3<T> engulf(const BBox3<T>& bbox, const BBox3<T>& other
 template<typename T> T diagonal(const BBox2<T>& b) { return distance(b.min, b.max); }
 template<typename T> T diagonal(const BBox3<T>& b) { return distance(b.min, b.max); }
 
-template<typename T> bool isEmpty(const BBox2<T>& b) { return b.max.x < b.min.x; }
-template<typename T> bool isEmpty(const BBox3<T>& b) { return b.max.x < b.min.x; }
+template<typename T> constexpr bool isEmpty(const BBox2<T>& b) { return b.max.x < b.min.x; }
+template<typename T> constexpr bool isEmpty(const BBox3<T>& b) { return b.max.x < b.min.x; }
 
-template<typename T> bool isNotEmpty(const BBox2<T>& b) { return b.min.x <= b.max.x; }
-template<typename T> bool isNotEmpty(const BBox3<T>& b) { return b.min.x <= b.max.x; }
+template<typename T> constexpr bool isNotEmpty(const BBox2<T>& b) { return b.min.x <= b.max.x; }
+template<typename T> constexpr bool isNotEmpty(const BBox3<T>& b) { return b.min.x <= b.max.x; }
 
-template<typename T> T maxSideLength(const BBox2<T>& b)
+template<typename T> constexpr T maxSideLength(const BBox2<T>& b)
 {
   Vec2<T> l = b.max - b.min;
   return l.x > l.y ? l.x : l.y;
 }
-template<typename T> T maxSideLength(const BBox3<T>& b)
+template<typename T> constexpr T maxSideLength(const BBox3<T>& b)
 {
   Vec3<T> l = b.max - b.min;
   T t = l.x > l.y ? l.x : l.y;
   return l.z > t ? l.z : t;
 }
 
-template<typename T> bool isStrictlyInside(const BBox2<T>& a, const BBox2<T>& b)
+template<typename T> constexpr T surfaceArea(const BBox3<T>& b)
+{
+  Vec3<T> l = b.max - b.min;
+  return T(2) * (l.x * l.y + l.y * l.z + l.z * l.x);
+}
+
+template<typename T> constexpr bool isInside(const BBox2<T>& a, const Vec2<T>& p)
+{
+  return a.min.x <= p.x && p.x <= a.max.x &&
+         a.min.y <= p.y && p.y <= a.max.y;
+}
+template<typename T> constexpr bool isInside(const BBox3<T>& a, const Vec3<T>& p)
+{
+  return a.min.x <= p.x && p.x <= a.max.x &&
+         a.min.y <= p.y && p.y <= a.max.y &&
+         a.min.z <= p.z && p.z <= a.max.z;
+}
+
+template<typename T> constexpr bool isStrictlyInside(const BBox2<T>& a, const BBox2<T>& b)
 {
   bool lx = a.min.x <= b.min.x;
   bool ly = a.min.y <= b.min.y;
@@ -267,7 +525,7 @@ template<typename T> bool isStrictlyInside(const BBox2<T>& a, const BBox2<T>& b)
   bool uy = b.max.y <= a.max.y;
   return lx && ly && ux && uy;
 }
-template<typename T> bool isStrictlyInside(const BBox3<T>& a, const BBox3<T>& b)
+template<typename T> constexpr bool isStrictlyInside(const BBox3<T>& a, const BBox3<T>& b)
 {
   bool lx = a.min.x <= b.min.x;
   bool ly = a.min.y <= b.min.y;
@@ -278,7 +536,7 @@ template<typename T> bool isStrictlyInside(const BBox3<T>& a, const BBox3<T>& b)
   return lx && ly && lz && ux && uy && uz;
 }
 
-template<typename T> bool isNotOverlapping(const BBox2<T>& a, const BBox2<T>& b)
+template<typename T> constexpr bool isNotOverlapping(const BBox2<T>& a, const BBox2<T>& b)
 {
   bool lx = b.max.x < a.min.x;
   bool ly = b.max.y < a.min.y;
@@ -286,7 +544,7 @@ template<typename T> bool isNotOverlapping(const BBox2<T>& a, const BBox2<T>& b)
   bool uy = a.max.y < b.min.y;
   return lx || ly || ux || uy;
 }
-template<typename T> bool isNotOverlapping(const BBox3<T>& a, const BBox3<T>& b)
+template<typename T> constexpr bool isNotOverlapping(const BBox3<T>& a, const BBox3<T>& b)
 {
   bool lx = b.max.x < a.min.x;
   bool ly = b.max.y < a.min.y;
@@ -297,7 +555,69 @@ template<typename T> bool isNotOverlapping(const BBox3<T>& a, const BBox3<T>& b)
   return lx || ly || lz || ux || uy || uz;
 }
 
-template<typename T> bool isOverlapping(const BBox2<T>& a, const BBox2<T>& b) { return !isNotOverlapping(a, b); }
-template<typename T> bool isOverlapping(const BBox3<T>& a, const BBox3<T>& b) { return !isNotOverlapping(a, b); }
+template<typename T> constexpr bool isOverlapping(const BBox2<T>& a, const BBox2<T>& b) { return !isNotOverlapping(a, b); }
+template<typename T> constexpr bool isOverlapping(const BBox3<T>& a, const BBox3<T>& b) { return !isNotOverlapping(a, b); }
+
+/** Slab test of ray against bbox in [tmin, tmax], on hit t is the entry distance.
+ *
+ * Rays parallel to an axis are handled via the infinite components of
+ * invDir, a ray in the plane of a face counts as hitting. Empty boxes are
+ * never hit. */
+template<typename T> constexpr bool intersect(T& t, const Ray3<T>& ray, const BBox3<T>& bbox, T tmin, T tmax)
+{
+  for (unsigned k = 0; k < 3; k++) {
+    bool negative = ray.invDir[k] < T(0);
+    T tnear = ((negative ? bbox.max[k] : bbox.min[k]) - ray.origin[k]) * ray.invDir[k];
+    T tfar = ((negative ? bbox.min[k] : bbox.max[k]) - ray.origin[k]) * ray.invDir[k];
+    tmin = tmin < tnear ? tnear : tmin;   // NaN from 0 * inf is ignored.
+    tmax = tfar < tmax ? tfar : tmax;
+  }
+  t = tmin;
+  return tmin <= tmax;
+}
+
+/** Signed distance from plane to p, scaled by the length of plane.n. */
+template<typename T> constexpr T distance(const Plane<T>& plane, const Vec3<T>& p) { return dot(plane.n, p) + plane.d; }
+
+template<typename T> Plane<T> normalize(const Plane<T>& plane)
+{
+  T s = T(1) / length(plane.n);
+  return makePlane(s * plane.n, s * plane.d);
+}
+
+/** Extract the frustum planes of a view-projection matrix.
+ *
+ * Clip space depth is [-w, w] by default (OpenGL), and [0, w] if
+ * depthZeroToOne is set (Direct3D, Vulkan). The planes are normalized. */
+Frustumf makeFrustumf(const Mat4f& viewProjection, bool depthZeroToOne = false);
+
+/** Classify bbox against frustum, empty boxes are outside.
+ *
+ * Tests the corner furthest along each plane normal (p-vertex) and the one
+ * furthest against it (n-vertex). Boxes outside the frustum but not fully
+ * outside any single plane are reported as intersecting. */
+template<typename T> constexpr Containment classify(const Frustum<T>& frustum, const BBox3<T>& bbox)
+{
+  Containment result = Containment::Inside;
+  for (const Plane<T>& plane : frustum.planes) {
+    Vec3<T> p{}, n{};
+    for (unsigned k = 0; k < 3; k++) {
+      bool positive = T(0) < plane.n[k];
+      p[k] = positive ? bbox.max[k] : bbox.min[k];
+      n[k] = positive ? bbox.min[k] : bbox.max[k];
+    }
+    if (distance(plane, p) < T(0)) return Containment::Outside;
+    if (distance(plane, n) < T(0)) result = Containment::Intersecting;
+  }
+  return result;
+}
+
+/** Relative rounding error transform of boxes widens its result by. */
+const float bboxTransformPadding = 4.f * FLT_EPSILON;
 
+/** Bounding box of a transformed bounding box, an empty box stays empty.
+ *
+ * Uses the center and extent of the box, rounded outward so that the result
+ * contains mul(M, p) for each corner p, and is a few ulps larger than the
+ * bounds of the eight transformed corners. */
 BBox3f transform(const Mat3x4f& M, const BBox3f& bbox);
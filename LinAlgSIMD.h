@@ -0,0 +1,34 @@
+#pragma once
+
+// Internal to the library sources, selects SIMD code paths. LinAlgOps.h
+// repeats the LINALG_SSE2 test for the inline rsqrt.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINALG_SSE2
+#include <emmintrin.h>
+#endif
+
+// Compilers that can build functions for instruction sets beyond the
+// command line options, used for runtime dispatch of the batched kernels.
+#if defined(LINALG_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define LINALG_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Build the functions defined between LINALG_TARGET_BEGIN and
+// LINALG_TARGET_END for the given instruction sets, e.g. "avx2,f16c".
+// Multiplies and adds are never contracted there, as AVX-512 implies FMA.
+// MSVC accepts any intrinsic without this.
+#define LINALG_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define LINALG_TARGET_BEGIN(isa) LINALG_PRAGMA(clang attribute push(__attribute__((target(isa))), apply_to = function)) \
+  LINALG_PRAGMA(float_control(push)) LINALG_PRAGMA(clang fp contract(off))
+#define LINALG_TARGET_END LINALG_PRAGMA(float_control(pop)) LINALG_PRAGMA(clang attribute pop)
+#elif defined(__GNUC__)
+#define LINALG_TARGET_BEGIN(isa) LINALG_PRAGMA(GCC push_options) LINALG_PRAGMA(GCC target(isa)) \
+  LINALG_PRAGMA(GCC optimize("fp-contract=off"))
+#define LINALG_TARGET_END LINALG_PRAGMA(GCC pop_options)
+#else
+#define LINALG_TARGET_BEGIN(isa)
+#define LINALG_TARGET_END
+#endif
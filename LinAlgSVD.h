@@ -0,0 +1,17 @@
+#pragma once
+#include <cfloat>
+
+// Internal to the library sources, constants shared by svd and getScale in
+// LinAlgOps.cpp and their batched kernels in LinAlgBatchKernels.h.
+
+/** Cyclic Jacobi sweeps of svd, enough to converge in float for any matrix. */
+const unsigned svdSweeps = 4;
+
+/** Squared ratio of the second to the largest singular value below which svd takes M V to have rank 1. */
+const float svdRankTolerance = (16.f * FLT_EPSILON) * (16.f * FLT_EPSILON);
+
+/** Coefficients of a polynomial in 2t - 1 within 6e-10 of cos(2/3 acos(t)) on [0, 1], used by getScale. */
+const double scaleAngleCoefficients[10] = {
+  0.76604444273159444, 0.24740906643480187, -0.015509169100049892, 0.0024663472272806962, -0.00050427800956462929,
+  0.00011646974924648389, -2.8499026488404416e-05, 7.4195273306543191e-06, -2.4961721635463619e-06, 6.9693874422682715e-07
+};
@@ -0,0 +1,221 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "LinAlgInstrument.h"
+#include "Parallel.h"
+
+namespace {
+
+  const unsigned spinCount = 64;    // Failed steal rounds before a worker sleeps.
+
+  struct Loop
+  {
+    void (*f)(void* context, size_t begin, size_t end);
+    void* context;
+    size_t grain;
+    std::atomic<size_t> remaining;  // Elements not yet done.
+#ifdef LINALG_INSTRUMENT
+    unsigned nesting;               // Of the calling thread, for the threads running its ranges.
+#endif
+  };
+
+  struct Task
+  {
+    Loop* loop;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Deque
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // Deque 0 is shared by all threads outside the pool, worker k owns deque k.
+  struct Pool
+  {
+    std::mutex configMutex;
+    std::atomic<bool> started{ false };
+    unsigned requested = 0;
+    unsigned count = 1;
+    std::unique_ptr<Deque[]> deques;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<unsigned> sleeping{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stop = false;
+
+    ~Pool() { shutdown(); }
+
+    void start();
+    void shutdown();
+  };
+
+  Pool pool;
+  thread_local unsigned self = 0;
+
+  void push(unsigned d, const Task& task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(pool.deques[d].mutex);
+      pool.deques[d].tasks.push_back(task);
+    }
+    pool.queued.fetch_add(1);
+    if (pool.sleeping.load()) {
+      std::lock_guard<std::mutex> lock(pool.sleepMutex);
+      pool.wake.notify_one();
+    }
+  }
+
+  bool pop(Task& task, unsigned d, bool back)
+  {
+    Deque& deque = pool.deques[d];
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    if (deque.tasks.empty()) return false;
+    if (back) {
+      task = deque.tasks.back();
+      deque.tasks.pop_back();
+    }
+    else {
+      task = deque.tasks.front();
+      deque.tasks.pop_front();
+    }
+    pool.queued.fetch_sub(1);
+    return true;
+  }
+
+  bool find(Task& task)
+  {
+    if (pop(task, self, true)) return true;
+    for (unsigned k = 1; k < pool.count; k++) {
+      if (pop(task, (self + k) % pool.count, false)) return true;
+    }
+    return false;
+  }
+
+  void run(Task task)
+  {
+    Loop* loop = task.loop;
+    while (2 * loop->grain <= task.end - task.begin) {
+      size_t mid = task.begin + ((task.end - task.begin) / loop->grain / 2) * loop->grain;
+      push(self, Task{ loop, mid, task.end });
+      task.end = mid;
+    }
+#ifdef LINALG_INSTRUMENT
+    unsigned nesting = getInstrumentNesting();
+    setInstrumentNesting(loop->nesting);
+    loop->f(loop->context, task.begin, task.end);
+    setInstrumentNesting(nesting);
+#else
+    loop->f(loop->context, task.begin, task.end);
+#endif
+    loop->remaining.fetch_sub(task.end - task.begin, std::memory_order_release);
+  }
+
+  void work(unsigned index)
+  {
+    self = index;
+    unsigned idle = 0;
+    while (true) {
+      Task task;
+      if (find(task)) {
+        run(task);
+        idle = 0;
+      }
+      else if (++idle < spinCount) {
+        std::this_thread::yield();
+      }
+      else {
+        // A pusher increments queued before reading sleeping, and we increment
+        // sleeping before reading queued, so one of us sees the other.
+        std::unique_lock<std::mutex> lock(pool.sleepMutex);
+        pool.sleeping.fetch_add(1);
+        pool.wake.wait(lock, []() { return pool.stop || pool.queued.load() != 0; });
+        pool.sleeping.fetch_sub(1);
+        if (pool.stop) return;
+        idle = 0;
+      }
+    }
+  }
+
+  void Pool::start()
+  {
+    std::lock_guard<std::mutex> lock(configMutex);
+    if (started.load()) return;
+
+    count = getThreadCount();
+    deques.reset(new Deque[count]);
+    stop = false;
+    for (unsigned k = 1; k < count; k++) {
+      workers.emplace_back(work, k);
+    }
+    started.store(true, std::memory_order_release);
+  }
+
+  void Pool::shutdown()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stop = true;
+      wake.notify_all();
+    }
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+    started.store(false);
+  }
+
+}
+
+
+void setThreadCount(unsigned threads)
+{
+  pool.shutdown();
+  std::lock_guard<std::mutex> lock(pool.configMutex);
+  pool.requested = threads;
+}
+
+unsigned getThreadCount()
+{
+  if (pool.started.load(std::memory_order_acquire)) return pool.count;
+  unsigned threads = pool.requested ? pool.requested : std::thread::hardware_concurrency();
+  return threads ? threads : 1;
+}
+
+void parallelFor(size_t N, size_t grain, unsigned threads, void (*f)(void* context, size_t begin, size_t end), void* context)
+{
+  if (N == 0) return;
+  if (grain == 0) grain = 1;
+  if (threads) {
+    size_t share = (N + threads - 1) / threads;
+    share = ((share + grain - 1) / grain) * grain;
+    if (grain < share) grain = share;
+  }
+  if (N < 2 * grain || getThreadCount() == 1) {
+    f(context, 0, N);
+    return;
+  }
+  if (!pool.started.load(std::memory_order_acquire)) pool.start();
+
+  Loop loop;
+  loop.f = f;
+  loop.context = context;
+  loop.grain = grain;
+  loop.remaining.store(N);
+#ifdef LINALG_INSTRUMENT
+  loop.nesting = getInstrumentNesting();
+#endif
+  run(Task{ &loop, 0, N });
+
+  // Help with any pending work, this loop's or others', until this loop is done.
+  while (loop.remaining.load(std::memory_order_acquire) != 0) {
+    Task task;
+    if (find(task)) run(task);
+    else std::this_thread::yield();
+  }
+}
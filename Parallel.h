@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Work-stealing thread pool for loops over large arrays.
+//
+// Each thread has a deque of pending ranges. A thread splits the range it
+// runs in halves down to the grain size, pushing the upper halves to the
+// back of its own deque and continuing with the lower half. It takes new
+// work from the back of its own deque, and idle threads steal from the front
+// of the others, where the largest ranges are. The calling thread works on
+// the loop until it is done, so loops may be nested.
+
+
+/** Set the number of threads used by parallelFor, including the calling thread.
+ *
+ * 0 uses all hardware threads, which is the default, and 1 runs all loops on
+ * the calling thread. Must not be called while a loop is running. */
+void setThreadCount(unsigned threads);
+
+/** Number of threads used by parallelFor, including the calling thread. */
+unsigned getThreadCount();
+
+/** Call f(context, begin, end) on disjoint ranges covering [0, N) and return when all are done.
+ *
+ * Range boundaries are multiples of grain, so that each range but the last
+ * holds a multiple of grain elements. threads > 0 limits the number of
+ * threads working on this loop by making the ranges larger. */
+void parallelFor(size_t N, size_t grain, unsigned threads, void (*f)(void* context, size_t begin, size_t end), void* context);
+
+/** parallelFor with f(begin, end). */
+template<typename F>
+void parallelFor(size_t N, size_t grain, unsigned threads, const F& f)
+{
+  parallelFor(N, grain, threads,
+              [](void* context, size_t begin, size_t end) { (*static_cast<const F*>(context))(begin, end); },
+              const_cast<F*>(&f));
+}
+
+/** Reduce [0, N) in parallel, with f(begin, end) reducing a range and combine(a, b) merging two results.
+ *
+ * The ranges are [k * grain, (k + 1) * grain), and their results are merged
+ * in order starting with init. The result is thus the same for any number of
+ * threads, even if combine is not associative, e.g. for floating-point sums. */
+template<typename T, typename F, typename C>
+T parallelReduce(size_t N, size_t grain, unsigned threads, const T& init, const F& f, const C& combine)
+{
+  if (grain == 0) grain = 1;
+  size_t chunks = (N + grain - 1) / grain;
+  if (chunks <= 1) return N ? combine(init, f(0, N)) : init;
+
+  std::vector<T> results(chunks);
+  parallelFor(chunks, 1, threads,
+              [&](size_t begin, size_t end)
+              {
+                for (size_t k = begin; k < end; k++) {
+                  results[k] = f(k * grain, k + 1 < chunks ? (k + 1) * grain : N);
+                }
+              });
+
+  T r = init;
+  for (const T& result : results) r = combine(r, result);
+  return r;
+}
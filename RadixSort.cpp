@@ -0,0 +1,110 @@
+#include <cstring>
+#include <utility>
+#include "RadixSort.h"
+
+namespace {
+
+  const size_t grain = 1 << 16;
+  const unsigned digitBits = 8;
+  const size_t digits = size_t(1) << digitBits;
+
+  std::vector<uint32_t>& keyBuffer(RadixSortScratch& scratch, uint32_t) { return scratch.keys32; }
+  std::vector<uint64_t>& keyBuffer(RadixSortScratch& scratch, uint64_t) { return scratch.keys64; }
+
+  // One pass from the keys and values in a to b, by the digit at shift.
+  // Returns false, without moving anything, if all keys have the same digit.
+  template<typename Key>
+  bool sortPass(RadixSortScratch& scratch, Key* bKeys, uint32_t* bValues, const Key* aKeys, const uint32_t* aValues, size_t N, unsigned shift, unsigned threads)
+  {
+    size_t chunks = (N + grain - 1) / grain;
+    scratch.histograms.assign(chunks * digits, 0);
+    parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t c = begin; c < end; c++) {
+                    uint32_t* h = scratch.histograms.data() + c * digits;
+                    size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                    for (size_t i = c * grain; i < last; i++) h[(aKeys[i] >> shift) & (digits - 1)]++;
+                  }
+                });
+
+    // Offsets of each digit within each chunk, digits in order and chunks in order within them.
+    uint32_t offset = 0;
+    for (size_t d = 0; d < digits; d++) {
+      uint32_t total = 0;
+      for (size_t c = 0; c < chunks; c++) total += scratch.histograms[c * digits + d];
+      if (total == N) return false;
+      for (size_t c = 0; c < chunks; c++) {
+        uint32_t count = scratch.histograms[c * digits + d];
+        scratch.histograms[c * digits + d] = offset;
+        offset += count;
+      }
+    }
+
+    parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t c = begin; c < end; c++) {
+                    uint32_t* h = scratch.histograms.data() + c * digits;
+                    size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                    for (size_t i = c * grain; i < last; i++) {
+                      Key key = aKeys[i];
+                      uint32_t j = h[(key >> shift) & (digits - 1)]++;
+                      bKeys[j] = key;
+                      if (bValues) bValues[j] = aValues[i];
+                    }
+                  }
+                });
+    return true;
+  }
+
+  template<typename Key>
+  void sortKeys(RadixSortScratch& scratch, Key* keys, uint32_t* values, size_t N, unsigned threads)
+  {
+    if (N < 2) return;
+    std::vector<Key>& tmpKeys = keyBuffer(scratch, Key());
+    tmpKeys.resize(N);
+    if (values) scratch.values.resize(N);
+
+    // Alternate between the input and the scratch arrays.
+    Key* aKeys = keys;
+    Key* bKeys = tmpKeys.data();
+    uint32_t* aValues = values;
+    uint32_t* bValues = values ? scratch.values.data() : nullptr;
+    for (unsigned shift = 0; shift < 8 * sizeof(Key); shift += digitBits) {
+      if (sortPass(scratch, bKeys, bValues, aKeys, aValues, N, shift, threads)) {
+        std::swap(aKeys, bKeys);
+        std::swap(aValues, bValues);
+      }
+    }
+    if (aKeys != keys) {
+      parallelFor(N, grain, threads, [&](size_t begin, size_t end)
+                  {
+                    std::memcpy(keys + begin, aKeys + begin, (end - begin) * sizeof(Key));
+                    if (values) std::memcpy(values + begin, aValues + begin, (end - begin) * sizeof(uint32_t));
+                  });
+    }
+  }
+
+}
+
+
+void radixSort(uint32_t* keys, uint32_t* values, size_t N, unsigned threads)
+{
+  RadixSortScratch scratch;
+  sortKeys(scratch, keys, values, N, threads);
+}
+
+void radixSort(uint64_t* keys, uint32_t* values, size_t N, unsigned threads)
+{
+  RadixSortScratch scratch;
+  sortKeys(scratch, keys, values, N, threads);
+}
+
+void radixSort(RadixSortScratch& scratch, uint32_t* keys, uint32_t* values, size_t N, unsigned threads)
+{
+  sortKeys(scratch, keys, values, N, threads);
+}
+
+void radixSort(RadixSortScratch& scratch, uint64_t* keys, uint32_t* values, size_t N, unsigned threads)
+{
+  sortKeys(scratch, keys, values, N, threads);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Parallel.h"
+
+// Parallel least significant digit radix sort of integer keys.
+//
+// Each pass sorts by 8 bits of the keys, with one histogram per chunk of
+// the input, so that the chunks scatter in parallel to disjoint ranges.
+// Passes are skipped when all keys share the digit, so keys of fewer bits,
+// e.g. 30-bit Morton keys or indices below 2^16, take fewer passes. The sort
+// is stable and the result does not depend on the number of threads.
+//
+// A typical use sorts Morton or Hilbert keys (LinAlgBatch.h) with the
+// indices 0 .. N - 1 as values, then reorders the items with gather.
+
+/** Scratch, kept so that repeated sorts do not allocate. */
+struct RadixSortScratch
+{
+  std::vector<uint32_t> keys32;
+  std::vector<uint64_t> keys64;
+  std::vector<uint32_t> values;
+  std::vector<uint32_t> histograms;
+};
+
+/** Sort N keys in ascending order, moving values[i] along with keys[i]. values may be null.
+ *
+ * threads as in LinAlgBatch.h. N must be less than 2^32. */
+void radixSort(uint32_t* keys, uint32_t* values, size_t N, unsigned threads = 0);
+void radixSort(uint64_t* keys, uint32_t* values, size_t N, unsigned threads = 0);
+void radixSort(RadixSortScratch& scratch, uint32_t* keys, uint32_t* values, size_t N, unsigned threads = 0);
+void radixSort(RadixSortScratch& scratch, uint64_t* keys, uint32_t* values, size_t N, unsigned threads = 0);
+
+/** Reorder N items, dst[i] = src[indices[i]]. dst must not overlap src. */
+template<typename T>
+void gather(T* dst, const T* src, const uint32_t* indices, size_t N, unsigned threads = 0)
+{
+  parallelFor(N, 1 << 16, threads, [&](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) dst[i] = src[indices[i]]; });
+}
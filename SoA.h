@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "LinAlg.h"
+
+// Structure-of-arrays containers and strided views.
+//
+// Vec3<T> and BBox3<T> arrays interleave their coordinates, which suits
+// interop and scalar code, while batch kernels want each coordinate in an
+// array of its own. Vec3SoA and BBox3SoA keep one array per coordinate, each
+// 64-byte aligned and zero padded to a multiple of 64 bytes, so that kernels
+// of any SIMD width can load whole registers. Vec3View describes points that
+// are already in memory, a Vec3<T> array or one attribute of an interleaved
+// vertex buffer, without copying.
+//
+// Elements read as Vec3<T> and BBox3<T> values, so scalar code works on all
+// of them. The batched conversions and kernels are in LinAlgBatch.h.
+
+/** Allocator for std::vector with storage aligned to Alignment bytes. */
+template<typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+  typedef T value_type;
+  template<typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+  AlignedAllocator() = default;
+  template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+  void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+  template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+  template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+/** Elements per array of a structure of arrays holding N elements, padded to 64 bytes. */
+template<typename T> size_t paddedSize(size_t N) { const size_t n = 64 / sizeof(T); return (N + n - 1) / n * n; }
+
+/** Vec3<T> values as separate x, y and z arrays.
+ *
+ * The arrays follow each other in data, pitch elements apart. */
+template<typename T>
+struct Vec3SoA
+{
+  std::vector<T, AlignedAllocator<T>> data;
+  size_t size = 0;
+  size_t pitch = 0;
+
+  T* array(unsigned k) { return data.data() + k * pitch; }
+  const T* array(unsigned k) const { return data.data() + k * pitch; }
+  T* x() { return array(0); }
+  T* y() { return array(1); }
+  T* z() { return array(2); }
+  const T* x() const { return array(0); }
+  const T* y() const { return array(1); }
+  const T* z() const { return array(2); }
+
+  Vec3<T> operator[](size_t i) const { const T* p = data.data() + i; return makeVec3(p[0], p[pitch], p[2 * pitch]); }
+  void set(size_t i, const Vec3<T>& v) { for (unsigned k = 0; k < 3; k++) data[k * pitch + i] = v[k]; }
+};
+typedef Vec3SoA<float>  Vec3SoAf;
+typedef Vec3SoA<double> Vec3SoAd;
+
+/** BBox3<T> values as six arrays, in the order of BBox3<T>::data: min x, y, z, then max x, y, z. */
+template<typename T>
+struct BBox3SoA
+{
+  std::vector<T, AlignedAllocator<T>> data;
+  size_t size = 0;
+  size_t pitch = 0;
+
+  T* array(unsigned k) { return data.data() + k * pitch; }
+  const T* array(unsigned k) const { return data.data() + k * pitch; }
+
+  BBox3<T> operator[](size_t i) const
+  {
+    const T* p = data.data() + i;
+    return makeBBox(makeVec3(p[0], p[pitch], p[2 * pitch]), makeVec3(p[3 * pitch], p[4 * pitch], p[5 * pitch]));
+  }
+  void set(size_t i, const BBox3<T>& b) { for (unsigned k = 0; k < 6; k++) data[k * pitch + i] = b.data[k]; }
+};
+typedef BBox3SoA<float>  BBox3SoAf;
+typedef BBox3SoA<double> BBox3SoAd;
+
+/** Resize a structure of arrays to N elements, existing values are kept and new ones are zero. */
+template<typename SoA>
+void resizeArrays(SoA& a, unsigned arrays, size_t N)
+{
+  typedef typename std::remove_reference<decltype(a.data[0])>::type T;
+  size_t pitch = paddedSize<T>(N);
+  size_t keep = a.size < N ? a.size : N;
+  if (pitch != a.pitch) {
+    decltype(a.data) data(arrays * pitch);
+    for (unsigned k = 0; k < arrays; k++) {
+      for (size_t i = 0; i < keep; i++) data[k * pitch + i] = a.data[k * a.pitch + i];
+    }
+    a.data.swap(data);
+    a.pitch = pitch;
+  }
+  else {
+    // Zero what is dropped, so that the padding stays zero.
+    for (unsigned k = 0; k < arrays; k++) {
+      for (size_t i = keep; i < a.size; i++) a.data[k * pitch + i] = T(0);
+    }
+  }
+  a.size = N;
+}
+
+template<typename T> void resize(Vec3SoA<T>& a, size_t N) { resizeArrays(a, 3, N); }
+template<typename T> void resize(BBox3SoA<T>& a, size_t N) { resizeArrays(a, 6, N); }
+
+template<typename T> T* addBytes(T* p, size_t n) { return reinterpret_cast<T*>(reinterpret_cast<char*>(p) + n); }
+template<typename T> const T* addBytes(const T* p, size_t n) { return reinterpret_cast<const T*>(reinterpret_cast<const char*>(p) + n); }
+
+/** N points in memory that is not owned, stride bytes apart. T is const for read-only views. */
+template<typename T>
+struct Vec3View
+{
+  typedef typename std::remove_const<T>::type Scalar;
+
+  T* data = nullptr;    // x of the first point, followed by y and z.
+  size_t stride = sizeof(Vec3<Scalar>);
+  size_t size = 0;
+
+  T* at(size_t i) const { return addBytes(data, i * stride); }
+  Vec3<Scalar> operator[](size_t i) const { return makeVec3<Scalar>(at(i)); }
+  void set(size_t i, const Vec3<Scalar>& v) const { T* p = at(i); p[0] = v.x; p[1] = v.y; p[2] = v.z; }
+
+  /** Read-only view of the same points. */
+  template<typename U, typename = typename std::enable_if<!std::is_const<T>::value && std::is_same<U, const T>::value>::type>
+  operator Vec3View<U>() const { Vec3View<U> v; v.data = data; v.stride = stride; v.size = size; return v; }
+};
+
+template<typename T> Vec3View<T> makeVec3View(T* p, size_t stride, size_t N) { Vec3View<T> v; v.data = p; v.stride = stride; v.size = N; return v; }
+template<typename T> Vec3View<T> makeVec3View(Vec3<T>* p, size_t N) { return makeVec3View(reinterpret_cast<T*>(p), sizeof(Vec3<T>), N); }
+template<typename T> Vec3View<const T> makeVec3View(const Vec3<T>* p, size_t N) { return makeVec3View(reinterpret_cast<const T*>(p), sizeof(Vec3<T>), N); }
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include "SweepAndPrune.h"
+#include "LinAlgOps.h"
+#include "LinAlgSIMD.h"
+
+namespace {
+
+  // Axis with largest variance of box centers, stays on current axis unless
+  // another axis is clearly better to avoid resorting back and forth.
+  unsigned chooseAxis(const BBox3f* bboxes, size_t N, unsigned current)
+  {
+    double s[3] = { 0.0, 0.0, 0.0 };
+    double s2[3] = { 0.0, 0.0, 0.0 };
+    size_t n = 0;
+    for (size_t i = 0; i < N; i++) {
+      if (isEmpty(bboxes[i])) continue;
+      for (unsigned k = 0; k < 3; k++) {
+        double c = 0.5 * (double(bboxes[i].min[k]) + double(bboxes[i].max[k]));
+        s[k] += c;
+        s2[k] += c * c;
+      }
+      n++;
+    }
+    if (n == 0) return current;
+
+    double var[3];
+    for (unsigned k = 0; k < 3; k++) {
+      var[k] = s2[k] - s[k] * s[k] / double(n);
+    }
+    unsigned best = var[0] < var[1] ? (var[1] < var[2] ? 2 : 1) : (var[0] < var[2] ? 2 : 0);
+    return 1.5 * var[current] < var[best] ? best : current;
+  }
+
+  void insertionSort(std::vector<uint32_t>& order, std::vector<float>& lo)
+  {
+    size_t N = order.size();
+    for (size_t i = 1; i < N; i++) {
+      float key = lo[i];
+      uint32_t ix = order[i];
+      size_t j = i;
+      for (; 0 < j && key < lo[j - 1]; j--) {
+        lo[j] = lo[j - 1];
+        order[j] = order[j - 1];
+      }
+      lo[j] = key;
+      order[j] = ix;
+    }
+  }
+
+  void emit(std::vector<Vec2u>& pairs, uint32_t a, uint32_t b)
+  {
+    pairs.push_back(a < b ? makeVec2u(a, b) : makeVec2u(b, a));
+  }
+
+}
+
+
+void update(std::vector<Vec2u>& pairs, SweepAndPrune& sap, const BBox3f* bboxes, size_t N)
+{
+  pairs.clear();
+
+  unsigned axis = chooseAxis(bboxes, N, sap.axis);
+  if (sap.order.size() != N || axis != sap.axis) {
+    sap.axis = axis;
+    sap.order.resize(N);
+    for (size_t i = 0; i < N; i++) sap.order[i] = uint32_t(i);
+    std::sort(sap.order.begin(), sap.order.end(),
+              [&](uint32_t i, uint32_t j) { return bboxes[i].min[axis] < bboxes[j].min[axis]; });
+  }
+
+  sap.lo.resize(N);
+  for (size_t i = 0; i < N; i++) {
+    sap.lo[i] = bboxes[sap.order[i]].min[axis];
+  }
+  insertionSort(sap.order, sap.lo);
+
+  unsigned a1 = (axis + 1) % 3;
+  unsigned a2 = (axis + 2) % 3;
+  sap.hi.resize(N);
+  for (auto& o : sap.other) o.resize(N);
+  for (size_t i = 0; i < N; i++) {
+    const BBox3f& b = bboxes[sap.order[i]];
+    sap.hi[i] = b.max[axis];
+    sap.other[0][i] = b.min[a1];
+    sap.other[1][i] = b.max[a1];
+    sap.other[2][i] = b.min[a2];
+    sap.other[3][i] = b.max[a2];
+  }
+
+  const float* lo = sap.lo.data();
+  const float* hi = sap.hi.data();
+  const float* min1 = sap.other[0].data();
+  const float* max1 = sap.other[1].data();
+  const float* min2 = sap.other[2].data();
+  const float* max2 = sap.other[3].data();
+  for (size_t i = 0; i < N; i++) {
+    size_t j = i + 1;
+#ifdef LINALG_SSE2
+    // Test four candidates at a time on the remaining axes.
+    __m128 lo_i = _mm_set1_ps(lo[i]);
+    __m128 hi_i = _mm_set1_ps(hi[i]);
+    __m128 min1_i = _mm_set1_ps(min1[i]);
+    __m128 max1_i = _mm_set1_ps(max1[i]);
+    __m128 min2_i = _mm_set1_ps(min2[i]);
+    __m128 max2_i = _mm_set1_ps(max2[i]);
+    for (; j + 4 <= N; j += 4) {
+      __m128 lo_j = _mm_loadu_ps(lo + j);
+      __m128 in = _mm_cmple_ps(lo_j, hi_i);
+      int inMask = _mm_movemask_ps(in);
+      if (inMask == 0) break;
+
+      __m128 sep = _mm_cmplt_ps(_mm_loadu_ps(hi + j), lo_i);
+      sep = _mm_or_ps(sep, _mm_cmplt_ps(_mm_loadu_ps(max1 + j), min1_i));
+      sep = _mm_or_ps(sep, _mm_cmplt_ps(max1_i, _mm_loadu_ps(min1 + j)));
+      sep = _mm_or_ps(sep, _mm_cmplt_ps(_mm_loadu_ps(max2 + j), min2_i));
+      sep = _mm_or_ps(sep, _mm_cmplt_ps(max2_i, _mm_loadu_ps(min2 + j)));
+      int mask = _mm_movemask_ps(_mm_andnot_ps(sep, in));
+      for (unsigned k = 0; k < 4; k++) {
+        if (mask & (1 << k)) emit(pairs, sap.order[i], sap.order[j + k]);
+      }
+      if (inMask != 0xf) {
+        j = N;  // Sorted by lo, the remaining candidates are past hi_i.
+        break;
+      }
+    }
+#endif
+    for (; j < N && lo[j] <= hi[i]; j++) {
+      bool sep = hi[j] < lo[i] ||
+                 max1[j] < min1[i] || max1[i] < min1[j] ||
+                 max2[j] < min2[i] || max2[i] < min2[j];
+      if (!sep) emit(pairs, sap.order[i], sap.order[j]);
+    }
+  }
+}
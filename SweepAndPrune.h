@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+
+/** Incremental sweep-and-prune broad phase.
+ *
+ * Keeps the boxes sorted along one axis between updates. With coherent
+ * motion the order is nearly sorted, and insertion sort brings it back in
+ * close to linear time. */
+struct SweepAndPrune
+{
+  std::vector<uint32_t> order;      // Box indices sorted by min along axis.
+  std::vector<float> lo;            // Sorted min along axis.
+  std::vector<float> hi;            // Max along axis, in sorted order.
+  std::vector<float> other[4];      // Min and max along the two other axes, in sorted order.
+  unsigned axis = 0;
+};
+
+/** Find all overlapping pairs among bboxes, writes pairs (i, j) with i < j to pairs.
+ *
+ * Pairs are the same as testing all pairs with isOverlapping, but not in any
+ * particular order. N may change between calls, which triggers a full sort. */
+void update(std::vector<Vec2u>& pairs, SweepAndPrune& sap, const BBox3f* bboxes, size_t N);
@@ -0,0 +1,158 @@
+#include "TileBins.h"
+#include "LinAlgSIMD.h"
+#include "Parallel.h"
+
+namespace {
+
+  const size_t minGrain = 1 << 12;     // Boxes per chunk of the count and scatter passes, at least.
+  const size_t tileGrain = 1 << 12;
+
+  // Tile coordinates of the box corners, clamped to [lower, upper] per
+  // component. NaN goes to lower. The bounds are integers, so clamping before
+  // the floor gives the same result as after.
+  inline Vec4i tileRange(const BBox2f& bbox, const float* origin, const float* invTileSize, const float* lower, const float* upper)
+  {
+    Vec4i r;
+#ifdef LINALG_SSE2
+    __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bbox.data), _mm_loadu_ps(origin)), _mm_loadu_ps(invTileSize));
+    t = _mm_min_ps(_mm_max_ps(t, _mm_loadu_ps(lower)), _mm_loadu_ps(upper));
+    __m128i i = _mm_cvttps_epi32(t);
+    i = _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(t, _mm_cvtepi32_ps(i))));   // Round down negative values.
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(r.data), i);
+#else
+    for (unsigned k = 0; k < 4; k++) {
+      float t = (bbox.data[k] - origin[k]) * invTileSize[k];
+      t = t > lower[k] ? t : lower[k];
+      t = t < upper[k] ? t : upper[k];
+      int i = int(t);
+      r.data[k] = i - int(t < float(i));
+    }
+#endif
+    return r;
+  }
+
+  struct RangeParameters
+  {
+    float origin[4];
+    float invTileSize[4];
+    float lower[4];
+    float upper[4];
+  };
+
+  // The min corner is clamped to [0, columns], the max corner to [-1, columns - 1], so
+  // boxes beyond the grid get an empty range.
+  RangeParameters makeRangeParameters(const TileBins& bins)
+  {
+    RangeParameters p;
+    for (unsigned k = 0; k < 4; k++) {
+      unsigned axis = k & 1;
+      float count = float(axis ? bins.rows : bins.columns);
+      p.origin[k] = bins.origin[axis];
+      p.invTileSize[k] = bins.invTileSize[axis];
+      p.lower[k] = k < 2 ? 0.f : -1.f;
+      p.upper[k] = k < 2 ? count : count - 1.f;
+    }
+    return p;
+  }
+
+  inline bool isNotEmpty(const Vec4i& r) { return r.x <= r.z && r.y <= r.w; }
+
+}
+
+
+void build(TileBins& bins, const BBox2f* bboxes, size_t N, const Vec2f& origin, const Vec2f& tileSize, uint32_t columns, uint32_t rows, unsigned threads)
+{
+  bins.origin = origin;
+  bins.tileSize = tileSize;
+  bins.invTileSize = makeVec2f(1.f / tileSize.x, 1.f / tileSize.y);
+  bins.columns = columns;
+  bins.rows = rows;
+  size_t T = size_t(columns) * rows;
+  bins.tileStart.assign(T + 1, 0);
+  bins.ranges.resize(N);
+
+  // Each chunk has its own counts for all tiles, so there are only a few
+  // chunks per thread. The items are in chunk order within each tile, so the
+  // result is the same for any number of chunks.
+  size_t maxChunks = 4 * size_t(threads ? threads : getThreadCount());
+  size_t chunks = (N + minGrain - 1) / minGrain;
+  chunks = chunks < maxChunks ? chunks : maxChunks;
+  size_t grain = chunks ? (N + chunks - 1) / chunks : 0;
+
+  // The counts of a chunk start as a 2D difference array, with a row and a
+  // column more than the grid, so each box adds to four corners instead of
+  // all its tiles. Running sums along the rows, then the columns, give the
+  // counts. Unsigned wraparound cancels out in the sums.
+  size_t pitch = size_t(columns) + 1;
+  size_t H = pitch * (size_t(rows) + 1);
+  bins.histograms.assign(chunks * H, 0);
+
+  RangeParameters p = makeRangeParameters(bins);
+  parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+              {
+                for (size_t c = begin; c < end; c++) {
+                  uint32_t* h = bins.histograms.data() + c * H;
+                  size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                  for (size_t i = c * grain; i < last; i++) {
+                    Vec4i r = tileRange(bboxes[i], p.origin, p.invTileSize, p.lower, p.upper);
+                    bins.ranges[i] = r;
+                    if (!isNotEmpty(r)) continue;
+                    size_t y0 = size_t(r.y) * pitch, y1 = size_t(r.w + 1) * pitch;
+                    h[y0 + r.x]++;
+                    h[y0 + r.z + 1]--;
+                    h[y1 + r.x]--;
+                    h[y1 + r.z + 1]++;
+                  }
+                  for (size_t y = 0; y < rows; y++) {
+                    for (size_t x = 1; x < columns; x++) h[y * pitch + x] += h[y * pitch + x - 1];
+                  }
+                  for (size_t y = 1; y < rows; y++) {
+                    for (size_t x = 0; x < columns; x++) h[y * pitch + x] += h[(y - 1) * pitch + x];
+                  }
+                }
+              });
+
+  // Per tile, the offset of each chunk within the tile and the tile's count,
+  // then the start of each tile and the position of each chunk in items.
+  uint32_t* start = bins.tileStart.data();
+  parallelFor(T, tileGrain, threads, [&](size_t begin, size_t end)
+              {
+                for (size_t t = begin; t < end; t++) {
+                  size_t j = t / columns * pitch + t % columns;
+                  uint32_t offset = 0;
+                  for (size_t c = 0; c < chunks; c++) {
+                    uint32_t count = bins.histograms[c * H + j];
+                    bins.histograms[c * H + j] = offset;
+                    offset += count;
+                  }
+                  start[t + 1] = offset;
+                }
+              });
+  for (size_t t = 0; t < T; t++) start[t + 1] += start[t];
+  bins.items.resize(start[T]);
+
+  parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+              {
+                for (size_t c = begin; c < end; c++) {
+                  uint32_t* h = bins.histograms.data() + c * H;
+                  for (size_t y = 0; y < rows; y++) {
+                    for (size_t x = 0; x < columns; x++) h[y * pitch + x] += start[y * columns + x];
+                  }
+                  size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                  for (size_t i = c * grain; i < last; i++) {
+                    Vec4i r = bins.ranges[i];
+                    if (!isNotEmpty(r)) continue;
+                    for (int y = r.y; y <= r.w; y++) {
+                      uint32_t* row = h + size_t(y) * pitch;
+                      for (int x = r.x; x <= r.z; x++) bins.items[row[x]++] = uint32_t(i);
+                    }
+                  }
+                }
+              });
+}
+
+Vec4i getTileRange(const TileBins& bins, const BBox2f& bbox)
+{
+  RangeParameters p = makeRangeParameters(bins);
+  return tileRange(bbox, p.origin, p.invTileSize, p.lower, p.upper);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+
+/** 2D boxes binned into a grid of screen tiles.
+ *
+ * The grid has columns x rows tiles of tileSize, tile (0, 0) has its min
+ * corner at origin and tile (x, y) is number y * columns + x. A box goes into
+ * the tiles from floor((min - origin) / tileSize) to floor((max - origin) /
+ * tileSize) on each axis, clipped to the grid and computed with the
+ * reciprocal of tileSize. A box touching the edge between two tiles goes
+ * into both, as for isOverlapping. Empty boxes go nowhere.
+ *
+ * Binning counts the tiles of the boxes in parallel, takes the prefix sum of
+ * the counts and then writes the indices of each tile into one array, so a
+ * rebuild allocates nothing once the arrays have grown. */
+struct TileBins
+{
+  Vec2f origin = makeVec2f(0.f);
+  Vec2f tileSize = makeVec2f(1.f);
+  Vec2f invTileSize = makeVec2f(1.f);
+  uint32_t columns = 0;
+  uint32_t rows = 0;
+  std::vector<uint32_t> tileStart;    // Tile t holds items[tileStart[t] .. tileStart[t + 1]).
+  std::vector<uint32_t> items;        // Box indices by tile, ascending within each tile.
+
+  // Scratch, kept so that rebuilds do not allocate.
+  std::vector<Vec4i> ranges;
+  std::vector<uint32_t> histograms;
+};
+
+/** Bin N boxes into columns x rows tiles of tileSize starting at origin. threads as in LinAlgBatch.h.
+ *
+ * The number of tiles and the total number of box and tile pairs must be less than 2^32. */
+void build(TileBins& bins, const BBox2f* bboxes, size_t N, const Vec2f& origin, const Vec2f& tileSize, uint32_t columns, uint32_t rows, unsigned threads = 0);
+
+/** Tiles of bbox as min x, min y, max x and max y, max is less than min on some axis if there are none. */
+Vec4i getTileRange(const TileBins& bins, const BBox2f& bbox);
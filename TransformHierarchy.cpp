@@ -0,0 +1,171 @@
+#include "TransformHierarchy.h"
+#include "LinAlgBatch.h"
+#include "LinAlgOps.h"
+#include "Parallel.h"
+
+namespace {
+
+  const size_t grain = 1 << 10;
+  const size_t block = 64;          // Nodes per call to the batched box transform.
+  const size_t denseFraction = 8;   // Sweep all levels when more than 1/8 of the nodes may change.
+
+  void mark(TransformHierarchy& h, uint32_t i)
+  {
+    if (h.marked[i]) return;
+    h.marked[i] = 1;
+    h.changed.push_back(i);
+  }
+
+  // Recompute the nodes of one level, or those with flags set if flags is
+  // not null. Their parents are up to date.
+  void updateLevel(TransformHierarchy& h, const uint32_t* nodes, size_t N, const uint8_t* flags, unsigned threads)
+  {
+    parallelFor(N, grain, threads, [&](size_t begin, size_t end)
+                {
+                  uint32_t ix[block];
+                  Mat3x4f M[block];
+                  BBox3f b[block];
+                  size_t i = begin;
+                  while (i < end) {
+                    size_t n = 0;
+                    for (; i < end && n < block; i++) {
+                      if (flags && !flags[nodes[i]]) continue;
+                      uint32_t k = nodes[i];
+                      uint32_t parent = h.parents[k];
+                      M[n] = parent == noParent ? h.local[k] : mul(h.world[parent], h.local[k]);
+                      b[n] = h.localBounds[k];
+                      h.world[k] = M[n];
+                      ix[n++] = k;
+                    }
+                    transform(b, M, b, n, 1);
+                    for (size_t j = 0; j < n; j++) h.worldBounds[ix[j]] = b[j];
+                  }
+                });
+  }
+
+  // Flag all descendants of the changed nodes in one pass over the nodes
+  // and sweep each level in index order.
+  size_t updateDense(TransformHierarchy& h, uint32_t first, unsigned threads)
+  {
+    size_t N = h.parents.size();
+    size_t count = 0;
+    for (size_t i = 0; i < N; i++) {
+      uint32_t parent = h.parents[i];
+      if (parent != noParent && h.marked[parent]) h.marked[i] = 1;
+      count += h.marked[i];
+    }
+    for (size_t d = first; d + 1 < h.levelStart.size(); d++) {
+      updateLevel(h, h.order.data() + h.levelStart[d], h.levelStart[d + 1] - h.levelStart[d], h.marked.data(), threads);
+    }
+    h.marked.assign(N, 0);
+    return count;
+  }
+
+  // Recompute the changed nodes level by level, adding the children of each
+  // level to the next.
+  size_t updateSparse(TransformHierarchy& h, uint32_t first, unsigned threads)
+  {
+    for (uint32_t i : h.changed) h.levels[h.depths[i]].push_back(i);
+
+    // A node is marked when it enters a level, so that a changed node below
+    // another changed node is only recomputed once.
+    size_t count = 0;
+    for (size_t d = first; d < h.levels.size(); d++) {
+      std::vector<uint32_t>& level = h.levels[d];
+      if (level.empty()) continue;
+      updateLevel(h, level.data(), level.size(), nullptr, threads);
+      count += level.size();
+
+      for (uint32_t i : level) {
+        h.marked[i] = 0;
+        if (d + 1 == h.levels.size()) continue;
+        for (uint32_t k = h.childStart[i]; k < h.childStart[i + 1]; k++) {
+          uint32_t c = h.children[k];
+          if (h.marked[c]) continue;
+          h.marked[c] = 1;
+          h.levels[d + 1].push_back(c);
+        }
+      }
+      level.clear();
+    }
+    return count;
+  }
+
+}
+
+
+void build(TransformHierarchy& h, const uint32_t* parents, const Mat3x4f* local, const BBox3f* localBounds, size_t N, unsigned threads)
+{
+  h.parents.assign(parents, parents + N);
+  h.local.assign(local, local + N);
+  if (localBounds) h.localBounds.assign(localBounds, localBounds + N);
+  else h.localBounds.assign(N, makeEmptyBBox3f());
+  h.world.resize(N);
+  h.worldBounds.resize(N);
+
+  uint32_t maxDepth = 0;
+  h.depths.resize(N);
+  h.childStart.assign(N + 1, 0);
+  for (size_t i = 0; i < N; i++) {
+    uint32_t parent = parents[i];
+    h.depths[i] = parent == noParent ? 0 : h.depths[parent] + 1;
+    if (maxDepth < h.depths[i]) maxDepth = h.depths[i];
+    if (parent != noParent) h.childStart[parent + 1]++;
+  }
+  for (size_t i = 0; i < N; i++) h.childStart[i + 1] += h.childStart[i];
+  h.children.resize(h.childStart[N]);
+  std::vector<uint32_t> fill(h.childStart.begin(), h.childStart.end() - 1);
+  for (size_t i = 0; i < N; i++) {
+    if (parents[i] != noParent) h.children[fill[parents[i]]++] = uint32_t(i);
+  }
+
+  h.subtreeSizes.assign(N, 1);
+  for (size_t i = N; i-- > 0;) {
+    if (parents[i] != noParent) h.subtreeSizes[parents[i]] += h.subtreeSizes[i];
+  }
+
+  // Counting sort by depth, stable so that each level is in index order.
+  h.levelStart.assign(maxDepth + 2, 0);
+  for (size_t i = 0; i < N; i++) h.levelStart[h.depths[i] + 1]++;
+  for (size_t d = 0; d <= maxDepth; d++) h.levelStart[d + 1] += h.levelStart[d];
+  h.order.resize(N);
+  fill.assign(h.levelStart.begin(), h.levelStart.end() - 1);
+  for (size_t i = 0; i < N; i++) h.order[fill[h.depths[i]]++] = uint32_t(i);
+
+  h.levels.resize(maxDepth + 1);
+  for (auto& level : h.levels) level.clear();
+  h.changed.clear();
+  h.marked.assign(N, 0);
+  for (size_t i = 0; i < N; i++) {
+    if (parents[i] == noParent) mark(h, uint32_t(i));
+  }
+  update(h, threads);
+}
+
+void setLocal(TransformHierarchy& h, uint32_t i, const Mat3x4f& M)
+{
+  h.local[i] = M;
+  mark(h, i);
+}
+
+void setLocalBounds(TransformHierarchy& h, uint32_t i, const BBox3f& bbox)
+{
+  h.localBounds[i] = bbox;
+  mark(h, i);
+}
+
+size_t update(TransformHierarchy& h, unsigned threads)
+{
+  if (h.changed.empty()) return 0;
+
+  // Upper bound of the nodes to recompute, as changed subtrees may overlap.
+  uint32_t first = ~0u;
+  size_t work = 0;
+  for (uint32_t i : h.changed) {
+    if (h.depths[i] < first) first = h.depths[i];
+    work += h.subtreeSizes[i];
+  }
+  size_t count = denseFraction * work < h.parents.size() ? updateSparse(h, first, threads) : updateDense(h, first, threads);
+  h.changed.clear();
+  return count;
+}
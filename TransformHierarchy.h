@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+
+/** Parent index of root nodes. */
+const uint32_t noParent = ~0u;
+
+/** Hierarchy of affine transforms with incremental updates.
+ *
+ * Nodes are stored in a flat array where each parent comes before its
+ * children. World transforms and bounds are only recomputed for nodes whose
+ * local transform or bounds changed since the last update, and for their
+ * descendants. The changed nodes are processed one depth level at a time,
+ * each level as one parallel batch. When the changed subtrees cover a large
+ * part of the hierarchy, the levels are instead swept in index order. */
+struct TransformHierarchy
+{
+  std::vector<uint32_t> parents;      // parents[i] < i, or noParent.
+  std::vector<Mat3x4f> local;         // Relative to the parent.
+  std::vector<BBox3f> localBounds;    // In the space of the node, may be empty.
+  std::vector<Mat3x4f> world;
+  std::vector<BBox3f> worldBounds;
+
+  std::vector<uint32_t> depths;
+  std::vector<uint32_t> subtreeSizes;
+  std::vector<uint32_t> childStart;   // Children of i are children[childStart[i] .. childStart[i + 1]).
+  std::vector<uint32_t> children;
+  std::vector<uint32_t> order;        // Nodes sorted by depth, then index.
+  std::vector<uint32_t> levelStart;   // Level d is order[levelStart[d] .. levelStart[d + 1]).
+  std::vector<uint32_t> changed;      // Nodes changed since the last update.
+  std::vector<uint8_t> marked;        // Node is in changed or in a level being updated.
+  std::vector<std::vector<uint32_t>> levels;
+};
+
+/** Set up a hierarchy of N nodes and compute all world transforms and bounds.
+ *
+ * parents[i] must be less than i, or noParent for roots. localBounds may be
+ * null, which gives empty bounds. threads as in LinAlgBatch.h. */
+void build(TransformHierarchy& h, const uint32_t* parents, const Mat3x4f* local, const BBox3f* localBounds, size_t N, unsigned threads = 0);
+
+/** Set the local transform of node i, the next update recomputes i and its descendants. */
+void setLocal(TransformHierarchy& h, uint32_t i, const Mat3x4f& M);
+
+/** Set the bounds of node i in its own space, the next update recomputes i and its descendants. */
+void setLocalBounds(TransformHierarchy& h, uint32_t i, const BBox3f& bbox);
+
+/** Recompute world transforms and bounds of the changed nodes and their descendants.
+ *
+ * world[i] = mul(world[parents[i]], local[i]), or local[i] for roots, and
+ * worldBounds[i] = transform(world[i], localBounds[i]). Returns the number
+ * of nodes recomputed. */
+size_t update(TransformHierarchy& h, unsigned threads = 0);
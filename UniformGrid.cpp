@@ -0,0 +1,243 @@
+#include "UniformGrid.h"
+#include "LinAlgOps.h"
+#include "Parallel.h"
+
+namespace {
+
+  const size_t grain = 1 << 16;
+  const unsigned partitionBits = 8;     // The sort first splits the buckets into up to 256 ranges.
+
+  // Floor of x as an int, without branches as the signs are random.
+  inline int cellCoord(float x)
+  {
+    const float limit = float(1 << 30);
+    float c = x > -limit ? x : -limit;    // NaN goes to -limit.
+    c = c < limit ? c : limit;
+    int i = int(c);
+    return i - int(c < float(i));
+  }
+
+  inline Vec3i cellOf(float invCellSize, const Vec3f& p)
+  {
+    return makeVec3i(cellCoord(invCellSize * p.x),
+                     cellCoord(invCellSize * p.y),
+                     cellCoord(invCellSize * p.z));
+  }
+
+  uint32_t hash(const Vec3i& c)
+  {
+    return (uint32_t(c.x) * 73856093u) ^ (uint32_t(c.y) * 19349663u) ^ (uint32_t(c.z) * 83492791u);
+  }
+
+  Vec3f center(const BBox3f& b) { return 0.5f * (b.min + b.max); }
+
+  const Vec3f& position(const Vec3f& p) { return p; }
+  Vec3f position(const BBox3f& b) { return center(b); }
+
+  std::vector<Vec3f>& partitionedItems(UniformGrid& grid, const Vec3f*) { return grid.partitionedPoints; }
+  std::vector<BBox3f>& partitionedItems(UniformGrid& grid, const BBox3f*) { return grid.partitionedBBoxes; }
+
+  // Counting sort of the items by bucket into grid.items and sorted.
+  //
+  // The items are first split by the top partitionBits of their bucket,
+  // with one histogram per chunk of grain items, and then each range of
+  // buckets is sorted on its own. Both passes are stable, so the result is
+  // the same for any number of threads. The first pass also moves the items,
+  // so that the second reads them in order instead of gathering them.
+  // All scratch arrays are kept in the grid.
+  template<typename T>
+  void sortItems(UniformGrid& grid, std::vector<T>& sorted, const T* input, size_t N, float cellSize, unsigned threads)
+  {
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < N) bits++;
+    unsigned pBits = bits < partitionBits ? bits : partitionBits;
+    unsigned shift = bits - pBits;
+    size_t P = size_t(1) << pBits;
+    size_t B = size_t(1) << bits;
+
+    grid.cellSize = cellSize;
+    grid.invCellSize = 1.f / cellSize;
+    grid.bucketMask = uint32_t(B - 1);
+    grid.bucketStart.resize(B + 1);
+    grid.items.resize(N);
+    grid.keys.resize(N);
+    grid.partitioned.resize(N);
+    grid.partitionedKeys.resize(N);
+    grid.partitionStart.resize(P + 1);
+    std::vector<T>& partitioned = partitionedItems(grid, input);
+    partitioned.resize(N);
+    sorted.resize(N);
+
+    size_t chunks = (N + grain - 1) / grain;
+    grid.histograms.assign(chunks * P, 0);
+    parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t c = begin; c < end; c++) {
+                    uint32_t* h = grid.histograms.data() + c * P;
+                    uint32_t* keys = grid.keys.data();
+                    float invCellSize = grid.invCellSize;
+                    uint32_t mask = grid.bucketMask;
+                    size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                    for (size_t i = c * grain; i < last; i++) {
+                      uint32_t key = hash(cellOf(invCellSize, position(input[i]))) & mask;
+                      keys[i] = key;
+                      h[key >> shift]++;
+                    }
+                  }
+                });
+
+    // Offsets of each partition within each chunk, partitions in order and chunks in order within them.
+    uint32_t* partitionStart = grid.partitionStart.data();
+    uint32_t offset = 0;
+    for (size_t p = 0; p < P; p++) {
+      partitionStart[p] = offset;
+      for (size_t c = 0; c < chunks; c++) {
+        uint32_t count = grid.histograms[c * P + p];
+        grid.histograms[c * P + p] = offset;
+        offset += count;
+      }
+    }
+    partitionStart[P] = offset;
+
+    parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t c = begin; c < end; c++) {
+                    uint32_t* h = grid.histograms.data() + c * P;
+                    size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                    for (size_t i = c * grain; i < last; i++) {
+                      uint32_t key = grid.keys[i];
+                      uint32_t j = h[key >> shift]++;
+                      grid.partitioned[j] = uint32_t(i);
+                      grid.partitionedKeys[j] = key;
+                      partitioned[j] = input[i];
+                    }
+                  }
+                });
+
+    // Partition p owns bucketStart[b + 1] for its buckets b, which counts
+    // bucket b, then holds its start while scattering and ends up as its end.
+    grid.bucketStart[0] = 0;
+    parallelFor(P, 1, threads, [&](size_t begin, size_t end)
+                {
+                  for (size_t p = begin; p < end; p++) {
+                    uint32_t* start = grid.bucketStart.data() + 1;
+                    size_t b0 = p << shift, b1 = (p + 1) << shift;
+                    for (size_t b = b0; b < b1; b++) start[b] = 0;
+                    for (uint32_t j = partitionStart[p]; j < partitionStart[p + 1]; j++) start[grid.partitionedKeys[j]]++;
+                    uint32_t s = partitionStart[p];
+                    for (size_t b = b0; b < b1; b++) {
+                      uint32_t count = start[b];
+                      start[b] = s;
+                      s += count;
+                    }
+                    for (uint32_t j = partitionStart[p]; j < partitionStart[p + 1]; j++) {
+                      uint32_t k = start[grid.partitionedKeys[j]]++;
+                      grid.items[k] = grid.partitioned[j];
+                      sorted[k] = partitioned[j];
+                    }
+                  }
+                });
+  }
+
+  // Call f(j) for the items j in the cells from lo to hi, each item once.
+  template<typename F>
+  void visitCells(const UniformGrid& grid, const Vec3i& lo, const Vec3i& hi, F f)
+  {
+    if (grid.items.empty() || hi.x < lo.x || hi.y < lo.y || hi.z < lo.z) return;
+
+    // Scan all items when there are more cells than buckets.
+    size_t buckets = size_t(grid.bucketMask) + 1;
+    size_t cells = 1;
+    for (unsigned k = 0; k < 3 && cells <= buckets; k++) cells *= size_t(int64_t(hi[k]) - lo[k] + 1);
+    if (buckets < cells) {
+      for (size_t j = 0; j < grid.items.size(); j++) f(j);
+      return;
+    }
+
+    // Other cells may share a bucket, only take the items of this cell so
+    // that none is visited twice.
+    bool isPoints = !grid.points.empty();
+    for (int z = lo.z; z <= hi.z; z++) {
+      for (int y = lo.y; y <= hi.y; y++) {
+        for (int x = lo.x; x <= hi.x; x++) {
+          Vec3i c = makeVec3i(x, y, z);
+          uint32_t b = hash(c) & grid.bucketMask;
+          for (uint32_t j = grid.bucketStart[b]; j < grid.bucketStart[b + 1]; j++) {
+            Vec3i d = cellOf(grid.invCellSize, isPoints ? grid.points[j] : center(grid.bboxes[j]));
+            if (d.x == x && d.y == y && d.z == z) f(j);
+          }
+        }
+      }
+    }
+  }
+
+}
+
+
+void build(UniformGrid& grid, const Vec3f* points, size_t N, float cellSize, unsigned threads)
+{
+  sortItems(grid, grid.points, points, N, cellSize, threads);
+  grid.bboxes.clear();
+  grid.extent = makeVec3f(0.f);
+}
+
+void build(UniformGrid& grid, const BBox3f* bboxes, size_t N, float cellSize, unsigned threads)
+{
+  sortItems(grid, grid.bboxes, bboxes, N, cellSize, threads);
+  grid.points.clear();
+
+  // As parallelReduce, with the results of the chunks kept in the grid.
+  size_t chunks = (N + grain - 1) / grain;
+  grid.chunkExtents.resize(chunks);
+  parallelFor(chunks, 1, threads, [&](size_t begin, size_t end)
+              {
+                for (size_t c = begin; c < end; c++) {
+                  Vec3f e = makeVec3f(0.f);
+                  size_t last = N < (c + 1) * grain ? N : (c + 1) * grain;
+                  for (size_t i = c * grain; i < last; i++) {
+                    for (unsigned k = 0; k < 3; k++) {
+                      float h = 0.5f * (bboxes[i].max[k] - bboxes[i].min[k]);
+                      e[k] = h > e[k] ? h : e[k];
+                    }
+                  }
+                  grid.chunkExtents[c] = e;
+                }
+              });
+  grid.extent = makeVec3f(0.f);
+  for (const Vec3f& e : grid.chunkExtents) grid.extent = max(grid.extent, e);
+}
+
+void findOverlapping(std::vector<uint32_t>& result, const UniformGrid& grid, const BBox3f& bbox)
+{
+  Vec3i lo = cellOf(grid.invCellSize, bbox.min - grid.extent);
+  Vec3i hi = cellOf(grid.invCellSize, bbox.max + grid.extent);
+  if (grid.bboxes.empty()) {
+    visitCells(grid, lo, hi, [&](size_t j) { if (isOverlapping(bbox, makeBBox(grid.points[j], grid.points[j]))) result.push_back(grid.items[j]); });
+  }
+  else {
+    visitCells(grid, lo, hi, [&](size_t j) { if (isOverlapping(bbox, grid.bboxes[j])) result.push_back(grid.items[j]); });
+  }
+}
+
+void findWithinRadius(std::vector<uint32_t>& result, const UniformGrid& grid, const Vec3f& p, float radius)
+{
+  Vec3f r = makeVec3f(radius) + grid.extent;
+  Vec3i lo = cellOf(grid.invCellSize, p - r);
+  Vec3i hi = cellOf(grid.invCellSize, p + r);
+  float r2 = radius * radius;
+  if (grid.bboxes.empty()) {
+    visitCells(grid, lo, hi, [&](size_t j) { if (distanceSquared(p, grid.points[j]) <= r2) result.push_back(grid.items[j]); });
+  }
+  else {
+    visitCells(grid, lo, hi, [&](size_t j)
+               {
+                 const BBox3f& b = grid.bboxes[j];
+                 float d2 = 0.f;
+                 for (unsigned k = 0; k < 3; k++) {
+                   float d = b.min[k] - p[k] > p[k] - b.max[k] ? b.min[k] - p[k] : p[k] - b.max[k];
+                   if (d > 0.f) d2 += d * d;
+                 }
+                 if (d2 <= r2) result.push_back(grid.items[j]);
+               });
+  }
+}
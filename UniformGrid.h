@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "LinAlg.h"
+
+/** Hashed uniform grid over points or boxes.
+ *
+ * Space is divided into cubes of cellSize, and the cell of each item, at
+ * its position or box center, is hashed into one of a power of two of
+ * buckets. The items are sorted by bucket into one contiguous array, so a
+ * rebuild allocates nothing once the arrays have grown. Queries visit the
+ * cells overlapping the query and test only the items found there.
+ *
+ * Boxes are only stored in the cell of their center, and queries are grown
+ * by the largest half size of all boxes. This suits many small boxes, a few
+ * large ones make all queries visit more cells. */
+struct UniformGrid
+{
+  float cellSize = 1.f;
+  float invCellSize = 1.f;
+  Vec3f extent = makeVec3f(0.f);      // Largest half size of the boxes, zero for points.
+  uint32_t bucketMask = 0;
+  std::vector<uint32_t> bucketStart;  // Bucket b holds items[bucketStart[b] .. bucketStart[b + 1]).
+  std::vector<uint32_t> items;        // Input indices sorted by bucket, then index.
+  std::vector<Vec3f> points;          // Points in the order of items, empty for boxes.
+  std::vector<BBox3f> bboxes;         // Boxes in the order of items, empty for points.
+
+  // Scratch, kept so that rebuilds do not allocate.
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> partitioned;
+  std::vector<uint32_t> partitionedKeys;
+  std::vector<uint32_t> partitionStart;
+  std::vector<uint32_t> histograms;
+  std::vector<Vec3f> partitionedPoints;
+  std::vector<BBox3f> partitionedBBoxes;
+  std::vector<Vec3f> chunkExtents;
+};
+
+/** Bin N points into cells of cellSize. threads as in LinAlgBatch.h. */
+void build(UniformGrid& grid, const Vec3f* points, size_t N, float cellSize, unsigned threads = 0);
+
+/** Bin N boxes into cells of cellSize by their centers, empty boxes are never found. */
+void build(UniformGrid& grid, const BBox3f* bboxes, size_t N, float cellSize, unsigned threads = 0);
+
+/** Append the input indices of all points or boxes overlapping bbox to result, see isOverlapping. */
+void findOverlapping(std::vector<uint32_t>& result, const UniformGrid& grid, const BBox3f& bbox);
+
+/** Append the input indices of all points or boxes at most radius from p to result. */
+void findWithinRadius(std::vector<uint32_t>& result, const UniformGrid& grid, const Vec3f& p, float radius);
@@ -0,0 +1,133 @@
+// Array files written and read back, and files with corrupted headers and directories.
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "check.h"
+#include "ArrayFile.h"
+
+namespace {
+
+  // Open a file holding the first size bytes.
+  ArrayFileError openBytes(const char* path, const std::vector<char>& bytes, size_t size)
+  {
+    std::FILE* f = std::fopen(path, "wb");
+    if (f == nullptr) return ArrayFileError::Open;
+    bool written = std::fwrite(bytes.data(), 1, size, f) == size;
+    if (std::fclose(f) != 0 || !written) return ArrayFileError::Open;
+
+    ArrayFile file;
+    ArrayFileError error = open(file, path);
+    close(file);
+    return error;
+  }
+
+  // Open a copy of bytes with the value at offset replaced.
+  template<typename T>
+  ArrayFileError openPatched(const char* path, std::vector<char> bytes, size_t offset, T value)
+  {
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    return openBytes(path, bytes, bytes.size());
+  }
+
+  template<typename T>
+  T readAt(const std::vector<char>& bytes, size_t offset)
+  {
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+  }
+
+  // Each field of the header and of the first entry made invalid in turn.
+  void checkCorrupted(const char* path, const std::vector<char>& bytes)
+  {
+    const size_t entries = size_t(readAt<uint64_t>(bytes, offsetof(ArrayFileHeader, entries)));
+    const uint32_t endianness = readAt<uint32_t>(bytes, offsetof(ArrayFileHeader, endianness));
+    const uint32_t version = readAt<uint32_t>(bytes, offsetof(ArrayFileHeader, version));
+    const uint64_t size = readAt<uint64_t>(bytes, offsetof(ArrayFileHeader, size));
+    const uint64_t offset = readAt<uint64_t>(bytes, entries + offsetof(ArrayFileEntry, offset));
+    const uint32_t swapped = (endianness >> 24) | ((endianness >> 8) & 0xff00) | ((endianness << 8) & 0xff0000) | (endianness << 24);
+
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, magic), 'x') == ArrayFileError::Format, "other magic");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, endianness), swapped) == ArrayFileError::Endianness, "other byte order");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, version), version + 1) == ArrayFileError::Version, "newer version");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, version), version - 1) == ArrayFileError::None, "older version");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, headerSize), uint32_t(sizeof(ArrayFileHeader) + 8)) == ArrayFileError::Format, "other header size");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, entrySize), uint32_t(sizeof(ArrayFileEntry) - 8)) == ArrayFileError::Format, "other entry size");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, alignment), uint32_t(24)) == ArrayFileError::Format, "alignment not a power of two");
+    check(openPatched(path, bytes, offsetof(ArrayFileHeader, size), size + 64) == ArrayFileError::Truncated, "size larger than the file");
+    check(openPatched(path, bytes, entries + offsetof(ArrayFileEntry, offset), offset + 8) == ArrayFileError::Format, "misaligned array");
+    check(openPatched(path, bytes, entries + offsetof(ArrayFileEntry, offset), size) == ArrayFileError::Truncated, "array outside the file");
+    check(openPatched(path, bytes, entries + offsetof(ArrayFileEntry, scalarSize), uint8_t(2)) == ArrayFileError::Format, "entry of inconsistent sizes");
+
+    std::vector<char> unterminated = bytes;
+    std::memset(unterminated.data() + entries + offsetof(ArrayFileEntry, name), 'a', sizeof(ArrayFileEntry::name));
+    check(openBytes(path, unterminated, bytes.size()) == ArrayFileError::Format, "name without a terminating zero");
+
+    // The directory moved 4 bytes into the padding after the last array.
+    std::vector<char> moved(bytes.begin(), bytes.end() - 4);
+    std::memmove(moved.data() + entries - 4, bytes.data() + entries, bytes.size() - entries);
+    const uint64_t movedEntries = entries - 4, movedSize = size - 4;
+    std::memcpy(moved.data() + offsetof(ArrayFileHeader, entries), &movedEntries, sizeof(movedEntries));
+    std::memcpy(moved.data() + offsetof(ArrayFileHeader, size), &movedSize, sizeof(movedSize));
+    check(openBytes(path, moved, moved.size()) == ArrayFileError::Format, "misaligned directory");
+
+    check(openBytes(path, bytes, bytes.size()) == ArrayFileError::None, "unchanged copy");
+    check(openBytes(path, bytes, bytes.size() - sizeof(ArrayFileEntry)) == ArrayFileError::Truncated, "file without its last entry");
+    check(openBytes(path, bytes, sizeof(ArrayFileHeader) / 2) == ArrayFileError::Format, "file shorter than the header");
+  }
+
+}
+
+
+void checkArrayFile(const char* path)
+{
+  setCheckSection("ArrayFile");
+
+  std::vector<Vec3f> points(1001);
+  std::vector<Mat3x4f> transforms(17);
+  std::vector<uint16_t> indices(3);
+  std::vector<Vec3h> halves(5);
+  for (Vec3f& p : points) p = randomVec3f(-1.f, 1.f);
+  for (Mat3x4f& M : transforms) M = randomMat3x4f();
+  for (size_t i = 0; i < indices.size(); i++) indices[i] = uint16_t(3 * i + 1);
+  for (Vec3h& h : halves) h = makeVec3h(randomVec3f(-10.f, 10.f));
+
+  ArrayFileWriter writer;
+  check(open(writer, path) == ArrayFileError::None, "open for writing");
+  check(writeArray(writer, "points", points.data(), points.size()), "write points");
+  check(writeArray(writer, "transforms", transforms.data(), transforms.size()), "write transforms");
+  check(writeArray(writer, "indices", indices.data(), indices.size()), "write indices");
+  check(writeArray(writer, "empty", points.data(), 0), "write empty");
+  check(writeArray(writer, "halves", halves.data(), halves.size()), "write halves");
+  check(close(writer) == ArrayFileError::None, "close writer");
+
+  ArrayFile file;
+  check(open(file, path) == ArrayFileError::None, "open for reading");
+  if (file.header == nullptr) return;
+  const size_t alignment = file.header->alignment;
+
+  const Vec3f* p = nullptr;
+  const Mat3x4f* M = nullptr;
+  const uint16_t* ix = nullptr;
+  const Vec3h* h = nullptr;
+  size_t n = 0;
+  check(findArray(p, n, file, "points") == ArrayFileError::None && n == points.size() && sameFloats(points.data(), p, n), "points");
+  check(reinterpret_cast<uintptr_t>(p) % alignment == 0, "points aligned");
+  check(findArray(M, n, file, "transforms") == ArrayFileError::None && n == transforms.size() && sameFloats(transforms.data(), M, n), "transforms");
+  check(reinterpret_cast<uintptr_t>(M) % alignment == 0, "transforms aligned");
+  check(findArray(ix, n, file, "indices") == ArrayFileError::None && n == indices.size() && sameBytes(indices.data(), ix, n), "indices");
+  check(findArray(h, n, file, "halves") == ArrayFileError::None && n == halves.size() && sameBytes(halves.data(), h, n), "halves");
+  check(findArray(p, n, file, "empty") == ArrayFileError::None && n == 0, "empty");
+  check(findArray(M, n, file, "points") == ArrayFileError::Layout, "other element type");
+  check(findArray(p, n, file, "missing") == ArrayFileError::NotFound, "missing array");
+
+  std::vector<char> bytes(file.base, file.base + file.size);
+  close(file);
+  checkCorrupted(path, bytes);
+
+  // Names of 40 characters or more fail the writer.
+  check(open(writer, path) == ArrayFileError::None && !writeArray(writer, "a name longer than the forty characters of an entry", points.data(), 1) &&
+        close(writer) == ArrayFileError::Format, "name too long");
+  std::remove(path);
+}
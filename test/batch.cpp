@@ -0,0 +1,462 @@
+// Batched operations against the scalar ones, bit for bit, at every SIMD
+// level the CPU supports, switched with setSIMDLevel.
+#include <cmath>
+#include <vector>
+#include "check.h"
+#include "LinAlgBatch.h"
+
+namespace {
+
+  const float nan = std::nanf("");
+  const float inf = INFINITY;
+
+  // Not a multiple of any SIMD width, so that the scalar tails run too.
+  const size_t N = 1000 + 13;
+
+  // Inputs of the level checks, with the special values the kernels must
+  // treat like the scalar code.
+  struct Inputs
+  {
+    Mat3x4f M;
+    BBox3f frame;
+    std::vector<Vec2f> points2;
+    std::vector<Vec3f> points;
+    std::vector<Vec3d> pointsd;
+    std::vector<Vec3f> directions;
+    std::vector<BBox3f> bboxes;
+    std::vector<Mat3x4f> transforms;
+    std::vector<Mat3f> matrices;
+    std::vector<Mat3d> matricesd;
+    std::vector<Vec4u> bones;
+    std::vector<Vec4f> weights;
+    std::vector<Mat3x4f> boneMatrices;
+    std::vector<DualQuatf> boneQuats;
+    std::vector<Ray3f> rays;
+    Frustumf frustums[2];
+  };
+
+  Inputs makeInputs()
+  {
+    Inputs in;
+    in.M = randomMat3x4f();
+    in.frame = makeBBox(makeVec3f(-100.f), makeVec3f(100.f));
+    in.points2.resize(N);
+    in.points.resize(N);
+    in.pointsd.resize(N);
+    in.directions.resize(N);
+    in.bboxes.resize(N);
+    in.transforms.resize(N);
+    in.matrices.resize(N);
+    in.matricesd.resize(N);
+    in.bones.resize(N);
+    in.weights.resize(N);
+    in.rays.resize(N);
+    for (size_t i = 0; i < N; i++) {
+      in.points2[i] = randomVec2f(-120.f, 120.f);
+      in.points[i] = randomVec3f(-120.f, 120.f);
+      in.pointsd[i] = makeVec3d(random(-1e3f, 1e3f), random(-1e3f, 1e3f), random(-1e3f, 1e3f));
+      in.directions[i] = randomVec3f(-2.f, 2.f);
+      in.bboxes[i] = randomBBox3f(100.f, 10.f);
+      in.transforms[i] = randomMat3x4f();
+      in.matrices[i] = randomMat3f();
+      for (unsigned k = 0; k < 9; k++) in.matricesd[i].data[k] = double(random(-1.f, 1.f));
+      for (unsigned k = 0; k < 4; k++) in.bones[i][k] = unsigned(random(0.f, 31.99f));
+      Vec4f w = makeVec4f(random01(), random01(), random01(), random01());
+      in.weights[i] = (1.f / (w.x + w.y + w.z + w.w)) * w;
+      in.rays[i] = makeRay3f(randomVec3f(-150.f, 150.f), randomVec3f(-1.f, 1.f));
+    }
+
+    // Vectors without a direction, which encodeOctahedral maps to +z.
+    in.directions[0] = makeVec3f(0.f);
+    in.directions[1] = makeVec3f(nan, 0.f, 0.f);
+    in.directions[2] = makeVec3f(inf, 1.f, 0.f);
+    in.directions[3] = makeVec3f(1e-40f, 0.f, -1e-40f);
+    in.points[4] = makeVec3f(0.f);
+    in.bboxes[5] = makeEmptyBBox3f();
+    in.bboxes[6] = makeBBox(in.points[6], in.points[6]);
+
+    // Singular, rank 1 and mirroring matrices.
+    in.matrices[7] = makeMat3f(makeVec3f(1.f, 2.f, 3.f), makeVec3f(2.f, 4.f, 6.f), makeVec3f(-1.f, -2.f, -3.f));
+    in.matrices[8] = makeMat3f(makeVec3f(0.f), makeVec3f(0.f), makeVec3f(0.f));
+    in.matrices[9] = makeMat3f(makeVec3f(1.f, 0.f, 0.f), makeVec3f(0.f, 1.f, 0.f), makeVec3f(0.f, 0.f, -1.f));
+    in.matrices[10] = makeMat3f(makeVec3f(1e-30f, 0.f, 0.f), makeVec3f(0.f, 1e30f, 0.f), makeVec3f(0.f, 0.f, 1.f));
+    in.matricesd[11] = makeMat3d(makeVec3d(1.0, 2.0, 3.0), makeVec3d(2.0, 4.0, 6.0), makeVec3d(0.0, 1.0, 0.0));
+
+    in.boneMatrices.resize(32);
+    in.boneQuats.resize(32);
+    for (size_t b = 0; b < 32; b++) {
+      in.boneQuats[b] = makeDualQuatf(randomQuatf(), randomVec3f(-10.f, 10.f));
+      in.boneMatrices[b] = makeMat3x4f(in.boneQuats[b]);
+    }
+
+    // 90 degree perspective looking down -z, as in the benchmarks, once moved aside.
+    const float n = 1.f, f = 100.f;
+    const float P[16] = { 1.f, 0.f, 0.f, 0.f,  0.f, 1.f, 0.f, 0.f,  0.f, 0.f, -(f + n) / (f - n), -1.f,  0.f, 0.f, -2.f * f * n / (f - n), 0.f };
+    for (size_t v = 0; v < 2; v++) {
+      Mat4f V = makeMat4f(P);
+      V.c3r0 = 30.f * v - 10.f;
+      in.frustums[v] = makeFrustumf(V);
+    }
+    return in;
+  }
+
+  // Results of the operations that are only defined to match between
+  // levels, not a scalar function.
+  struct LevelResults
+  {
+    std::vector<Vec3f> skinnedLinear;
+    std::vector<Vec3f> skinnedDualQuat;
+    std::vector<Vec3f> quantizedTransformed;
+  };
+
+  void checkTransforms(const Inputs& in)
+  {
+    const Mat3x4f& M = in.M;
+    std::vector<Vec3f> ref(N), out(N);
+    for (size_t i = 0; i < N; i++) ref[i] = mul(M, in.points[i]);
+    transform(out.data(), M, in.points.data(), N, 1);
+    check(sameFloats(ref, out), "transform(Vec3f*)");
+
+    out = in.points;
+    transform(out.data(), M, out.data(), N, 1);
+    check(sameFloats(ref, out), "transform(Vec3f*) in place");
+
+    std::vector<float> interleaved(5 * N, 7.f), transformed(5 * N, 7.f);
+    for (size_t i = 0; i < N; i++) write(interleaved.data() + 5 * i, in.points[i]);
+    transform(transformed.data(), 5 * sizeof(float), M, interleaved.data(), 5 * sizeof(float), N);
+    bool ok = true;
+    for (size_t i = 0; i < N; i++) {
+      ok = ok && sameFloats(&ref[i], reinterpret_cast<const Vec3f*>(transformed.data() + 5 * i), 1);
+      ok = ok && transformed[5 * i + 3] == 7.f && transformed[5 * i + 4] == 7.f;
+    }
+    check(ok, "transform(float*, stride)");
+
+    Vec3SoAf soa, soaOut;
+    convert(soa, makeVec3View(in.points.data(), N), 1);
+    transform(soaOut, M, soa, 1);
+    std::fill(out.begin(), out.end(), makeVec3f(0.f));
+    convert(makeVec3View(out.data(), N), soaOut, 1);
+    check(sameFloats(ref, out), "transform(Vec3SoAf)");
+
+    std::fill(out.begin(), out.end(), makeVec3f(0.f));
+    transform(makeVec3View(out.data(), N), M, makeVec3View(in.points.data(), N), 1);
+    check(sameFloats(ref, out), "transform(Vec3View)");
+
+    std::vector<BBox3f> boxRef(N), boxOut(N);
+    for (size_t i = 0; i < N; i++) boxRef[i] = transform(M, in.bboxes[i]);
+    transform(boxOut.data(), M, in.bboxes.data(), N, 1);
+    check(sameFloats(boxRef, boxOut), "transform(BBox3f*)");
+
+    for (size_t i = 0; i < N; i++) boxRef[i] = transform(in.transforms[i], in.bboxes[i]);
+    transform(boxOut.data(), in.transforms.data(), in.bboxes.data(), N, 1);
+    check(sameFloats(boxRef, boxOut), "transform(Mat3x4f*, BBox3f*)");
+
+    BBox3SoAf boxSoA;
+    convert(boxSoA, in.bboxes.data(), N, 1);
+    convert(boxOut.data(), boxSoA, 1);
+    check(sameFloats(in.bboxes, boxOut), "convert(BBox3SoAf)");
+  }
+
+  // min and max that skip NaN coordinates, as the batched engulf does.
+  template<typename B, typename V>
+  void engulfNumbers(B& bbox, const V& p)
+  {
+    for (size_t k = 0; k < sizeof(V) / sizeof(p.x); k++) {
+      if (p[k] < bbox.min[k]) bbox.min[k] = p[k];
+      if (bbox.max[k] < p[k]) bbox.max[k] = p[k];
+    }
+  }
+
+  void checkBounds(const Inputs& in)
+  {
+    std::vector<Vec3f> points = in.points;
+    points[11] = makeVec3f(nan, 500.f, -500.f);
+    points[12] = makeVec3f(-600.f, nan, nan);
+
+    BBox3f start = makeBBox(makeVec3f(1.f), makeVec3f(2.f));
+    BBox3f ref = start;
+    for (const Vec3f& p : points) engulfNumbers(ref, p);
+    check(sameFloats(&ref, &start, 1) == false, "engulf reference");
+    BBox3f out = engulf(start, points.data(), N, 1);
+    check(sameFloats(&ref, &out, 1), "engulf(Vec3f*)");
+
+    std::vector<float> interleaved(4 * N);
+    for (size_t i = 0; i < N; i++) write(interleaved.data() + 4 * i, points[i]);
+    out = engulf(start, interleaved.data(), 4 * sizeof(float), N, 1);
+    check(sameFloats(&ref, &out, 1), "engulf(float*, stride)");
+
+    out = engulf(start, makeVec3View(points.data(), N), 1);
+    check(sameFloats(&ref, &out, 1), "engulf(Vec3View)");
+
+    Vec3SoAf soa;
+    convert(soa, makeVec3View(points.data(), N), 1);
+    out = engulf(start, soa, 1);
+    check(sameFloats(&ref, &out, 1), "engulf(Vec3SoAf)");
+
+    BBox2f ref2 = makeEmptyBBox2f();
+    for (const Vec2f& p : in.points2) engulfNumbers(ref2, p);
+    BBox2f out2 = engulf(makeEmptyBBox2f(), in.points2.data(), N, 1);
+    check(sameFloats(&ref2, &out2, 1), "engulf(Vec2f*)");
+
+    BBox3d refd = makeEmptyBBox3d();
+    for (const Vec3d& p : in.pointsd) engulfNumbers(refd, p);
+    BBox3d outd = engulf(makeEmptyBBox3d(), in.pointsd.data(), N, 1);
+    check(sameDoubles(&refd, &outd, 1), "engulf(Vec3d*)");
+
+    BBox3f refBoxes = makeEmptyBBox3f();
+    for (const BBox3f& b : in.bboxes) refBoxes = engulf(refBoxes, b);
+    out = engulf(makeEmptyBBox3f(), in.bboxes.data(), N, 1);
+    check(sameFloats(&refBoxes, &out, 1), "engulf(BBox3f*)");
+  }
+
+  void checkVectors(const Inputs& in)
+  {
+    std::vector<float> ref(N), out(N);
+    for (size_t i = 0; i < N; i++) ref[i] = length(in.directions[i]);
+    length(out.data(), in.directions.data(), N);
+    check(sameFloats(ref, out), "length");
+
+    for (size_t i = 0; i < N; i++) ref[i] = distance(in.points[i], in.directions[i]);
+    distance(out.data(), in.points.data(), in.directions.data(), N);
+    check(sameFloats(ref, out), "distance");
+
+    std::vector<Vec3f> ref3(N), out3(N);
+    for (size_t i = 0; i < N; i++) ref3[i] = normalize(in.directions[i]);
+    normalize(out3.data(), in.directions.data(), N);
+    check(sameFloats(ref3, out3), "normalize");
+  }
+
+  void checkCompression(const Inputs& in, LevelResults& results)
+  {
+    // Halves, without NaNs, whose payloads F16C keeps.
+    std::vector<Vec3f> values(N);
+    for (size_t i = 0; i < N; i++) values[i] = 1000.f * in.directions[i];
+    values[1] = makeVec3f(inf, -inf, 1e-7f);
+    values[2] = makeVec3f(65520.f, -65504.f, 6e-8f);
+    values[3] = makeVec3f(-0.f, 1e-30f, 3e-5f);
+    std::vector<Vec3h> halfRef(N), halfOut(N);
+    for (size_t i = 0; i < N; i++) halfRef[i] = makeVec3h(values[i]);
+    convert(halfOut.data(), values.data(), N);
+    check(sameBytes(halfRef, halfOut), "convert(Vec3h*)");
+
+    std::vector<Vec3f> ref(N), out(N);
+    for (size_t i = 0; i < N; i++) ref[i] = makeVec3f(halfRef[i]);
+    convert(out.data(), halfRef.data(), N);
+    check(sameFloats(ref, out), "convert(Vec3f*, Vec3h*)");
+
+    for (size_t i = 0; i < N; i++) ref[i] = mul(in.M, makeVec3f(halfRef[i]));
+    transform(out.data(), in.M, halfRef.data(), N);
+    check(sameFloats(ref, out), "transform(Vec3h*)");
+
+    std::vector<Vec3us> quantRef(N), quantOut(N);
+    for (size_t i = 0; i < N; i++) quantRef[i] = quantize(in.frame, in.points[i]);
+    quantize(quantOut.data(), in.frame, in.points.data(), N);
+    check(sameBytes(quantRef, quantOut), "quantize");
+
+    for (size_t i = 0; i < N; i++) ref[i] = dequantize(in.frame, quantRef[i]);
+    dequantize(out.data(), in.frame, quantRef.data(), N);
+    check(sameFloats(ref, out), "dequantize");
+
+    results.quantizedTransformed.resize(N);
+    transform(results.quantizedTransformed.data(), in.M, in.frame, quantRef.data(), N);
+
+    std::vector<Vec2s> octRef(N), octOut(N);
+    for (size_t i = 0; i < N; i++) octRef[i] = encodeOctahedral(in.directions[i]);
+    encodeOctahedral(octOut.data(), in.directions.data(), N);
+    check(sameBytes(octRef, octOut), "encodeOctahedral");
+    for (size_t i = 0; i < 4; i++) {
+      Vec3f d = decodeOctahedral(octOut[i]);
+      check(d.x == 0.f && d.y == 0.f && d.z == 1.f, "encodeOctahedral of vectors without a direction");
+    }
+
+    for (size_t i = 0; i < N; i++) ref[i] = decodeOctahedral(octRef[i]);
+    decodeOctahedral(out.data(), octRef.data(), N);
+    check(sameFloats(ref, out), "decodeOctahedral");
+  }
+
+  void checkSkinning(const Inputs& in, LevelResults& results)
+  {
+    results.skinnedLinear.resize(N);
+    results.skinnedDualQuat.resize(N);
+    skinLinear(results.skinnedLinear.data(), in.points.data(), in.bones.data(), in.weights.data(), in.boneMatrices.data(), N, 1);
+    skinDualQuat(results.skinnedDualQuat.data(), in.points.data(), in.bones.data(), in.weights.data(), in.boneQuats.data(), N, 1);
+
+    // Both blend rigid transforms, so a single influence gives the same point.
+    std::vector<Vec4f> single(N, makeVec4f(1.f, 0.f, 0.f, 0.f));
+    std::vector<Vec3f> linear(N), dual(N);
+    skinLinear(linear.data(), in.points.data(), in.bones.data(), single.data(), in.boneMatrices.data(), N, 1);
+    skinDualQuat(dual.data(), in.points.data(), in.bones.data(), single.data(), in.boneQuats.data(), N, 1);
+    bool ok = true;
+    for (size_t i = 0; i < N; i++) ok = ok && distance(linear[i], dual[i]) <= 1e-3f * (1.f + length(linear[i]));
+    check(ok, "skinLinear and skinDualQuat of single influences");
+  }
+
+  void checkQueries(const Inputs& in)
+  {
+    const size_t words = (N + 31) / 32;
+    std::vector<uint32_t> hitsRef(words), hitsOut(words);
+    std::vector<float> tRef(N), tOut(N);
+
+    const Ray3f& ray = in.rays[0];
+    for (size_t i = 0; i < N; i++) {
+      float t = 0.f;
+      if (intersect(t, ray, in.bboxes[i], 0.f, 200.f)) {
+        hitsRef[i / 32] |= 1u << (i % 32);
+        tRef[i] = t;
+      }
+    }
+    intersect(hitsOut.data(), tOut.data(), ray, in.bboxes.data(), N, 0.f, 200.f);
+    bool ok = sameBytes(hitsRef, hitsOut);
+    for (size_t i = 0; i < N; i++) ok = ok && (!((hitsRef[i / 32] >> (i % 32)) & 1) || same(tRef[i], tOut[i]));
+    check(ok, "intersect(Ray3f, BBox3f*)");
+
+    std::fill(hitsRef.begin(), hitsRef.end(), 0);
+    const BBox3f bbox = makeBBox(makeVec3f(-50.f), makeVec3f(50.f));
+    for (size_t i = 0; i < N; i++) {
+      float t = 0.f;
+      if (intersect(t, in.rays[i], bbox, 0.f, 200.f)) {
+        hitsRef[i / 32] |= 1u << (i % 32);
+        tRef[i] = t;
+      }
+    }
+    intersect(hitsOut.data(), tOut.data(), in.rays.data(), N, bbox, 0.f, 200.f);
+    ok = sameBytes(hitsRef, hitsOut);
+    for (size_t i = 0; i < N; i++) ok = ok && (!((hitsRef[i / 32] >> (i % 32)) & 1) || same(tRef[i], tOut[i]));
+    check(ok, "intersect(Ray3f*, BBox3f)");
+
+    std::vector<Containment> classRef(N), classOut(N);
+    for (size_t i = 0; i < N; i++) classRef[i] = classify(in.frustums[0], in.bboxes[i]);
+    classify(classOut.data(), in.frustums[0], in.bboxes.data(), N);
+    check(sameBytes(classRef, classOut), "classify");
+
+    std::vector<uint32_t> visibleRef[2];
+    for (size_t v = 0; v < 2; v++) {
+      for (size_t i = 0; i < N; i++) {
+        if (classify(in.frustums[v], in.bboxes[i]) != Containment::Outside) visibleRef[v].push_back(uint32_t(i));
+      }
+    }
+    std::vector<uint32_t> visible(N);
+    visible.resize(cull(visible.data(), in.frustums[0], in.bboxes.data(), N));
+    check(sameBytes(visibleRef[0], visible), "cull");
+
+    std::vector<uint32_t> lists(2 * N);
+    uint32_t* listPointers[2] = { lists.data(), lists.data() + N };
+    size_t counts[2];
+    cull(counts, listPointers, in.frustums, 2, in.bboxes.data(), N);
+    for (size_t v = 0; v < 2; v++) {
+      check(counts[v] == visibleRef[v].size() && sameBytes(listPointers[v], visibleRef[v].data(), counts[v]), "cull(Frustumf*)");
+    }
+  }
+
+  template<typename T, typename Batched, typename Scalar>
+  void checkInverses(const std::vector<T>& src, Batched batched, Scalar scalar, bool (*compare)(const T*, const T*, size_t), const char* what)
+  {
+    const size_t words = (N + 31) / 32;
+    std::vector<T> ref(N), out(N);
+    std::vector<uint32_t> singularRef(words), singular(words, ~0u);
+    for (size_t i = 0; i < N; i++) {
+      ref[i] = scalar(src[i]);
+      if (isSingular(determinant(src[i]))) singularRef[i / 32] |= 1u << (i % 32);
+    }
+    batched(out.data(), singular.data(), src.data(), N, 1u);
+    check(compare(ref.data(), out.data(), N) && sameBytes(singularRef, singular), what);
+  }
+
+  void checkMatrices(const Inputs& in)
+  {
+    checkInverses(in.matrices, [](Mat3f* d, uint32_t* s, const Mat3f* m, size_t n, unsigned t) { inverse(d, s, m, n, t); },
+                  [](const Mat3f& m) { return inverse(m); }, sameFloats<Mat3f>, "inverse(Mat3f*)");
+    checkInverses(in.matrices, [](Mat3f* d, uint32_t* s, const Mat3f* m, size_t n, unsigned t) { inverseTranspose(d, s, m, n, t); },
+                  [](const Mat3f& m) { return inverseTranspose(m); }, sameFloats<Mat3f>, "inverseTranspose(Mat3f*)");
+    checkInverses(in.matricesd, [](Mat3d* d, uint32_t* s, const Mat3d* m, size_t n, unsigned t) { inverse(d, s, m, n, t); },
+                  [](const Mat3d& m) { return inverse(m); }, sameDoubles<Mat3d>, "inverse(Mat3d*)");
+    checkInverses(in.matricesd, [](Mat3d* d, uint32_t* s, const Mat3d* m, size_t n, unsigned t) { inverseTranspose(d, s, m, n, t); },
+                  [](const Mat3d& m) { return inverseTranspose(m); }, sameDoubles<Mat3d>, "inverseTranspose(Mat3d*)");
+
+    std::vector<Mat3f> U(N), V(N), R(N), S(N), URef(N), VRef(N), RRef(N), SRef(N);
+    std::vector<Vec3f> sigma(N), sigmaRef(N);
+    for (size_t i = 0; i < N; i++) {
+      svd(URef[i], sigmaRef[i], VRef[i], in.matrices[i]);
+      polarDecomposition(RRef[i], SRef[i], in.matrices[i]);
+    }
+    svd(U.data(), sigma.data(), V.data(), in.matrices.data(), N, 1);
+    check(sameFloats(URef, U) && sameFloats(sigmaRef, sigma) && sameFloats(VRef, V), "svd");
+    polarDecomposition(R.data(), S.data(), in.matrices.data(), N, 1);
+    check(sameFloats(RRef, R) && sameFloats(SRef, S), "polarDecomposition");
+
+    std::vector<float> scaleRef(N), scale(N);
+    for (size_t i = 0; i < N; i++) scaleRef[i] = getScale(in.matrices[i]);
+    getScale(scale.data(), in.matrices.data(), N, 1);
+    check(sameFloats(scaleRef, scale), "getScale(Mat3f*)");
+    for (size_t i = 0; i < N; i++) scaleRef[i] = getScale(in.transforms[i]);
+    getScale(scale.data(), in.transforms.data(), N, 1);
+    check(sameFloats(scaleRef, scale), "getScale(Mat3x4f*)");
+  }
+
+  template<typename Key, typename BBox, typename Vec, typename Batched, typename Scalar>
+  void checkKeys(const BBox& frame, const std::vector<Vec>& points, Batched batched, Scalar scalar, const char* what)
+  {
+    std::vector<Key> ref(points.size()), out(points.size());
+    for (size_t i = 0; i < points.size(); i++) ref[i] = scalar(frame, points[i]);
+    batched(out.data(), frame, points.data(), points.size());
+    check(sameBytes(ref, out), what);
+  }
+
+  void checkSpaceFillingCurves(const Inputs& in)
+  {
+    const BBox2f frame2 = makeBBox(makeVec2f(-100.f), makeVec2f(100.f));
+    const BBox3f& frame3 = in.frame;
+    typedef const BBox2f& F2;
+    typedef const BBox3f& F3;
+    checkKeys<uint32_t>(frame3, in.points, [](uint32_t* d, F3 f, const Vec3f* p, size_t n) { mortonKey(d, f, p, n, 1); },
+                        [](F3 f, const Vec3f& p) { return mortonKey(f, p); }, "mortonKey(Vec3f*)");
+    checkKeys<uint32_t>(frame2, in.points2, [](uint32_t* d, F2 f, const Vec2f* p, size_t n) { mortonKey(d, f, p, n, 1); },
+                        [](F2 f, const Vec2f& p) { return mortonKey(f, p); }, "mortonKey(Vec2f*)");
+    checkKeys<uint64_t>(frame3, in.points, [](uint64_t* d, F3 f, const Vec3f* p, size_t n) { mortonKey(d, f, p, n, 1); },
+                        [](F3 f, const Vec3f& p) { return mortonKey64(f, p); }, "mortonKey64(Vec3f*)");
+    checkKeys<uint64_t>(frame2, in.points2, [](uint64_t* d, F2 f, const Vec2f* p, size_t n) { mortonKey(d, f, p, n, 1); },
+                        [](F2 f, const Vec2f& p) { return mortonKey64(f, p); }, "mortonKey64(Vec2f*)");
+    checkKeys<uint32_t>(frame3, in.points, [](uint32_t* d, F3 f, const Vec3f* p, size_t n) { hilbertKey(d, f, p, n, 1); },
+                        [](F3 f, const Vec3f& p) { return hilbertKey(f, p); }, "hilbertKey(Vec3f*)");
+    checkKeys<uint32_t>(frame2, in.points2, [](uint32_t* d, F2 f, const Vec2f* p, size_t n) { hilbertKey(d, f, p, n, 1); },
+                        [](F2 f, const Vec2f& p) { return hilbertKey(f, p); }, "hilbertKey(Vec2f*)");
+    checkKeys<uint64_t>(frame3, in.points, [](uint64_t* d, F3 f, const Vec3f* p, size_t n) { hilbertKey(d, f, p, n, 1); },
+                        [](F3 f, const Vec3f& p) { return hilbertKey64(f, p); }, "hilbertKey64(Vec3f*)");
+    checkKeys<uint64_t>(frame2, in.points2, [](uint64_t* d, F2 f, const Vec2f* p, size_t n) { hilbertKey(d, f, p, n, 1); },
+                        [](F2 f, const Vec2f& p) { return hilbertKey64(f, p); }, "hilbertKey64(Vec2f*)");
+  }
+}
+
+
+void checkBatchLevels()
+{
+  const char* names[] = { "scalar", "sse2", "avx2", "avx512" };
+  const SIMDLevel best = getSIMDLevel();
+  const Inputs in = makeInputs();
+  LevelResults scalarResults;
+
+  for (unsigned l = 0; l <= unsigned(best); l++) {
+    setSIMDLevel(SIMDLevel(l));
+    setCheckSection(names[l]);
+
+    LevelResults results;
+    checkTransforms(in);
+    checkBounds(in);
+    checkVectors(in);
+    checkCompression(in, results);
+    checkSkinning(in, results);
+    checkQueries(in);
+    checkMatrices(in);
+    checkSpaceFillingCurves(in);
+
+    if (l == 0) {
+      scalarResults = results;
+    }
+    else {
+      check(sameFloats(scalarResults.skinnedLinear, results.skinnedLinear), "skinLinear against the scalar level");
+      check(sameFloats(scalarResults.skinnedDualQuat, results.skinnedDualQuat), "skinDualQuat against the scalar level");
+      check(sameFloats(scalarResults.quantizedTransformed, results.quantizedTransformed), "transform(Vec3us*) against the scalar level");
+    }
+  }
+  setSIMDLevel(best);
+}
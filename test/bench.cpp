@@ -0,0 +1,1022 @@
+// Micro-benchmarks of LinAlgOps and the batched kernels.
+//
+// Usage: cdmath-bench [--json file] [--filter substring] [--size N] [--bvh-size N]
+//                     [--warmup N] [--iterations N]
+//
+// Every benchmark runs a fixed number of warm-up and timed iterations over
+// the same input. The minimum and median of the timed iterations are
+// reported, the median is the number to compare between runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "LinAlg.h"
+#include "LinAlgOps.h"
+#include "LinAlgBatch.h"
+#include "ArrayFile.h"
+#include "BVH.h"
+#include "SweepAndPrune.h"
+#include "TransformHierarchy.h"
+#include "UniformGrid.h"
+#include "KdTree.h"
+#include "RadixSort.h"
+#include "TileBins.h"
+
+namespace {
+
+  struct Options
+  {
+    const char* json = nullptr;
+    const char* filter = nullptr;
+    size_t size = 1 << 20;
+    size_t bvhSize = 10000000;
+    unsigned warmup = 2;
+    unsigned iterations = 10;
+  };
+
+  struct Result
+  {
+    std::string name;
+    std::string variant;
+    size_t n;
+    unsigned iterations;
+    double nsMin;
+    double nsMedian;
+  };
+
+  Options options;
+  std::vector<Result> results;
+
+  // Keep the compiler from optimizing away results that are never read.
+#if defined(__GNUC__) || defined(__clang__)
+  template<typename T> void escape(T* p) { asm volatile("" : : "g"(p) : "memory"); }
+#else
+  volatile const void* escapeSink;
+  template<typename T> void escape(T* p) { escapeSink = p; }
+#endif
+
+  template<typename T>
+  void keep(T value)
+  {
+    static T sink;
+    sink = value;
+    escape(&sink);
+  }
+
+  uint32_t seed = 1;
+  float random01()
+  {
+    seed = seed * 1664525u + 1013904223u;
+    return float(seed >> 8) * (1.f / float(1 << 24));
+  }
+  float random(float a, float b) { return a + (b - a) * random01(); }
+  Vec3f randomVec3f(float a, float b) { return makeVec3f(random(a, b), random(a, b), random(a, b)); }
+
+  Quatf randomQuatf()
+  {
+    return normalize(makeQuatf(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f)));
+  }
+
+  Mat3f randomMat3f()
+  {
+    Mat3f M;
+    for (float& v : M.data) v = random(-1.f, 1.f);
+    for (unsigned k = 0; k < 3; k++) M.data[4 * k] += 4.f;   // Keep it well-conditioned.
+    return M;
+  }
+
+  Mat3x4f randomMat3x4f()
+  {
+    Mat3f R = randomMat3f();
+    return makeMat3x4f(R.cols[0], R.cols[1], R.cols[2], randomVec3f(-10.f, 10.f));
+  }
+
+  BBox3f randomBBox3f(float extent, float size)
+  {
+    Vec3f a = randomVec3f(-extent, extent);
+    return makeBBox(a, a + randomVec3f(0.f, size));
+  }
+
+  bool enabled(const char* name)
+  {
+    return options.filter == nullptr || std::strstr(name, options.filter) != nullptr;
+  }
+
+  // Time f, which performs n operations per call.
+  template<typename F>
+  void run(const char* name, const char* variant, size_t n, F f, unsigned iterations = 0)
+  {
+    if (!enabled(name)) return;
+    if (iterations == 0) iterations = options.iterations;
+
+    for (unsigned i = 0; i < options.warmup; i++) f();
+
+    std::vector<double> ns(iterations);
+    for (unsigned i = 0; i < iterations; i++) {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      auto stop = std::chrono::steady_clock::now();
+      ns[i] = std::chrono::duration<double, std::nano>(stop - start).count() / double(n);
+    }
+    std::sort(ns.begin(), ns.end());
+
+    Result r;
+    r.name = name;
+    r.variant = variant;
+    r.n = n;
+    r.iterations = iterations;
+    r.nsMin = ns.front();
+    r.nsMedian = ns[ns.size() / 2];
+    results.push_back(r);
+
+    std::printf("%-28s %-8s %10zu %10.3f ns/op %10.3f Mop/s\n",
+                name, variant, n, r.nsMedian, 1e3 / r.nsMedian);
+    std::fflush(stdout);
+  }
+
+  void benchVectorOps(size_t N)
+  {
+    std::vector<Vec3f> a(N), b(N), r(N);
+    std::vector<float> t(N);
+    for (size_t i = 0; i < N; i++) {
+      a[i] = randomVec3f(-1.f, 1.f);
+      b[i] = randomVec3f(-1.f, 1.f);
+    }
+
+    run("cross(Vec3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = cross(a[i], b[i]);
+      escape(r.data());
+    });
+    run("dot(Vec3f)", "scalar", N, [&]() {
+      float s = 0.f;
+      for (size_t i = 0; i < N; i++) s += dot(a[i], b[i]);
+      keep(s);
+    });
+    run("length(Vec3f)", "scalar", N, [&]() {
+      float s = 0.f;
+      for (size_t i = 0; i < N; i++) s += length(a[i]);
+      keep(s);
+    });
+    run("distance(Vec3f)", "scalar", N, [&]() {
+      float s = 0.f;
+      for (size_t i = 0; i < N; i++) s += distance(a[i], b[i]);
+      keep(s);
+    });
+    run("normalize(Vec3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = normalize(a[i]);
+      escape(r.data());
+    });
+    run("normalize(Vec3f,FastPrecision)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = normalize(a[i], FastPrecision());
+      escape(r.data());
+    });
+    run("length(Vec3f[])", "batched", N, [&]() {
+      length(t.data(), a.data(), N);
+      escape(t.data());
+    });
+    run("length(Vec3f[],FastPrecision)", "batched", N, [&]() {
+      length(t.data(), a.data(), N, FastPrecision());
+      escape(t.data());
+    });
+    run("distance(Vec3f[])", "batched", N, [&]() {
+      distance(t.data(), a.data(), b.data(), N);
+      escape(t.data());
+    });
+    run("distance(Vec3f[],FastPrecision)", "batched", N, [&]() {
+      distance(t.data(), a.data(), b.data(), N, FastPrecision());
+      escape(t.data());
+    });
+    run("normalize(Vec3f[])", "batched", N, [&]() {
+      normalize(r.data(), a.data(), N);
+      escape(r.data());
+    });
+    run("normalize(Vec3f[],FastPrecision)", "batched", N, [&]() {
+      normalize(r.data(), a.data(), N, FastPrecision());
+      escape(r.data());
+    });
+    run("min/max(Vec3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = max(min(a[i], b[i]), r[i]);
+      escape(r.data());
+    });
+  }
+
+  void benchMatrixOps(size_t N)
+  {
+    std::vector<Mat3f> A(N), B(N), R(N);
+    std::vector<Mat3x4f> C(N), D(N);
+    std::vector<Mat4f> E(N), F(N);
+    std::vector<Mat3d> Ad(N), Rd(N);
+    std::vector<uint32_t> singular((N + 31) / 32);
+    for (size_t i = 0; i < N; i++) {
+      A[i] = randomMat3f();
+      for (unsigned k = 0; k < 9; k++) Ad[i].data[k] = A[i].data[k];
+      B[i] = randomMat3f();
+      C[i] = randomMat3x4f();
+      E[i] = makeMat4f(randomMat3x4f());
+      E[i].c3r0 = random(-0.1f, 0.1f);
+      E[i].c3r3 = random(1.f, 2.f);
+    }
+
+    run("inverse(Mat3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) R[i] = inverse(A[i]);
+      escape(R.data());
+    });
+    run("inverseTranspose(Mat3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) R[i] = inverseTranspose(A[i]);
+      escape(R.data());
+    });
+    run("inverse(Mat3d)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) Rd[i] = inverse(Ad[i]);
+      escape(Rd.data());
+    });
+    run("inverse(Mat3f[])", "batched", N, [&]() {
+      inverse(R.data(), singular.data(), A.data(), N, 1);
+      escape(R.data());
+    });
+    run("inverse(Mat3f[]) mt", "batched", N, [&]() {
+      inverse(R.data(), singular.data(), A.data(), N, 0);
+      escape(R.data());
+    });
+    run("inverseTranspose(Mat3f[])", "batched", N, [&]() {
+      inverseTranspose(R.data(), singular.data(), A.data(), N, 1);
+      escape(R.data());
+    });
+    run("inverse(Mat3d[])", "batched", N, [&]() {
+      inverse(Rd.data(), singular.data(), Ad.data(), N, 1);
+      escape(Rd.data());
+    });
+    run("inverse(Mat3x4f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) D[i] = inverse(C[i]);
+      escape(D.data());
+    });
+    run("inverse(Mat4f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) F[i] = inverse(E[i]);
+      escape(F.data());
+    });
+    run("inverseAffine(Mat4f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) F[i] = inverseAffine(E[i]);
+      escape(F.data());
+    });
+    run("mul(Mat3f,Mat3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) R[i] = mul(A[i], B[i]);
+      escape(R.data());
+    });
+    run("mul(Mat3x4f,Mat3x4f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) D[i] = mul(C[i], D[i]);
+      escape(D.data());
+    });
+    run("mul(Mat4f,Mat4f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) F[i] = mul(E[i], F[i]);
+      escape(F.data());
+    });
+    run("getScale(Mat3f)", "scalar", N, [&]() {
+      float s = 0.f;
+      for (size_t i = 0; i < N; i++) s += getScale(A[i]);
+      keep(s);
+    });
+    run("getScale(Mat3x4f)", "scalar", N, [&]() {
+      float s = 0.f;
+      for (size_t i = 0; i < N; i++) s += getScale(C[i]);
+      keep(s);
+    });
+    std::vector<float> scales(N);
+    run("getScale(Mat3x4f[])", "batched", N, [&]() {
+      getScale(scales.data(), C.data(), N, 1);
+      escape(scales.data());
+    });
+    run("getScale(Mat3x4f[]) mt", "batched", N, [&]() {
+      getScale(scales.data(), C.data(), N, 0);
+      escape(scales.data());
+    });
+
+    std::vector<Vec3f> sigma(N);
+    run("svd(Mat3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) svd(R[i], sigma[i], B[i], A[i]);
+      escape(R.data());
+    });
+    run("svd(Mat3f[])", "batched", N, [&]() {
+      svd(R.data(), sigma.data(), B.data(), A.data(), N, 1);
+      escape(R.data());
+    });
+    run("polarDecomposition(Mat3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) polarDecomposition(R[i], B[i], A[i]);
+      escape(R.data());
+    });
+    run("polarDecomposition(Mat3f[])", "batched", N, [&]() {
+      polarDecomposition(R.data(), B.data(), A.data(), N, 1);
+      escape(R.data());
+    });
+  }
+
+  void benchTransforms(size_t N)
+  {
+    Mat3x4f M = randomMat3x4f();
+    std::vector<Mat3x4f> Ms(N);
+    std::vector<Vec3f> p(N), q(N);
+    std::vector<float> interleaved(8 * N);
+    std::vector<BBox3f> b(N), c(N);
+    for (size_t i = 0; i < N; i++) {
+      Ms[i] = randomMat3x4f();
+      p[i] = randomVec3f(-100.f, 100.f);
+      write(interleaved.data() + 8 * i, p[i]);
+      b[i] = randomBBox3f(100.f, 1.f);
+    }
+
+    run("mul(Mat3x4f,Vec3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) q[i] = mul(M, p[i]);
+      escape(q.data());
+    });
+    run("mul(Mat3x4f,Vec3f)", "batched", N, [&]() {
+      transform(q.data(), M, p.data(), N, 1);
+      escape(q.data());
+    });
+    run("mul(Mat3x4f,Vec3f) mt", "batched", N, [&]() {
+      transform(q.data(), M, p.data(), N, 0);
+      escape(q.data());
+    });
+    run("mul(Mat3x4f,Vec3f) stride", "batched", N, [&]() {
+      transform(interleaved.data(), 8 * sizeof(float), M, interleaved.data(), 8 * sizeof(float), N);
+      escape(interleaved.data());
+    });
+    // Filled before the runs that read it, so that --filter can select them alone.
+    Vec3SoAf soa, soaOut;
+    convert(soa, makeVec3View(p.data(), N), 1);
+    run("convert(Vec3SoAf,Vec3f[])", "batched", N, [&]() {
+      convert(soa, makeVec3View(p.data(), N), 1);
+      escape(soa.x());
+    });
+    run("convert(Vec3SoAf,interleaved)", "batched", N, [&]() {
+      convert(soa, makeVec3View<const float>(interleaved.data(), 8 * sizeof(float), N), 1);
+      escape(soa.x());
+    });
+    run("convert(Vec3f[],Vec3SoAf)", "batched", N, [&]() {
+      convert(makeVec3View(q.data(), N), soa, 1);
+      escape(q.data());
+    });
+    run("mul(Mat3x4f,Vec3f) SoA", "batched", N, [&]() {
+      transform(soaOut, M, soa, 1);
+      escape(soaOut.x());
+    });
+    run("transform(Mat3x4f,BBox3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) c[i] = transform(M, b[i]);
+      escape(c.data());
+    });
+    run("transform(Mat3x4f,BBox3f)", "batched", N, [&]() {
+      transform(c.data(), M, b.data(), N, 1);
+      escape(c.data());
+    });
+    run("transform(Mat3x4f,BBox3f) mt", "batched", N, [&]() {
+      transform(c.data(), M, b.data(), N, 0);
+      escape(c.data());
+    });
+    run("transform(Mat3x4f[],BBox3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) c[i] = transform(Ms[i], b[i]);
+      escape(c.data());
+    });
+    run("transform(Mat3x4f[],BBox3f)", "batched", N, [&]() {
+      transform(c.data(), Ms.data(), b.data(), N, 1);
+      escape(c.data());
+    });
+    run("transform(Mat3x4f[],BBox3f) mt", "batched", N, [&]() {
+      transform(c.data(), Ms.data(), b.data(), N, 0);
+      escape(c.data());
+    });
+  }
+
+  void benchBounds(size_t N)
+  {
+    std::vector<Vec3f> p(N);
+    std::vector<Vec3d> pd(N);
+    for (size_t i = 0; i < N; i++) {
+      p[i] = randomVec3f(-100.f, 100.f);
+      pd[i] = makeVec3d(p[i].x, p[i].y, p[i].z);
+    }
+
+    run("engulf(BBox3f,Vec3f)", "scalar", N, [&]() {
+      BBox3f b = makeEmptyBBox3f();
+      for (size_t i = 0; i < N; i++) b = engulf(b, p[i]);
+      keep(b);
+    });
+    run("engulf(BBox3f,Vec3f)", "batched", N, [&]() {
+      keep(engulf(makeEmptyBBox3f(), p.data(), N, 1));
+    });
+    run("engulf(BBox3f,Vec3f) mt", "batched", N, [&]() {
+      keep(engulf(makeEmptyBBox3f(), p.data(), N, 0));
+    });
+    std::vector<BBox3f> b(N);
+    for (size_t i = 0; i < N; i++) b[i] = randomBBox3f(100.f, 1.f);
+    run("engulf(BBox3f,BBox3f)", "scalar", N, [&]() {
+      BBox3f r = makeEmptyBBox3f();
+      for (size_t i = 0; i < N; i++) r = engulf(r, b[i]);
+      keep(r);
+    });
+    run("engulf(BBox3f,BBox3f)", "batched", N, [&]() {
+      keep(engulf(makeEmptyBBox3f(), b.data(), N, 1));
+    });
+    run("engulf(BBox3f,BBox3f) mt", "batched", N, [&]() {
+      keep(engulf(makeEmptyBBox3f(), b.data(), N, 0));
+    });
+    run("engulf(BBox3d,Vec3d)", "scalar", N, [&]() {
+      BBox3d b = makeEmptyBBox3d();
+      for (size_t i = 0; i < N; i++) b = engulf(b, pd[i]);
+      keep(b);
+    });
+    run("engulf(BBox3d,Vec3d)", "batched", N, [&]() {
+      keep(engulf(makeEmptyBBox3d(), pd.data(), N, 1));
+    });
+  }
+
+  void benchStorageFormats(size_t N)
+  {
+    Mat3x4f M = randomMat3x4f();
+    BBox3f frame = makeBBox(makeVec3f(-100.f), makeVec3f(100.f));
+    std::vector<Vec3f> p(N), n(N), q(N);
+    std::vector<Vec3h> h(N);
+    std::vector<Vec3us> u(N);
+    std::vector<Vec2s> o(N);
+    for (size_t i = 0; i < N; i++) {
+      p[i] = randomVec3f(-100.f, 100.f);
+      n[i] = normalize(randomVec3f(-1.f, 1.f));
+    }
+    convert(h.data(), p.data(), N);
+    quantize(u.data(), frame, p.data(), N);
+    encodeOctahedral(o.data(), n.data(), N);
+
+    run("makeVec3h", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) h[i] = makeVec3h(p[i]);
+      escape(h.data());
+    });
+    run("makeVec3h", "batched", N, [&]() {
+      convert(h.data(), p.data(), N);
+      escape(h.data());
+    });
+    run("makeVec3f(Vec3h)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) q[i] = makeVec3f(h[i]);
+      escape(q.data());
+    });
+    run("makeVec3f(Vec3h)", "batched", N, [&]() {
+      convert(q.data(), h.data(), N);
+      escape(q.data());
+    });
+    run("quantize", "batched", N, [&]() {
+      quantize(u.data(), frame, p.data(), N);
+      escape(u.data());
+    });
+    run("dequantize", "batched", N, [&]() {
+      dequantize(q.data(), frame, u.data(), N);
+      escape(q.data());
+    });
+    run("encodeOctahedral", "batched", N, [&]() {
+      encodeOctahedral(o.data(), n.data(), N);
+      escape(o.data());
+    });
+    run("decodeOctahedral", "batched", N, [&]() {
+      decodeOctahedral(q.data(), o.data(), N);
+      escape(q.data());
+    });
+    run("transform(Vec3h)", "batched", N, [&]() {
+      transform(q.data(), M, h.data(), N);
+      escape(q.data());
+    });
+    run("transform(Vec3us)", "batched", N, [&]() {
+      transform(q.data(), M, frame, u.data(), N);
+      escape(q.data());
+    });
+  }
+
+  void benchQuaternions(size_t N)
+  {
+    std::vector<Quatf> a(N), b(N), r(N);
+    std::vector<Vec3f> p(N), q(N);
+    for (size_t i = 0; i < N; i++) {
+      a[i] = randomQuatf();
+      b[i] = randomQuatf();
+      p[i] = randomVec3f(-1.f, 1.f);
+    }
+
+    run("mul(Quatf,Vec3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) q[i] = mul(a[i], p[i]);
+      escape(q.data());
+    });
+    run("mul(Quatf,Quatf)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = mul(a[i], b[i]);
+      escape(r.data());
+    });
+    run("nlerp(Quatf)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = nlerp(a[i], b[i], 0.3f);
+      escape(r.data());
+    });
+    run("slerp(Quatf)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) r[i] = slerp(a[i], b[i], 0.3f);
+      escape(r.data());
+    });
+
+    const unsigned boneCount = 64;
+    std::vector<Mat3x4f> M(boneCount);
+    std::vector<DualQuatf> D(boneCount);
+    for (unsigned k = 0; k < boneCount; k++) {
+      D[k] = makeDualQuatf(randomQuatf(), randomVec3f(-1.f, 1.f));
+      M[k] = makeMat3x4f(D[k]);
+    }
+    std::vector<Vec4u> bones(N);
+    std::vector<Vec4f> weights(N);
+    for (size_t i = 0; i < N; i++) {
+      for (unsigned k = 0; k < 4; k++) bones[i][k] = unsigned(random01() * boneCount) % boneCount;
+      weights[i] = makeVec4f(0.4f, 0.3f, 0.2f, 0.1f);
+    }
+    run("skinLinear", "batched", N, [&]() {
+      skinLinear(q.data(), p.data(), bones.data(), weights.data(), M.data(), N, 1);
+      escape(q.data());
+    });
+    run("skinDualQuat", "batched", N, [&]() {
+      skinDualQuat(q.data(), p.data(), bones.data(), weights.data(), D.data(), N, 1);
+      escape(q.data());
+    });
+  }
+
+  void benchRays(size_t N)
+  {
+    std::vector<BBox3f> boxes(N);
+    std::vector<Ray3f> rays(N);
+    for (size_t i = 0; i < N; i++) {
+      boxes[i] = randomBBox3f(10.f, 1.f);
+      rays[i] = makeRay3f(randomVec3f(-10.f, 10.f), randomVec3f(-1.f, 1.f));
+    }
+    std::vector<uint32_t> hits((N + 31) / 32);
+    std::vector<float> t(N);
+
+    run("intersect(Ray3f,BBox3f)", "scalar", N, [&]() {
+      uint32_t count = 0;
+      for (size_t i = 0; i < N; i++) count += intersect(t[i], rays[0], boxes[i], 0.f, 100.f) ? 1 : 0;
+      keep(count);
+    });
+    run("intersect(Ray3f,BBox3f[])", "batched", N, [&]() {
+      intersect(hits.data(), t.data(), rays[0], boxes.data(), N, 0.f, 100.f);
+      escape(hits.data());
+    });
+    run("intersect(Ray3f[],BBox3f)", "batched", N, [&]() {
+      intersect(hits.data(), t.data(), rays.data(), N, boxes[0], 0.f, 100.f);
+      escape(hits.data());
+    });
+  }
+
+  void benchCulling(size_t N)
+  {
+    std::vector<BBox3f> boxes(N);
+    for (size_t i = 0; i < N; i++) boxes[i] = randomBBox3f(100.f, 2.f);
+
+    // 90 degree perspective looking down -z from a few positions.
+    const float n = 1.f, f = 100.f;
+    const float P[16] = { 1.f, 0.f, 0.f, 0.f,  0.f, 1.f, 0.f, 0.f,  0.f, 0.f, -(f + n) / (f - n), -1.f,  0.f, 0.f, -2.f * f * n / (f - n), 0.f };
+    const size_t V = 4;
+    Frustumf frustums[V];
+    for (size_t v = 0; v < V; v++) {
+      Mat4f M = makeMat4f(P);
+      M.c3r0 = 20.f * v - 30.f;
+      frustums[v] = makeFrustumf(M);
+    }
+    std::vector<Containment> result(N);
+    std::vector<uint32_t> visible(V * N);
+    uint32_t* lists[V];
+    for (size_t v = 0; v < V; v++) lists[v] = visible.data() + v * N;
+    size_t counts[V];
+
+    run("classify(Frustumf,BBox3f)", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) result[i] = classify(frustums[0], boxes[i]);
+      escape(result.data());
+    });
+    run("classify(Frustumf,BBox3f[])", "batched", N, [&]() {
+      classify(result.data(), frustums[0], boxes.data(), N);
+      escape(result.data());
+    });
+    run("cull(Frustumf,BBox3f[])", "batched", N, [&]() {
+      keep(cull(lists[0], frustums[0], boxes.data(), N));
+    });
+    run("cull(Frustumf[4],BBox3f[])", "batched", N, [&]() {
+      cull(counts, lists, frustums, V, boxes.data(), N);
+      escape(counts);
+    });
+  }
+
+  // Load an instance table of transforms and bounds and merge the bounds,
+  // reading into arrays versus mapping the file.
+  void benchArrayFile(size_t N)
+  {
+    if (!enabled("ArrayFile")) return;
+
+    const char* path = "cdmath-bench-arrays.bin";
+    std::vector<Mat3x4f> transforms(N);
+    std::vector<BBox3f> bounds(N);
+    for (size_t i = 0; i < N; i++) {
+      transforms[i] = randomMat3x4f();
+      bounds[i] = randomBBox3f(100.f, 1.f);
+    }
+    ArrayFileWriter writer;
+    open(writer, path);
+    writeArray(writer, "transforms", transforms.data(), N);
+    writeArray(writer, "bounds", bounds.data(), N);
+    if (close(writer) != ArrayFileError::None) {
+      std::fprintf(stderr, "Failed to write %s\n", path);
+      return;
+    }
+
+    run("ArrayFile load", "copy", N, [&]() {
+      ArrayFile file;
+      open(file, path);
+      const Mat3x4f* t = nullptr;
+      const BBox3f* b = nullptr;
+      size_t n = 0;
+      findArray(t, n, file, "transforms");
+      std::vector<Mat3x4f> tc(t, t + n);
+      findArray(b, n, file, "bounds");
+      std::vector<BBox3f> bc(b, b + n);
+      close(file);
+      keep(engulf(makeEmptyBBox3f(), bc.data(), n, 1));
+      escape(tc.data());
+    });
+    run("ArrayFile load", "mapped", N, [&]() {
+      ArrayFile file;
+      open(file, path);
+      const Mat3x4f* t = nullptr;
+      const BBox3f* b = nullptr;
+      size_t n = 0;
+      findArray(t, n, file, "transforms");
+      findArray(b, n, file, "bounds");
+      keep(engulf(makeEmptyBBox3f(), b, n, 1));
+      escape(t);
+      close(file);
+    });
+    std::remove(path);
+  }
+
+  // Shallow random scene, recomputing everything versus 1% of the nodes moving.
+  void benchTransformHierarchy(size_t N)
+  {
+    if (!enabled("TransformHierarchy")) return;
+
+    std::vector<uint32_t> parents(N);
+    std::vector<Mat3x4f> local(N);
+    std::vector<BBox3f> bounds(N);
+    for (size_t i = 0; i < N; i++) {
+      parents[i] = i < 16 ? noParent : uint32_t(random01() * float(i / 4));
+      local[i] = randomMat3x4f();
+      bounds[i] = randomBBox3f(1.f, 1.f);
+    }
+    TransformHierarchy h;
+    build(h, parents.data(), local.data(), bounds.data(), N);
+
+    const size_t moving = N / 100;
+    std::vector<uint32_t> moved(moving);
+    for (size_t i = 0; i < moving; i++) moved[i] = uint32_t(random01() * float(N - 1));
+
+    run("TransformHierarchy update all", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) {
+        h.world[i] = parents[i] == noParent ? h.local[i] : mul(h.world[parents[i]], h.local[i]);
+        h.worldBounds[i] = transform(h.world[i], h.localBounds[i]);
+      }
+      escape(h.worldBounds.data());
+    });
+    run("TransformHierarchy update all", "batched", N, [&]() {
+      for (size_t i = 0; i < 16; i++) setLocal(h, uint32_t(i), h.local[i]);
+      keep(update(h));
+    });
+    run("TransformHierarchy update 1%", "batched", N, [&]() {
+      for (uint32_t i : moved) setLocal(h, i, h.local[i]);
+      keep(update(h));
+    });
+  }
+
+  void benchUniformGrid(size_t N)
+  {
+    if (!enabled("UniformGrid")) return;
+
+    // About one item per cell.
+    float extent = 0.5f * std::cbrt(float(N));
+    std::vector<Vec3f> points(N);
+    std::vector<BBox3f> boxes(N);
+    for (size_t i = 0; i < N; i++) {
+      points[i] = randomVec3f(-extent, extent);
+      boxes[i] = randomBBox3f(extent, 0.5f);
+    }
+
+    UniformGrid grid;
+    run("UniformGrid build points", "batched", N, [&]() {
+      build(grid, points.data(), N, 1.f, 1);
+      escape(grid.items.data());
+    });
+    run("UniformGrid build points mt", "batched", N, [&]() {
+      build(grid, points.data(), N, 1.f, 0);
+      escape(grid.items.data());
+    });
+
+    const size_t Q = 1 << 16;
+    std::vector<Vec3f> centers(Q);
+    std::vector<BBox3f> queries(Q);
+    for (size_t i = 0; i < Q; i++) {
+      centers[i] = randomVec3f(-extent, extent);
+      queries[i] = randomBBox3f(extent, 2.f);
+    }
+    std::vector<uint32_t> hits;
+    run("UniformGrid findWithinRadius points", "scalar", Q, [&]() {
+      hits.clear();
+      for (size_t i = 0; i < Q; i++) findWithinRadius(hits, grid, centers[i], 1.f);
+      keep(hits.size());
+    });
+
+    run("UniformGrid build boxes", "batched", N, [&]() {
+      build(grid, boxes.data(), N, 1.f, 1);
+      escape(grid.items.data());
+    });
+    run("UniformGrid findOverlapping boxes", "scalar", Q, [&]() {
+      hits.clear();
+      for (size_t i = 0; i < Q; i++) findOverlapping(hits, grid, queries[i]);
+      keep(hits.size());
+    });
+  }
+
+  void benchKdTree(size_t N)
+  {
+    if (!enabled("KdTree")) return;
+
+    float extent = 0.5f * std::cbrt(float(N));
+    std::vector<Vec3f> points(N);
+    for (size_t i = 0; i < N; i++) points[i] = randomVec3f(-extent, extent);
+
+    KdTreef tree;
+    run("KdTree build", "batched", N, [&]() {
+      build(tree, points.data(), N, 1);
+      escape(tree.indices.data());
+    });
+    run("KdTree build mt", "batched", N, [&]() {
+      build(tree, points.data(), N, 0);
+      escape(tree.indices.data());
+    });
+
+    const size_t Q = 1 << 16;
+    const size_t k = 8;
+    std::vector<Vec3f> queries(Q);
+    for (size_t i = 0; i < Q; i++) queries[i] = randomVec3f(-extent, extent);
+    std::vector<uint32_t> indices(Q * k);
+    std::vector<float> distances(Q * k);
+    run("KdTree findNearest k=8", "scalar", Q, [&]() {
+      for (size_t i = 0; i < Q; i++) findNearest(indices.data() + i * k, distances.data() + i * k, tree, queries[i], k);
+      escape(indices.data());
+    });
+    run("KdTree findNearest k=8", "batched", Q, [&]() {
+      findNearest(indices.data(), distances.data(), tree, queries.data(), Q, k, 1);
+      escape(indices.data());
+    });
+    run("KdTree findNearest k=8 mt", "batched", Q, [&]() {
+      findNearest(indices.data(), distances.data(), tree, queries.data(), Q, k, 0);
+      escape(indices.data());
+    });
+
+    std::vector<uint32_t> hits;
+    std::vector<size_t> start;
+    run("KdTree findWithinRadius", "scalar", Q, [&]() {
+      hits.clear();
+      for (size_t i = 0; i < Q; i++) findWithinRadius(hits, tree, queries[i], 1.f);
+      keep(hits.size());
+    });
+    run("KdTree findWithinRadius", "batched", Q, [&]() {
+      findWithinRadius(hits, start, tree, queries.data(), Q, 1.f, 0);
+      keep(hits.size());
+    });
+  }
+
+  void benchSpatialSort(size_t N)
+  {
+    if (!enabled("SpatialSort")) return;
+
+    std::vector<Vec3f> points(N);
+    for (size_t i = 0; i < N; i++) points[i] = randomVec3f(-1.f, 1.f);
+    BBox3f frame = makeBBox(makeVec3f(-1.f), makeVec3f(1.f));
+    std::vector<uint32_t> keys(N);
+    std::vector<uint64_t> keys64(N);
+
+    run("SpatialSort mortonKey", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) keys[i] = mortonKey(frame, points[i]);
+      escape(keys.data());
+    });
+    run("SpatialSort mortonKey", "batched", N, [&]() {
+      mortonKey(keys.data(), frame, points.data(), N, 1);
+      escape(keys.data());
+    });
+    run("SpatialSort hilbertKey", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) keys[i] = hilbertKey(frame, points[i]);
+      escape(keys.data());
+    });
+    run("SpatialSort hilbertKey", "batched", N, [&]() {
+      hilbertKey(keys.data(), frame, points.data(), N, 1);
+      escape(keys.data());
+    });
+    run("SpatialSort hilbertKey64", "batched", N, [&]() {
+      hilbertKey(keys64.data(), frame, points.data(), N, 1);
+      escape(keys64.data());
+    });
+
+    // Sorting resets the keys and indices first, which is included in the time.
+    std::vector<uint32_t> sorted(N), indices(N);
+    std::vector<uint64_t> sorted64(N);
+    RadixSortScratch scratch;
+    run("SpatialSort std::stable_sort", "scalar", N, [&]() {
+      for (size_t i = 0; i < N; i++) indices[i] = uint32_t(i);
+      std::stable_sort(indices.begin(), indices.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+      escape(indices.data());
+    });
+    run("SpatialSort radixSort", "batched", N, [&]() {
+      std::memcpy(sorted.data(), keys.data(), N * sizeof(uint32_t));
+      for (size_t i = 0; i < N; i++) indices[i] = uint32_t(i);
+      radixSort(scratch, sorted.data(), indices.data(), N, 1);
+      escape(indices.data());
+    });
+    run("SpatialSort radixSort mt", "batched", N, [&]() {
+      std::memcpy(sorted.data(), keys.data(), N * sizeof(uint32_t));
+      for (size_t i = 0; i < N; i++) indices[i] = uint32_t(i);
+      radixSort(scratch, sorted.data(), indices.data(), N, 0);
+      escape(indices.data());
+    });
+    run("SpatialSort radixSort 64", "batched", N, [&]() {
+      std::memcpy(sorted64.data(), keys64.data(), N * sizeof(uint64_t));
+      for (size_t i = 0; i < N; i++) indices[i] = uint32_t(i);
+      radixSort(scratch, sorted64.data(), indices.data(), N, 1);
+      escape(indices.data());
+    });
+    std::vector<Vec3f> reordered(N);
+    run("SpatialSort gather", "batched", N, [&]() {
+      gather(reordered.data(), points.data(), indices.data(), N, 1);
+      escape(reordered.data());
+    });
+  }
+
+  void benchTileBins(size_t N)
+  {
+    if (!enabled("TileBins")) return;
+
+    // Boxes up to 64 pixels on a 1920 x 1080 screen with 16 pixel tiles.
+    const uint32_t columns = 120, rows = 68;
+    const Vec2f origin = makeVec2f(0.f), tileSize = makeVec2f(16.f);
+    std::vector<BBox2f> boxes(N);
+    for (size_t i = 0; i < N; i++) {
+      Vec3f a = randomVec3f(0.f, 1920.f);
+      Vec3f d = randomVec3f(0.f, 64.f);
+      boxes[i] = makeBBox(makeVec2f(a.x, 0.5625f * a.y), makeVec2f(a.x + d.x, 0.5625f * a.y + d.y));
+    }
+
+    std::vector<std::vector<uint32_t>> tiles(columns * rows);
+    run("TileBins build", "scalar", N, [&]() {
+      for (auto& tile : tiles) tile.clear();
+      for (size_t i = 0; i < N; i++) {
+        const BBox2f& b = boxes[i];
+        int x0 = std::max(int(std::floor(b.min.x / tileSize.x)), 0), x1 = std::min(int(std::floor(b.max.x / tileSize.x)), int(columns) - 1);
+        int y0 = std::max(int(std::floor(b.min.y / tileSize.y)), 0), y1 = std::min(int(std::floor(b.max.y / tileSize.y)), int(rows) - 1);
+        for (int y = y0; y <= y1; y++) {
+          for (int x = x0; x <= x1; x++) tiles[y * columns + x].push_back(uint32_t(i));
+        }
+      }
+      escape(tiles.data());
+    });
+
+    TileBins bins;
+    run("TileBins build", "batched", N, [&]() {
+      build(bins, boxes.data(), N, origin, tileSize, columns, rows, 1);
+      escape(bins.items.data());
+    });
+    run("TileBins build mt", "batched", N, [&]() {
+      build(bins, boxes.data(), N, origin, tileSize, columns, rows, 0);
+      escape(bins.items.data());
+    });
+  }
+
+  void benchBVH(size_t N)
+  {
+    if (!enabled("BVH")) return;
+
+    std::vector<BBox3f> boxes(N);
+    float extent = 1000.f;
+    for (size_t i = 0; i < N; i++) boxes[i] = randomBBox3f(extent, 2.f);
+
+    BVH bvh;
+    unsigned buildIterations = 3;
+    run("BVH build", "batched", N, [&]() {
+      build(bvh, boxes.data(), N);
+      escape(bvh.nodes.data());
+    }, buildIterations);
+    build(bvh, boxes.data(), N);
+
+    const size_t Q = 1 << 16;
+    std::vector<BBox3f> queries(Q);
+    std::vector<Vec3f> points(Q);
+    for (size_t i = 0; i < Q; i++) {
+      queries[i] = randomBBox3f(extent, 20.f);
+      points[i] = randomVec3f(-extent, extent);
+    }
+    std::vector<uint32_t> hits;
+    run("BVH findOverlapping", "scalar", Q, [&]() {
+      hits.clear();
+      for (size_t i = 0; i < Q; i++) findOverlapping(hits, bvh, queries[i]);
+      keep(hits.size());
+    });
+    run("BVH findContaining", "scalar", Q, [&]() {
+      hits.clear();
+      for (size_t i = 0; i < Q; i++) findContaining(hits, bvh, points[i]);
+      keep(hits.size());
+    });
+  }
+
+  void benchSweepAndPrune(size_t N)
+  {
+    if (!enabled("SweepAndPrune")) return;
+
+    std::vector<BBox3f> boxes(N);
+    float extent = 100.f * std::cbrt(float(N));
+    for (size_t i = 0; i < N; i++) boxes[i] = randomBBox3f(extent, 20.f);
+
+    SweepAndPrune sap;
+    std::vector<Vec2u> pairs;
+    update(pairs, sap, boxes.data(), N);
+    run("SweepAndPrune update", "batched", N, [&]() {
+      for (BBox3f& b : boxes) {
+        Vec3f d = randomVec3f(-0.5f, 0.5f);
+        b = makeBBox(b.min + d, b.max + d);
+      }
+      update(pairs, sap, boxes.data(), N);
+      keep(pairs.size());
+    });
+  }
+
+  void writeJSON(const char* path)
+  {
+    FILE* f = std::fopen(path, "w");
+    if (f == nullptr) {
+      std::fprintf(stderr, "Failed to open %s for writing\n", path);
+      std::exit(EXIT_FAILURE);
+    }
+    std::fprintf(f, "{\n");
+#if defined(__VERSION__)
+    std::fprintf(f, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    std::fprintf(f, "  \"warmup\": %u,\n", options.warmup);
+    std::fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result& r = results[i];
+      std::fprintf(f, "    { \"name\": \"%s\", \"variant\": \"%s\", \"n\": %zu, \"iterations\": %u, "
+                      "\"ns_per_op_min\": %.4f, \"ns_per_op_median\": %.4f, \"ops_per_sec\": %.1f }%s\n",
+                   r.name.c_str(), r.variant.c_str(), r.n, r.iterations,
+                   r.nsMin, r.nsMedian, 1e9 / r.nsMedian,
+                   i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    std::fclose(f);
+  }
+
+  void usage(const char* name)
+  {
+    std::fprintf(stderr, "Usage: %s [--json file] [--filter substring] [--size N] [--bvh-size N] [--warmup N] [--iterations N]\n", name);
+    std::exit(EXIT_FAILURE);
+  }
+
+}
+
+
+int main(int argc, char** argv)
+{
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 == argc) usage(argv[0]);
+    const char* value = argv[++i];
+    if (arg == "--json") options.json = value;
+    else if (arg == "--filter") options.filter = value;
+    else if (arg == "--size") options.size = std::strtoull(value, nullptr, 10);
+    else if (arg == "--bvh-size") options.bvhSize = std::strtoull(value, nullptr, 10);
+    else if (arg == "--warmup") options.warmup = unsigned(std::strtoul(value, nullptr, 10));
+    else if (arg == "--iterations") options.iterations = unsigned(std::strtoul(value, nullptr, 10));
+    else usage(argv[0]);
+  }
+  if (options.size == 0 || options.iterations == 0) usage(argv[0]);
+
+  benchVectorOps(options.size);
+  benchMatrixOps(options.size);
+  benchTransforms(options.size);
+  benchBounds(options.size);
+  benchStorageFormats(options.size);
+  benchQuaternions(options.size);
+  benchRays(options.size);
+  benchCulling(options.size);
+  benchArrayFile(options.size);
+  benchTransformHierarchy(options.size);
+  benchUniformGrid(options.size);
+  benchKdTree(options.size);
+  benchSpatialSort(options.size);
+  benchTileBins(options.size);
+  benchSweepAndPrune(options.size / 4);
+  benchBVH(options.bvhSize);
+
+  if (options.json) writeJSON(options.json);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// BVH queries against testing every box, and builds on one and on several threads.
+#include <algorithm>
+#include <vector>
+#include "check.h"
+#include "BVH.h"
+
+namespace {
+
+  // Boxes of varied sizes, with empty boxes, runs of identical boxes that
+  // no split plane separates, and boxes sharing faces.
+  std::vector<BBox3f> makeBoxes(size_t N)
+  {
+    std::vector<BBox3f> bboxes(N);
+    for (size_t i = 0; i < N; i++) {
+      bboxes[i] = randomBBox3f(100.f, i % 7 ? 5.f : 40.f);
+      if (i % 97 == 3) bboxes[i] = makeEmptyBBox3f();
+      if (i % 61 == 5) bboxes[i] = bboxes[i - 1];
+    }
+    for (size_t i = N / 2; i < N / 2 + 20 && i < N; i++) bboxes[i] = bboxes[N / 2];
+    for (size_t i = 1; i + 10 < N; i += 113) {
+      bboxes[i + 1] = makeBBox(makeVec3f(bboxes[i].max.x, bboxes[i].min.y, bboxes[i].min.z), bboxes[i].max + makeVec3f(3.f, 0.f, 0.f));
+    }
+    return bboxes;
+  }
+
+  // Leaves hold 1 to 4 boxes and cover each box once. SAH splits few of
+  // the ranges of 4 boxes or more, so leaves average well above 2 boxes.
+  bool hasCompactLeaves(const BVH& bvh)
+  {
+    std::vector<uint32_t> covered(bvh.indices.size(), 0);
+    size_t leaves = 0;
+    for (size_t i = 0; i < bvh.nodes.size(); i++) {
+      const BVHNode& node = bvh.nodes[i];
+      if (i == 1 || node.count == 0) continue;
+      if (4 < node.count || bvh.indices.size() < size_t(node.first) + node.count) return false;
+      for (uint32_t k = node.first; k < node.first + node.count; k++) covered[k]++;
+      leaves++;
+    }
+    for (uint32_t c : covered) {
+      if (c != 1) return false;
+    }
+    return 2 * leaves < bvh.indices.size();
+  }
+
+  std::vector<uint32_t> sorted(std::vector<uint32_t> a)
+  {
+    std::sort(a.begin(), a.end());
+    return a;
+  }
+
+  void checkQueries(const std::vector<BBox3f>& bboxes, const char* overlapping, const char* containing)
+  {
+    BVH bvh;
+    build(bvh, bboxes.data(), bboxes.size(), 1);
+
+    std::vector<BBox3f> queries;
+    for (size_t q = 0; q < 200; q++) queries.push_back(randomBBox3f(110.f, q % 3 ? 20.f : 2.f));
+    queries.push_back(makeEmptyBBox3f());
+    queries.push_back(makeBBox(makeVec3f(-1000.f), makeVec3f(1000.f)));
+    for (size_t i = 0; i < bboxes.size() && i < 50; i++) queries.push_back(bboxes[i]);
+
+    bool ok = true;
+    std::vector<uint32_t> found, expected;
+    for (const BBox3f& query : queries) {
+      found.clear();
+      expected.clear();
+      findOverlapping(found, bvh, query);
+      for (size_t i = 0; i < bboxes.size(); i++) {
+        if (isOverlapping(bboxes[i], query)) expected.push_back(uint32_t(i));
+      }
+      ok = ok && sorted(found) == expected;
+    }
+    check(ok, overlapping);
+
+    // Random points, and the corners of the boxes, which are inside them.
+    std::vector<Vec3f> points;
+    for (size_t q = 0; q < 200; q++) points.push_back(randomVec3f(-110.f, 110.f));
+    for (size_t i = 0; i < bboxes.size() && i < 50; i++) {
+      if (isEmpty(bboxes[i])) continue;
+      points.push_back(bboxes[i].min);
+      points.push_back(bboxes[i].max);
+    }
+
+    ok = true;
+    for (const Vec3f& p : points) {
+      found.clear();
+      expected.clear();
+      findContaining(found, bvh, p);
+      for (size_t i = 0; i < bboxes.size(); i++) {
+        if (isInside(bboxes[i], p)) expected.push_back(uint32_t(i));
+      }
+      ok = ok && sorted(found) == expected;
+    }
+    check(ok, containing);
+  }
+
+}
+
+
+void checkBVH()
+{
+  setCheckSection("BVH");
+
+  for (size_t N : { 0, 1, 2, 5 }) {
+    checkQueries(makeBoxes(N), "findOverlapping of a few boxes", "findContaining of a few boxes");
+  }
+  checkQueries(makeBoxes(5000), "findOverlapping", "findContaining");
+  checkQueries(std::vector<BBox3f>(300, makeBBox(makeVec3f(1.f), makeVec3f(2.f))),
+               "findOverlapping of identical boxes", "findContaining of identical boxes");
+
+  // Large enough that subtrees are built on several threads.
+  std::vector<BBox3f> bboxes(300000);
+  for (BBox3f& b : bboxes) b = randomBBox3f(100.f, 2.f);
+  BVH bvh1, bvhN;
+  build(bvh1, bboxes.data(), bboxes.size(), 1);
+  build(bvhN, bboxes.data(), bboxes.size(), 0);
+  check(bvh1.nodes.size() == bvhN.nodes.size() && sameBytes(bvh1.nodes.data(), bvhN.nodes.data(), bvh1.nodes.size()) &&
+        sameBytes(bvh1.indices, bvhN.indices), "build on several threads");
+  check(hasCompactLeaves(bvh1), "leaves of 1 to 4 boxes, 2 or more on average");
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "LinAlg.h"
+#include "LinAlgOps.h"
+
+// Helpers of the regression checks. Each file in test/ checks one part of
+// the library, and main.cpp runs them all.
+
+
+/** Count and print a failed check, what names it. */
+void check(bool ok, const char* what);
+
+/** Name printed with the failed checks that follow. */
+void setCheckSection(const char* section);
+
+// The checks of each file, in the order main runs them.
+void checkBatchLevels();        // batch.cpp
+void checkOps();                // ops.cpp
+void checkParallel();           // parallel.cpp
+void checkArrayFile(const char* path); // arrayfile.cpp
+void checkTransformHierarchy(); // hierarchy.cpp
+void checkUniformGrid();        // grid.cpp
+void checkKdTree();             // kdtree.cpp
+void checkRadixSort();          // radixsort.cpp
+void checkTileBins();           // tilebins.cpp
+void checkInstrument();         // instrument.cpp
+void checkBVH();                // bvh.cpp
+void checkSweepAndPrune();      // sweepandprune.cpp
+
+
+/** Same bits, where any two NaNs are the same. */
+inline bool same(float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0 || (a != a && b != b); }
+inline bool same(double a, double b) { return std::memcmp(&a, &b, sizeof(double)) == 0 || (a != a && b != b); }
+
+/** Arrays of N elements made of floats or doubles, compared with same. */
+template<typename S, typename T>
+bool sameScalars(const T* a, const T* b, size_t N)
+{
+  const size_t n = sizeof(T) / sizeof(S);
+  const S* p = reinterpret_cast<const S*>(a);
+  const S* q = reinterpret_cast<const S*>(b);
+  for (size_t i = 0; i < n * N; i++) {
+    if (!same(p[i], q[i])) return false;
+  }
+  return true;
+}
+template<typename T> bool sameFloats(const T* a, const T* b, size_t N) { return sameScalars<float>(a, b, N); }
+template<typename T> bool sameDoubles(const T* a, const T* b, size_t N) { return sameScalars<double>(a, b, N); }
+template<typename T> bool sameFloats(const std::vector<T>& a, const std::vector<T>& b) { return a.size() == b.size() && sameFloats(a.data(), b.data(), a.size()); }
+
+/** Integers and halves, compared as bytes. */
+template<typename T> bool sameBytes(const T* a, const T* b, size_t N) { return N == 0 || std::memcmp(a, b, sizeof(T) * N) == 0; }
+template<typename T> bool sameBytes(const std::vector<T>& a, const std::vector<T>& b) { return a.size() == b.size() && sameBytes(a.data(), b.data(), a.size()); }
+
+
+/** Deterministic random numbers, so that a failure repeats. */
+inline uint32_t randomSeed = 1;
+inline float random01()
+{
+  randomSeed = randomSeed * 1664525u + 1013904223u;
+  return float(randomSeed >> 8) * (1.f / float(1 << 24));
+}
+inline float random(float a, float b) { return a + (b - a) * random01(); }
+inline Vec2f randomVec2f(float a, float b) { return makeVec2f(random(a, b), random(a, b)); }
+inline Vec3f randomVec3f(float a, float b) { return makeVec3f(random(a, b), random(a, b), random(a, b)); }
+
+inline Quatf randomQuatf()
+{
+  return normalize(makeQuatf(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f)));
+}
+
+inline Mat3f randomMat3f()
+{
+  Mat3f M;
+  for (float& v : M.data) v = random(-1.f, 1.f);
+  return M;
+}
+
+inline Mat3x4f randomMat3x4f()
+{
+  Mat3f R = randomMat3f();
+  return makeMat3x4f(R.cols[0], R.cols[1], R.cols[2], randomVec3f(-10.f, 10.f));
+}
+
+inline BBox3f randomBBox3f(float extent, float size)
+{
+  Vec3f a = randomVec3f(-extent, extent);
+  return makeBBox(a, a + randomVec3f(0.f, size));
+}
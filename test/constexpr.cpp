@@ -0,0 +1,140 @@
+// Compile-time checks that the constexpr types and operations fold to constants.
+//
+// Nothing here runs, the file compiles only if every static_assert can be
+// evaluated by the compiler. The values are small integers and halves, so
+// that the float results are exact.
+//
+// Not constexpr, as they need sqrt, SIMD or out-of-line code: length,
+// distance and normalize of vectors, quaternions and planes, inverse,
+// inverseTranspose, svd and getScale, mul of Mat4f, project, slerp, the
+// conversions to and from Quatf, DualQuatf and Half, quantize and the
+// spatial keys, makeFrustumf and transform of boxes.
+#include "LinAlg.h"
+#include "LinAlgOps.h"
+
+namespace {
+
+  template<typename V> constexpr bool equal(const V& a, const V& b, unsigned n)
+  {
+    for (unsigned k = 0; k < n; k++) {
+      if (!(a[k] == b[k])) return false;
+    }
+    return true;
+  }
+
+  constexpr bool equal(const Vec3f& a, const Vec3f& b) { return equal(a, b, 3); }
+  constexpr bool equal(const Vec4f& a, const Vec4f& b) { return equal(a, b, 4); }
+  constexpr bool equal(const Quatf& a, const Quatf& b) { return equal(a, b, 4); }
+
+  constexpr bool equal(const Mat3f& a, const Mat3f& b)
+  {
+    return equal(column(a, 0), column(b, 0)) && equal(column(a, 1), column(b, 1)) && equal(column(a, 2), column(b, 2));
+  }
+
+  constexpr bool equal(const Mat3x4f& a, const Mat3x4f& b)
+  {
+    return equal(column(a, 0), column(b, 0)) && equal(column(a, 1), column(b, 1)) &&
+           equal(column(a, 2), column(b, 2)) && equal(column(a, 3), column(b, 3));
+  }
+
+  // Vectors.
+  constexpr Vec3f a = makeVec3f(1.f, 2.f, 3.f);
+  constexpr Vec3f b = makeVec3f(4.f, -5.f, 6.f);
+  static_assert(a.x == 1.f && a.y == 2.f && a.z == 3.f, "makeVec3f");
+  static_assert(a[2] == 3.f && makeVec4f(1.f, 2.f, 3.f, 4.f)[3] == 4.f, "operator[]");
+  static_assert(equal(makeVec3f(makeVec4f(a.x, a.y, a.z, 7.f)), a), "makeVec3f of Vec4f");
+  static_assert(makeVec2f(a).y == 2.f && makeVec2i(makeVec3i(1, 2, 3)).y == 2, "makeVec2 of Vec3");
+  static_assert(equal(a + b, makeVec3f(5.f, -3.f, 9.f)), "operator+");
+  static_assert(equal(a - b, makeVec3f(-3.f, 7.f, -3.f)), "operator-");
+  static_assert(equal(2.f * a, makeVec3f(2.f, 4.f, 6.f)), "operator*");
+  static_assert(dot(a, b) == 12.f && lengthSquared(a) == 14.f && distanceSquared(a, a) == 0.f, "dot");
+  static_assert(equal(cross(a, b), makeVec3f(27.f, 6.f, -13.f)), "cross");
+  static_assert(equal(min(a, b), makeVec3f(1.f, -5.f, 3.f)) && equal(max(a, b), makeVec3f(4.f, 2.f, 6.f)), "min, max");
+
+  constexpr Vec3f writeComponents()
+  {
+    Vec3f v{};
+    for (unsigned k = 0; k < 3; k++) v[k] = float(k + 1);
+    return v;
+  }
+  static_assert(equal(writeComponents(), a), "operator[] assignment");
+
+  // Matrices, a table of the rotations taking +z to each face of a cube.
+  constexpr Mat3f cubeFaces[6] = {
+    makeMatRowMajor3f( 0.f, 0.f,  1.f,   0.f, 1.f,  0.f,  -1.f,  0.f,  0.f),  // +x
+    makeMatRowMajor3f( 0.f, 0.f, -1.f,   0.f, 1.f,  0.f,   1.f,  0.f,  0.f),  // -x
+    makeMatRowMajor3f( 1.f, 0.f,  0.f,   0.f, 0.f,  1.f,   0.f, -1.f,  0.f),  // +y
+    makeMatRowMajor3f( 1.f, 0.f,  0.f,   0.f, 0.f, -1.f,   0.f,  1.f,  0.f),  // -y
+    makeMatRowMajor3f( 1.f, 0.f,  0.f,   0.f, 1.f,  0.f,   0.f,  0.f,  1.f),  // +z
+    makeMatRowMajor3f(-1.f, 0.f,  0.f,   0.f, 1.f,  0.f,   0.f,  0.f, -1.f),  // -z
+  };
+  constexpr Vec3f z = makeVec3f(0.f, 0.f, 1.f);
+  static_assert(equal(mul(cubeFaces[0], z), makeVec3f(1.f, 0.f, 0.f)), "mul(Mat3f, Vec3f)");
+  static_assert(equal(mul(cubeFaces[3], z), makeVec3f(0.f, -1.f, 0.f)), "mul(Mat3f, Vec3f)");
+  static_assert(determinant(cubeFaces[1]) == 1.f && determinant(cubeFaces[5]) == 1.f, "determinant");
+  static_assert(equal(mul(cubeFaces[0], cubeFaces[1]), cubeFaces[4]) && equal(mul(cubeFaces[0], cubeFaces[0]), cubeFaces[5]), "mul(Mat3f, Mat3f)");
+
+  constexpr float elements[12] = { 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f, 10.f, 11.f, 12.f };
+  constexpr Mat3f M = makeMat3f(elements);
+  static_assert(M.c1r0 == 4.f && M.c2r2 == 9.f && equal(column(M, 1), makeVec3f(4.f, 5.f, 6.f)), "makeMat3f(const float*)");
+  static_assert(equal(makeMat3f(column(M, 0), column(M, 1), column(M, 2)), M), "makeMat3f of columns");
+
+  constexpr Mat3x4f A = makeMatRowMajor3x4f(1.f, 0.f, 0.f, 1.f,
+                                            0.f, 0.f, -1.f, 2.f,
+                                            0.f, 1.f, 0.f, 3.f);
+  static_assert(equal(mul(A, a), makeVec3f(2.f, -1.f, 5.f)), "mul(Mat3x4f, Vec3f)");
+  static_assert(equal(mul(mul(A, A), a), mul(A, mul(A, a))), "mul(Mat3x4f, Mat3x4f)");
+  static_assert(equal(makeMat3x4f(makeMat4f(A)), A) && equal(column(makeMat4f(A), 3), makeVec4f(1.f, 2.f, 3.f, 1.f)), "makeMat4f, makeMat3x4f");
+  static_assert(equal(makeMat3x4f(elements), makeMat3x4f(makeVec3f(1.f, 2.f, 3.f), makeVec3f(4.f, 5.f, 6.f),
+                                                         makeVec3f(7.f, 8.f, 9.f), makeVec3f(10.f, 11.f, 12.f))), "makeMat3x4f");
+
+  // Quaternions. q is a quarter turn about z scaled to length sqrt(1/2), so that its products are exact.
+  constexpr float h = 0.5f;
+  constexpr Quatf q = makeQuatf(0.f, 0.f, h, h);
+  static_assert(equal(mul(q, conjugate(q)), makeQuatf(0.f, 0.f, 0.f, 0.5f)), "mul(Quatf, Quatf), conjugate");
+  static_assert(dot(q, q) == 0.5f && equal(makeIdentityQuatf(), makeQuatf(0.f, 0.f, 0.f, 1.f)), "dot(Quatf), identity");
+  constexpr Quatf r = makeQuatf(0.f, 0.f, 0.f, 1.f);
+  static_assert(equal(mul(r, a), a), "mul(Quatf, Vec3f)");
+  static_assert(equal(mul(makeDualQuat(r, makeQuatf(h, 0.f, 0.f, 0.f)), a), makeVec3f(2.f, 2.f, 3.f)), "mul(DualQuatf, Vec3f)");
+
+  // Boxes, bounds of a table of points computed at compile time.
+  constexpr Vec3f points[4] = { a, b, makeVec3f(0.f), makeVec3f(-1.f, 8.f, 0.5f) };
+  constexpr BBox3f boundsOf(const Vec3f* p, size_t N)
+  {
+    BBox3f bbox = makeEmptyBBox3f();
+    for (size_t i = 0; i < N; i++) bbox = engulf(bbox, p[i]);
+    return bbox;
+  }
+  constexpr BBox3f bounds = boundsOf(points, 4);
+  static_assert(equal(bounds.min, makeVec3f(-1.f, -5.f, 0.f)) && equal(bounds.max, makeVec3f(4.f, 8.f, 6.f)), "engulf");
+  static_assert(isEmpty(makeEmptyBBox3f()) && isNotEmpty(bounds), "isEmpty");
+  static_assert(maxSideLength(bounds) == 13.f && surfaceArea(bounds) == 2.f * (65.f + 78.f + 30.f), "maxSideLength, surfaceArea");
+  static_assert(isInside(bounds, a) && !isInside(bounds, makeVec3f(5.f)), "isInside");
+  static_assert(isStrictlyInside(bounds, makeBBox(a, a)) && isOverlapping(bounds, makeBBox(makeVec3f(4.f), makeVec3f(5.f))), "isOverlapping");
+  static_assert(equal(grow(bounds, 1.f).max, makeVec3f(5.f, 9.f, 7.f)), "grow");
+  static_assert(engulf(makeEmptyBBox2f(), makeVec2f(1.f, 2.f)).max.y == 2.f, "engulf(BBox2f)");
+  static_assert(grow(makeBBox(makeVec2f(1.f, 2.f), makeVec2f(3.f, 4.f)), 0.5f).min.y == 1.5f, "grow(BBox2f)");
+  static_assert(grow(makeBBox(makeVec3d(1.0), makeVec3d(2.0)), 0.5).max.z == 2.5, "grow(BBox3d)");
+
+  constexpr float hitDistance(const Ray3f& ray, const BBox3f& bbox)
+  {
+    float t = 0.f;
+    return intersect(t, ray, bbox, 0.f, 100.f) ? t : -1.f;
+  }
+  // Division by zero is not a constant expression, so the rays are not axis-aligned.
+  static_assert(hitDistance(makeRay3f(makeVec3f(-5.f, -4.f, -3.f), makeVec3f(1.f)), bounds) == 4.f, "intersect");
+  static_assert(hitDistance(makeRay3f(makeVec3f(-5.f, -4.f, 20.f), makeVec3f(1.f)), bounds) == -1.f, "intersect miss");
+
+  // Planes and frustums.
+  constexpr Planef ground = makePlane(makeVec3f(0.f, 1.f, 0.f), 0.f);
+  static_assert(distance(ground, a) == 2.f, "distance(Planef, Vec3f)");
+  constexpr Frustumf box = { {
+    makePlane(makeVec3f(1.f, 0.f, 0.f), 2.f), makePlane(makeVec3f(-1.f, 0.f, 0.f), 2.f),
+    makePlane(makeVec3f(0.f, 1.f, 0.f), 2.f), makePlane(makeVec3f(0.f, -1.f, 0.f), 2.f),
+    makePlane(makeVec3f(0.f, 0.f, 1.f), 2.f), makePlane(makeVec3f(0.f, 0.f, -1.f), 2.f),
+  } };
+  static_assert(classify(box, makeBBox(makeVec3f(-1.f), makeVec3f(1.f))) == Containment::Inside, "classify");
+  static_assert(classify(box, makeBBox(makeVec3f(1.f), makeVec3f(3.f))) == Containment::Intersecting, "classify");
+  static_assert(classify(box, makeBBox(makeVec3f(3.f), makeVec3f(4.f))) == Containment::Outside, "classify");
+
+}
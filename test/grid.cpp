@@ -0,0 +1,151 @@
+// Uniform grid queries against testing every item, and builds on one and on several threads.
+#include <algorithm>
+#include <vector>
+#include "check.h"
+#include "UniformGrid.h"
+
+namespace {
+
+  std::vector<uint32_t> sorted(std::vector<uint32_t> a)
+  {
+    std::sort(a.begin(), a.end());
+    return a;
+  }
+
+  // Squared distance from p to the nearest point of a non-empty box.
+  float boxDistanceSquared(const BBox3f& b, const Vec3f& p)
+  {
+    return distanceSquared(p, max(b.min, min(b.max, p)));
+  }
+
+  // Points on a lattice of cellSize / 2, so that many lie on cell borders,
+  // with duplicates.
+  std::vector<Vec3f> makePoints(size_t N, float extent, float cellSize)
+  {
+    std::vector<Vec3f> points(N);
+    for (size_t i = 0; i < N; i++) {
+      points[i] = randomVec3f(-extent, extent);
+      if (i % 5 == 1) {
+        for (unsigned k = 0; k < 3; k++) points[i][k] = 0.5f * cellSize * float(int(2.f * points[i][k] / cellSize));
+      }
+      if (i % 11 == 2) points[i] = points[i - 1];
+    }
+    return points;
+  }
+
+  // Small and large boxes, with empty boxes and duplicates.
+  std::vector<BBox3f> makeBoxes(size_t N, float extent)
+  {
+    std::vector<BBox3f> bboxes(N);
+    for (size_t i = 0; i < N; i++) {
+      bboxes[i] = randomBBox3f(extent, i % 50 == 49 ? 10.f : 1.f);
+      if (i % 13 == 4) bboxes[i] = makeEmptyBBox3f();
+      if (i % 17 == 6) bboxes[i] = bboxes[i - 1];
+    }
+    return bboxes;
+  }
+
+  // Queries of all sizes, from within one cell to more cells than buckets.
+  std::vector<BBox3f> makeQueries(float extent, float cellSize)
+  {
+    const float sizes[3] = { 0.1f * cellSize, cellSize, 0.2f * extent };
+    std::vector<BBox3f> queries;
+    for (size_t q = 0; q < 150; q++) queries.push_back(randomBBox3f(1.1f * extent, sizes[q % 3]));
+    queries.push_back(makeBBox(makeVec3f(-2.f * extent), makeVec3f(2.f * extent)));
+    queries.push_back(makeBBox(makeVec3f(0.f), makeVec3f(0.f)));
+    queries.push_back(makeEmptyBBox3f());
+    return queries;
+  }
+
+  bool checkPoints(const std::vector<Vec3f>& points, float cellSize, float extent)
+  {
+    UniformGrid grid;
+    build(grid, points.data(), points.size(), cellSize, 1);
+
+    bool ok = true;
+    std::vector<uint32_t> found, expected;
+    for (const BBox3f& query : makeQueries(extent, cellSize)) {
+      found.clear();
+      expected.clear();
+      findOverlapping(found, grid, query);
+      for (size_t i = 0; i < points.size(); i++) {
+        if (isOverlapping(query, makeBBox(points[i], points[i]))) expected.push_back(uint32_t(i));
+      }
+      ok = ok && sorted(found) == expected;
+
+      if (isEmpty(query)) continue;
+      Vec3f p = query.min;
+      float radius = query.max.x - query.min.x;
+      found.clear();
+      expected.clear();
+      findWithinRadius(found, grid, p, radius);
+      for (size_t i = 0; i < points.size(); i++) {
+        if (distanceSquared(p, points[i]) <= radius * radius) expected.push_back(uint32_t(i));
+      }
+      ok = ok && sorted(found) == expected;
+    }
+    return ok;
+  }
+
+  bool checkBoxes(const std::vector<BBox3f>& bboxes, float cellSize, float extent)
+  {
+    UniformGrid grid;
+    build(grid, bboxes.data(), bboxes.size(), cellSize, 1);
+
+    bool ok = true;
+    std::vector<uint32_t> found, expected;
+    for (const BBox3f& query : makeQueries(extent, cellSize)) {
+      found.clear();
+      expected.clear();
+      findOverlapping(found, grid, query);
+      for (size_t i = 0; i < bboxes.size(); i++) {
+        if (isOverlapping(query, bboxes[i])) expected.push_back(uint32_t(i));
+      }
+      ok = ok && sorted(found) == expected;
+
+      if (isEmpty(query)) continue;
+      Vec3f p = query.min;
+      float radius = query.max.x - query.min.x;
+      found.clear();
+      expected.clear();
+      findWithinRadius(found, grid, p, radius);
+      for (size_t i = 0; i < bboxes.size(); i++) {
+        if (!isEmpty(bboxes[i]) && boxDistanceSquared(bboxes[i], p) <= radius * radius) expected.push_back(uint32_t(i));
+      }
+      ok = ok && sorted(found) == expected;
+    }
+    return ok;
+  }
+
+}
+
+
+void checkUniformGrid()
+{
+  setCheckSection("UniformGrid");
+
+  // Few buckets, so that cells of a query share a bucket.
+  bool okPoints = true, okBoxes = true;
+  for (size_t N : { 0, 1, 2, 3, 5, 8, 9 }) {
+    okPoints = okPoints && checkPoints(makePoints(N, 1.f, 1.f), 1.f, 1.f);
+    okBoxes = okBoxes && checkBoxes(makeBoxes(N, 1.f), 1.f, 1.f);
+  }
+  check(okPoints, "points in cells sharing buckets");
+  check(okBoxes, "boxes in cells sharing buckets");
+
+  check(checkPoints(makePoints(5000, 50.f, 2.f), 2.f, 50.f), "points");
+  check(checkBoxes(makeBoxes(5000, 50.f), 2.f, 50.f), "boxes");
+
+  // Cells much smaller than the queries, which scan all items.
+  check(checkPoints(makePoints(2000, 50.f, 0.05f), 0.05f, 50.f), "points in small cells");
+  check(checkBoxes(makeBoxes(2000, 50.f), 0.05f, 50.f), "boxes in small cells");
+
+  // Large enough that the sort splits into several tasks.
+  std::vector<BBox3f> bboxes(300000);
+  for (BBox3f& b : bboxes) b = randomBBox3f(100.f, 2.f);
+  UniformGrid grid1, gridN;
+  build(grid1, bboxes.data(), bboxes.size(), 4.f, 1);
+  build(gridN, bboxes.data(), bboxes.size(), 4.f, 0);
+  check(sameBytes(grid1.items, gridN.items) && sameBytes(grid1.bucketStart, gridN.bucketStart) &&
+        sameFloats(&grid1.extent, &gridN.extent, 1), "build on several threads");
+}
@@ -0,0 +1,118 @@
+// Incremental transform hierarchy updates against recomputing every node.
+#include <vector>
+#include "check.h"
+#include "TransformHierarchy.h"
+
+namespace {
+
+  // World transforms and bounds of all nodes, each parent before its children.
+  bool matchesFullUpdate(const TransformHierarchy& h)
+  {
+    std::vector<Mat3x4f> world(h.parents.size());
+    std::vector<BBox3f> worldBounds(h.parents.size());
+    for (size_t i = 0; i < h.parents.size(); i++) {
+      uint32_t parent = h.parents[i];
+      world[i] = parent == noParent ? h.local[i] : mul(world[parent], h.local[i]);
+      worldBounds[i] = transform(world[i], h.localBounds[i]);
+    }
+    return sameFloats(world, h.world) && sameFloats(worldBounds, h.worldBounds);
+  }
+
+  // Number of nodes that are changed or below a changed node.
+  size_t countDescendants(const TransformHierarchy& h, const std::vector<uint32_t>& changed)
+  {
+    std::vector<uint8_t> flags(h.parents.size(), 0);
+    for (uint32_t i : changed) flags[i] = 1;
+    size_t count = 0;
+    for (size_t i = 0; i < h.parents.size(); i++) {
+      if (h.parents[i] != noParent && flags[h.parents[i]]) flags[i] = 1;
+      count += flags[i];
+    }
+    return count;
+  }
+
+  // Whether update takes the sparse path, the same test as update for distinct nodes.
+  bool isSparse(const TransformHierarchy& h, const std::vector<uint32_t>& changed)
+  {
+    size_t work = 0;
+    for (uint32_t i : changed) work += h.subtreeSizes[i];
+    return 8 * work < h.parents.size();
+  }
+
+  // Change the local transforms or bounds of the nodes and check the update.
+  bool checkUpdate(TransformHierarchy& h, const std::vector<uint32_t>& changed, unsigned threads)
+  {
+    for (uint32_t i : changed) {
+      if (i % 2 == 0 || i % 3) setLocal(h, i, randomMat3x4f());
+      if (i % 2) setLocalBounds(h, i, i % 5 ? randomBBox3f(1.f, 1.f) : makeEmptyBBox3f());
+    }
+    size_t expected = countDescendants(h, changed);
+    return update(h, threads) == expected && matchesFullUpdate(h);
+  }
+
+  // A node with a subtree of 2 to limit nodes.
+  uint32_t randomInnerNode(const TransformHierarchy& h, size_t limit)
+  {
+    for (;;) {
+      uint32_t i = uint32_t(random01() * float(h.parents.size()));
+      if (i < h.parents.size() && 2 <= h.subtreeSizes[i] && h.subtreeSizes[i] <= limit) return i;
+    }
+  }
+
+}
+
+
+void checkTransformHierarchy()
+{
+  setCheckSection("TransformHierarchy");
+
+  // Several roots and deep chains of nodes, some without bounds.
+  const size_t N = 20000;
+  std::vector<uint32_t> parents(N);
+  std::vector<Mat3x4f> local(N);
+  std::vector<BBox3f> localBounds(N);
+  for (size_t i = 0; i < N; i++) {
+    size_t back = 1 + size_t(random01() * 40.f);
+    parents[i] = i < back || random01() < 0.005f ? noParent : uint32_t(i - back);
+    local[i] = randomMat3x4f();
+    localBounds[i] = i % 7 ? randomBBox3f(1.f, 1.f) : makeEmptyBBox3f();
+  }
+
+  TransformHierarchy h;
+  build(h, parents.data(), local.data(), localBounds.data(), N, 0);
+  check(matchesFullUpdate(h), "build");
+  check(update(h) == 0 && matchesFullUpdate(h), "update without changes");
+
+  // A few nodes, one of them below another changed node and one changed twice.
+  bool ok = true;
+  bool sparse = true;
+  for (unsigned round = 0; round < 20; round++) {
+    uint32_t a = randomInnerNode(h, N / 200);
+    uint32_t b = h.children[h.childStart[a]];
+    std::vector<uint32_t> changed = { a, b, randomInnerNode(h, N / 200), uint32_t(N - 1) };
+    sparse = sparse && isSparse(h, changed);
+    changed.push_back(a);
+    ok = ok && checkUpdate(h, changed, round % 2 ? 1 : 0);
+  }
+  check(sparse, "few changes take the sparse path");
+  check(ok, "update of few nodes");
+
+  // More than 1/8 of the nodes, many of them below other changed nodes.
+  ok = true;
+  bool dense = true;
+  for (unsigned round = 0; round < 4; round++) {
+    std::vector<uint32_t> changed;
+    for (size_t i = 0; i < N / 4; i++) changed.push_back(uint32_t(random01() * float(N - 1)));
+    dense = dense && !isSparse(h, changed);
+    ok = ok && checkUpdate(h, changed, round % 2 ? 1 : 0);
+  }
+  check(dense, "many changes take the dense path");
+  check(ok, "update of many nodes");
+
+  // The roots, which changes every node.
+  std::vector<uint32_t> roots;
+  for (size_t i = 0; i < N; i++) {
+    if (parents[i] == noParent) roots.push_back(uint32_t(i));
+  }
+  check(checkUpdate(h, roots, 0), "update of the roots");
+}
@@ -0,0 +1,117 @@
+// Counts of the instrumented operations, built with LINALG_INSTRUMENT in the
+// Instrument configuration. Other configurations check that they stay zero.
+#include <vector>
+#include "check.h"
+#include "LinAlgBatch.h"
+#include "LinAlgInstrument.h"
+
+namespace {
+
+  const size_t opCount = size_t(InstrumentedOp::Count);
+
+  struct Stats
+  {
+    OpStats ops[opCount];
+    const OpStats& operator[](InstrumentedOp op) const { return ops[size_t(op)]; }
+  };
+
+  Stats getStats()
+  {
+    Stats stats;
+    getInstrumentStats(stats.ops);
+    return stats;
+  }
+
+  // Calls and elements of op, and no calls of any other operation.
+  bool countsOnly(const Stats& stats, InstrumentedOp op, uint64_t calls, uint64_t elements)
+  {
+    for (size_t i = 0; i < opCount; i++) {
+      bool counted = InstrumentedOp(i) == op;
+      if (stats.ops[i].calls != (counted ? calls : 0) || stats.ops[i].elements != (counted ? elements : 0)) return false;
+    }
+    return true;
+  }
+
+#ifdef LINALG_INSTRUMENT
+  void storeFrame(void* context, const OpStats* stats)
+  {
+    std::vector<Stats>& frames = *static_cast<std::vector<Stats>*>(context);
+    frames.emplace_back();
+    for (size_t i = 0; i < opCount; i++) frames.back().ops[i] = stats[i];
+  }
+#endif
+
+}
+
+
+void checkInstrument()
+{
+  setCheckSection("Instrument");
+
+  const Mat3f A = randomMat3f(), B = randomMat3f();
+  const Mat3x4f M = randomMat3x4f();
+  volatile float sink = 0.f;
+
+#ifdef LINALG_INSTRUMENT
+  // The product spells out its columns, so it counts once.
+  resetInstrumentStats();
+  sink = mul(A, B).data[0];
+  check(countsOnly(getStats(), InstrumentedOp::MulMat3, 1, 1), "mul(Mat3f, Mat3f) counts once");
+
+  // The inverse multiplies internally, which does not count.
+  resetInstrumentStats();
+  sink = inverse(M).data[0];
+  check(countsOnly(getStats(), InstrumentedOp::InverseMat3x4, 1, 1), "inverse(Mat3x4f) counts once");
+
+  // At every level, as the scalar kernels and the tails of the others call
+  // the scalar operations.
+  const size_t N = 300000;
+  std::vector<Vec3f> points(N), transformed(N);
+  for (Vec3f& p : points) p = randomVec3f(-10.f, 10.f);
+  std::vector<Vec2s> codes(1003);
+  std::vector<Vec3f> normals(codes.size());
+  for (Vec2s& e : codes) e = encodeOctahedral(normalize(randomVec3f(-1.f, 1.f)));
+
+  const SIMDLevel best = getSIMDLevel();
+  bool once = true, muted = true;
+  for (unsigned level = 0; level <= unsigned(best); level++) {
+    setSIMDLevel(SIMDLevel(level));
+
+    // Large enough to run on several threads, whose ranges do not count.
+    resetInstrumentStats();
+    transform(transformed.data(), M, points.data(), N, 0);
+    once = once && countsOnly(getStats(), InstrumentedOp::TransformPoints, 1, N);
+
+    // Batched decode mutes the normalize of its scalar tail.
+    resetInstrumentStats();
+    decodeOctahedral(normals.data(), codes.data(), codes.size());
+    muted = muted && countsOnly(getStats(), InstrumentedOp::Normalize, 0, 0);
+  }
+  setSIMDLevel(best);
+  check(once, "batched transform on several threads counts once");
+  check(muted, "batched decodeOctahedral does not count normalize");
+
+  // Each frame gets the counts since the previous one.
+  std::vector<Stats> frames;
+  setInstrumentCallback(storeFrame, &frames);
+  resetInstrumentStats();
+  for (unsigned i = 0; i < 2; i++) sink = mul(A, B).data[0];
+  endInstrumentFrame();
+  for (unsigned i = 0; i < 3; i++) sink = mul(A, B).data[0];
+  sink = inverse(M).data[0];
+  endInstrumentFrame();
+  endInstrumentFrame();
+  setInstrumentCallback(nullptr, nullptr);
+  endInstrumentFrame();
+  check(frames.size() == 3 && countsOnly(frames[0], InstrumentedOp::MulMat3, 2, 2) &&
+        frames[1][InstrumentedOp::MulMat3].calls == 3 && frames[1][InstrumentedOp::InverseMat3x4].calls == 1 &&
+        countsOnly(frames[2], InstrumentedOp::MulMat3, 0, 0), "endInstrumentFrame passes the counts of each frame");
+  check(getStats()[InstrumentedOp::MulMat3].calls == 5, "getInstrumentStats counts across frames");
+#else
+  resetInstrumentStats();
+  sink = mul(A, B).data[0];
+  sink = inverse(M).data[0];
+  check(countsOnly(getStats(), InstrumentedOp::MulMat3, 0, 0), "no counts without LINALG_INSTRUMENT");
+#endif
+  (void)sink;
+}
@@ -0,0 +1,146 @@
+// k-d tree queries against testing every point, and queries on one and on several threads.
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "check.h"
+#include "KdTree.h"
+
+namespace {
+
+  template<typename T>
+  Vec3<T> randomVec3(T a, T b) { return makeVec3<T>(T(random(float(a), float(b))), T(random(float(a), float(b))), T(random(float(a), float(b)))); }
+
+  // Random points, and points on an integer lattice, which have many equal
+  // distances to the lattice points among the queries, with duplicates.
+  template<typename T>
+  std::vector<Vec3<T>> makePoints(size_t N)
+  {
+    std::vector<Vec3<T>> points(N);
+    for (size_t i = 0; i < N; i++) {
+      points[i] = randomVec3<T>(T(-10), T(10));
+      if (i % 3 == 1) points[i] = makeVec3<T>(std::floor(points[i].x), std::floor(points[i].y), std::floor(points[i].z));
+      if (i % 7 == 2) points[i] = points[i - 1];
+    }
+    return points;
+  }
+
+  template<typename T>
+  std::vector<Vec3<T>> makeQueries(const std::vector<Vec3<T>>& points)
+  {
+    std::vector<Vec3<T>> queries;
+    for (size_t q = 0; q < 100; q++) queries.push_back(randomVec3<T>(T(-12), T(12)));
+    for (size_t q = 0; q < 50; q++) queries.push_back(makeVec3<T>(std::floor(queries[q].x), std::floor(queries[q].y), std::floor(queries[q].z)));
+    for (size_t i = 0; i < points.size() && i < 20; i++) queries.push_back(points[i]);
+    queries.push_back(makeVec3<T>(T(1000), T(1000), T(1000)));
+    return queries;
+  }
+
+  // Input indices of all points with their squared distances to p, closest first and ties by index.
+  template<typename T>
+  std::vector<std::pair<T, uint32_t>> allNearest(const std::vector<Vec3<T>>& points, const Vec3<T>& p)
+  {
+    std::vector<std::pair<T, uint32_t>> nearest;
+    for (size_t i = 0; i < points.size(); i++) nearest.push_back(std::make_pair(distanceSquared(points[i], p), uint32_t(i)));
+    std::sort(nearest.begin(), nearest.end());
+    return nearest;
+  }
+
+  template<typename T>
+  bool checkNearest(const std::vector<Vec3<T>>& points, size_t k)
+  {
+    KdTree<T> tree;
+    build(tree, points.data(), points.size(), 1);
+    std::vector<Vec3<T>> queries = makeQueries(points);
+    const size_t Q = queries.size();
+
+    // Unused slots of the batch are padded with ~0u and infinity.
+    std::vector<uint32_t> indices(k), batchIndices(Q * k);
+    std::vector<T> distances(k), batchDistances(Q * k);
+    findNearest(batchIndices.data(), batchDistances.data(), tree, queries.data(), Q, k, 0);
+
+    bool ok = true;
+    for (size_t q = 0; q < Q; q++) {
+      std::vector<std::pair<T, uint32_t>> expected = allNearest(points, queries[q]);
+      size_t n = std::min(k, expected.size());
+      ok = ok && findNearest(indices.data(), distances.data(), tree, queries[q], k) == n;
+      for (size_t j = 0; j < k; j++) {
+        bool found = j < n;
+        ok = ok && (!found || (indices[j] == expected[j].second && same(distances[j], expected[j].first)));
+        ok = ok && batchIndices[q * k + j] == (found ? expected[j].second : ~0u);
+        ok = ok && same(batchDistances[q * k + j], found ? expected[j].first : T(INFINITY));
+      }
+    }
+    return ok;
+  }
+
+  template<typename T>
+  bool checkWithinRadius(const std::vector<Vec3<T>>& points, T radius)
+  {
+    KdTree<T> tree;
+    build(tree, points.data(), points.size(), 1);
+    std::vector<Vec3<T>> queries = makeQueries(points);
+
+    // The batch holds the results of each query in the order of the scalar query.
+    std::vector<uint32_t> batch;
+    std::vector<size_t> start;
+    findWithinRadius(batch, start, tree, queries.data(), queries.size(), radius, 0);
+    bool ok = start.size() == queries.size() + 1 && start[0] == 0 && start.back() == batch.size();
+
+    std::vector<uint32_t> found, expected;
+    for (size_t q = 0; q < queries.size() && ok; q++) {
+      found.clear();
+      expected.clear();
+      findWithinRadius(found, tree, queries[q], radius);
+      for (size_t i = 0; i < points.size(); i++) {
+        if (distanceSquared(points[i], queries[q]) <= radius * radius) expected.push_back(uint32_t(i));
+      }
+      ok = ok && start[q + 1] - start[q] == found.size() && std::equal(found.begin(), found.end(), batch.begin() + start[q]);
+      std::sort(found.begin(), found.end());
+      ok = ok && found == expected;
+    }
+    return ok;
+  }
+
+  template<typename T>
+  bool checkQueries(size_t N)
+  {
+    std::vector<Vec3<T>> points = makePoints<T>(N);
+    bool ok = true;
+    for (size_t k : { 1, 4, 17 }) ok = ok && checkNearest(points, k);
+    for (T radius : { T(0), T(1), T(3) }) ok = ok && checkWithinRadius(points, radius);
+    return ok;
+  }
+
+}
+
+
+void checkKdTree()
+{
+  setCheckSection("KdTree");
+
+  // Fewer points than k, one leaf, and several levels.
+  bool okFloat = true, okDouble = true;
+  for (size_t N : { 0, 1, 3, 16, 17, 2000 }) {
+    okFloat = okFloat && checkQueries<float>(N);
+    okDouble = okDouble && checkQueries<double>(N);
+  }
+  check(okFloat, "queries of KdTreef");
+  check(okDouble, "queries of KdTreed");
+
+  // Large enough that the build and the queries split into several tasks.
+  const size_t M = 300000, Q = 20000, K = 4;
+  std::vector<Vec3f> points(M);
+  for (Vec3f& p : points) p = randomVec3f(-100.f, 100.f);
+  KdTreef tree1, treeN;
+  build(tree1, points.data(), M, 1);
+  build(treeN, points.data(), M, 0);
+  check(tree1.nodes.size() == treeN.nodes.size() && sameBytes(tree1.nodes.data(), treeN.nodes.data(), tree1.nodes.size()) &&
+        sameBytes(tree1.indices, treeN.indices), "build on several threads");
+
+  std::vector<uint32_t> n1(Q * K), nN(Q * K);
+  std::vector<float> d1(Q * K), dN(Q * K);
+  findNearest(n1.data(), d1.data(), tree1, points.data(), Q, K, 1);
+  findNearest(nN.data(), dN.data(), tree1, points.data(), Q, K, 0);
+  check(sameBytes(n1, nN) && sameFloats(d1, dN), "findNearest on several threads");
+}
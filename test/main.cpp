@@ -1,7 +1,53 @@
-#include "LinAlg.h"
-#include "LinAlgOps.h"
+// Regression checks of the library, see check.h.
+//
+// Prints the failed checks and exits with 1 if there are any.
+#include <cstdio>
+#include "check.h"
+#include "Parallel.h"
+
+namespace {
+
+  const char* currentSection = "";
+  unsigned failures = 0;
+
+}
+
+
+void check(bool ok, const char* what)
+{
+  if (ok) return;
+  failures++;
+  std::printf("FAILED %s: %s\n", currentSection, what);
+}
+
+void setCheckSection(const char* section)
+{
+  currentSection = section;
+}
 
 int main(int argc, char** argv)
 {
+  // More threads than the test machine may have, so that the threaded
+  // operations run on several threads.
+  setThreadCount(4);
+
+  checkBatchLevels();
+  checkOps();
+  checkParallel();
+  checkArrayFile(argc > 1 ? argv[1] : "cdmath-test.arrays");
+  checkTransformHierarchy();
+  checkUniformGrid();
+  checkKdTree();
+  checkRadixSort();
+  checkTileBins();
+  checkInstrument();
+  checkBVH();
+  checkSweepAndPrune();
+
+  if (failures) {
+    std::printf("%u checks failed\n", failures);
+    return 1;
+  }
+  std::printf("All checks passed\n");
   return 0;
 }
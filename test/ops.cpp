@@ -0,0 +1,285 @@
+// Scalar operations of LinAlgOps.h against their definitions, within the
+// rounding error of float.
+#include <cmath>
+#include <vector>
+#include "check.h"
+
+namespace {
+
+  // Largest difference between the n elements of a and b.
+  template<typename T>
+  T maxError(const T* a, const T* b, size_t n)
+  {
+    T e = T(0);
+    for (size_t i = 0; i < n; i++) {
+      T d = std::abs(a[i] - b[i]);
+      e = d > e || d != d ? d : e;
+    }
+    return e;
+  }
+
+  template<typename M> bool isIdentity(const M& A, const M& I, float tolerance)
+  {
+    return maxError(A.data, I.data, sizeof(A.data) / sizeof(A.data[0])) <= tolerance;
+  }
+
+  Mat3f transposed(const Mat3f& M)
+  {
+    Mat3f T;
+    for (unsigned c = 0; c < 3; c++) {
+      for (unsigned r = 0; r < 3; r++) T.data[3 * c + r] = M.data[3 * r + c];
+    }
+    return T;
+  }
+
+  // Random matrices with a dominant diagonal, so that they are well conditioned.
+  Mat3f randomInvertibleMat3f()
+  {
+    Mat3f M = randomMat3f();
+    for (unsigned k = 0; k < 3; k++) M.data[4 * k] += random01() < 0.5f ? 3.f : -3.f;
+    return M;
+  }
+
+  Mat4f randomRigidMat4f()
+  {
+    Mat3f R = makeMat3f(randomQuatf());
+    return makeMat4f(makeMat3x4f(R.cols[0], R.cols[1], R.cols[2], randomVec3f(-100.f, 100.f)));
+  }
+
+  void checkInverses()
+  {
+    const Mat3f I3 = makeMat3f(makeVec3f(1.f, 0.f, 0.f), makeVec3f(0.f, 1.f, 0.f), makeVec3f(0.f, 0.f, 1.f));
+    const Mat3d I3d = makeMat3d(makeVec3d(1.0, 0.0, 0.0), makeVec3d(0.0, 1.0, 0.0), makeVec3d(0.0, 0.0, 1.0));
+    const Mat3x4f I34 = makeMat3x4f(I3.cols[0], I3.cols[1], I3.cols[2], makeVec3f(0.f));
+    const Mat4f I4 = makeMat4f(I34);
+
+    bool ok3 = true, ok3d = true, ok34 = true, ok4 = true, okAffine = true, okRigid = true;
+    for (unsigned i = 0; i < 1000; i++) {
+      Mat3f A = randomInvertibleMat3f();
+      ok3 = ok3 && isIdentity(mul(A, inverse(A)), I3, 1e-5f) && isIdentity(mul(inverse(A), A), I3, 1e-5f);
+      ok3 = ok3 && isIdentity(mul(A, transposed(inverseTranspose(A))), I3, 1e-5f);
+
+      Mat3d Ad;
+      for (unsigned k = 0; k < 9; k++) Ad.data[k] = double(A.data[k]);
+      Mat3d Bd = inverse(Ad), Cd;
+      for (unsigned c = 0; c < 3; c++) {
+        for (unsigned r = 0; r < 3; r++) {
+          double s = 0.0;
+          for (unsigned k = 0; k < 3; k++) s += Ad.data[3 * k + r] * Bd.data[3 * c + k];
+          Cd.data[3 * c + r] = s;
+        }
+      }
+      ok3d = ok3d && maxError(Cd.data, I3d.data, 9) <= 1e-14;
+
+      Mat3x4f T = makeMat3x4f(A.cols[0], A.cols[1], A.cols[2], randomVec3f(-100.f, 100.f));
+      ok34 = ok34 && isIdentity(mul(T, inverse(T)), I34, 1e-4f) && isIdentity(mul(inverse(T), T), I34, 1e-4f);
+
+      // A projective row, with a small translation to keep G well conditioned.
+      Mat4f G = makeMat4f(makeMat3x4f(A.cols[0], A.cols[1], A.cols[2], randomVec3f(-2.f, 2.f)));
+      for (unsigned k = 0; k < 4; k++) G.data[4 * k + 3] = random(-0.5f, 0.5f);
+      G.c3r3 += 3.f;
+      ok4 = ok4 && isIdentity(mul(G, inverse(G)), I4, 1e-4f) && isIdentity(mul(inverse(G), G), I4, 1e-4f);
+
+      Mat4f F = makeMat4f(T);
+      okAffine = okAffine && isIdentity(mul(F, inverseAffine(F)), I4, 1e-4f) && isIdentity(mul(inverseAffine(F), F), I4, 1e-4f);
+
+      Mat4f R = randomRigidMat4f();
+      okRigid = okRigid && isIdentity(mul(R, inverseRigid(R)), I4, 1e-4f) && isIdentity(mul(inverseRigid(R), R), I4, 1e-4f);
+    }
+    check(ok3, "inverse and inverseTranspose of Mat3f");
+    check(ok3d, "inverse of Mat3d");
+    check(ok34, "inverse of Mat3x4f");
+    check(ok4, "inverse of Mat4f");
+    check(okAffine, "inverseAffine");
+    check(okRigid, "inverseRigid");
+  }
+
+  // Distance between the rotations of unit quaternions, which q and -q share.
+  float rotationError(const Quatf& a, const Quatf& b)
+  {
+    float plus = 0.f, minus = 0.f;
+    for (unsigned k = 0; k < 4; k++) {
+      plus = std::fmax(plus, std::abs(a[k] - b[k]));
+      minus = std::fmax(minus, std::abs(a[k] + b[k]));
+    }
+    return std::fmin(plus, minus);
+  }
+
+  Quatf axisAngle(const Vec3f& axis, float angle)
+  {
+    Vec3f u = std::sin(0.5f * angle) * normalize(axis);
+    return makeQuatf(u.x, u.y, u.z, std::cos(0.5f * angle));
+  }
+
+  void checkQuaternions()
+  {
+    // Random rotations, and rotations close to 0 and 180 degrees, which take
+    // the other branches of makeQuatf.
+    std::vector<Quatf> rotations;
+    for (unsigned i = 0; i < 1000; i++) rotations.push_back(randomQuatf());
+    for (unsigned k = 0; k < 3; k++) {
+      Vec3f axis = makeVec3f(0.f);
+      axis[k] = 1.f;
+      rotations.push_back(axisAngle(axis, 3.1415926f));
+      rotations.push_back(axisAngle(axis + makeVec3f(0.01f), 3.14f));
+      rotations.push_back(axisAngle(axis, 1e-4f));
+    }
+    rotations.push_back(makeQuatf(0.f, 0.f, 0.f, 1.f));
+
+    bool okMat3 = true, okMul = true, okDualQuat = true, okMat3x4 = true;
+    for (const Quatf& q : rotations) {
+      Mat3f R = makeMat3f(q);
+      okMat3 = okMat3 && rotationError(makeQuatf(R), q) <= 1e-6f;
+
+      Vec3f p = randomVec3f(-10.f, 10.f);
+      okMul = okMul && distance(mul(q, p), mul(R, p)) <= 1e-5f;
+
+      Vec3f t = randomVec3f(-100.f, 100.f);
+      Mat3x4f M = makeMat3x4f(R.cols[0], R.cols[1], R.cols[2], t);
+      DualQuatf d = makeDualQuatf(M);
+      DualQuatf e = makeDualQuatf(q, t);
+      okDualQuat = okDualQuat && rotationError(d.real, q) <= 1e-6f && distance(mul(d, p), mul(M, p)) <= 1e-4f && distance(mul(e, p), mul(M, p)) <= 1e-4f;
+      okMat3x4 = okMat3x4 && maxError(makeMat3x4f(d).data, M.data, 12) <= 1e-4f && maxError(makeMat3x4f(e).data, M.data, 12) <= 1e-4f;
+    }
+    check(okMat3, "makeQuatf(makeMat3f(q))");
+    check(okMul, "mul(Quatf, Vec3f)");
+    check(okDualQuat, "makeDualQuatf");
+    check(okMat3x4, "makeMat3x4f(makeDualQuatf(M))");
+
+    // The ends, and the middle which is the normalized sum along the shorter
+    // arc, also for nearly equal rotations and for rotations more than 180
+    // degrees apart as quaternions.
+    bool okEnds = true, okMiddle = true;
+    for (size_t i = 0; i + 1 < rotations.size(); i++) {
+      const Quatf& a = rotations[i];
+      Quatf b = i % 3 ? rotations[i + 1] : normalize(makeQuatf(a.x + 1e-4f, a.y, a.z - 1e-4f, a.w));
+      okEnds = okEnds && rotationError(slerp(a, b, 0.f), a) <= 1e-6f && rotationError(slerp(a, b, 1.f), b) <= 1e-6f;
+      okMiddle = okMiddle && rotationError(slerp(a, b, 0.5f), nlerp(a, b, 0.5f)) <= 1e-6f;
+    }
+    check(okEnds, "slerp at 0 and 1");
+    check(okMiddle, "slerp at 0.5");
+  }
+
+  // Projections looking down -z from near to far, with clip space depth
+  // [-w, w], or [0, w] if zeroToOne.
+  Mat4f perspective(float near, float far, bool zeroToOne)
+  {
+    float a = zeroToOne ? far / (near - far) : (far + near) / (near - far);
+    float b = zeroToOne ? far * near / (near - far) : 2.f * far * near / (near - far);
+    return makeMatRowMajor4f(1.5f, 0.f, 0.f, 0.f,
+                             0.f, 2.f, 0.f, 0.f,
+                             0.f, 0.f, a, b,
+                             0.f, 0.f, -1.f, 0.f);
+  }
+
+  Mat4f orthographic(float near, float far, bool zeroToOne)
+  {
+    float a = zeroToOne ? -1.f / (far - near) : -2.f / (far - near);
+    float b = zeroToOne ? -near / (far - near) : -(far + near) / (far - near);
+    return makeMatRowMajor4f(0.1f, 0.f, 0.f, 0.f,
+                             0.f, 0.2f, 0.f, 0.f,
+                             0.f, 0.f, a, b,
+                             0.f, 0.f, 0.f, 1.f);
+  }
+
+  // The corners of the frustum, projected back from clip space, lie on the
+  // three planes of their faces and inside the others, and the center is
+  // inside all planes.
+  bool isFrustumOf(const Frustumf& frustum, const Mat4f& viewProjection, bool zeroToOne)
+  {
+    const Mat4f unproject = inverse(viewProjection);
+    for (const Planef& plane : frustum.planes) {
+      if (!(std::abs(length(plane.n) - 1.f) <= 1e-6f)) return false;
+    }
+    for (unsigned c = 0; c < 8; c++) {
+      Vec3f ndc = makeVec3f(c & 1 ? 1.f : -1.f, c & 2 ? 1.f : -1.f, c & 4 ? 1.f : zeroToOne ? 0.f : -1.f);
+      Vec3f p = project(unproject, ndc);
+      float tolerance = 1e-4f * (1.f + length(p));
+      for (unsigned k = 0; k < 6; k++) {
+        bool onFace = ndc[k / 2] == (k % 2 ? 1.f : k == 4 && zeroToOne ? 0.f : -1.f);
+        float d = distance(frustum.planes[k], p);
+        if (onFace ? !(std::abs(d) <= tolerance) : !(tolerance < d)) return false;
+      }
+    }
+    Vec3f center = project(unproject, makeVec3f(0.f, 0.f, zeroToOne ? 0.5f : 0.f));
+    for (const Planef& plane : frustum.planes) {
+      if (!(0.f < distance(plane, center))) return false;
+    }
+    return true;
+  }
+
+  void checkFrustums()
+  {
+    bool okPerspective = true, okOrthographic = true;
+    for (unsigned i = 0; i < 100; i++) {
+      Mat4f view = inverseRigid(randomRigidMat4f());
+      for (bool zeroToOne : { false, true }) {
+        Mat4f P = mul(perspective(0.5f, 50.f, zeroToOne), view);
+        okPerspective = okPerspective && isFrustumOf(makeFrustumf(P, zeroToOne), P, zeroToOne);
+        Mat4f O = mul(orthographic(1.f, 30.f, zeroToOne), view);
+        okOrthographic = okOrthographic && isFrustumOf(makeFrustumf(O, zeroToOne), O, zeroToOne);
+      }
+    }
+    check(okPerspective, "makeFrustumf of perspective projections");
+    check(okOrthographic, "makeFrustumf of orthographic projections");
+  }
+
+  void checkFastPrecision()
+  {
+    // Every binade, with the estimate and the refinement in float.
+    bool ok = true;
+    float worst = 0.f;
+    for (int e = -126; e < 128; e++) {
+      for (unsigned i = 0; i < 256; i++) {
+        float x = std::ldexp(1.f + float(i) / 256.f + random01() / 256.f, e);
+        if (FLT_MAX < x) x = FLT_MAX;
+        double exact = 1.0 / std::sqrt(double(x));
+        float error = float(std::abs(double(rsqrt(x, FastPrecision())) - exact) / exact);
+        worst = error > worst || error != error ? error : worst;
+      }
+    }
+    check(worst < 5e-7f, "rsqrt(x, FastPrecision) within 5e-7");
+
+    for (float x : { 0.f, -0.f, 1e-40f, 0.5f * FLT_MIN, -1.f }) ok = ok && rsqrt(x, FastPrecision()) == 0.f;
+    check(ok, "rsqrt(x, FastPrecision) of x below FLT_MIN");
+
+    // Squared lengths below FLT_MIN count as zero.
+    ok = true;
+    for (float a : { 0.f, 1e-20f }) {
+      Vec3f v = makeVec3f(a, -a, a);
+      Vec3f n = normalize(v, FastPrecision());
+      ok = ok && length(v, FastPrecision()) == 0.f && distance(v, makeVec3f(0.f), FastPrecision()) == 0.f;
+      ok = ok && n.x == 0.f && n.y == 0.f && n.z == 0.f;
+      ok = ok && length(makeVec2f(a, a), FastPrecision()) == 0.f && length(makeVec4f(a, a, a, a), FastPrecision()) == 0.f;
+    }
+    check(ok, "length and normalize with FastPrecision of zero vectors");
+
+    // rsqrt and the rounding of the dot product.
+    bool okLength = true, okNormalize = true, okExact = true;
+    for (unsigned i = 0; i < 10000; i++) {
+      Vec3f v = std::ldexp(1.f, int(i % 40) - 20) * randomVec3f(-1.f, 1.f);
+      Vec3f w = randomVec3f(-1.f, 1.f);
+      float l = length(v);
+      okLength = okLength && std::abs(length(v, FastPrecision()) - l) <= 1e-6f * l;
+      okLength = okLength && std::abs(distance(v, w, FastPrecision()) - distance(v, w)) <= 1e-6f * distance(v, w);
+      okNormalize = okNormalize && std::abs(length(normalize(v, FastPrecision())) - 1.f) <= 1e-6f;
+      okExact = okExact && same(length(v, ExactPrecision()), l);
+      Vec3f a = normalize(v, ExactPrecision()), b = normalize(v);
+      okExact = okExact && sameFloats(&a, &b, 1);
+    }
+    check(okLength, "length and distance with FastPrecision");
+    check(okNormalize, "normalize with FastPrecision");
+    check(okExact, "ExactPrecision same as no tag");
+  }
+
+}
+
+
+void checkOps()
+{
+  setCheckSection("LinAlgOps");
+  checkInverses();
+  checkQuaternions();
+  checkFrustums();
+  checkFastPrecision();
+}
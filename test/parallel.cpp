@@ -0,0 +1,97 @@
+// The thread pool, and batched operations on one and on several threads.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "check.h"
+#include "LinAlgBatch.h"
+#include "Parallel.h"
+
+namespace {
+
+  // Each index is visited once, by ranges on multiples of grain.
+  bool coversOnce(size_t N, size_t grain, unsigned threads)
+  {
+    std::unique_ptr<std::atomic<uint32_t>[]> visits(new std::atomic<uint32_t>[N]);
+    for (size_t i = 0; i < N; i++) visits[i] = 0;
+    std::atomic<bool> aligned(true);
+    parallelFor(N, grain, threads,
+                [&](size_t begin, size_t end)
+                {
+                  if (begin % grain || (end % grain && end != N) || N < end || end <= begin) aligned = false;
+                  for (size_t i = begin; i < end; i++) visits[i]++;
+                });
+    for (size_t i = 0; i < N; i++) {
+      if (visits[i] != 1) return false;
+    }
+    return aligned;
+  }
+
+  void checkParallelFor()
+  {
+    bool ok = true;
+    for (size_t N : { 0, 1, 7, 64, 1000, 100003 }) {
+      for (size_t grain : { 1, 16, 1000 }) {
+        ok = ok && coversOnce(N, grain, 0) && coversOnce(N, grain, 1) && coversOnce(N, grain, 2);
+      }
+    }
+    check(ok, "parallelFor covers each index once");
+
+    // Loops started from within a loop.
+    std::vector<std::atomic<uint32_t>> visits(64 * 1000);
+    parallelFor(64, 1, 0,
+                [&](size_t begin, size_t end)
+                {
+                  for (size_t i = begin; i < end; i++) {
+                    parallelFor(1000, 10, 0, [&](size_t b, size_t e) { for (size_t j = b; j < e; j++) visits[1000 * i + j]++; });
+                  }
+                });
+    ok = true;
+    for (const std::atomic<uint32_t>& v : visits) ok = ok && v == 1;
+    check(ok, "nested parallelFor");
+
+    // A float sum, which is not associative, merged in the order of the ranges.
+    std::vector<float> values(100000);
+    for (float& v : values) v = random(-1.f, 1.f) * std::ldexp(1.f, int(random(-20.f, 20.f)));
+    auto sum = [&](size_t begin, size_t end) { float s = 0.f; for (size_t i = begin; i < end; i++) s += values[i]; return s; };
+    auto add = [](float a, float b) { return a + b; };
+    float expected = 0.f;
+    for (size_t begin = 0; begin < values.size(); begin += 333) expected += sum(begin, std::min(begin + 333, values.size()));
+    check(same(parallelReduce(values.size(), 333, 1, 0.f, sum, add), expected) &&
+          same(parallelReduce(values.size(), 333, 0, 0.f, sum, add), expected), "parallelReduce in the order of the ranges");
+  }
+
+}
+
+
+void checkParallel()
+{
+  setCheckSection("Parallel");
+
+  checkParallelFor();
+
+  // Large enough that every operation splits into several tasks.
+  const size_t M = 300000;
+  std::vector<Vec3f> points(M);
+  std::vector<Mat3f> matrices(M);
+  for (size_t i = 0; i < M; i++) {
+    points[i] = randomVec3f(-100.f, 100.f);
+    matrices[i] = randomMat3f();
+  }
+  const Mat3x4f T = randomMat3x4f();
+
+  std::vector<Vec3f> p1(M), pN(M);
+  transform(p1.data(), T, points.data(), M, 1);
+  transform(pN.data(), T, points.data(), M, 0);
+  check(sameFloats(p1, pN), "transform(Vec3f*) on several threads");
+
+  BBox3f b1 = engulf(makeEmptyBBox3f(), points.data(), M, 1);
+  BBox3f bN = engulf(makeEmptyBBox3f(), points.data(), M, 0);
+  check(sameFloats(&b1, &bN, 1), "engulf(Vec3f*) on several threads");
+
+  std::vector<Mat3f> m1(M), mN(M);
+  inverse(m1.data(), nullptr, matrices.data(), M, 1);
+  inverse(mN.data(), nullptr, matrices.data(), M, 0);
+  check(sameFloats(m1, mN), "inverse(Mat3f*) on several threads");
+}
@@ -1,5 +1,5 @@
 solution "cdmath"
-	configurations { "Debug", "Release" }
+	configurations { "Debug", "Release", "Instrument" }
 
 project "cdmath"
 	kind "ConsoleApp"
@@ -14,10 +14,18 @@ project "cdmath"
 		"premake5.lua"
 	}
 
+	removefiles {
+		"./bench.cpp"
+	}
+
 	includedirs {
-		"../include"
+		"../include",
+		".."
 	}
 
+	filter "system:linux"
+		links { "pthread" }
+
 	filter "configurations:Debug"
 		defines { "DEBUG" }
 		symbols "On"
@@ -26,3 +34,44 @@ project "cdmath"
 		defines { "NDEBUG" }
 		symbols "On"
 		optimize "On"
+
+	-- Release with the counters of LinAlgInstrument.h, which the checks in
+	-- instrument.cpp then cover.
+	filter "configurations:Instrument"
+		defines { "NDEBUG", "LINALG_INSTRUMENT" }
+		symbols "On"
+		optimize "On"
+
+project "cdmath-bench"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "c++17"
+	targetdir "%{cfg.buildcfg}"
+
+	files {
+		"../*.h",
+		"../*.cpp",
+		"./bench.cpp",
+		"premake5.lua"
+	}
+
+	includedirs {
+		".."
+	}
+
+	filter "system:linux"
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		defines { "DEBUG" }
+		symbols "On"
+
+	filter "configurations:Release"
+		defines { "NDEBUG" }
+		symbols "On"
+		optimize "Speed"
+
+	filter "configurations:Instrument"
+		defines { "NDEBUG", "LINALG_INSTRUMENT" }
+		symbols "On"
+		optimize "Speed"
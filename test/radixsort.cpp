@@ -0,0 +1,166 @@
+// Morton and Hilbert keys of known cells, and radix sort against a stable sort.
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "check.h"
+#include "LinAlgBatch.h"
+#include "RadixSort.h"
+
+namespace {
+
+  // Random integer of up to 31 bits, of which the top 24 are random.
+  uint32_t randomBits(unsigned bits) { return uint32_t(random01() * float(1u << bits)); }
+
+  // Key of the cell coordinates c, bit by bit, x in the lowest bit.
+  template<typename Key>
+  Key interleave(const uint32_t* c, unsigned D, unsigned bits)
+  {
+    Key key = 0;
+    for (unsigned b = 0; b < bits; b++) {
+      for (unsigned k = 0; k < D; k++) key |= Key((c[k] >> b) & 1) << (D * b + k);
+    }
+    return key;
+  }
+
+  // Frames of 2^bits units along each axis, so that the cell of a point is its integer part.
+  BBox3f frame3(unsigned bits) { return makeBBox(makeVec3f(0.f), makeVec3f(float(1u << bits))); }
+  BBox2f frame2(unsigned bits) { return makeBBox(makeVec2f(0.f), makeVec2f(float(1u << bits))); }
+
+  void checkMortonKeys()
+  {
+    bool ok32 = true, ok64 = true;
+    for (unsigned i = 0; i < 10000; i++) {
+      uint32_t c[3] = { randomBits(10), randomBits(10), randomBits(10) };
+      Vec3f p = makeVec3f(float(c[0]) + 0.5f, float(c[1]) + 0.5f, float(c[2]) + 0.5f);
+      ok32 = ok32 && mortonKey(frame3(10), p) == interleave<uint32_t>(c, 3, 10);
+
+      c[0] = randomBits(15), c[1] = randomBits(15);
+      ok32 = ok32 && mortonKey(frame2(15), makeVec2f(float(c[0]) + 0.5f, float(c[1]) + 0.5f)) == interleave<uint32_t>(c, 2, 15);
+
+      c[0] = randomBits(21), c[1] = randomBits(21), c[2] = randomBits(21);
+      p = makeVec3f(float(c[0]) + 0.5f, float(c[1]) + 0.5f, float(c[2]) + 0.5f);
+      ok64 = ok64 && mortonKey64(frame3(21), p) == interleave<uint64_t>(c, 3, 21);
+
+      // Float holds 24 bits, so cells of 31 bits are multiples of 2^7, as are the random bits.
+      c[0] = randomBits(31), c[1] = randomBits(31);
+      ok64 = ok64 && mortonKey64(frame2(31), makeVec2f(float(c[0]), float(c[1]))) == interleave<uint64_t>(c, 2, 31);
+    }
+    check(ok32, "mortonKey of known cells");
+    check(ok64, "mortonKey64 of known cells");
+
+    // Points outside the frame, and NaN, go to the cells on its sides.
+    const uint32_t lo[3] = { 0, 0, 0 }, hi[3] = { 1023, 1023, 0 };
+    check(mortonKey(frame3(10), makeVec3f(-5.f, NAN, -1e30f)) == interleave<uint32_t>(lo, 3, 10) &&
+          mortonKey(frame3(10), makeVec3f(2000.f, 1e30f, -1.f)) == interleave<uint32_t>(hi, 3, 10), "mortonKey outside the frame");
+  }
+
+  // The cell after each cell along the curve shares a face with it.
+  void checkHilbertKeys()
+  {
+    bool ok3 = true, ok2 = true;
+    for (unsigned i = 0; i < 10000; i++) {
+      uint32_t c[3] = { randomBits(10), randomBits(10), randomBits(10) };
+      Vec3f p = makeVec3f(float(c[0]) + 0.5f, float(c[1]) + 0.5f, float(c[2]) + 0.5f);
+      uint32_t key = hilbertKey(frame3(10), p);
+      bool next = key == (1u << 30) - 1;
+      for (unsigned k = 0; k < 3; k++) {
+        for (float d : { -1.f, 1.f }) {
+          Vec3f q = p;
+          q[k] += d;
+          next = next || (0.f < q[k] && q[k] < 1024.f && hilbertKey(frame3(10), q) == key + 1);
+        }
+      }
+      ok3 = ok3 && next;
+
+      Vec2f p2 = makeVec2f(float(randomBits(15)) + 0.5f, float(randomBits(15)) + 0.5f);
+      uint32_t key2 = hilbertKey(frame2(15), p2);
+      next = key2 == (1u << 30) - 1;
+      for (unsigned k = 0; k < 2; k++) {
+        for (float d : { -1.f, 1.f }) {
+          Vec2f q = p2;
+          q[k] += d;
+          next = next || (0.f < q[k] && q[k] < 32768.f && hilbertKey(frame2(15), q) == key2 + 1);
+        }
+      }
+      ok2 = ok2 && next;
+    }
+    check(ok3, "hilbertKey steps to a face neighbor");
+    check(ok2, "hilbertKey of Vec2f steps to an edge neighbor");
+    check(hilbertKey(frame3(10), makeVec3f(0.5f)) == 0 && hilbertKey(frame2(15), makeVec2f(0.5f)) == 0, "hilbertKey starts at the first cell");
+  }
+
+  // Keys with values 0 .. N - 1, sorted by radixSort and by std::stable_sort.
+  template<typename Key>
+  bool sortsStably(const std::vector<Key>& input, unsigned threads, bool withValues)
+  {
+    std::vector<Key> keys = input;
+    std::vector<uint32_t> values(input.size());
+    std::vector<std::pair<Key, uint32_t>> expected(input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+      values[i] = uint32_t(i);
+      expected[i] = std::make_pair(input[i], uint32_t(i));
+    }
+    std::stable_sort(expected.begin(), expected.end(), [](const std::pair<Key, uint32_t>& a, const std::pair<Key, uint32_t>& b) { return a.first < b.first; });
+
+    RadixSortScratch scratch;
+    radixSort(scratch, keys.data(), withValues ? values.data() : nullptr, keys.size(), threads);
+    for (size_t i = 0; i < input.size(); i++) {
+      if (keys[i] != expected[i].first || (withValues && values[i] != expected[i].second)) return false;
+    }
+    return true;
+  }
+
+  // Full range keys, keys of few bits, equal keys, and keys that only differ
+  // in their top byte, which skip all other passes.
+  template<typename Key>
+  std::vector<std::vector<Key>> makeKeys(size_t N)
+  {
+    std::vector<std::vector<Key>> keys(4, std::vector<Key>(N));
+    const unsigned top = 8 * sizeof(Key) - 8;
+    for (size_t i = 0; i < N; i++) {
+      Key k = Key(randomBits(24)) << (8 * sizeof(Key) - 24) | Key(randomBits(24));
+      keys[0][i] = k;
+      keys[1][i] = k & 0x3ff;
+      keys[2][i] = Key(12345);
+      keys[3][i] = Key(k >> top) << top | Key(0x42);
+    }
+    return keys;
+  }
+
+  template<typename Key>
+  bool checkSort()
+  {
+    bool ok = true;
+    for (size_t N : { 0, 1, 2, 255, 1000, 300000 }) {
+      for (const std::vector<Key>& keys : makeKeys<Key>(N)) {
+        ok = ok && sortsStably(keys, 1, true) && sortsStably(keys, 0, true) && sortsStably(keys, 0, false);
+      }
+    }
+    return ok;
+  }
+
+}
+
+
+void checkRadixSort()
+{
+  setCheckSection("RadixSort");
+
+  checkMortonKeys();
+  checkHilbertKeys();
+  check(checkSort<uint32_t>(), "radixSort of 32-bit keys");
+  check(checkSort<uint64_t>(), "radixSort of 64-bit keys");
+
+  // Large enough that the keys split into several tasks.
+  const size_t M = 300000;
+  std::vector<Vec3f> points(M);
+  for (Vec3f& p : points) p = randomVec3f(-100.f, 100.f);
+  const BBox3f frame = makeBBox(makeVec3f(-100.f), makeVec3f(100.f));
+  std::vector<uint32_t> k1(M), kN(M);
+  std::vector<uint64_t> h1(M), hN(M);
+  mortonKey(k1.data(), frame, points.data(), M, 1);
+  mortonKey(kN.data(), frame, points.data(), M, 0);
+  hilbertKey(h1.data(), frame, points.data(), M, 1);
+  hilbertKey(hN.data(), frame, points.data(), M, 0);
+  check(sameBytes(k1, kN) && sameBytes(h1, hN), "keys on several threads");
+}
@@ -0,0 +1,115 @@
+// Sweep and prune pairs against testing all pairs, over frames of moving boxes.
+#include <algorithm>
+#include <vector>
+#include "check.h"
+#include "SweepAndPrune.h"
+
+namespace {
+
+  bool lessPair(const Vec2u& a, const Vec2u& b) { return a.x < b.x || (a.x == b.x && a.y < b.y); }
+
+  std::vector<Vec2u> allPairs(const std::vector<BBox3f>& bboxes)
+  {
+    std::vector<Vec2u> pairs;
+    for (uint32_t i = 0; i < bboxes.size(); i++) {
+      for (uint32_t j = i + 1; j < bboxes.size(); j++) {
+        if (isOverlapping(bboxes[i], bboxes[j])) pairs.push_back(makeVec2u(i, j));
+      }
+    }
+    return pairs;
+  }
+
+  bool samePairs(std::vector<Vec2u> pairs, const std::vector<Vec2u>& expected)
+  {
+    std::sort(pairs.begin(), pairs.end(), lessPair);
+    return pairs.size() == expected.size() && sameBytes(pairs, expected);
+  }
+
+  // Boxes spread along one axis, so that sweep and prune chooses it, with
+  // empty boxes and boxes touching the next one at a face or an edge.
+  std::vector<BBox3f> makeBoxes(size_t N, unsigned axis)
+  {
+    std::vector<BBox3f> bboxes(N);
+    for (size_t i = 0; i < N; i++) {
+      Vec3f p = randomVec3f(-10.f, 10.f);
+      p[axis] *= 20.f;
+      bboxes[i] = makeBBox(p, p + randomVec3f(0.5f, 3.f));
+      if (i % 53 == 7) bboxes[i] = makeEmptyBBox3f();
+      if (i % 31 == 2 && i + 1 < N && !isEmpty(bboxes[i])) {
+        BBox3f& next = bboxes[i + 1];
+        next = bboxes[i];
+        next.min[axis] = bboxes[i].max[axis];
+        next.max[axis] = bboxes[i].max[axis] + 1.f;
+        if (i % 2) next.min[(axis + 1) % 3] = bboxes[i].max[(axis + 1) % 3];
+        i++;
+      }
+    }
+    return bboxes;
+  }
+
+  // Move each box by a little, keeping the empty boxes empty.
+  void jitter(std::vector<BBox3f>& bboxes, float amount)
+  {
+    for (BBox3f& b : bboxes) {
+      if (isEmpty(b)) continue;
+      Vec3f d = randomVec3f(-amount, amount);
+      b = makeBBox(b.min + d, b.max + d);
+    }
+  }
+
+}
+
+
+void checkSweepAndPrune()
+{
+  setCheckSection("SweepAndPrune");
+
+  SweepAndPrune sap;
+  std::vector<Vec2u> pairs;
+  std::vector<BBox3f> bboxes = makeBoxes(700, 0);
+  bool ok = true;
+  bool axes = true;
+
+  // Coherent motion, sorted again by insertion sort.
+  for (unsigned frame = 0; frame < 10; frame++) {
+    update(pairs, sap, bboxes.data(), bboxes.size());
+    ok = ok && samePairs(pairs, allPairs(bboxes)) && std::is_sorted(sap.lo.begin(), sap.lo.end());
+    axes = axes && sap.axis == 0;
+    jitter(bboxes, 1.f);
+  }
+  check(ok, "update of moving boxes");
+
+  // Spread along z instead, which switches the axis and sorts again.
+  ok = true;
+  bboxes = makeBoxes(700, 2);
+  for (unsigned frame = 0; frame < 3; frame++) {
+    update(pairs, sap, bboxes.data(), bboxes.size());
+    ok = ok && samePairs(pairs, allPairs(bboxes));
+    axes = axes && sap.axis == 2;
+    jitter(bboxes, 1.f);
+  }
+  check(ok, "update after switching axis");
+  check(axes, "axis of the largest spread");
+
+  // Boxes added and removed, which sorts again.
+  ok = true;
+  for (size_t N : { 701, 650, 3, 0, 1, 2, 5, 700 }) {
+    bboxes.resize(N);
+    for (size_t i = 0; i < N; i++) {
+      if (i % 4 == 0) bboxes[i] = randomBBox3f(100.f, 10.f);
+    }
+    update(pairs, sap, bboxes.data(), bboxes.size());
+    ok = ok && samePairs(pairs, allPairs(bboxes));
+  }
+  check(ok, "update with a different number of boxes");
+
+  // Many overlapping boxes, so that most runs of four candidates overlap.
+  ok = true;
+  for (BBox3f& b : bboxes) b = randomBBox3f(5.f, 4.f);
+  for (unsigned frame = 0; frame < 3; frame++) {
+    update(pairs, sap, bboxes.data(), bboxes.size());
+    ok = ok && samePairs(pairs, allPairs(bboxes));
+    jitter(bboxes, 0.5f);
+  }
+  check(ok, "update of dense boxes");
+}
@@ -0,0 +1,126 @@
+// Tile bins against testing every box with every tile, and builds on one and on several threads.
+#include <cmath>
+#include <vector>
+#include "check.h"
+#include "TileBins.h"
+
+namespace {
+
+  // floor((x - origin) / tileSize) with the reciprocal, within [lower, upper], NaN to lower.
+  int tileOf(float x, float origin, float invTileSize, float lower, float upper)
+  {
+    float t = (x - origin) * invTileSize;
+    t = t > lower ? t : lower;
+    return int(std::floor(t < upper ? t : upper));
+  }
+
+  // Tiles of each box as documented, built tile by tile.
+  bool matchesEveryTile(const TileBins& bins, const std::vector<BBox2f>& bboxes)
+  {
+    std::vector<Vec4i> ranges;
+    for (const BBox2f& b : bboxes) {
+      Vec4i r;
+      r.x = tileOf(b.min.x, bins.origin.x, bins.invTileSize.x, 0.f, float(bins.columns));
+      r.y = tileOf(b.min.y, bins.origin.y, bins.invTileSize.y, 0.f, float(bins.rows));
+      r.z = tileOf(b.max.x, bins.origin.x, bins.invTileSize.x, -1.f, float(bins.columns) - 1.f);
+      r.w = tileOf(b.max.y, bins.origin.y, bins.invTileSize.y, -1.f, float(bins.rows) - 1.f);
+      if (isEmpty(b)) r = makeVec4i(0, 0, -1, -1);
+      Vec4i g = getTileRange(bins, b);
+      if (!isEmpty(b) && (g.x != r.x || g.y != r.y || g.z != r.z || g.w != r.w)) return false;
+      ranges.push_back(r);
+    }
+
+    std::vector<uint32_t> tileStart(1, 0), items;
+    for (int y = 0; y < int(bins.rows); y++) {
+      for (int x = 0; x < int(bins.columns); x++) {
+        for (size_t i = 0; i < bboxes.size(); i++) {
+          const Vec4i& r = ranges[i];
+          if (r.x <= x && x <= r.z && r.y <= y && y <= r.w) items.push_back(uint32_t(i));
+        }
+        tileStart.push_back(uint32_t(items.size()));
+      }
+    }
+    return sameBytes(tileStart, bins.tileStart) && sameBytes(items, bins.items);
+  }
+
+  // Every box overlapping the inside of a tile is in it, and every box in a
+  // tile overlaps it, for tile sizes whose reciprocal is exact.
+  bool coversTiles(const TileBins& bins, const std::vector<BBox2f>& bboxes)
+  {
+    for (uint32_t y = 0; y < bins.rows; y++) {
+      for (uint32_t x = 0; x < bins.columns; x++) {
+        Vec2f min = bins.origin + makeVec2f(float(x) * bins.tileSize.x, float(y) * bins.tileSize.y);
+        BBox2f tile = makeBBox(min, min + bins.tileSize);
+        uint32_t t = y * bins.columns + x;
+        std::vector<uint8_t> listed(bboxes.size(), 0);
+        for (uint32_t j = bins.tileStart[t]; j < bins.tileStart[t + 1]; j++) {
+          if (!isOverlapping(tile, bboxes[bins.items[j]])) return false;
+          listed[bins.items[j]] = 1;
+        }
+        for (size_t i = 0; i < bboxes.size(); i++) {
+          const BBox2f& b = bboxes[i];
+          bool inside = b.min.x < tile.max.x && tile.min.x < b.max.x && b.min.y < tile.max.y && tile.min.y < b.max.y;
+          if (inside && !listed[i]) return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Boxes of all sizes, partly or wholly outside the grid, with corners on
+  // tile edges, points, empty boxes and NaN.
+  std::vector<BBox2f> makeBoxes(size_t N, const Vec2f& origin, const Vec2f& tileSize, uint32_t columns, uint32_t rows)
+  {
+    Vec2f size = makeVec2f(tileSize.x * float(columns), tileSize.y * float(rows));
+    std::vector<BBox2f> bboxes(N);
+    for (size_t i = 0; i < N; i++) {
+      Vec2f a = origin + makeVec2f(random(-0.2f, 1.2f) * size.x, random(-0.2f, 1.2f) * size.y);
+      float s = i % 10 ? 2.f : 0.5f * size.x;
+      BBox2f& b = bboxes[i];
+      b = makeBBox(a, a + makeVec2f(random(0.f, s * tileSize.x), random(0.f, s * tileSize.y)));
+      if (i % 7 == 1) b.min = origin + makeVec2f(float(int(random(0.f, float(columns)))) * tileSize.x, float(int(random(0.f, float(rows)))) * tileSize.y);
+      if (i % 7 == 2) b.max = origin + makeVec2f(float(int(random(0.f, float(columns)))) * tileSize.x, float(int(random(0.f, float(rows)))) * tileSize.y);
+      if (i % 7 == 1 && isEmpty(b)) b.max = b.min;
+      if (i % 7 == 2 && isEmpty(b)) b.min = b.max;
+      if (i % 19 == 3) b = makeEmptyBBox2f();
+      if (i % 23 == 4) b.max.x = NAN;
+    }
+    bboxes.push_back(makeBBox(origin - size, origin + 2.f * size));
+    return bboxes;
+  }
+
+}
+
+
+void checkTileBins()
+{
+  setCheckSection("TileBins");
+
+  bool ok = true, covered = true;
+  for (size_t N : { 0, 1, 2, 500, 5000 }) {
+    TileBins bins;
+    Vec2f origin = makeVec2f(-100.f, 30.f);
+    std::vector<BBox2f> bboxes = makeBoxes(N, origin, makeVec2f(8.f, 4.f), 25, 13);
+    build(bins, bboxes.data(), bboxes.size(), origin, makeVec2f(8.f, 4.f), 25, 13, 1);
+    ok = ok && matchesEveryTile(bins, bboxes);
+    covered = covered && coversTiles(bins, bboxes);
+
+    bboxes = makeBoxes(N, origin, makeVec2f(7.3f, 3.1f), 17, 9);
+    build(bins, bboxes.data(), bboxes.size(), origin, makeVec2f(7.3f, 3.1f), 17, 9, 0);
+    ok = ok && matchesEveryTile(bins, bboxes);
+  }
+  check(ok, "build and getTileRange");
+  check(covered, "boxes overlapping each tile");
+
+  // Large enough that the count and scatter split into several tasks.
+  const size_t M = 300000;
+  std::vector<BBox2f> bboxes(M);
+  for (BBox2f& b : bboxes) {
+    Vec2f a = randomVec2f(-100.f, 100.f);
+    b = makeBBox(a, a + randomVec2f(0.f, 2.f));
+  }
+  TileBins bins1, binsN;
+  build(bins1, bboxes.data(), M, makeVec2f(-100.f), makeVec2f(8.f), 25, 25, 1);
+  build(binsN, bboxes.data(), M, makeVec2f(-100.f), makeVec2f(8.f), 25, 25, 0);
+  check(sameBytes(bins1.tileStart, binsN.tileStart) && sameBytes(bins1.items, binsN.items), "build on several threads");
+}